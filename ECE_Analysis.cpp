@@ -0,0 +1,504 @@
+/*
+
+Objective:
+Streaming engine analysis definition file
+*/
+
+#include "ECE_Analysis.hpp"
+#include <cstring>
+#include <iostream>
+
+// Triple buffer index bits of "middle": slot number and the fresh flag
+const unsigned int ANALYSIS_INDEX_MASK = 3;
+const unsigned int ANALYSIS_FRESH = 4;
+
+// Start of the next token
+// Inputs: scan position, line end, set to the end of the token
+// Output: token start (end if none)
+static const char* nextToken(const char* it, const char* end, const char*& tokenLast)
+{
+    while (it < end && (*it == ' ' || *it == '\t'))
+    {
+        it++;
+    }
+    tokenLast = it;
+    while (tokenLast < end && *tokenLast != ' ' && *tokenLast != '\t')
+    {
+        tokenLast++;
+    }
+    return it;
+}
+
+// Compare a token with a keyword
+// Inputs: token start and end, keyword
+// Output: true if equal
+static bool tokenIs(const char* token, const char* tokenLast, const char* word)
+{
+    size_t length = std::strlen(word);
+    return static_cast<size_t>(tokenLast - token) == length && std::memcmp(token, word, length) == 0;
+}
+
+// Decimal value of a token (digits after the first non-digit are ignored)
+// Inputs: token start and end
+// Output: value
+static long long tokenNumber(const char* token, const char* tokenLast)
+{
+    bool negative = token < tokenLast && *token == '-';
+    if (negative)
+    {
+        token++;
+    }
+    long long value = 0;
+    while (token < tokenLast && *token >= '0' && *token <= '9')
+    {
+        value = value * 10 + (*token - '0');
+        token++;
+    }
+    return negative ? -value : value;
+}
+
+// Empty a snapshot for a new search
+// Inputs: snapshot, position identifier, side to move
+// Output: None
+static void resetSnapshot(analysisSnapshotT& snapshot, unsigned long long positionId, bool whiteToMove)
+{
+    snapshot.positionId = positionId;
+    snapshot.whiteToMove = whiteToMove;
+    snapshot.lineCount = 0;
+    snapshot.depth = 0;
+    snapshot.nodes = 0;
+    snapshot.nps = 0;
+    snapshot.timeMs = 0;
+    snapshot.hashfull = 0;
+    for (unsigned int it = 0; it < ANALYSIS_MAX_DEPTH; it++)
+    {
+        snapshot.depthTimeMs[it] = -1;
+    }
+    snapshot.linesVersion++;
+}
+
+// Parse a UCI "info" line in place
+// Inputs: line start and end (no terminator needed), fields to fill
+// Output: false if not an info line
+bool parseInfoLine(const char* begin, const char* end, engineInfoT& info)
+{
+    info = { 0, 0, 0, false, false, 0, BOUND_EXACT, -1, -1, -1, -1, nullptr, nullptr };
+    const char* tokenLast;
+    const char* token = nextToken(begin, end, tokenLast);
+    if (!tokenIs(token, tokenLast, "info"))
+    {
+        return false;
+    }
+
+    token = nextToken(tokenLast, end, tokenLast);
+    while (token < end)
+    {
+        // Free text and move lists run to the end of the line
+        if (tokenIs(token, tokenLast, "string") || tokenIs(token, tokenLast, "refutation") ||
+            tokenIs(token, tokenLast, "currline"))
+        {
+            break;
+        }
+        if (tokenIs(token, tokenLast, "pv"))
+        {
+            info.pv = tokenLast;
+            info.pvEnd = end;
+            break;
+        }
+        // Bound flags stand alone after the score
+        if (tokenIs(token, tokenLast, "lowerbound") || tokenIs(token, tokenLast, "upperbound"))
+        {
+            info.bound = token[0] == 'l' ? BOUND_LOWER : BOUND_UPPER;
+            token = nextToken(tokenLast, end, tokenLast);
+            continue;
+        }
+
+        // Everything else is a key followed by one value
+        const char* valueLast;
+        const char* value = nextToken(tokenLast, end, valueLast);
+        if (tokenIs(token, tokenLast, "score"))
+        {
+            // "score cp 25" / "score mate -3": the kind, then the value
+            const char* scoreLast;
+            const char* score = nextToken(valueLast, end, scoreLast);
+            info.hasScore = true;
+            info.isMate = tokenIs(value, valueLast, "mate");
+            info.score = static_cast<int>(tokenNumber(score, scoreLast));
+            valueLast = scoreLast;
+        }
+        else if (tokenIs(token, tokenLast, "depth"))
+        {
+            info.depth = static_cast<int>(tokenNumber(value, valueLast));
+        }
+        else if (tokenIs(token, tokenLast, "seldepth"))
+        {
+            info.selDepth = static_cast<int>(tokenNumber(value, valueLast));
+        }
+        else if (tokenIs(token, tokenLast, "multipv"))
+        {
+            info.multiPv = static_cast<int>(tokenNumber(value, valueLast));
+        }
+        else if (tokenIs(token, tokenLast, "nodes"))
+        {
+            info.nodes = tokenNumber(value, valueLast);
+        }
+        else if (tokenIs(token, tokenLast, "nps"))
+        {
+            info.nps = tokenNumber(value, valueLast);
+        }
+        else if (tokenIs(token, tokenLast, "time"))
+        {
+            info.timeMs = tokenNumber(value, valueLast);
+        }
+        else if (tokenIs(token, tokenLast, "hashfull"))
+        {
+            info.hashfull = static_cast<int>(tokenNumber(value, valueLast));
+        }
+        // Other keys (currmove, tbhits, cpuload, ...) are skipped with their value
+        token = nextToken(valueLast, end, tokenLast);
+    }
+    return true;
+}
+
+// Constructor function
+engineAnalysis::engineAnalysis()
+    : middle(2), requestedId(0), requestedWhite(true), stopsPending(0), infoLines(0)
+{
+    working.sequence = 0;
+    working.linesVersion = 0;
+    resetSnapshot(working, 0, true);
+    for (unsigned int it = 0; it < 3; it++)
+    {
+        buffers[it] = working;
+    }
+}
+
+// Destructor function
+engineAnalysis::~engineAnalysis()
+{
+    close();
+}
+
+// Start the analysis engine
+// Inputs: engine executable
+// Output: true if running
+bool engineAnalysis::start(const std::string& enginePath)
+{
+    if (hProcess != NULL)
+    {
+        return true;
+    }
+    SECURITY_ATTRIBUTES sa = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+    HANDLE hStdoutWrite = NULL;
+    HANDLE hStdinRead = NULL;
+    if (!CreatePipe(&hStdoutRead, &hStdoutWrite, &sa, 0) || !CreatePipe(&hStdinRead, &hStdinWrite, &sa, 0))
+    {
+        if (hStdoutWrite != NULL) CloseHandle(hStdoutWrite);
+        close();
+        return false;
+    }
+    // Our ends stay in this process
+    SetHandleInformation(hStdoutRead, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(hStdinWrite, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFO si = { sizeof(STARTUPINFO) };
+    PROCESS_INFORMATION pi;
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = hStdinRead;
+    si.hStdOutput = hStdoutWrite;
+    si.hStdError = hStdoutWrite;
+
+    std::string commandLine = enginePath;
+    BOOL started = CreateProcess(NULL, &commandLine[0], NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi);
+    // The child holds its own copies, closing ours ends the reader when it exits
+    CloseHandle(hStdoutWrite);
+    CloseHandle(hStdinRead);
+    if (!started)
+    {
+        std::cerr << "Analysis: failed to start " << enginePath << std::endl;
+        close();
+        return false;
+    }
+    hProcess = pi.hProcess;
+    CloseHandle(pi.hThread);
+
+    lineLength = 0;
+    lineOverflow = false;
+    stopsPending = 0;
+    searching = false;
+    sentMultiPv = 0;
+    reader = std::thread(&engineAnalysis::readLoop, this);
+
+    writeLine("uci");
+    writeLine("isready");
+    return true;
+}
+
+// Quit the engine and join the reader
+// Inputs: None
+// Output: None
+void engineAnalysis::close()
+{
+    if (hProcess != NULL)
+    {
+        writeLine("stop");
+        writeLine("quit");
+        if (WaitForSingleObject(hProcess, 2000) == WAIT_TIMEOUT)
+        {
+            TerminateProcess(hProcess, 1);
+        }
+        CloseHandle(hProcess);
+        hProcess = NULL;
+    }
+    // The pipe breaks with the process gone
+    if (reader.joinable())
+    {
+        reader.join();
+    }
+    if (hStdoutRead != NULL)
+    {
+        CloseHandle(hStdoutRead);
+        hStdoutRead = NULL;
+    }
+    if (hStdinWrite != NULL)
+    {
+        CloseHandle(hStdinWrite);
+        hStdinWrite = NULL;
+    }
+    searching = false;
+}
+
+// Check if the engine process is up
+// Inputs: None
+// Output: true if started
+bool engineAnalysis::isRunning() const
+{
+    return hProcess != NULL;
+}
+
+// Lines searched per position (takes effect on the next analyze)
+// Inputs: MultiPV count (clamped to 1..ANALYSIS_MAX_PV)
+// Output: None
+void engineAnalysis::setMultiPv(unsigned int count)
+{
+    multiPv = count < 1 ? 1 : (count > ANALYSIS_MAX_PV ? ANALYSIS_MAX_PV : count);
+}
+
+// Get the MultiPV count
+// Inputs: None
+// Output: lines searched
+unsigned int engineAnalysis::getMultiPv() const
+{
+    return multiPv;
+}
+
+// Stop the current search and analyze a position until told otherwise
+// Inputs: engine "position" command, its identifier, side to move (true for white)
+// Output: true if the commands were written
+bool engineAnalysis::analyze(const std::string& positionCommand, unsigned long long positionId, bool whiteToMove)
+{
+    if (hProcess == NULL)
+    {
+        return false;
+    }
+    stop();
+    // Engines take options between searches, the stop above is queued first
+    if (multiPv != sentMultiPv)
+    {
+        writeLine("setoption name MultiPV value " + std::to_string(multiPv));
+        sentMultiPv = multiPv;
+    }
+    // Side first: the reader picks both up once it sees the new identifier
+    requestedWhite = whiteToMove;
+    requestedId = positionId;
+    searching = writeLine(positionCommand) && writeLine("go infinite");
+    return searching;
+}
+
+// Stop searching (the last lines stay published)
+// Inputs: None
+// Output: None
+void engineAnalysis::stop()
+{
+    if (!searching)
+    {
+        return;
+    }
+    // Counted before the write so no line of the old search slips through
+    stopsPending++;
+    writeLine("stop");
+    searching = false;
+}
+
+// Latest published lines (render thread only, never blocks)
+// Inputs: None
+// Output: snapshot valid until the next call
+const analysisSnapshotT& engineAnalysis::latest()
+{
+    if (middle.load(std::memory_order_acquire) & ANALYSIS_FRESH)
+    {
+        front = middle.exchange(front, std::memory_order_acq_rel) & ANALYSIS_INDEX_MASK;
+    }
+    return buffers[front];
+}
+
+// Info lines parsed since start
+// Inputs: None
+// Output: count
+unsigned long long engineAnalysis::getInfoLines() const
+{
+    return infoLines.load();
+}
+
+// Write one command line to the engine
+// Inputs: command
+// Output: true if written
+bool engineAnalysis::writeLine(const std::string& line)
+{
+    if (hStdinWrite == NULL)
+    {
+        return false;
+    }
+    std::string text = line + "\n";
+    DWORD written = 0;
+    return WriteFile(hStdinWrite, text.c_str(), static_cast<DWORD>(text.size()), &written, NULL) && written == text.size();
+}
+
+// Read the engine output until the pipe closes
+// Inputs: None
+// Output: None
+void engineAnalysis::readLoop()
+{
+    char chunk[4096];
+    DWORD read = 0;
+    while (ReadFile(hStdoutRead, chunk, sizeof(chunk), &read, NULL) && read > 0)
+    {
+        const char* it = chunk;
+        const char* chunkEnd = chunk + read;
+        while (it < chunkEnd)
+        {
+            const char* newline = static_cast<const char*>(std::memchr(it, '\n', chunkEnd - it));
+            const char* pieceEnd = newline ? newline : chunkEnd;
+            size_t length = pieceEnd - it;
+
+            if (newline && lineLength == 0)
+            {
+                // Whole line inside the chunk: parsed where it lies
+                processLine(it, (length > 0 && it[length - 1] == '\r') ? pieceEnd - 1 : pieceEnd);
+            }
+            else
+            {
+                // Line split across reads: gathered in the line buffer
+                if (!lineOverflow && lineLength + length <= ANALYSIS_LINE_MAX)
+                {
+                    std::memcpy(lineBuffer + lineLength, it, length);
+                    lineLength += length;
+                }
+                else
+                {
+                    lineOverflow = true;
+                }
+                if (newline)
+                {
+                    if (!lineOverflow)
+                    {
+                        size_t lineEnd = (lineLength > 0 && lineBuffer[lineLength - 1] == '\r') ? lineLength - 1 : lineLength;
+                        processLine(lineBuffer, lineBuffer + lineEnd);
+                    }
+                    lineLength = 0;
+                    lineOverflow = false;
+                }
+            }
+            it = newline ? newline + 1 : chunkEnd;
+        }
+    }
+}
+
+// Handle one complete output line
+// Inputs: line start and end
+// Output: None
+void engineAnalysis::processLine(const char* begin, const char* end)
+{
+    // The bestmove of a stopped search closes its stream
+    if (end - begin >= 8 && std::memcmp(begin, "bestmove", 8) == 0)
+    {
+        if (stopsPending.load() > 0)
+        {
+            stopsPending--;
+        }
+        return;
+    }
+    engineInfoT info;
+    if (!parseInfoLine(begin, end, info) || stopsPending.load() > 0)
+    {
+        return;
+    }
+    infoLines++;
+
+    // First line of a new search
+    unsigned long long positionId = requestedId.load();
+    if (working.positionId != positionId)
+    {
+        resetSnapshot(working, positionId, requestedWhite.load());
+        searchStart = std::chrono::steady_clock::now();
+    }
+
+    // Throughput comes with most lines, currmove updates included
+    long long elapsedMs = info.timeMs >= 0 ? info.timeMs :
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - searchStart).count();
+    working.timeMs = elapsedMs;
+    if (info.nodes >= 0) working.nodes = info.nodes;
+    if (info.nps >= 0) working.nps = info.nps;
+    if (info.hashfull >= 0) working.hashfull = info.hashfull;
+    if (info.depth > working.depth)
+    {
+        working.depth = info.depth;
+    }
+    if (info.depth > 0 && info.depth < static_cast<int>(ANALYSIS_MAX_DEPTH) && working.depthTimeMs[info.depth] < 0)
+    {
+        working.depthTimeMs[info.depth] = elapsedMs;
+    }
+
+    // Variation update (engines without MultiPV leave the index out)
+    int index = (info.multiPv > 0 ? info.multiPv : 1) - 1;
+    if (info.hasScore && info.pv != nullptr && index < static_cast<int>(ANALYSIS_MAX_PV))
+    {
+        analysisLineT& line = working.lines[index];
+        line.depth = info.depth;
+        line.selDepth = info.selDepth;
+        line.score = info.score;
+        line.isMate = info.isMate;
+        line.bound = info.bound;
+        line.moveCount = 0;
+        const char* moveLast;
+        const char* move = nextToken(info.pv, info.pvEnd, moveLast);
+        while (move < info.pvEnd && line.moveCount < ANALYSIS_PV_MOVES)
+        {
+            size_t length = moveLast - move;
+            if (length > 5)
+            {
+                break;
+            }
+            std::memcpy(line.moves[line.moveCount], move, length);
+            line.moves[line.moveCount][length] = '\0';
+            line.moveCount++;
+            move = nextToken(moveLast, info.pvEnd, moveLast);
+        }
+        if (static_cast<unsigned int>(index) >= working.lineCount)
+        {
+            working.lineCount = index + 1;
+        }
+        working.linesVersion++;
+    }
+    publish();
+}
+
+// Copy the working snapshot out to the render thread
+// Inputs: None
+// Output: None
+void engineAnalysis::publish()
+{
+    working.sequence++;
+    buffers[back] = working;
+    back = middle.exchange(back | ANALYSIS_FRESH, std::memory_order_acq_rel) & ANALYSIS_INDEX_MASK;
+}
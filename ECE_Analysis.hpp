@@ -0,0 +1,183 @@
+/*
+
+Objective:
+Streaming MultiPV analysis on a second engine process. Info lines are
+parsed in place as they arrive, and the latest top lines are published
+through a lock-free triple buffer that the renderer reads every frame.
+*/
+
+#ifndef ECE_ANALYSIS_HPP
+#define ECE_ANALYSIS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <windows.h>
+
+// Principal variations kept (MultiPV is clamped to this)
+const unsigned int ANALYSIS_MAX_PV = 8;
+// MultiPV when analysis is switched on
+const unsigned int ANALYSIS_DEFAULT_PV = 3;
+// Moves kept per variation (the rest of the line is skipped)
+const unsigned int ANALYSIS_PV_MOVES = 12;
+// Depths tracked in the depth-over-time table
+const unsigned int ANALYSIS_MAX_DEPTH = 128;
+// Longest engine line accepted (longer ones are dropped whole)
+const unsigned int ANALYSIS_LINE_MAX = 4096;
+
+// Score bound of an info line
+const int BOUND_EXACT = 0;
+const int BOUND_LOWER = 1;
+const int BOUND_UPPER = -1;
+
+// Fields of one "info" line; the variation points into the line (nothing is copied)
+typedef struct
+{
+    int depth;
+    int selDepth;
+    int multiPv;
+    bool hasScore;
+    bool isMate;
+    int score;
+    int bound;
+    long long nodes;
+    long long nps;
+    long long timeMs;
+    int hashfull;
+    const char* pv;
+    const char* pvEnd;
+} engineInfoT;
+
+// One ranked variation
+typedef struct
+{
+    int depth;
+    int selDepth;
+    // Centipawns, or moves to mate when isMate (side to move's view)
+    int score;
+    bool isMate;
+    int bound;
+    unsigned int moveCount;
+    char moves[ANALYSIS_PV_MOVES][6];
+} analysisLineT;
+
+// Everything the renderer and the metrics need, copied whole on publish
+typedef struct
+{
+    // Position the lines belong to (see engineAnalysis::analyze)
+    unsigned long long positionId;
+    bool whiteToMove;
+    unsigned int lineCount;
+    analysisLineT lines[ANALYSIS_MAX_PV];
+    // Live engine throughput
+    int depth;
+    long long nodes;
+    long long nps;
+    long long timeMs;
+    int hashfull;
+    // Search time when each depth was first reported (-1 if not reached)
+    long long depthTimeMs[ANALYSIS_MAX_DEPTH];
+    // Bumped on every publish, and when a variation changed
+    unsigned long long sequence;
+    unsigned long long linesVersion;
+} analysisSnapshotT;
+
+// Parse a UCI "info" line in place
+// Inputs: line start and end (no terminator needed), fields to fill
+// Output: false if not an info line
+bool parseInfoLine(const char* begin, const char* end, engineInfoT& info);
+
+class engineAnalysis
+{
+private:
+    HANDLE hProcess = NULL;
+    HANDLE hStdinWrite = NULL;
+    HANDLE hStdoutRead = NULL;
+    std::thread reader;
+    unsigned int multiPv = ANALYSIS_DEFAULT_PV;
+    unsigned int sentMultiPv = 0;
+    bool searching = false;
+
+    // Triple buffer: the reader thread fills back and swaps it with middle,
+    // the render thread swaps front with middle when the fresh bit is set
+    analysisSnapshotT buffers[3];
+    std::atomic<unsigned int> middle;
+    unsigned int back = 1;
+    unsigned int front = 0;
+
+    // Reader thread state
+    analysisSnapshotT working;
+    char lineBuffer[ANALYSIS_LINE_MAX];
+    size_t lineLength = 0;
+    bool lineOverflow = false;
+    std::chrono::steady_clock::time_point searchStart;
+
+    // Search the reader should collect (set before "go" is written)
+    std::atomic<unsigned long long> requestedId;
+    std::atomic<bool> requestedWhite;
+    // Stopped searches whose bestmove has not arrived (their info lines are dropped)
+    std::atomic<unsigned int> stopsPending;
+    std::atomic<unsigned long long> infoLines;
+
+    // Write one command line to the engine
+    // Inputs: command
+    // Output: true if written
+    bool writeLine(const std::string& line);
+    // Read the engine output until the pipe closes
+    // Inputs: None
+    // Output: None
+    void readLoop();
+    // Handle one complete output line
+    // Inputs: line start and end
+    // Output: None
+    void processLine(const char* begin, const char* end);
+    // Copy the working snapshot out to the render thread
+    // Inputs: None
+    // Output: None
+    void publish();
+
+public:
+    // Constructor function
+    engineAnalysis();
+    // Destructor function
+    ~engineAnalysis();
+    // Start the analysis engine
+    // Inputs: engine executable
+    // Output: true if running
+    bool start(const std::string& enginePath);
+    // Quit the engine and join the reader
+    // Inputs: None
+    // Output: None
+    void close();
+    // Check if the engine process is up
+    // Inputs: None
+    // Output: true if started
+    bool isRunning() const;
+    // Lines searched per position (takes effect on the next analyze)
+    // Inputs: MultiPV count (clamped to 1..ANALYSIS_MAX_PV)
+    // Output: None
+    void setMultiPv(unsigned int count);
+    // Get the MultiPV count
+    // Inputs: None
+    // Output: lines searched
+    unsigned int getMultiPv() const;
+    // Stop the current search and analyze a position until told otherwise
+    // Inputs: engine "position" command, its identifier, side to move (true for white)
+    // Output: true if the commands were written
+    bool analyze(const std::string& positionCommand, unsigned long long positionId, bool whiteToMove);
+    // Stop searching (the last lines stay published)
+    // Inputs: None
+    // Output: None
+    void stop();
+    // Latest published lines (render thread only, never blocks)
+    // Inputs: None
+    // Output: snapshot valid until the next call
+    const analysisSnapshotT& latest();
+    // Info lines parsed since start
+    // Inputs: None
+    // Output: count
+    unsigned long long getInfoLines() const;
+};
+
+#endif
@@ -0,0 +1,729 @@
+/*
+
+Objective:
+Spectator broadcast definition file
+*/
+
+// Winsock 2 before anything that pulls in windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "ECE_Broadcast.hpp"
+#include "ECE_CommandLine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+// Close a socket and mark it closed
+// Inputs: socket
+// Output: None
+static void closeSocket(uintptr_t& socketHandle)
+{
+    if (static_cast<SOCKET>(socketHandle) != INVALID_SOCKET)
+    {
+        closesocket(static_cast<SOCKET>(socketHandle));
+        socketHandle = static_cast<uintptr_t>(INVALID_SOCKET);
+    }
+}
+
+// Switch a socket to non-blocking mode
+// Inputs: socket
+// Output: true if switched
+static bool setNonBlocking(SOCKET socketHandle)
+{
+    unsigned long enable = 1;
+    return ioctlsocket(socketHandle, FIONBIO, &enable) == 0;
+}
+
+// Loopback address
+// Inputs: port
+// Output: address
+static sockaddr_in loopbackAddress(unsigned short port)
+{
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    return address;
+}
+
+// Constructor function
+broadcastServer::broadcastServer()
+    : listenSocket(static_cast<uintptr_t>(INVALID_SOCKET)), wakeSocket(static_cast<uintptr_t>(INVALID_SOCKET)),
+      running(false), wakePending(false)
+{
+    stats = { 0, 0, 0, 0, 0, 0 };
+}
+
+// destructor function
+broadcastServer::~broadcastServer()
+{
+    stop();
+}
+
+// Listen on 127.0.0.1 and start the poll loop
+// Inputs: TCP port (0 picks a free one), board to start from
+// Output: true if listening
+bool broadcastServer::start(unsigned short cPort, const chessPosition& position)
+{
+    stop();
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        std::cerr << "Broadcast: Winsock unavailable" << std::endl;
+        return false;
+    }
+
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address = loopbackAddress(cPort);
+    socklen_t addressLength = sizeof(address);
+    // Datagram socket connected to itself, readable whenever a publish wants the loop
+    SOCKET waker = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in wakeAddress = loopbackAddress(0);
+    socklen_t wakeLength = sizeof(wakeAddress);
+    listenSocket = static_cast<uintptr_t>(listener);
+    wakeSocket = static_cast<uintptr_t>(waker);
+    if (listener == INVALID_SOCKET || waker == INVALID_SOCKET ||
+        bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0 || !setNonBlocking(listener) ||
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0 ||
+        bind(waker, reinterpret_cast<sockaddr*>(&wakeAddress), sizeof(wakeAddress)) != 0 ||
+        getsockname(waker, reinterpret_cast<sockaddr*>(&wakeAddress), &wakeLength) != 0 ||
+        ::connect(waker, reinterpret_cast<sockaddr*>(&wakeAddress), sizeof(wakeAddress)) != 0 || !setNonBlocking(waker))
+    {
+        std::cerr << "Broadcast: can not listen on port " << cPort << std::endl;
+        closeSocket(listenSocket);
+        closeSocket(wakeSocket);
+        WSACleanup();
+        return false;
+    }
+    port = ntohs(address.sin_port);
+
+    current = position;
+    stream.clear();
+    streamBase = 0;
+    sequence = 0;
+    stats = { 0, 0, 0, 0, 0, 0 };
+    wakePending = false;
+    running = true;
+    loop = std::thread(&broadcastServer::run, this);
+    return true;
+}
+
+// Close every connection and stop the loop
+// Inputs: None
+// Output: None
+void broadcastServer::stop()
+{
+    if (!running)
+    {
+        return;
+    }
+    running = false;
+    wakePending = false;
+    wake();
+    loop.join();
+    for (broadcastSubscriberT& subscriber : subscribers)
+    {
+        closeSocket(subscriber.socket);
+    }
+    subscribers.clear();
+    closeSocket(listenSocket);
+    closeSocket(wakeSocket);
+    WSACleanup();
+}
+
+// Check if the server is up
+// Inputs: None
+// Output: true if listening
+bool broadcastServer::isRunning() const
+{
+    return running;
+}
+
+// Get the port listened on
+// Inputs: None
+// Output: port
+unsigned short broadcastServer::getPort() const
+{
+    return port;
+}
+
+// Wake the poll loop once per batch of publishes
+// Inputs: None
+// Output: None
+void broadcastServer::wake()
+{
+    if (!wakePending.exchange(true))
+    {
+        char signal = 0;
+        send(static_cast<SOCKET>(wakeSocket), &signal, 1, 0);
+    }
+}
+
+// Append a frame (streamMutex held)
+// Inputs: type, payload, payload size
+// Output: None
+void broadcastServer::appendFrame(uint8_t type, const void* payload, uint16_t length)
+{
+    broadcastHeaderT header = { type, 0, length, sequence++ };
+    const unsigned char* headerBytes = reinterpret_cast<const unsigned char*>(&header);
+    const unsigned char* payloadBytes = static_cast<const unsigned char*>(payload);
+    stream.insert(stream.end(), headerBytes, headerBytes + sizeof(header));
+    stream.insert(stream.end(), payloadBytes, payloadBytes + length);
+    stats.framesPublished++;
+}
+
+// Snapshot frame of the current board (streamMutex held)
+// Inputs: bytes to append it to
+// Output: None
+void broadcastServer::snapshotFrame(std::vector<unsigned char>& bytes)
+{
+    // A private snapshot carries the sequence of the next stream frame
+    broadcastHeaderT header = { BROADCAST_SNAPSHOT, 0, sizeof(recordKeyframeT), sequence };
+    recordKeyframeT keyframe;
+    std::memset(&keyframe, 0, sizeof(keyframe));
+    keyframe.kind = RECORD_KEYFRAME;
+    packKeyframe(current, keyframe);
+    const unsigned char* headerBytes = reinterpret_cast<const unsigned char*>(&header);
+    const unsigned char* keyframeBytes = reinterpret_cast<const unsigned char*>(&keyframe);
+    bytes.insert(bytes.end(), headerBytes, headerBytes + sizeof(header));
+    bytes.insert(bytes.end(), keyframeBytes, keyframeBytes + sizeof(keyframe));
+}
+
+// Publish a whole board (new game, undo, jump)
+// Inputs: position
+// Output: None
+void broadcastServer::publishPosition(const chessPosition& position)
+{
+    if (!running)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        current = position;
+        std::vector<unsigned char> frame;
+        snapshotFrame(frame);
+        // Numbered like any other stream frame
+        reinterpret_cast<broadcastHeaderT*>(frame.data())->sequence = sequence++;
+        stream.insert(stream.end(), frame.begin(), frame.end());
+        stats.framesPublished++;
+    }
+    wake();
+}
+
+// Publish a move delta
+// Inputs: move, position after it, RECORD_BY_*
+// Output: None
+void broadcastServer::publishMove(chessMove move, const chessPosition& position, uint8_t source)
+{
+    if (!running)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        // The board before the move tells what was taken (en passant included)
+        broadcastMoveT delta = { move, current.pieceAt(moveTo(move)), source };
+        unsigned char mover = current.pieceAt(moveFrom(move));
+        if (delta.captured == PIECE_NONE && (mover & PIECE_TYPE_MASK) == PIECE_PAWN && fileOf(moveFrom(move)) != fileOf(moveTo(move)))
+        {
+            delta.captured = PIECE_PAWN | ((mover & PIECE_BLACK) ^ PIECE_BLACK);
+        }
+        current = position;
+        appendFrame(BROADCAST_MOVE, &delta, sizeof(delta));
+    }
+    wake();
+}
+
+// Publish the engine lines of the board position
+// Inputs: analysis snapshot
+// Output: None
+void broadcastServer::publishAnalysis(const analysisSnapshotT& snapshot)
+{
+    if (!running)
+    {
+        return;
+    }
+    broadcastAnalysisT analysis;
+    std::memset(&analysis, 0, sizeof(analysis));
+    analysis.whiteToMove = snapshot.whiteToMove ? 1 : 0;
+    analysis.lineCount = static_cast<uint8_t>((std::min)(snapshot.lineCount, BROADCAST_MAX_PV));
+    for (unsigned int it = 0; it < analysis.lineCount; it++)
+    {
+        const analysisLineT& line = snapshot.lines[it];
+        analysis.lines[it].score = static_cast<int16_t>((std::max)(-32767, (std::min)(32767, line.score)));
+        analysis.lines[it].move = line.moveCount > 0 ? uciToMove(line.moves[0]) : NO_MOVE;
+        analysis.lines[it].isMate = line.isMate ? 1 : 0;
+        analysis.lines[it].depth = static_cast<uint8_t>((std::max)(0, (std::min)(255, line.depth)));
+    }
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        appendFrame(BROADCAST_ANALYSIS, &analysis, sizeof(analysis));
+    }
+    wake();
+}
+
+// Send what a subscriber is owed, batched into as few calls as the socket takes
+// Inputs: subscriber
+// Output: false if the connection is gone
+bool broadcastServer::flushSubscriber(broadcastSubscriberT& subscriber)
+{
+    std::lock_guard<std::mutex> lock(streamMutex);
+    SOCKET socketHandle = static_cast<SOCKET>(subscriber.socket);
+    while (subscriber.ownSent < subscriber.own.size())
+    {
+        int sent = send(socketHandle, reinterpret_cast<const char*>(subscriber.own.data() + subscriber.ownSent),
+                        static_cast<int>(subscriber.own.size() - subscriber.ownSent), 0);
+        if (sent == SOCKET_ERROR)
+        {
+            return WSAGetLastError() == WSAEWOULDBLOCK;
+        }
+        subscriber.ownSent += sent;
+        stats.bytesSent += sent;
+        stats.sendCalls++;
+    }
+    subscriber.own.clear();
+    subscriber.ownSent = 0;
+
+    // Everything queued since the last call goes in one send
+    unsigned long long end = streamBase + stream.size();
+    if (subscriber.sent < end)
+    {
+        int length = static_cast<int>((std::min<unsigned long long>)(end - subscriber.sent, INT_MAX));
+        int sent = send(socketHandle, reinterpret_cast<const char*>(stream.data() + (subscriber.sent - streamBase)), length, 0);
+        if (sent == SOCKET_ERROR)
+        {
+            return WSAGetLastError() == WSAEWOULDBLOCK;
+        }
+        subscriber.sent += sent;
+        stats.bytesSent += sent;
+        stats.sendCalls++;
+        // Follow the frame boundaries, a cut over must finish the frame in flight
+        while (subscriber.frameEnd < subscriber.sent)
+        {
+            const broadcastHeaderT* header = reinterpret_cast<const broadcastHeaderT*>(stream.data() + (subscriber.frameEnd - streamBase));
+            subscriber.frameEnd += sizeof(broadcastHeaderT) + header->length;
+        }
+    }
+    return true;
+}
+
+// Poll loop: accepts, fans out, cuts over laggards, trims the stream
+// Inputs: None
+// Output: None
+void broadcastServer::run()
+{
+    std::vector<WSAPOLLFD> fds;
+    char scratch[512];
+    while (running)
+    {
+        unsigned long long end;
+        {
+            std::lock_guard<std::mutex> lock(streamMutex);
+            end = streamBase + stream.size();
+        }
+        fds.resize(2 + subscribers.size());
+        fds[0].fd = static_cast<SOCKET>(listenSocket);
+        fds[0].events = POLLIN;
+        fds[1].fd = static_cast<SOCKET>(wakeSocket);
+        fds[1].events = POLLIN;
+        for (size_t it = 0; it < subscribers.size(); it++)
+        {
+            const broadcastSubscriberT& subscriber = subscribers[it];
+            bool owed = subscriber.ownSent < subscriber.own.size() || subscriber.sent < end;
+            fds[it + 2].fd = static_cast<SOCKET>(subscriber.socket);
+            fds[it + 2].events = static_cast<short>(POLLIN | (owed ? POLLOUT : 0));
+        }
+        for (WSAPOLLFD& fd : fds)
+        {
+            fd.revents = 0;
+        }
+        if (WSAPoll(fds.data(), static_cast<unsigned long>(fds.size()), BROADCAST_POLL_MS) == SOCKET_ERROR)
+        {
+            continue;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            // Drain before clearing, a publish in between is still served as end is re-read next round
+            while (recv(static_cast<SOCKET>(wakeSocket), scratch, sizeof(scratch), 0) > 0)
+            {
+            }
+            wakePending = false;
+        }
+
+        // Backwards, so a closed subscriber can swap with the last one
+        unsigned int closed = 0;
+        for (size_t it = subscribers.size(); it-- > 0;)
+        {
+            short events = fds[it + 2].revents;
+            bool alive = (events & (POLLERR | POLLHUP | POLLNVAL)) == 0;
+            if (alive && (events & POLLIN))
+            {
+                // Viewers do not talk, a read only finds the end of the connection
+                int received = recv(static_cast<SOCKET>(subscribers[it].socket), scratch, sizeof(scratch), 0);
+                alive = received > 0 || (received == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK);
+            }
+            if (alive && (events & POLLOUT))
+            {
+                alive = flushSubscriber(subscribers[it]);
+            }
+            if (!alive)
+            {
+                closeSocket(subscribers[it].socket);
+                subscribers[it] = std::move(subscribers.back());
+                subscribers.pop_back();
+                closed++;
+            }
+        }
+
+        // New viewers start with the board as it is now
+        unsigned int refused = 0;
+        if (fds[0].revents & POLLIN)
+        {
+            SOCKET client;
+            while ((client = accept(static_cast<SOCKET>(listenSocket), nullptr, nullptr)) != INVALID_SOCKET)
+            {
+                int noDelay = 1;
+                if (subscribers.size() >= BROADCAST_MAX_SUBSCRIBERS || !setNonBlocking(client))
+                {
+                    closesocket(client);
+                    refused++;
+                    continue;
+                }
+                setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+                broadcastSubscriberT subscriber;
+                subscriber.socket = static_cast<uintptr_t>(client);
+                subscriber.ownSent = 0;
+                {
+                    std::lock_guard<std::mutex> lock(streamMutex);
+                    snapshotFrame(subscriber.own);
+                    subscriber.sent = streamBase + stream.size();
+                    subscriber.frameEnd = subscriber.sent;
+                }
+                subscribers.push_back(std::move(subscriber));
+                if (!flushSubscriber(subscribers.back()))
+                {
+                    closeSocket(subscribers.back().socket);
+                    subscribers.pop_back();
+                    closed++;
+                }
+            }
+        }
+
+        // Slow readers are cut over to a snapshot, then the stream is trimmed to the slowest one left
+        std::lock_guard<std::mutex> lock(streamMutex);
+        stats.disconnects += closed + refused;
+        stats.subscribers = static_cast<unsigned int>(subscribers.size());
+        end = streamBase + stream.size();
+        unsigned long long keep = end;
+        bool drained = true;
+        for (broadcastSubscriberT& subscriber : subscribers)
+        {
+            if (end - subscriber.sent > BROADCAST_MAX_LAG)
+            {
+                // Bytes still owed stay in front: the rest of their own data, the end of a half sent frame
+                subscriber.own.erase(subscriber.own.begin(), subscriber.own.begin() + subscriber.ownSent);
+                subscriber.ownSent = 0;
+                subscriber.own.insert(subscriber.own.end(), stream.begin() + (subscriber.sent - streamBase),
+                                      stream.begin() + (subscriber.frameEnd - streamBase));
+                snapshotFrame(subscriber.own);
+                subscriber.sent = end;
+                subscriber.frameEnd = end;
+                stats.resyncs++;
+            }
+            keep = (std::min)(keep, subscriber.sent);
+            drained = drained && subscriber.own.empty() && subscriber.sent == end;
+        }
+        if (drained)
+        {
+            drainedAt = end;
+        }
+        // Erasing only once half the buffer is consumed keeps the trimming linear
+        size_t consumed = static_cast<size_t>(keep - streamBase);
+        if (consumed > 0 && 2 * consumed >= stream.size())
+        {
+            stream.erase(stream.begin(), stream.begin() + consumed);
+            streamBase = keep;
+        }
+    }
+}
+
+// Get the counters
+// Inputs: None
+// Output: statistics
+broadcastStatsT broadcastServer::getStats()
+{
+    std::lock_guard<std::mutex> lock(streamMutex);
+    return stats;
+}
+
+// Check that every subscriber has everything published so far
+// Inputs: None
+// Output: true if nothing is owed
+bool broadcastServer::isDrained()
+{
+    std::lock_guard<std::mutex> lock(streamMutex);
+    return drainedAt == streamBase + stream.size();
+}
+
+// Constructor function
+broadcastViewer::broadcastViewer()
+    : viewerSocket(static_cast<uintptr_t>(INVALID_SOCKET)), connected(false)
+{
+}
+
+// destructor function
+broadcastViewer::~broadcastViewer()
+{
+    close();
+}
+
+// Connect to a server on 127.0.0.1 and start reading
+// Inputs: TCP port
+// Output: true if connected
+bool broadcastViewer::connect(unsigned short port)
+{
+    close();
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        std::cerr << "Broadcast: Winsock unavailable" << std::endl;
+        return false;
+    }
+    SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address = loopbackAddress(port);
+    viewerSocket = static_cast<uintptr_t>(client);
+    if (client == INVALID_SOCKET || ::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        std::cerr << "Broadcast: no server on port " << port << std::endl;
+        closeSocket(viewerSocket);
+        WSACleanup();
+        return false;
+    }
+    connected = true;
+    reader = std::thread(&broadcastViewer::run, this);
+    return true;
+}
+
+// Drop the connection
+// Inputs: None
+// Output: None
+void broadcastViewer::close()
+{
+    if (static_cast<SOCKET>(viewerSocket) == INVALID_SOCKET)
+    {
+        return;
+    }
+    // The blocked read returns once the socket is shut down
+    shutdown(static_cast<SOCKET>(viewerSocket), SD_BOTH);
+    reader.join();
+    closeSocket(viewerSocket);
+    connected = false;
+    events.clear();
+    WSACleanup();
+}
+
+// Check the connection
+// Inputs: None
+// Output: true while the stream is open
+bool broadcastViewer::isConnected() const
+{
+    return connected;
+}
+
+// Take the oldest decoded frame
+// Inputs: event to fill
+// Output: false if none is waiting
+bool broadcastViewer::poll(broadcastEventT& event)
+{
+    std::lock_guard<std::mutex> lock(eventMutex);
+    if (events.empty())
+    {
+        return false;
+    }
+    event = events.front();
+    events.pop_front();
+    return true;
+}
+
+// Receive and decode frames until the connection ends
+// Inputs: None
+// Output: None
+void broadcastViewer::run()
+{
+    std::vector<unsigned char> received(64 * 1024);
+    size_t filled = 0;
+    for (;;)
+    {
+        int count = recv(static_cast<SOCKET>(viewerSocket), reinterpret_cast<char*>(received.data() + filled),
+                         static_cast<int>(received.size() - filled), 0);
+        if (count <= 0)
+        {
+            break;
+        }
+        filled += count;
+
+        // Whole frames only, a partial one waits for the next read
+        size_t offset = 0;
+        while (filled - offset >= sizeof(broadcastHeaderT))
+        {
+            broadcastHeaderT header;
+            std::memcpy(&header, received.data() + offset, sizeof(header));
+            size_t frameSize = sizeof(header) + header.length;
+            if (filled - offset < frameSize)
+            {
+                break;
+            }
+            const unsigned char* payload = received.data() + offset + sizeof(header);
+            broadcastEventT event;
+            event.type = header.type;
+            event.sequence = header.sequence;
+            bool valid = true;
+            if (header.type == BROADCAST_SNAPSHOT && header.length == sizeof(recordKeyframeT))
+            {
+                recordKeyframeT keyframe;
+                std::memcpy(&keyframe, payload, sizeof(keyframe));
+                valid = unpackKeyframe(keyframe, event.position);
+            }
+            else if (header.type == BROADCAST_MOVE && header.length == sizeof(broadcastMoveT))
+            {
+                std::memcpy(&event.move, payload, sizeof(event.move));
+            }
+            else if (header.type == BROADCAST_ANALYSIS && header.length == sizeof(broadcastAnalysisT))
+            {
+                std::memcpy(&event.analysis, payload, sizeof(event.analysis));
+            }
+            else
+            {
+                // Unknown frames are skipped, newer servers may send more kinds
+                valid = false;
+            }
+            if (valid)
+            {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                events.push_back(event);
+            }
+            offset += frameSize;
+        }
+        std::memmove(received.data(), received.data() + offset, filled - offset);
+        filled -= offset;
+    }
+    connected = false;
+}
+
+// Command line entry for "--bench-broadcast"
+// Inputs: program arguments
+// Output: process exit code
+int broadcastBenchmarkMain(int argc, char* argv[])
+{
+    std::vector<unsigned int> subscriberCounts = { 1, 10, 100, 1000 };
+    unsigned long frames = 20000;
+    unsigned long subscribers = 0;
+    bool valid = true;
+    for (int i = 2; i < argc && valid; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--subscribers" && i + 1 < argc)
+        {
+            valid = parseBoundedNumber(argv[++i], 1, BROADCAST_MAX_SUBSCRIBERS, subscribers);
+            subscriberCounts = { static_cast<unsigned int>(subscribers) };
+        }
+        else if (arg == "--frames" && i + 1 < argc) valid = parseBoundedNumber(argv[++i], 1, BROADCAST_MAX_BENCH_FRAMES, frames);
+        else valid = false;
+    }
+    if (!valid)
+    {
+        std::cerr << "Usage: Lab3 --bench-broadcast [--subscribers N (1.." << BROADCAST_MAX_SUBSCRIBERS
+                  << ")] [--frames M (1.." << BROADCAST_MAX_BENCH_FRAMES << ")]" << std::endl;
+        return -1;
+    }
+
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+    chessPosition start;
+    chessMove move = uciToMove("e2e4");
+    for (unsigned int subscriberCount : subscriberCounts)
+    {
+        broadcastServer server;
+        if (!server.start(0, start))
+        {
+            WSACleanup();
+            return -1;
+        }
+        // Subscribers are plain sockets read in this thread, the server does the fan-out
+        std::vector<WSAPOLLFD> clients;
+        sockaddr_in address = loopbackAddress(server.getPort());
+        for (unsigned int it = 0; it < subscriberCount; it++)
+        {
+            SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (client == INVALID_SOCKET || ::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+            {
+                std::cerr << "Broadcast: connection " << it << " failed" << std::endl;
+                break;
+            }
+            setNonBlocking(client);
+            WSAPOLLFD fd;
+            fd.fd = client;
+            fd.events = POLLIN;
+            fd.revents = 0;
+            clients.push_back(fd);
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (server.getStats().subscribers < clients.size() && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // Publish as fast as possible while every subscriber reads
+        std::vector<char> scratch(64 * 1024);
+        unsigned long long receivedBytes = 0;
+        std::atomic<bool> published(false);
+        auto begin = std::chrono::steady_clock::now();
+        std::thread publisher([&]() {
+            for (unsigned long it = 0; it < frames; it++)
+            {
+                server.publishMove(move, start, RECORD_BY_ENGINE);
+            }
+            published = true;
+        });
+        deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            if (WSAPoll(clients.data(), static_cast<unsigned long>(clients.size()), 10) > 0)
+            {
+                for (WSAPOLLFD& fd : clients)
+                {
+                    int count;
+                    while ((fd.revents & POLLIN) && (count = recv(fd.fd, scratch.data(), static_cast<int>(scratch.size()), 0)) > 0)
+                    {
+                        receivedBytes += count;
+                    }
+                }
+            }
+            if (published && server.isDrained() && receivedBytes == server.getStats().bytesSent)
+            {
+                break;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        publisher.join();
+
+        broadcastStatsT stats = server.getStats();
+        std::cout << clients.size() << " subscribers: " << frames << " frames in " << 1000.0 * seconds << " ms, "
+                  << frames / seconds << " frames/s published, "
+                  << receivedBytes / (sizeof(broadcastHeaderT) + sizeof(broadcastMoveT)) / seconds << " frames/s delivered ("
+                  << receivedBytes / seconds / (1024.0 * 1024.0) << " MB/s), " << stats.sendCalls << " sends, "
+                  << stats.resyncs << " snapshot cut-overs" << std::endl;
+        for (WSAPOLLFD& fd : clients)
+        {
+            closesocket(fd.fd);
+        }
+        server.stop();
+    }
+    WSACleanup();
+    return 0;
+}
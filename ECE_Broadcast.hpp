@@ -0,0 +1,258 @@
+/*
+
+Objective:
+Spectator broadcast over a loopback socket. The game side publishes
+compact binary frames (board snapshots, move deltas, engine lines) into
+one shared stream; a single poll loop fans it out to every subscriber
+with one batched send per writable socket. Subscribers that fall too far
+behind are cut over to a fresh snapshot instead of holding the stream.
+The viewer side decodes the stream for a renderer that has no engine.
+*/
+
+#ifndef ECE_BROADCAST_HPP
+#define ECE_BROADCAST_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ECE_ChessPosition.hpp"
+#include "ECE_GameRecord.hpp"
+#include "ECE_Analysis.hpp"
+
+// Default TCP port on 127.0.0.1
+const unsigned short BROADCAST_PORT = 5150;
+// Subscribers served at once (later connections are refused)
+const unsigned int BROADCAST_MAX_SUBSCRIBERS = 1024;
+// Frames published per pass of "--bench-broadcast" at most
+const unsigned int BROADCAST_MAX_BENCH_FRAMES = 10000000;
+// Stream bytes a subscriber may owe before it is cut over to a snapshot
+const size_t BROADCAST_MAX_LAG = 256 * 1024;
+// Poll timeout, the loop also wakes on every publish (ms)
+const int BROADCAST_POLL_MS = 100;
+// Engine lines carried per analysis frame
+const unsigned int BROADCAST_MAX_PV = 4;
+
+// Frame types
+const uint8_t BROADCAST_SNAPSHOT = 1;
+const uint8_t BROADCAST_MOVE = 2;
+const uint8_t BROADCAST_ANALYSIS = 3;
+
+// Frame header (8 bytes), the payload follows
+typedef struct
+{
+    uint8_t type;
+    uint8_t reserved;
+    // Payload bytes
+    uint16_t length;
+    // Counts every frame published (a gap means the viewer was cut over)
+    uint32_t sequence;
+} broadcastHeaderT;
+
+// Move delta (4 bytes)
+typedef struct
+{
+    // chessMove encoding
+    uint16_t move;
+    // Piece code taken by the move (PIECE_NONE if none)
+    uint8_t captured;
+    // RECORD_BY_*
+    uint8_t source;
+} broadcastMoveT;
+
+// One engine line (6 bytes)
+typedef struct
+{
+    // Side to move's view: centipawns or moves to mate
+    int16_t score;
+    // First move of the line
+    uint16_t move;
+    uint8_t isMate;
+    uint8_t depth;
+} broadcastLineT;
+
+// Engine lines for the position on the board (28 bytes)
+typedef struct
+{
+    uint8_t whiteToMove;
+    uint8_t lineCount;
+    uint16_t reserved;
+    broadcastLineT lines[BROADCAST_MAX_PV];
+} broadcastAnalysisT;
+
+static_assert(sizeof(broadcastHeaderT) == 8, "broadcast header layout");
+static_assert(sizeof(broadcastMoveT) == 4, "broadcast move layout");
+static_assert(sizeof(broadcastAnalysisT) == 28, "broadcast analysis layout");
+
+// Server counters
+typedef struct
+{
+    unsigned int subscribers;
+    unsigned long long framesPublished;
+    unsigned long long bytesSent;
+    unsigned long long sendCalls;
+    // Subscribers cut over to a snapshot, and connections closed or refused
+    unsigned long long resyncs;
+    unsigned long long disconnects;
+} broadcastStatsT;
+
+// One connected viewer (poll loop thread only)
+typedef struct
+{
+    // SOCKET (winsock2.h stays out of this header, windows.h users get the old winsock)
+    uintptr_t socket;
+    // Absolute stream offset sent so far, and the end of the frame it is in
+    unsigned long long sent;
+    unsigned long long frameEnd;
+    // Bytes owed before the shared stream (snapshot, end of a cut frame)
+    std::vector<unsigned char> own;
+    size_t ownSent;
+} broadcastSubscriberT;
+
+class broadcastServer
+{
+private:
+    uintptr_t listenSocket;
+    // Loopback datagram socket connected to itself: a publish wakes the poll loop
+    uintptr_t wakeSocket;
+    unsigned short port = 0;
+    std::thread loop;
+    std::atomic<bool> running;
+    std::atomic<bool> wakePending;
+
+    // Frames not yet sent to every subscriber (guarded by streamMutex)
+    std::mutex streamMutex;
+    std::vector<unsigned char> stream;
+    unsigned long long streamBase = 0;
+    uint32_t sequence = 0;
+    // Board as last published, for snapshots
+    chessPosition current;
+    broadcastStatsT stats;
+    // Stream end the last time every subscriber had everything
+    unsigned long long drainedAt = 0;
+
+    std::vector<broadcastSubscriberT> subscribers;
+
+    // Poll loop: accepts, fans out, cuts over laggards, trims the stream
+    // Inputs: None
+    // Output: None
+    void run();
+    // Append a frame (streamMutex held)
+    // Inputs: type, payload, payload size
+    // Output: None
+    void appendFrame(uint8_t type, const void* payload, uint16_t length);
+    // Snapshot frame of the current board (streamMutex held)
+    // Inputs: bytes to append it to
+    // Output: None
+    void snapshotFrame(std::vector<unsigned char>& bytes);
+    // Wake the poll loop once per batch of publishes
+    // Inputs: None
+    // Output: None
+    void wake();
+    // Send what a subscriber is owed, batched into as few calls as the socket takes
+    // Inputs: subscriber
+    // Output: false if the connection is gone
+    bool flushSubscriber(broadcastSubscriberT& subscriber);
+
+public:
+    // Constructor function
+    broadcastServer();
+    // destructor function
+    ~broadcastServer();
+    // Listen on 127.0.0.1 and start the poll loop
+    // Inputs: TCP port (0 picks a free one), board to start from
+    // Output: true if listening
+    bool start(unsigned short cPort, const chessPosition& position);
+    // Close every connection and stop the loop
+    // Inputs: None
+    // Output: None
+    void stop();
+    // Check if the server is up
+    // Inputs: None
+    // Output: true if listening
+    bool isRunning() const;
+    // Get the port listened on
+    // Inputs: None
+    // Output: port
+    unsigned short getPort() const;
+    // Publish a whole board (new game, undo, jump)
+    // Inputs: position
+    // Output: None
+    void publishPosition(const chessPosition& position);
+    // Publish a move delta
+    // Inputs: move, position after it, RECORD_BY_*
+    // Output: None
+    void publishMove(chessMove move, const chessPosition& position, uint8_t source);
+    // Publish the engine lines of the board position
+    // Inputs: analysis snapshot
+    // Output: None
+    void publishAnalysis(const analysisSnapshotT& snapshot);
+    // Get the counters
+    // Inputs: None
+    // Output: statistics
+    broadcastStatsT getStats();
+    // Check that every subscriber has everything published so far
+    // Inputs: None
+    // Output: true if nothing is owed
+    bool isDrained();
+};
+
+// Decoded frame for the viewer
+typedef struct
+{
+    uint8_t type;
+    uint32_t sequence;
+    // BROADCAST_SNAPSHOT
+    chessPosition position;
+    // BROADCAST_MOVE
+    broadcastMoveT move;
+    // BROADCAST_ANALYSIS
+    broadcastAnalysisT analysis;
+} broadcastEventT;
+
+class broadcastViewer
+{
+private:
+    uintptr_t viewerSocket;
+    std::thread reader;
+    std::atomic<bool> connected;
+    std::mutex eventMutex;
+    std::deque<broadcastEventT> events;
+
+    // Receive and decode frames until the connection ends
+    // Inputs: None
+    // Output: None
+    void run();
+
+public:
+    // Constructor function
+    broadcastViewer();
+    // destructor function
+    ~broadcastViewer();
+    // Connect to a server on 127.0.0.1 and start reading
+    // Inputs: TCP port
+    // Output: true if connected
+    bool connect(unsigned short port);
+    // Drop the connection
+    // Inputs: None
+    // Output: None
+    void close();
+    // Check the connection
+    // Inputs: None
+    // Output: true while the stream is open
+    bool isConnected() const;
+    // Take the oldest decoded frame
+    // Inputs: event to fill
+    // Output: false if none is waiting
+    bool poll(broadcastEventT& event);
+};
+
+// Command line entry for "--bench-broadcast"
+// Inputs: program arguments
+// Output: process exit code
+int broadcastBenchmarkMain(int argc, char* argv[]);
+
+#endif
@@ -1,7 +1,44 @@
 #include "ECE_ChessEngine.hpp"
+#include "ECE_Analysis.hpp"
+#include <cstring>
+#include <mutex>
 
 HANDLE hInputWrite, hInputRead;
 HANDLE hOutputWrite, hOutputRead;
+// Engine reported time and score of the last search (from its info lines)
+long long lastSearchMs = -1;
+bool lastHasScore = false;
+bool lastIsMate = false;
+int lastScore = 0;
+int lastDepth = 0;
+// Heap allocations of the last getResponseMove
+unsigned long long lastSearchAllocations = 0;
+// One command line at a time on the engine's input (the line and its newline are two writes)
+static std::mutex engineWriteMutex;
+
+// Keep the latest search time and main line score of one complete info line
+// Inputs: line start and end (no newline)
+// Output: None
+static void scanSearchInfo(const char* begin, const char* end)
+{
+    engineInfoT info;
+    if (!parseInfoLine(begin, end, info))
+    {
+        return;
+    }
+    if (info.timeMs >= 0)
+    {
+        lastSearchMs = info.timeMs;
+    }
+    // Bounds and side lines do not score the move played
+    if (info.hasScore && info.bound == BOUND_EXACT && info.multiPv <= 1)
+    {
+        lastHasScore = true;
+        lastIsMate = info.isMate;
+        lastScore = info.score;
+        lastDepth = info.depth;
+    }
+}
 
 bool InitializeEngine() 
 {
@@ -19,7 +56,7 @@ bool InitializeEngine()
     si.hStdError = hOutputWrite;
 
     // Path to Komodo executable
-    std::string enginePath = "dragon-64bit.exe";
+    std::string enginePath = ENGINE_PATH;
     if (!CreateProcess(NULL, const_cast<char*>(enginePath.c_str()), NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi)) {
         std::cerr << "Failed to start engine" << std::endl;
         return false;
@@ -28,17 +65,21 @@ bool InitializeEngine()
     CloseHandle(pi.hProcess);
     CloseHandle(pi.hThread);
 
+    scratchScope scope(searchArena());
+    std::pmr::string response(&searchArena());
+    response.reserve(ENGINE_READ_BYTES);
     sendMove("uci");
-    std::cout << "Engine Response: " << ReadFromEngine() << std::endl;
+    std::cout << "Engine Response: " << ReadFromEngine(response) << std::endl;
 
     sendMove("isready");
-    std::cout << "Engine Response: " << ReadFromEngine() << std::endl;
+    std::cout << "Engine Response: " << ReadFromEngine(response) << std::endl;
 
 	return true;
 }
 
 bool sendMove(const std::string& strMove)
 {
+    std::lock_guard<std::mutex> lock(engineWriteMutex);
     DWORD written;
     WriteFile(hInputWrite, strMove.c_str(), strMove.length(), &written, NULL);
     WriteFile(hInputWrite, "\n", 1, &written, NULL);
@@ -46,35 +87,131 @@ bool sendMove(const std::string& strMove)
 	return true;
 }
 
-bool getResponseMove(std::string& strMove)
+// Read a UCI move ("e7e5", "a7a8q") at a position of a reply
+// Inputs: reply, offset of the move, move to fill
+// Output: true if a move is there (the move is left empty otherwise)
+static bool readUciMove(const std::pmr::string& response, size_t offset, std::string& move)
+{
+    move.clear();
+    if (offset + 4 > response.size())
+    {
+        return false;
+    }
+    const char* text = response.data() + offset;
+    if (text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8' ||
+        text[2] < 'a' || text[2] > 'h' || text[3] < '1' || text[3] > '8')
+    {
+        return false;
+    }
+    size_t length = 4;
+    if (offset + 4 < response.size() && std::strchr("nbrq", text[4]) != nullptr && text[4] != '\0')
+    {
+        length = 5;
+    }
+    // Short enough for the string's own storage
+    move.assign(text, length);
+    return true;
+}
+
+bool getResponseMove(std::string& strMove, std::string& strPonder)
 {
-    // use the output to interact with the movement object
-    std::string response;
-    while ((response = ReadFromEngine()).find("bestmove") == std::string::npos) {
+    // One read buffer and one line buffer for the whole search, in this thread's arena
+    scratchScope scope(searchArena());
+    unsigned long long allocationsBefore = threadAllocations();
+    std::pmr::string response(&searchArena());
+    std::pmr::string line(&searchArena());
+    response.reserve(ENGINE_READ_BYTES);
+    line.reserve(ENGINE_READ_BYTES);
+    lastSearchMs = -1;
+    lastHasScore = false;
+    strMove.clear();
+    strPonder.clear();
+
+    // Only complete lines are parsed: a line split across two reads waits in the line buffer for its end
+    bool bestmoveSeen = false;
+    while (!bestmoveSeen)
+    {
+        if (ReadFromEngine(response).empty())
+        { // Pipe closed, no reply will come
+            lastSearchAllocations = threadAllocations() - allocationsBefore;
+            return false;
+        }
         std::cout << "Engine Response: " << response << std::endl;
+        size_t start = 0;
+        while (start < response.size() && !bestmoveSeen)
+        {
+            size_t newline = response.find('\n', start);
+            if (newline == std::string::npos)
+            {
+                line.append(response, start, std::string::npos);
+                break;
+            }
+            line.append(response, start, newline - start);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            if (line.compare(0, 9, "bestmove ") == 0)
+            {
+                // Split the move and the expected reply ("bestmove e7e5 ponder g1f3" -> "e7e5", "g1f3"),
+                // read in place: a regex search allocates its state on every call
+                bestmoveSeen = true;
+                std::cout << "Engine best move: " << line << std::endl;
+                if (readUciMove(line, 9, strMove))
+                {
+                    size_t ponder = 9 + strMove.size();
+                    if (line.compare(ponder, 8, " ponder ") == 0)
+                    {
+                        readUciMove(line, ponder + 8, strPonder);
+                    }
+                }
+            }
+            else
+            {
+                scanSearchInfo(line.data(), line.data() + line.size());
+            }
+            line.clear();
+            start = newline + 1;
+        }
+    }
+    lastSearchAllocations = threadAllocations() - allocationsBefore;
+    if (strMove.empty())
+    { // "bestmove (none)"
+        return false;
     }
 
-    std::cout << "Engine best move: " << response << std::endl;
-    strMove = response;
-    std::cout << strMove << std::endl;
+    // Return true on returning call from object
 
-    std::regex moveRegex("^bestmove ([a-h][1-8])([a-h][1-8])$");
+	return true;
+}
 
-    //if (std::reg)
+long long getLastSearchTime()
+{
+    return lastSearchMs;
+}
 
-    // Return true on returning call from object
+bool getLastSearchScore(int& score, bool& isMate, int& depth)
+{
+    score = lastScore;
+    isMate = lastIsMate;
+    depth = lastDepth;
+    return lastHasScore;
+}
 
-	return true;
+unsigned long long getLastSearchAllocations()
+{
+    return lastSearchAllocations;
 }
 
-std::string ReadFromEngine() {
-    char buffer[4096];
+std::pmr::string& ReadFromEngine(std::pmr::string& output) {
+    char buffer[ENGINE_READ_BYTES];
     DWORD read;
-    std::string output;
+    // Keeps its capacity: no allocation once the buffer has grown to a read
+    output.clear();
     if (ReadFile(hOutputRead, buffer, sizeof(buffer) - 1, &read, NULL) && read > 0)
     {
         buffer[read] = '\0';
-        output = buffer;
+        output.assign(buffer);
     }
     return output;
 }
\ No newline at end of file
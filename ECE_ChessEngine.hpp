@@ -1,14 +1,35 @@
+#ifndef ECE_CHESS_ENGINE_HPP
+#define ECE_CHESS_ENGINE_HPP
+
 #include <string>
 #include <iostream>
 #include <string>
 #include <windows.h>
 #include <regex>
 #include "chessCommon.h"
+#include "ECE_ScratchArena.hpp"
+
+// Path to the UCI engine executable
+const char ENGINE_PATH[] = "dragon-64bit.exe";
+// Bytes taken from the pipe per read (reply buffers reserve this once)
+const size_t ENGINE_READ_BYTES = 4096;
 
 bool InitializeEngine();
 
 bool sendMove(const std::string& strMove);
 
-bool getResponseMove(std::string& strMove);
+bool getResponseMove(std::string& strMove, std::string& strPonder);
+
+// Search time the engine reported for the last bestmove (ms, -1 if it sent none)
+long long getLastSearchTime();
+
+// Score of the last bestmove's main line (side to move's view, false if it sent none)
+bool getLastSearchScore(int& score, bool& isMate, int& depth);
+
+// Heap allocations made while waiting for the last bestmove (0 when the reply stayed in the search arena)
+unsigned long long getLastSearchAllocations();
+
+// Next chunk of engine output into a reused buffer (returns it)
+std::pmr::string& ReadFromEngine(std::pmr::string& output);
 
-std::string ReadFromEngine();
\ No newline at end of file
+#endif
@@ -0,0 +1,806 @@
+/*
+
+Objective:
+Compact game position definition file
+*/
+
+#include "ECE_ChessPosition.hpp"
+#include <sstream>
+
+// Constructor function (start position)
+chessPosition::chessPosition()
+{
+    setStartPos();
+}
+
+// Reset to the standard start position
+// Inputs: None
+// Output: None
+void chessPosition::setStartPos()
+{
+    // Back rank order from the a file
+    const unsigned char backRank[8] = { PIECE_ROOK, PIECE_KNIGHT, PIECE_BISHOP, PIECE_QUEEN,
+                                        PIECE_KING, PIECE_BISHOP, PIECE_KNIGHT, PIECE_ROOK };
+    for (int sq = 0; sq < 64; sq++)
+    {
+        squares[sq] = PIECE_NONE;
+    }
+    for (int file = 0; file < 8; file++)
+    {
+        squares[squareOf(file, 0)] = backRank[file];
+        squares[squareOf(file, 1)] = PIECE_PAWN;
+        squares[squareOf(file, 6)] = PIECE_PAWN | PIECE_BLACK;
+        squares[squareOf(file, 7)] = backRank[file] | PIECE_BLACK;
+    }
+    whiteToMove = true;
+    castling = CASTLE_WK | CASTLE_WQ | CASTLE_BK | CASTLE_BQ;
+    epSquare = NO_SQUARE;
+    halfmoveClock = 0;
+    plyCount = 0;
+}
+
+// Load a position from FEN
+// Inputs: FEN string
+// Output: true if valid (the position is unchanged otherwise)
+bool chessPosition::setFromFen(const std::string& fen)
+{
+    std::istringstream fields(fen);
+    std::string placement, side, rights, ep;
+    unsigned int halfmove = 0;
+    unsigned int fullmove = 1;
+    if (!(fields >> placement >> side))
+    {
+        return false;
+    }
+    // Castling, en passant and counters are optional (EPD style)
+    if (!(fields >> rights)) rights = "-";
+    if (!(fields >> ep)) ep = "-";
+    if (!(fields >> halfmove)) halfmove = 0;
+    if (!(fields >> fullmove) || fullmove == 0) fullmove = 1;
+
+    // Placement from a8 to h1, single pass
+    chessPosition next = *this;
+    int file = 0;
+    int rank = 7;
+    int kings[2] = { 0, 0 };
+    for (char c : placement)
+    {
+        if (c == '/')
+        {
+            if (file != 8 || rank == 0)
+            {
+                return false;
+            }
+            file = 0;
+            rank--;
+        }
+        else if (c >= '1' && c <= '8')
+        {
+            for (int empty = c - '0'; empty > 0; empty--)
+            {
+                if (file > 7) return false;
+                next.squares[squareOf(file++, rank)] = PIECE_NONE;
+            }
+        }
+        else
+        {
+            unsigned char piece = fenCharToPiece(c);
+            if (piece == PIECE_NONE || file > 7)
+            {
+                return false;
+            }
+            if ((piece & PIECE_TYPE_MASK) == PIECE_KING)
+            {
+                kings[(piece & PIECE_BLACK) ? 1 : 0]++;
+            }
+            // Pawns never stand on the first or last rank (the move generator steps off the board)
+            if ((piece & PIECE_TYPE_MASK) == PIECE_PAWN && (rank == 0 || rank == 7))
+            {
+                return false;
+            }
+            next.squares[squareOf(file++, rank)] = piece;
+        }
+    }
+    if (file != 8 || rank != 0 || kings[0] != 1 || kings[1] != 1 || (side != "w" && side != "b"))
+    {
+        return false;
+    }
+
+    next.whiteToMove = (side == "w");
+    next.castling = 0;
+    for (char c : rights)
+    {
+        switch (c)
+        {
+        case 'K': next.castling |= CASTLE_WK; break;
+        case 'Q': next.castling |= CASTLE_WQ; break;
+        case 'k': next.castling |= CASTLE_BK; break;
+        case 'q': next.castling |= CASTLE_BQ; break;
+        default: break;
+        }
+    }
+    // A right needs its king and rook on their home squares, the others are dropped
+    if (next.squares[squareOf(4, 0)] != PIECE_KING) next.castling &= ~(CASTLE_WK | CASTLE_WQ);
+    if (next.squares[squareOf(7, 0)] != PIECE_ROOK) next.castling &= ~CASTLE_WK;
+    if (next.squares[squareOf(0, 0)] != PIECE_ROOK) next.castling &= ~CASTLE_WQ;
+    if (next.squares[squareOf(4, 7)] != (PIECE_KING | PIECE_BLACK)) next.castling &= ~(CASTLE_BK | CASTLE_BQ);
+    if (next.squares[squareOf(7, 7)] != (PIECE_ROOK | PIECE_BLACK)) next.castling &= ~CASTLE_BK;
+    if (next.squares[squareOf(0, 7)] != (PIECE_ROOK | PIECE_BLACK)) next.castling &= ~CASTLE_BQ;
+    next.epSquare = (ep == "-") ? NO_SQUARE : notationToSquare(ep);
+    // The target needs an enemy pawn that just made a double step past it, otherwise it is dropped
+    if (next.epSquare != NO_SQUARE)
+    {
+        int epFile = fileOf(next.epSquare);
+        int epRank = rankOf(next.epSquare);
+        int forward = next.whiteToMove ? -1 : 1;
+        unsigned char enemyPawn = next.whiteToMove ? (PIECE_PAWN | PIECE_BLACK) : PIECE_PAWN;
+        if (epRank != (next.whiteToMove ? 5 : 2) ||
+            next.squares[squareOf(epFile, epRank + forward)] != enemyPawn ||
+            next.squares[next.epSquare] != PIECE_NONE ||
+            next.squares[squareOf(epFile, epRank - forward)] != PIECE_NONE)
+        {
+            next.epSquare = NO_SQUARE;
+        }
+    }
+    next.halfmoveClock = halfmove;
+    next.plyCount = 2 * (fullmove - 1) + (next.whiteToMove ? 0 : 1);
+    *this = next;
+    return true;
+}
+
+// Serialize the position to FEN
+// Inputs: None
+// Output: FEN string
+std::string chessPosition::toFen() const
+{
+    std::string fen;
+    for (int rank = 7; rank >= 0; rank--)
+    {
+        int empty = 0;
+        for (int file = 0; file < 8; file++)
+        {
+            unsigned char piece = squares[squareOf(file, rank)];
+            if (piece == PIECE_NONE)
+            {
+                empty++;
+                continue;
+            }
+            if (empty > 0)
+            {
+                fen += static_cast<char>('0' + empty);
+                empty = 0;
+            }
+            fen += pieceToFenChar(piece);
+        }
+        if (empty > 0)
+        {
+            fen += static_cast<char>('0' + empty);
+        }
+        if (rank > 0)
+        {
+            fen += '/';
+        }
+    }
+
+    fen += whiteToMove ? " w " : " b ";
+    if (castling == 0)
+    {
+        fen += '-';
+    }
+    else
+    {
+        if (castling & CASTLE_WK) fen += 'K';
+        if (castling & CASTLE_WQ) fen += 'Q';
+        if (castling & CASTLE_BK) fen += 'k';
+        if (castling & CASTLE_BQ) fen += 'q';
+    }
+    fen += ' ';
+    if (epSquare == NO_SQUARE)
+    {
+        fen += '-';
+    }
+    else
+    {
+        fen += static_cast<char>('a' + fileOf(epSquare));
+        fen += static_cast<char>('1' + rankOf(epSquare));
+    }
+    fen += " " + std::to_string(halfmoveClock) + " " + std::to_string(plyCount / 2 + 1);
+    return fen;
+}
+
+// Play a move in UCI notation (e2e4, e7e8q, e1g1)
+// Inputs: move string
+// Output: true if the move could be applied
+bool chessPosition::applyUciMove(const std::string& uciMove)
+{
+    chessMove move = uciToMove(uciMove);
+    return move != NO_MOVE && applyMove(move);
+}
+
+// Play a compact move (no legality check)
+// Inputs: move
+// Output: true if the move could be applied
+bool chessPosition::applyMove(chessMove move)
+{
+    int from = moveFrom(move);
+    int to = moveTo(move);
+    if (squares[from] == PIECE_NONE || from == to)
+    {
+        return false;
+    }
+
+    unsigned char piece = squares[from];
+    unsigned char colour = piece & PIECE_BLACK;
+    unsigned char type = piece & PIECE_TYPE_MASK;
+    bool isCapture = squares[to] != PIECE_NONE;
+
+    // En passant removes the pawn behind the target square
+    if (type == PIECE_PAWN && to == epSquare && fileOf(from) != fileOf(to))
+    {
+        squares[squareOf(fileOf(to), rankOf(from))] = PIECE_NONE;
+        isCapture = true;
+    }
+
+    // Castling moves the rook as well (king moves two files)
+    if (type == PIECE_KING && (fileOf(to) - fileOf(from) == 2 || fileOf(from) - fileOf(to) == 2))
+    {
+        int rank = rankOf(from);
+        if (fileOf(to) > fileOf(from))
+        {
+            squares[squareOf(5, rank)] = squares[squareOf(7, rank)];
+            squares[squareOf(7, rank)] = PIECE_NONE;
+        }
+        else
+        {
+            squares[squareOf(3, rank)] = squares[squareOf(0, rank)];
+            squares[squareOf(0, rank)] = PIECE_NONE;
+        }
+    }
+
+    // Move the piece (with promotion if requested)
+    squares[to] = piece;
+    squares[from] = PIECE_NONE;
+    if (type == PIECE_PAWN && (rankOf(to) == 0 || rankOf(to) == 7))
+    {
+        int promotion = movePromotion(move);
+        squares[to] = static_cast<unsigned char>((promotion != PIECE_NONE ? promotion : PIECE_QUEEN) | colour);
+    }
+
+    // Castling rights are lost by moving the king or touching a corner
+    if (type == PIECE_KING)
+    {
+        castling &= colour ? ~(CASTLE_BK | CASTLE_BQ) : ~(CASTLE_WK | CASTLE_WQ);
+    }
+    if (from == 0 || to == 0) castling &= ~CASTLE_WQ;
+    if (from == 7 || to == 7) castling &= ~CASTLE_WK;
+    if (from == 56 || to == 56) castling &= ~CASTLE_BQ;
+    if (from == 63 || to == 63) castling &= ~CASTLE_BK;
+
+    // Double pawn push opens an en passant square
+    epSquare = NO_SQUARE;
+    if (type == PIECE_PAWN && (to - from == 16 || from - to == 16))
+    {
+        epSquare = (from + to) / 2;
+    }
+
+    halfmoveClock = (type == PIECE_PAWN || isCapture) ? 0 : halfmoveClock + 1;
+    whiteToMove = !whiteToMove;
+    plyCount++;
+    return true;
+}
+
+// Move directions as {file, rank} steps
+static const int KNIGHT_STEPS[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+static const int KING_STEPS[8][2] = { {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1} };
+static const int ROOK_STEPS[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+static const int BISHOP_STEPS[4][2] = { {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+
+// Add moves of a sliding piece along the given directions
+// Inputs: origin square, direction table and size, output list, count
+// Output: new move count
+int chessPosition::addSlides(int from, const int (*directions)[2], int directionCount, chessMove* moves, int count) const
+{
+    unsigned char colour = squares[from] & PIECE_BLACK;
+    for (int d = 0; d < directionCount; d++)
+    {
+        int file = fileOf(from) + directions[d][0];
+        int rank = rankOf(from) + directions[d][1];
+        while (file >= 0 && file < 8 && rank >= 0 && rank < 8)
+        {
+            int to = squareOf(file, rank);
+            if (squares[to] != PIECE_NONE)
+            {
+                if ((squares[to] & PIECE_BLACK) != colour)
+                {
+                    moves[count++] = makeMove(from, to);
+                }
+                break;
+            }
+            moves[count++] = makeMove(from, to);
+            file += directions[d][0];
+            rank += directions[d][1];
+        }
+    }
+    return count;
+}
+
+// Generate moves without checking king safety
+// Inputs: output list (MAX_MOVES)
+// Output: number of moves
+int chessPosition::generatePseudoMoves(chessMove* moves) const
+{
+    int count = 0;
+    unsigned char colour = whiteToMove ? 0 : PIECE_BLACK;
+    int forward = whiteToMove ? 1 : -1;
+    int startRank = whiteToMove ? 1 : 6;
+    int lastRank = whiteToMove ? 7 : 0;
+
+    for (int from = 0; from < 64; from++)
+    {
+        unsigned char piece = squares[from];
+        if (piece == PIECE_NONE || (piece & PIECE_BLACK) != colour)
+        {
+            continue;
+        }
+        int file = fileOf(from);
+        int rank = rankOf(from);
+
+        switch (piece & PIECE_TYPE_MASK)
+        {
+        case PIECE_PAWN:
+        {
+            int targets[3];
+            int targetCount = 0;
+            int oneStep = squareOf(file, rank + forward);
+            if (squares[oneStep] == PIECE_NONE)
+            {
+                targets[targetCount++] = oneStep;
+                int twoStep = squareOf(file, rank + 2 * forward);
+                if (rank == startRank && squares[twoStep] == PIECE_NONE)
+                {
+                    moves[count++] = makeMove(from, twoStep);
+                }
+            }
+            for (int side = -1; side <= 1; side += 2)
+            {
+                if (file + side < 0 || file + side > 7)
+                {
+                    continue;
+                }
+                int to = squareOf(file + side, rank + forward);
+                if (to == epSquare ||
+                    (squares[to] != PIECE_NONE && (squares[to] & PIECE_BLACK) != colour))
+                {
+                    targets[targetCount++] = to;
+                }
+            }
+            for (int t = 0; t < targetCount; t++)
+            {
+                if (rankOf(targets[t]) == lastRank)
+                {
+                    moves[count++] = makeMove(from, targets[t], PIECE_QUEEN);
+                    moves[count++] = makeMove(from, targets[t], PIECE_ROOK);
+                    moves[count++] = makeMove(from, targets[t], PIECE_BISHOP);
+                    moves[count++] = makeMove(from, targets[t], PIECE_KNIGHT);
+                }
+                else
+                {
+                    moves[count++] = makeMove(from, targets[t]);
+                }
+            }
+            break;
+        }
+        case PIECE_KNIGHT:
+        case PIECE_KING:
+        {
+            const int (*steps)[2] = ((piece & PIECE_TYPE_MASK) == PIECE_KNIGHT) ? KNIGHT_STEPS : KING_STEPS;
+            for (int d = 0; d < 8; d++)
+            {
+                int toFile = file + steps[d][0];
+                int toRank = rank + steps[d][1];
+                if (toFile < 0 || toFile > 7 || toRank < 0 || toRank > 7)
+                {
+                    continue;
+                }
+                int to = squareOf(toFile, toRank);
+                if (squares[to] == PIECE_NONE || (squares[to] & PIECE_BLACK) != colour)
+                {
+                    moves[count++] = makeMove(from, to);
+                }
+            }
+            break;
+        }
+        case PIECE_BISHOP:
+            count = addSlides(from, BISHOP_STEPS, 4, moves, count);
+            break;
+        case PIECE_ROOK:
+            count = addSlides(from, ROOK_STEPS, 4, moves, count);
+            break;
+        case PIECE_QUEEN:
+            count = addSlides(from, BISHOP_STEPS, 4, moves, count);
+            count = addSlides(from, ROOK_STEPS, 4, moves, count);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Castling: rook on its corner, squares between empty, king not passing through check
+    int homeRank = whiteToMove ? 0 : 7;
+    int kingSquare = squareOf(4, homeRank);
+    unsigned char kingSide = whiteToMove ? CASTLE_WK : CASTLE_BK;
+    unsigned char queenSide = whiteToMove ? CASTLE_WQ : CASTLE_BQ;
+    if ((castling & (kingSide | queenSide)) && squares[kingSquare] == (PIECE_KING | colour) &&
+        !isSquareAttacked(kingSquare, !whiteToMove))
+    {
+        if ((castling & kingSide) && squares[kingSquare + 3] == (PIECE_ROOK | colour) &&
+            squares[kingSquare + 1] == PIECE_NONE && squares[kingSquare + 2] == PIECE_NONE &&
+            !isSquareAttacked(kingSquare + 1, !whiteToMove))
+        {
+            moves[count++] = makeMove(kingSquare, kingSquare + 2);
+        }
+        if ((castling & queenSide) && squares[kingSquare - 4] == (PIECE_ROOK | colour) &&
+            squares[kingSquare - 1] == PIECE_NONE && squares[kingSquare - 2] == PIECE_NONE &&
+            squares[kingSquare - 3] == PIECE_NONE && !isSquareAttacked(kingSquare - 1, !whiteToMove))
+        {
+            moves[count++] = makeMove(kingSquare, kingSquare - 2);
+        }
+    }
+    return count;
+}
+
+// Generate all legal moves
+// Inputs: output list (MAX_MOVES)
+// Output: number of moves
+int chessPosition::generateLegalMoves(chessMove* moves) const
+{
+    chessMove pseudoMoves[MAX_MOVES];
+    int pseudoCount = generatePseudoMoves(pseudoMoves);
+    int count = 0;
+    for (int i = 0; i < pseudoCount; i++)
+    {
+        // Copy-make: the position is small enough to copy per move
+        chessPosition next = *this;
+        next.applyMove(pseudoMoves[i]);
+        // The mover's king must not be left attacked
+        if (!next.isSquareAttacked(next.kingSquare(whiteToMove), next.whiteToMove))
+        {
+            moves[count++] = pseudoMoves[i];
+        }
+    }
+    return count;
+}
+
+// Check if a square is attacked
+// Inputs: square, attacking side (true for white)
+// Output: true if attacked
+bool chessPosition::isSquareAttacked(int square, bool byWhite) const
+{
+    unsigned char colour = byWhite ? 0 : PIECE_BLACK;
+    int file = fileOf(square);
+    int rank = rankOf(square);
+
+    // Pawns attack from one rank behind (from the attacker's view)
+    int pawnRank = rank - (byWhite ? 1 : -1);
+    if (pawnRank >= 0 && pawnRank < 8)
+    {
+        if ((file > 0 && squares[squareOf(file - 1, pawnRank)] == (PIECE_PAWN | colour)) ||
+            (file < 7 && squares[squareOf(file + 1, pawnRank)] == (PIECE_PAWN | colour)))
+        {
+            return true;
+        }
+    }
+
+    // Knights and king
+    for (int d = 0; d < 8; d++)
+    {
+        int knightFile = file + KNIGHT_STEPS[d][0];
+        int knightRank = rank + KNIGHT_STEPS[d][1];
+        if (knightFile >= 0 && knightFile < 8 && knightRank >= 0 && knightRank < 8 &&
+            squares[squareOf(knightFile, knightRank)] == (PIECE_KNIGHT | colour))
+        {
+            return true;
+        }
+        int kingFile = file + KING_STEPS[d][0];
+        int kingRank = rank + KING_STEPS[d][1];
+        if (kingFile >= 0 && kingFile < 8 && kingRank >= 0 && kingRank < 8 &&
+            squares[squareOf(kingFile, kingRank)] == (PIECE_KING | colour))
+        {
+            return true;
+        }
+    }
+
+    // Sliders: first piece met along each line
+    for (int d = 0; d < 8; d++)
+    {
+        const int* step = (d < 4) ? ROOK_STEPS[d] : BISHOP_STEPS[d - 4];
+        unsigned char slider = (d < 4) ? PIECE_ROOK : PIECE_BISHOP;
+        int lineFile = file + step[0];
+        int lineRank = rank + step[1];
+        while (lineFile >= 0 && lineFile < 8 && lineRank >= 0 && lineRank < 8)
+        {
+            unsigned char piece = squares[squareOf(lineFile, lineRank)];
+            if (piece != PIECE_NONE)
+            {
+                if (piece == (slider | colour) || piece == (PIECE_QUEEN | colour))
+                {
+                    return true;
+                }
+                break;
+            }
+            lineFile += step[0];
+            lineRank += step[1];
+        }
+    }
+    return false;
+}
+
+// Check if the side to move is in check
+// Inputs: None
+// Output: true if in check
+bool chessPosition::inCheck() const
+{
+    return isSquareAttacked(kingSquare(whiteToMove), !whiteToMove);
+}
+
+// Resolve a SAN move (Nbd7, exd5, O-O, e8=Q+) against the legal moves
+// Inputs: SAN string
+// Output: move or NO_MOVE if illegal or ambiguous
+chessMove chessPosition::parseSan(const std::string& san) const
+{
+    // Drop check, mate and annotation suffixes
+    std::string text = san;
+    while (!text.empty() && (text.back() == '+' || text.back() == '#' || text.back() == '!' || text.back() == '?'))
+    {
+        text.pop_back();
+    }
+
+    chessMove moves[MAX_MOVES];
+    int moveCount = generateLegalMoves(moves);
+
+    // Castling (also accept the zero spelling)
+    if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0")
+    {
+        int kingFrom = kingSquare(whiteToMove);
+        int kingTo = kingFrom + ((text.size() == 3) ? 2 : -2);
+        for (int i = 0; i < moveCount; i++)
+        {
+            if (moveFrom(moves[i]) == kingFrom && moveTo(moves[i]) == kingTo &&
+                (squares[kingFrom] & PIECE_TYPE_MASK) == PIECE_KING)
+            {
+                return moves[i];
+            }
+        }
+        return NO_MOVE;
+    }
+
+    // Piece letter (none for pawns)
+    int pieceType = PIECE_PAWN;
+    size_t pos = 0;
+    if (!text.empty())
+    {
+        switch (text[0])
+        {
+        case 'N': pieceType = PIECE_KNIGHT; pos = 1; break;
+        case 'B': pieceType = PIECE_BISHOP; pos = 1; break;
+        case 'R': pieceType = PIECE_ROOK; pos = 1; break;
+        case 'Q': pieceType = PIECE_QUEEN; pos = 1; break;
+        case 'K': pieceType = PIECE_KING; pos = 1; break;
+        default: break;
+        }
+    }
+
+    // Promotion suffix (e8=Q or e8Q)
+    int promotion = PIECE_NONE;
+    if (pieceType == PIECE_PAWN && text.size() >= 3)
+    {
+        char promo = text.back();
+        switch (promo)
+        {
+        case 'N': promotion = PIECE_KNIGHT; break;
+        case 'B': promotion = PIECE_BISHOP; break;
+        case 'R': promotion = PIECE_ROOK; break;
+        case 'Q': promotion = PIECE_QUEEN; break;
+        default: break;
+        }
+        if (promotion != PIECE_NONE)
+        {
+            text.pop_back();
+            if (!text.empty() && text.back() == '=')
+            {
+                text.pop_back();
+            }
+        }
+    }
+
+    // Destination is the last square, everything before it disambiguates
+    if (text.size() < pos + 2)
+    {
+        return NO_MOVE;
+    }
+    int to = notationToSquare(text.substr(text.size() - 2));
+    if (to == NO_SQUARE)
+    {
+        return NO_MOVE;
+    }
+    int fromFile = -1;
+    int fromRank = -1;
+    for (size_t i = pos; i < text.size() - 2; i++)
+    {
+        if (text[i] >= 'a' && text[i] <= 'h') fromFile = text[i] - 'a';
+        else if (text[i] >= '1' && text[i] <= '8') fromRank = text[i] - '1';
+    }
+
+    chessMove found = NO_MOVE;
+    for (int i = 0; i < moveCount; i++)
+    {
+        int from = moveFrom(moves[i]);
+        if (moveTo(moves[i]) != to || (squares[from] & PIECE_TYPE_MASK) != pieceType ||
+            (fromFile >= 0 && fileOf(from) != fromFile) || (fromRank >= 0 && rankOf(from) != fromRank) ||
+            movePromotion(moves[i]) != promotion)
+        {
+            continue;
+        }
+        if (found != NO_MOVE)
+        { // Ambiguous
+            return NO_MOVE;
+        }
+        found = moves[i];
+    }
+    return found;
+}
+
+// Get the piece on a square
+// Inputs: square index
+// Output: piece code
+unsigned char chessPosition::pieceAt(int square) const
+{
+    return squares[square];
+}
+
+// Check the side to move
+// Inputs: None
+// Output: true if white is to move
+bool chessPosition::isWhiteToMove() const
+{
+    return whiteToMove;
+}
+
+// Get castling rights
+// Inputs: None
+// Output: CASTLE_* bits
+unsigned char chessPosition::castlingRights() const
+{
+    return castling;
+}
+
+// Get en passant target square
+// Inputs: None
+// Output: square index or NO_SQUARE
+int chessPosition::enPassantSquare() const
+{
+    return epSquare;
+}
+
+// Get the number of half moves played
+// Inputs: None
+// Output: ply count
+unsigned int chessPosition::ply() const
+{
+    return plyCount;
+}
+
+// Get the fifty move rule counter
+// Inputs: None
+// Output: half moves since the last capture or pawn move
+unsigned int chessPosition::halfmoves() const
+{
+    return halfmoveClock;
+}
+
+// Find the king of a side
+// Inputs: side (true for white)
+// Output: square index or NO_SQUARE
+int chessPosition::kingSquare(bool white) const
+{
+    unsigned char king = PIECE_KING | (white ? 0 : PIECE_BLACK);
+    for (int sq = 0; sq < 64; sq++)
+    {
+        if (squares[sq] == king)
+        {
+            return sq;
+        }
+    }
+    return NO_SQUARE;
+}
+
+// Convert "e4" to a square index
+// Inputs: algebraic square
+// Output: square index or NO_SQUARE
+int notationToSquare(const std::string& notation)
+{
+    if (notation.size() < 2 || notation[0] < 'a' || notation[0] > 'h' || notation[1] < '1' || notation[1] > '8')
+    {
+        return NO_SQUARE;
+    }
+    return squareOf(notation[0] - 'a', notation[1] - '1');
+}
+
+// Convert a compact move to UCI notation
+// Inputs: move
+// Output: move string (e2e4, e7e8q)
+std::string moveToUci(chessMove move)
+{
+    std::string uciMove;
+    uciMove += static_cast<char>('a' + fileOf(moveFrom(move)));
+    uciMove += static_cast<char>('1' + rankOf(moveFrom(move)));
+    uciMove += static_cast<char>('a' + fileOf(moveTo(move)));
+    uciMove += static_cast<char>('1' + rankOf(moveTo(move)));
+    if (movePromotion(move) != PIECE_NONE)
+    {
+        uciMove += "  nbrq"[movePromotion(move)];
+    }
+    return uciMove;
+}
+
+// Convert UCI notation to a compact move
+// Inputs: move string (e2e4, e7e8q)
+// Output: move or NO_MOVE if malformed
+chessMove uciToMove(const std::string& uciMove)
+{
+    if (uciMove.size() < 4)
+    {
+        return NO_MOVE;
+    }
+    int from = notationToSquare(uciMove.substr(0, 2));
+    int to = notationToSquare(uciMove.substr(2, 2));
+    if (from == NO_SQUARE || to == NO_SQUARE)
+    {
+        return NO_MOVE;
+    }
+    int promotion = PIECE_NONE;
+    if (uciMove.size() > 4)
+    {
+        switch (uciMove[4])
+        {
+        case 'n': promotion = PIECE_KNIGHT; break;
+        case 'b': promotion = PIECE_BISHOP; break;
+        case 'r': promotion = PIECE_ROOK; break;
+        case 'q': promotion = PIECE_QUEEN; break;
+        default: break;
+        }
+    }
+    return makeMove(from, to, promotion);
+}
+
+// Convert a piece code to its FEN letter
+// Inputs: piece code
+// Output: letter (PNBRQK white, pnbrqk black)
+char pieceToFenChar(unsigned char piece)
+{
+    char letter = " PNBRQK"[piece & PIECE_TYPE_MASK];
+    return (piece & PIECE_BLACK) ? static_cast<char>(letter - 'A' + 'a') : letter;
+}
+
+// Convert a FEN letter to a piece code
+// Inputs: letter
+// Output: piece code or PIECE_NONE
+unsigned char fenCharToPiece(char letter)
+{
+    switch (letter)
+    {
+    case 'P': return PIECE_PAWN;
+    case 'N': return PIECE_KNIGHT;
+    case 'B': return PIECE_BISHOP;
+    case 'R': return PIECE_ROOK;
+    case 'Q': return PIECE_QUEEN;
+    case 'K': return PIECE_KING;
+    case 'p': return PIECE_PAWN | PIECE_BLACK;
+    case 'n': return PIECE_KNIGHT | PIECE_BLACK;
+    case 'b': return PIECE_BISHOP | PIECE_BLACK;
+    case 'r': return PIECE_ROOK | PIECE_BLACK;
+    case 'q': return PIECE_QUEEN | PIECE_BLACK;
+    case 'k': return PIECE_KING | PIECE_BLACK;
+    default: return PIECE_NONE;
+    }
+}
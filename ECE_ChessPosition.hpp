@@ -0,0 +1,170 @@
+/*
+
+Objective:
+Compact game position (rules side of the board) shared by the engine helpers
+*/
+
+#ifndef ECE_CHESS_POSITION_HPP
+#define ECE_CHESS_POSITION_HPP
+
+#include <string>
+
+// Piece codes (type in the low bits, colour in PIECE_BLACK)
+const unsigned char PIECE_NONE = 0;
+const unsigned char PIECE_PAWN = 1;
+const unsigned char PIECE_KNIGHT = 2;
+const unsigned char PIECE_BISHOP = 3;
+const unsigned char PIECE_ROOK = 4;
+const unsigned char PIECE_QUEEN = 5;
+const unsigned char PIECE_KING = 6;
+const unsigned char PIECE_BLACK = 8;
+const unsigned char PIECE_TYPE_MASK = 7;
+
+// Castling rights bits
+const unsigned char CASTLE_WK = 1;
+const unsigned char CASTLE_WQ = 2;
+const unsigned char CASTLE_BK = 4;
+const unsigned char CASTLE_BQ = 8;
+
+// No en passant square
+const int NO_SQUARE = -1;
+
+// Standard start position
+const char START_FEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Square helpers (a1 = 0, h1 = 7, a8 = 56, h8 = 63)
+inline int squareOf(int file, int rank) { return rank * 8 + file; }
+inline int fileOf(int square) { return square & 7; }
+inline int rankOf(int square) { return square >> 3; }
+
+// Compact move: from (bits 0-5), to (bits 6-11), promotion piece type (bits 12-14)
+typedef unsigned short chessMove;
+const chessMove NO_MOVE = 0;
+// Upper bound of legal moves in any position
+const int MAX_MOVES = 256;
+
+inline chessMove makeMove(int from, int to, int promotion = PIECE_NONE) { return static_cast<chessMove>(from | (to << 6) | (promotion << 12)); }
+inline int moveFrom(chessMove move) { return move & 63; }
+inline int moveTo(chessMove move) { return (move >> 6) & 63; }
+inline int movePromotion(chessMove move) { return (move >> 12) & 7; }
+
+class chessPosition
+{
+private:
+    // Board squares a1..h8
+    unsigned char squares[64];
+    // true if white is to move
+    bool whiteToMove;
+    // Castling rights (CASTLE_* bits)
+    unsigned char castling;
+    // En passant target square or NO_SQUARE
+    int epSquare;
+    // Fifty move rule counter
+    unsigned int halfmoveClock;
+    // Moves played from the start of the game
+    unsigned int plyCount;
+
+    // Add moves of a sliding piece along the given directions
+    // Inputs: origin square, direction table and size, output list, count
+    // Output: new move count
+    int addSlides(int from, const int (*directions)[2], int directionCount, chessMove* moves, int count) const;
+    // Generate moves without checking king safety
+    // Inputs: output list (MAX_MOVES)
+    // Output: number of moves
+    int generatePseudoMoves(chessMove* moves) const;
+
+public:
+    // Constructor function (start position)
+    chessPosition();
+    // Reset to the standard start position
+    // Inputs: None
+    // Output: None
+    void setStartPos();
+    // Load a position from FEN
+    // Inputs: FEN string
+    // Output: true if valid (the position is unchanged otherwise)
+    bool setFromFen(const std::string& fen);
+    // Serialize the position to FEN
+    // Inputs: None
+    // Output: FEN string
+    std::string toFen() const;
+    // Play a move in UCI notation (e2e4, e7e8q, e1g1)
+    // Inputs: move string
+    // Output: true if the move could be applied
+    bool applyUciMove(const std::string& uciMove);
+    // Play a compact move (no legality check)
+    // Inputs: move
+    // Output: true if the move could be applied
+    bool applyMove(chessMove move);
+    // Generate all legal moves
+    // Inputs: output list (MAX_MOVES)
+    // Output: number of moves
+    int generateLegalMoves(chessMove* moves) const;
+    // Check if a square is attacked
+    // Inputs: square, attacking side (true for white)
+    // Output: true if attacked
+    bool isSquareAttacked(int square, bool byWhite) const;
+    // Check if the side to move is in check
+    // Inputs: None
+    // Output: true if in check
+    bool inCheck() const;
+    // Resolve a SAN move (Nbd7, exd5, O-O, e8=Q+) against the legal moves
+    // Inputs: SAN string
+    // Output: move or NO_MOVE if illegal or ambiguous
+    chessMove parseSan(const std::string& san) const;
+    // Get the piece on a square
+    // Inputs: square index
+    // Output: piece code
+    unsigned char pieceAt(int square) const;
+    // Check the side to move
+    // Inputs: None
+    // Output: true if white is to move
+    bool isWhiteToMove() const;
+    // Get castling rights
+    // Inputs: None
+    // Output: CASTLE_* bits
+    unsigned char castlingRights() const;
+    // Get en passant target square
+    // Inputs: None
+    // Output: square index or NO_SQUARE
+    int enPassantSquare() const;
+    // Get the number of half moves played
+    // Inputs: None
+    // Output: ply count
+    unsigned int ply() const;
+    // Get the fifty move rule counter
+    // Inputs: None
+    // Output: half moves since the last capture or pawn move
+    unsigned int halfmoves() const;
+    // Find the king of a side
+    // Inputs: side (true for white)
+    // Output: square index or NO_SQUARE
+    int kingSquare(bool white) const;
+};
+
+// Convert "e4" to a square index
+// Inputs: algebraic square
+// Output: square index or NO_SQUARE
+int notationToSquare(const std::string& notation);
+
+// Convert a piece code to its FEN letter
+// Inputs: piece code
+// Output: letter (PNBRQK white, pnbrqk black)
+char pieceToFenChar(unsigned char piece);
+
+// Convert a FEN letter to a piece code
+// Inputs: letter
+// Output: piece code or PIECE_NONE
+unsigned char fenCharToPiece(char letter);
+
+// Convert a compact move to UCI notation
+// Inputs: move
+// Output: move string (e2e4, e7e8q)
+std::string moveToUci(chessMove move);
+
+// Convert UCI notation to a compact move
+// Inputs: move string (e2e4, e7e8q)
+// Output: move or NO_MOVE if malformed
+chessMove uciToMove(const std::string& uciMove);
+
+#endif
@@ -0,0 +1,58 @@
+/*
+Objective:
+Command line number parsing shared by the batch and benchmark modes
+*/
+
+#ifndef ECE_COMMAND_LINE_HPP
+#define ECE_COMMAND_LINE_HPP
+
+#include <string>
+#include <stdexcept>
+
+// Read a decimal argument that has to lie within bounds (no sign, no trailing text)
+// Inputs: text, smallest and largest accepted value, value to fill
+// Output: false if it is not a number in range (the value is unchanged)
+inline bool parseBoundedNumber(const std::string& text, unsigned long minimum, unsigned long maximum, unsigned long& value)
+{
+    // Nine digits always fit, longer ones are out of range anyway
+    if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return false;
+    }
+    unsigned long parsed = std::stoul(text);
+    if (parsed < minimum || parsed > maximum)
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Read a decimal argument with an optional sign and fraction that has to lie within bounds
+// Inputs: text, smallest and largest accepted value, value to fill
+// Output: false if it is not a number in range (the value is unchanged)
+inline bool parseBoundedReal(const std::string& text, double minimum, double maximum, double& value)
+{
+    if (text.empty() || text.find_first_not_of("+-.0123456789") != std::string::npos)
+    {
+        return false;
+    }
+    size_t used = 0;
+    double parsed;
+    try
+    {
+        parsed = std::stod(text, &used);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    if (used != text.size() || parsed < minimum || parsed > maximum)
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+#endif
@@ -0,0 +1,555 @@
+/*
+
+Objective:
+UCI engine process pool definition file
+*/
+
+#include "ECE_EnginePool.hpp"
+#include <cstring>
+#include <sstream>
+
+// Parse the depth and score of a UCI "info" line
+// Inputs: line, reply to update
+// Output: true if the line carried a score
+bool parseInfoScore(const std::string& line, engineReplyT& reply)
+{
+    if (line.compare(0, 5, "info ") != 0 || line.find(" score ") == std::string::npos)
+    {
+        return false;
+    }
+    // Bound scores (lowerbound/upperbound) are still the latest estimate
+    std::istringstream tokens(line);
+    std::string token;
+    while (tokens >> token)
+    {
+        if (token == "depth")
+        {
+            tokens >> reply.depth;
+        }
+        else if (token == "cp")
+        {
+            tokens >> reply.scoreCp;
+            reply.isMate = false;
+            reply.hasScore = true;
+        }
+        else if (token == "mate")
+        {
+            tokens >> reply.scoreCp;
+            reply.isMate = true;
+            reply.hasScore = true;
+        }
+        else if (token == "pv")
+        { // Nothing interesting after the principal variation
+            break;
+        }
+    }
+    return true;
+}
+
+// Constructor function
+enginePool::enginePool()
+{
+    hWakeEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+}
+
+// Destructor function
+enginePool::~enginePool()
+{
+    stop();
+    CloseHandle(hWakeEvent);
+}
+
+// Start an engine process with an overlapped stdout pipe
+// Inputs: engine slot
+// Output: true if the process started
+bool enginePool::spawnEngine(unsigned int id)
+{
+    pooledEngine& engine = *engines[id];
+    SECURITY_ATTRIBUTES sa = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+
+    // Anonymous pipes can not be read overlapped, so stdout is a named pipe
+    std::string pipeName = "\\\\.\\pipe\\ece_engine_" + std::to_string(GetCurrentProcessId()) + "_" +
+                           std::to_string(id) + "_" + std::to_string(engine.generation++);
+    engine.hStdoutRead = CreateNamedPipeA(pipeName.c_str(), PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED,
+                                          PIPE_TYPE_BYTE | PIPE_WAIT, 1, 4096, 4096, 0, NULL);
+    if (engine.hStdoutRead == INVALID_HANDLE_VALUE)
+    {
+        engine.hStdoutRead = NULL;
+        return false;
+    }
+    HANDLE hStdoutWrite = CreateFileA(pipeName.c_str(), GENERIC_WRITE, 0, &sa, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE hStdinRead = NULL;
+    if (hStdoutWrite == INVALID_HANDLE_VALUE || !CreatePipe(&hStdinRead, &engine.hStdinWrite, &sa, 0))
+    {
+        if (hStdoutWrite != INVALID_HANDLE_VALUE) CloseHandle(hStdoutWrite);
+        closeEngine(id);
+        return false;
+    }
+    // Our ends must not leak into the other engines
+    SetHandleInformation(engine.hStdinWrite, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFO si = { sizeof(STARTUPINFO) };
+    PROCESS_INFORMATION pi;
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = hStdinRead;
+    si.hStdOutput = hStdoutWrite;
+    si.hStdError = hStdoutWrite;
+
+    std::string commandLine = enginePath;
+    BOOL started = CreateProcess(NULL, &commandLine[0], NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi);
+    // The child holds its own copies, closing ours lets us see EOF on exit
+    CloseHandle(hStdoutWrite);
+    CloseHandle(hStdinRead);
+    if (!started)
+    {
+        std::cerr << "Engine pool: failed to start " << enginePath << std::endl;
+        closeEngine(id);
+        return false;
+    }
+    engine.hProcess = pi.hProcess;
+    CloseHandle(pi.hThread);
+    engine.lineBuffer.clear();
+
+    // Commands queue up in the pipe until the engine reads them
+    writeLine(id, "uci");
+    writeLine(id, "isready");
+    return issueRead(id);
+}
+
+// Kill an engine process and release its handles
+// Inputs: engine slot
+// Output: None
+void enginePool::closeEngine(unsigned int id)
+{
+    pooledEngine& engine = *engines[id];
+    if (engine.hStdoutRead != NULL)
+    {
+        CancelIo(engine.hStdoutRead);
+        CloseHandle(engine.hStdoutRead);
+        engine.hStdoutRead = NULL;
+    }
+    if (engine.hStdinWrite != NULL)
+    {
+        CloseHandle(engine.hStdinWrite);
+        engine.hStdinWrite = NULL;
+    }
+    if (engine.hProcess != NULL)
+    {
+        if (WaitForSingleObject(engine.hProcess, 0) == WAIT_TIMEOUT)
+        {
+            TerminateProcess(engine.hProcess, 1);
+        }
+        CloseHandle(engine.hProcess);
+        engine.hProcess = NULL;
+    }
+}
+
+// Replace a dead engine and resend its pending search
+// Inputs: engine slot
+// Output: None
+void enginePool::restartEngine(unsigned int id)
+{
+    pooledEngine& engine = *engines[id];
+    closeEngine(id);
+    restarts++;
+    std::cerr << "Engine pool: engine " << id << " exited, restarting" << std::endl;
+
+    // A failed spawn is tried again a few times, then the slot is retired (never leased again)
+    bool started = false;
+    for (unsigned int attempt = 0; attempt <= ENGINE_POOL_RETRIES && !started; attempt++)
+    {
+        started = spawnEngine(id);
+    }
+    if (!started)
+    {
+        std::cerr << "Engine pool: engine " << id << " could not be restarted, slot retired" << std::endl;
+        freeCondition.notify_all();
+    }
+    if (engine.searching)
+    {
+        if (started && engine.retries < ENGINE_POOL_RETRIES)
+        {
+            engine.retries++;
+            writeLine(id, engine.positionCommand);
+            writeLine(id, engine.goCommand);
+        }
+        else
+        { // Give up on this search, the caller gets an empty move
+            engine.searching = false;
+            engine.replyReady = true;
+            engine.reply.bestMove.clear();
+            failedSearches++;
+            replyCondition.notify_all();
+        }
+    }
+}
+
+// Queue the next overlapped read on the engine's stdout
+// Inputs: engine slot
+// Output: false if the pipe is broken
+bool enginePool::issueRead(unsigned int id)
+{
+    pooledEngine& engine = *engines[id];
+    std::memset(&engine.readOverlapped, 0, sizeof(engine.readOverlapped));
+    engine.readOverlapped.hEvent = engine.hReadEvent;
+    ResetEvent(engine.hReadEvent);
+
+    // Immediate completion also signals the event, the loop picks it up
+    if (!ReadFile(engine.hStdoutRead, engine.readBuffer, sizeof(engine.readBuffer), NULL, &engine.readOverlapped) &&
+        GetLastError() != ERROR_IO_PENDING)
+    {
+        return false;
+    }
+    return true;
+}
+
+// Handle a complete line of engine output
+// Inputs: engine slot, line
+// Output: None
+void enginePool::processLine(unsigned int id, const std::string& line)
+{
+    pooledEngine& engine = *engines[id];
+    if (!engine.searching)
+    { // id/option/readyok chatter
+        return;
+    }
+    if (parseInfoScore(line, engine.reply))
+    {
+        return;
+    }
+    if (line.compare(0, 9, "bestmove ") == 0)
+    {
+        std::istringstream tokens(line);
+        std::string token;
+        tokens >> token >> engine.reply.bestMove;
+        if (tokens >> token && token == "ponder")
+        {
+            tokens >> engine.reply.ponderMove;
+        }
+        engine.reply.latencyMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - engine.startTime).count();
+
+        completedSearches++;
+        totalLatencyMs += engine.reply.latencyMs;
+        if (engine.reply.latencyMs > maxLatencyMs)
+        {
+            maxLatencyMs = engine.reply.latencyMs;
+        }
+        engine.searching = false;
+        engine.replyReady = true;
+        replyCondition.notify_all();
+    }
+}
+
+// Write a command line to an engine
+// Inputs: engine slot, command
+// Output: true if written
+bool enginePool::writeLine(unsigned int id, const std::string& command)
+{
+    pooledEngine& engine = *engines[id];
+    if (engine.hStdinWrite == NULL)
+    {
+        return false;
+    }
+    std::string line = command + "\n";
+    DWORD written;
+    return WriteFile(engine.hStdinWrite, line.c_str(), static_cast<DWORD>(line.length()), &written, NULL) &&
+           written == line.length();
+}
+
+// Multiplex all engine pipes and process handles
+// Inputs: None
+// Output: None
+void enginePool::ioLoop()
+{
+    HANDLE waitHandles[MAXIMUM_WAIT_OBJECTS];
+    unsigned int waitOwner[MAXIMUM_WAIT_OBJECTS];
+    bool waitIsProcess[MAXIMUM_WAIT_OBJECTS];
+
+    while (true)
+    {
+        // Rebuild the wait set, handles change when an engine restarts
+        DWORD waitCount = 0;
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            if (!running)
+            {
+                return;
+            }
+            waitHandles[waitCount++] = hWakeEvent;
+            for (unsigned int id = 0; id < engines.size(); id++)
+            {
+                if (engines[id]->hProcess == NULL)
+                {
+                    continue;
+                }
+                waitHandles[waitCount] = engines[id]->hReadEvent;
+                waitOwner[waitCount] = id;
+                waitIsProcess[waitCount++] = false;
+                waitHandles[waitCount] = engines[id]->hProcess;
+                waitOwner[waitCount] = id;
+                waitIsProcess[waitCount++] = true;
+            }
+        }
+
+        DWORD result = WaitForMultipleObjects(waitCount, waitHandles, FALSE, INFINITE);
+        if (result == WAIT_FAILED)
+        {
+            std::cerr << "Engine pool: wait failed" << std::endl;
+            return;
+        }
+        DWORD slot = result - WAIT_OBJECT_0;
+        if (slot == 0 || slot >= waitCount)
+        { // Woken up for stop()
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(poolMutex);
+        unsigned int id = waitOwner[slot];
+        pooledEngine& engine = *engines[id];
+        if (waitIsProcess[slot])
+        {
+            restartEngine(id);
+            continue;
+        }
+
+        DWORD bytesRead = 0;
+        if (!GetOverlappedResult(engine.hStdoutRead, &engine.readOverlapped, &bytesRead, FALSE) || bytesRead == 0)
+        {
+            restartEngine(id);
+            continue;
+        }
+
+        // Split the chunk into lines (engines may send partial lines)
+        engine.lineBuffer.append(engine.readBuffer, bytesRead);
+        size_t lineStart = 0;
+        size_t lineEnd;
+        while ((lineEnd = engine.lineBuffer.find('\n', lineStart)) != std::string::npos)
+        {
+            size_t length = lineEnd - lineStart;
+            if (length > 0 && engine.lineBuffer[lineEnd - 1] == '\r')
+            {
+                length--;
+            }
+            processLine(id, engine.lineBuffer.substr(lineStart, length));
+            lineStart = lineEnd + 1;
+        }
+        engine.lineBuffer.erase(0, lineStart);
+
+        if (!issueRead(id))
+        {
+            restartEngine(id);
+        }
+    }
+}
+
+// Spawn the engines and the I/O thread
+// Inputs: number of engines (up to ENGINE_POOL_MAX), engine executable
+// Output: true if every engine started
+bool enginePool::start(unsigned int count, const std::string& path)
+{
+    stop();
+    if (count == 0 || count > ENGINE_POOL_MAX)
+    {
+        std::cerr << "Engine pool: size must be 1.." << ENGINE_POOL_MAX << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    enginePath = path;
+    bool allStarted = true;
+    for (unsigned int id = 0; id < count; id++)
+    {
+        engines.push_back(std::unique_ptr<pooledEngine>(new pooledEngine));
+        engines[id]->hReadEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+        allStarted = spawnEngine(id) && allStarted;
+    }
+    running = true;
+    ioThread = std::thread(&enginePool::ioLoop, this);
+    return allStarted;
+}
+
+// Quit all engines and join the I/O thread
+// Inputs: None
+// Output: None
+void enginePool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        running = false;
+        // Fail pending searches so their callers return
+        for (auto& engine : engines)
+        {
+            if (engine->searching)
+            {
+                engine->searching = false;
+                engine->replyReady = true;
+                engine->reply.bestMove.clear();
+            }
+        }
+    }
+    freeCondition.notify_all();
+    replyCondition.notify_all();
+    SetEvent(hWakeEvent);
+    if (ioThread.joinable())
+    {
+        ioThread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    for (unsigned int id = 0; id < engines.size(); id++)
+    {
+        writeLine(id, "quit");
+        if (engines[id]->hProcess != NULL)
+        {
+            WaitForSingleObject(engines[id]->hProcess, 1000);
+        }
+        closeEngine(id);
+        CloseHandle(engines[id]->hReadEvent);
+    }
+    engines.clear();
+}
+
+// Lease an idle engine (blocks while all are busy, dead slots are skipped)
+// Inputs: None
+// Output: engine id or -1 if the pool is stopped or has no live engine
+int enginePool::lease()
+{
+    std::unique_lock<std::mutex> lock(poolMutex);
+    int engineId = -1;
+    queueDepth++;
+    freeCondition.wait(lock, [&]() {
+        if (!running)
+        {
+            return true;
+        }
+        bool anyAlive = false;
+        for (unsigned int id = 0; id < engines.size(); id++)
+        {
+            // Slots whose process failed to start or was retired are skipped
+            if (engines[id]->hProcess == NULL)
+            {
+                continue;
+            }
+            anyAlive = true;
+            if (!engines[id]->leased)
+            {
+                engineId = static_cast<int>(id);
+                return true;
+            }
+        }
+        // No engine left to wait for
+        return !anyAlive;
+    });
+    queueDepth--;
+    if (engineId >= 0)
+    {
+        engines[engineId]->leased = true;
+    }
+    return engineId;
+}
+
+// Return a leased engine to the pool
+// Inputs: engine id
+// Output: None
+void enginePool::release(int engineId)
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (engineId < 0 || engineId >= static_cast<int>(engines.size()))
+        {
+            return;
+        }
+        engines[engineId]->leased = false;
+    }
+    freeCondition.notify_one();
+}
+
+// Send a command without waiting for a reply (setoption, ucinewgame)
+// Inputs: engine id, command
+// Output: true if written
+bool enginePool::sendCommand(int engineId, const std::string& command)
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (engineId < 0 || engineId >= static_cast<int>(engines.size()))
+    {
+        return false;
+    }
+    return writeLine(engineId, command);
+}
+
+// Run a search and wait for bestmove
+// Inputs: engine id, "position ..." command, "go ..." command, reply
+// Output: true if the engine returned a move (false at once if its process is gone)
+bool enginePool::search(int engineId, const std::string& positionCommand, const std::string& goCommand, engineReplyT& reply)
+{
+    std::unique_lock<std::mutex> lock(poolMutex);
+    if (!running || engineId < 0 || engineId >= static_cast<int>(engines.size()))
+    {
+        return false;
+    }
+    pooledEngine& engine = *engines[engineId];
+    if (engine.hProcess == NULL)
+    { // Retired or never started: nothing would ever answer
+        failedSearches++;
+        reply = engineReplyT();
+        return false;
+    }
+    engine.positionCommand = positionCommand;
+    engine.goCommand = goCommand;
+    engine.reply = engineReplyT();
+    engine.retries = 0;
+    engine.replyReady = false;
+    engine.searching = true;
+    engine.startTime = std::chrono::steady_clock::now();
+
+    // A failed write means the engine died: the search fails at once (the I/O thread restarts the engine)
+    if (!writeLine(engineId, positionCommand) || !writeLine(engineId, goCommand))
+    {
+        engine.searching = false;
+        engine.reply.bestMove.clear();
+        failedSearches++;
+        reply = engine.reply;
+        return false;
+    }
+
+    replyCondition.wait(lock, [&]() { return engine.replyReady; });
+    reply = engine.reply;
+    return !reply.bestMove.empty() && reply.bestMove != "(none)";
+}
+
+// Get pool metrics
+// Inputs: None
+// Output: metrics snapshot
+enginePoolStatsT enginePool::getStats()
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    enginePoolStatsT stats;
+    stats.engines = static_cast<unsigned int>(engines.size());
+    stats.leased = 0;
+    for (const auto& engine : engines)
+    {
+        stats.leased += engine->leased ? 1 : 0;
+    }
+    stats.queueDepth = queueDepth;
+    stats.completedSearches = completedSearches;
+    stats.failedSearches = failedSearches;
+    stats.restarts = restarts;
+    stats.avgLatencyMs = completedSearches ? totalLatencyMs / completedSearches : 0.0;
+    stats.maxLatencyMs = maxLatencyMs;
+    return stats;
+}
+
+// Print pool metrics
+// Inputs: output stream
+// Output: None
+void enginePool::reportStats(std::ostream& out)
+{
+    enginePoolStatsT stats = getStats();
+    out << "Engine pool: " << stats.leased << "/" << stats.engines << " leased, "
+        << stats.queueDepth << " waiting, "
+        << stats.completedSearches << " searches ("
+        << stats.failedSearches << " failed), "
+        << stats.restarts << " restarts, latency avg "
+        << stats.avgLatencyMs << " ms max " << stats.maxLatencyMs << " ms" << std::endl;
+}
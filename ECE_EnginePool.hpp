@@ -0,0 +1,167 @@
+/*
+
+Objective:
+Pool of local UCI engine processes leased per request (batch analysis,
+self-play, spectator boards). All engine pipes are serviced by one I/O
+thread waiting on overlapped reads.
+*/
+
+#ifndef ECE_ENGINE_POOL_HPP
+#define ECE_ENGINE_POOL_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <condition_variable>
+#include <windows.h>
+
+// One wait slot for the wake event, two (stdout read, process) per engine
+const unsigned int ENGINE_POOL_MAX = (MAXIMUM_WAIT_OBJECTS - 1) / 2;
+// A search is resent this many times after engine crashes before failing
+const unsigned int ENGINE_POOL_RETRIES = 2;
+
+// Result of one engine search
+typedef struct
+{
+    std::string bestMove;
+    std::string ponderMove;
+    int depth = 0;
+    int scoreCp = 0;
+    bool isMate = false;
+    // true once an info line carried a cp or mate score
+    bool hasScore = false;
+    double latencyMs = 0.0;
+} engineReplyT;
+
+// Pool metrics
+typedef struct
+{
+    unsigned int engines;
+    unsigned int leased;
+    unsigned int queueDepth;
+    unsigned long long completedSearches;
+    unsigned long long failedSearches;
+    unsigned long long restarts;
+    double avgLatencyMs;
+    double maxLatencyMs;
+} enginePoolStatsT;
+
+// Parse the depth and score of a UCI "info" line
+// Inputs: line, reply to update
+// Output: true if the line carried a score
+bool parseInfoScore(const std::string& line, engineReplyT& reply);
+
+class enginePool
+{
+private:
+    // Per process state (owned by the pool, guarded by poolMutex)
+    struct pooledEngine
+    {
+        HANDLE hProcess = NULL;
+        HANDLE hStdinWrite = NULL;
+        HANDLE hStdoutRead = NULL;
+        HANDLE hReadEvent = NULL;
+        OVERLAPPED readOverlapped;
+        char readBuffer[4096];
+        std::string lineBuffer;
+        unsigned int generation = 0;
+        bool leased = false;
+        bool searching = false;
+        bool replyReady = false;
+        unsigned int retries = 0;
+        std::string positionCommand;
+        std::string goCommand;
+        engineReplyT reply;
+        std::chrono::steady_clock::time_point startTime;
+    };
+
+    std::vector<std::unique_ptr<pooledEngine>> engines;
+    std::string enginePath;
+    std::mutex poolMutex;
+    std::condition_variable freeCondition;
+    std::condition_variable replyCondition;
+    std::thread ioThread;
+    HANDLE hWakeEvent = NULL;
+    bool running = false;
+
+    // Metrics
+    unsigned int queueDepth = 0;
+    unsigned long long completedSearches = 0;
+    unsigned long long failedSearches = 0;
+    unsigned long long restarts = 0;
+    double totalLatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+
+    // Start an engine process with an overlapped stdout pipe
+    // Inputs: engine slot
+    // Output: true if the process started
+    bool spawnEngine(unsigned int id);
+    // Kill an engine process and release its handles
+    // Inputs: engine slot
+    // Output: None
+    void closeEngine(unsigned int id);
+    // Replace a dead engine and resend its pending search
+    // Inputs: engine slot
+    // Output: None
+    void restartEngine(unsigned int id);
+    // Queue the next overlapped read on the engine's stdout
+    // Inputs: engine slot
+    // Output: false if the pipe is broken
+    bool issueRead(unsigned int id);
+    // Handle a complete line of engine output
+    // Inputs: engine slot, line
+    // Output: None
+    void processLine(unsigned int id, const std::string& line);
+    // Write a command line to an engine
+    // Inputs: engine slot, command
+    // Output: true if written
+    bool writeLine(unsigned int id, const std::string& command);
+    // Multiplex all engine pipes and process handles
+    // Inputs: None
+    // Output: None
+    void ioLoop();
+
+public:
+    // Constructor function
+    enginePool();
+    // destructor function
+    ~enginePool();
+    // Spawn the engines and the I/O thread
+    // Inputs: number of engines (up to ENGINE_POOL_MAX), engine executable
+    // Output: true if every engine started
+    bool start(unsigned int count, const std::string& path);
+    // Quit all engines and join the I/O thread
+    // Inputs: None
+    // Output: None
+    void stop();
+    // Lease an idle engine (blocks while all are busy, dead slots are skipped)
+    // Inputs: None
+    // Output: engine id or -1 if the pool is stopped or has no live engine
+    int lease();
+    // Return a leased engine to the pool
+    // Inputs: engine id
+    // Output: None
+    void release(int engineId);
+    // Send a command without waiting for a reply (setoption, ucinewgame)
+    // Inputs: engine id, command
+    // Output: true if written
+    bool sendCommand(int engineId, const std::string& command);
+    // Run a search and wait for bestmove
+    // Inputs: engine id, "position ..." command, "go ..." command, reply
+    // Output: true if the engine returned a move (false at once if its process is gone)
+    bool search(int engineId, const std::string& positionCommand, const std::string& goCommand, engineReplyT& reply);
+    // Get pool metrics
+    // Inputs: None
+    // Output: metrics snapshot
+    enginePoolStatsT getStats();
+    // Print pool metrics
+    // Inputs: output stream
+    // Output: None
+    void reportStats(std::ostream& out);
+};
+
+#endif
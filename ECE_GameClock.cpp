@@ -0,0 +1,336 @@
+/*
+
+Objective:
+Game clock definition file
+*/
+
+#include "ECE_GameClock.hpp"
+#include <cstdio>
+#include <regex>
+#include <stdexcept>
+
+// Parse a time control ("off", "5", "5+3", "5d2", "movetime 500"; minutes and seconds)
+// Inputs: text, control to fill
+// Output: true if valid
+bool parseTimeControl(const std::string& text, timeControlT& control)
+{
+    // Compiled once; the digit counts keep every value well inside long long milliseconds
+    static const std::regex clockRegex("^(\\d{1,4}(\\.\\d{1,3})?)(([+d])(\\d{1,4}(\\.\\d{1,3})?))?$");
+    static const std::regex moveTimeRegex("^movetime (\\d{1,9})$");
+    std::smatch match;
+    control = { CLOCK_OFF, 0, 0, 0 };
+    if (text == "off")
+    {
+        return true;
+    }
+    if (std::regex_match(text, match, moveTimeRegex))
+    {
+        control.mode = CLOCK_MOVETIME;
+        try
+        {
+            control.moveTimeMs = std::stoll(match[1].str());
+        }
+        catch (const std::exception&)
+        {
+            control = { CLOCK_OFF, 0, 0, 0 };
+            return false;
+        }
+        return control.moveTimeMs > 0;
+    }
+    if (!std::regex_match(text, match, clockRegex))
+    {
+        return false;
+    }
+    try
+    {
+        control.baseMs = static_cast<long long>(std::stod(match[1].str()) * 60000.0);
+        control.incrementMs = match[3].matched ? static_cast<long long>(std::stod(match[5].str()) * 1000.0) : 0;
+    }
+    catch (const std::exception&)
+    {
+        control = { CLOCK_OFF, 0, 0, 0 };
+        return false;
+    }
+    if (control.incrementMs == 0)
+    {
+        control.mode = CLOCK_SUDDEN_DEATH;
+    }
+    else
+    {
+        control.mode = match[4].str() == "+" ? CLOCK_INCREMENT : CLOCK_DELAY;
+    }
+    return control.baseMs > 0;
+}
+
+// Clock display of a time
+// Inputs: milliseconds
+// Output: "m:ss.s"
+std::string formatClock(long long timeMs)
+{
+    char text[32];
+    long long tenths = timeMs / 100;
+    snprintf(text, sizeof(text), "%lld:%02lld.%lld", tenths / 600, (tenths / 10) % 60, tenths % 10);
+    return text;
+}
+
+// Set a time control and start the side to move's clock
+// Inputs: control, side to move (true for white)
+// Output: None
+void gameClock::configure(const timeControlT& cControl, bool whiteToMove)
+{
+    control = cControl;
+    reset(whiteToMove);
+}
+
+// New game on the same control
+// Inputs: side to move (true for white)
+// Output: None
+void gameClock::reset(bool whiteToMove)
+{
+    for (int side = 0; side < 2; side++)
+    {
+        remainingMs[side] = control.baseMs;
+        flagged[side] = false;
+        flagReported[side] = false;
+    }
+    running = whiteToMove ? 0 : 1;
+    turnStart = std::chrono::steady_clock::now();
+}
+
+// Check for a time control
+// Inputs: None
+// Output: true unless off
+bool gameClock::isEnabled() const
+{
+    return control.mode != CLOCK_OFF;
+}
+
+// Time the running side has used this turn
+// Inputs: None
+// Output: milliseconds (0 when stopped)
+long long gameClock::turnMs() const
+{
+    if (running < 0)
+    {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - turnStart).count();
+}
+
+// Clock time charged for a turn (the delay is free)
+// Inputs: time used
+// Output: milliseconds
+long long gameClock::chargedMs(long long usedMs) const
+{
+    if (control.mode == CLOCK_DELAY)
+    {
+        return usedMs > control.incrementMs ? usedMs - control.incrementMs : 0;
+    }
+    return usedMs;
+}
+
+// End the running side's turn and start the other one
+// Inputs: None
+// Output: time used (ms)
+long long gameClock::press()
+{
+    long long usedMs = turnMs();
+    if (running >= 0 && control.mode != CLOCK_OFF && control.mode != CLOCK_MOVETIME)
+    {
+        remainingMs[running] -= chargedMs(usedMs);
+        if (remainingMs[running] <= 0)
+        {
+            remainingMs[running] = 0;
+            flagged[running] = true;
+        }
+        // Fischer increment is earned by completing the move in time
+        else if (control.mode == CLOCK_INCREMENT)
+        {
+            remainingMs[running] += control.incrementMs;
+        }
+    }
+    running = running == 0 ? 1 : 0;
+    turnStart = std::chrono::steady_clock::now();
+    return usedMs;
+}
+
+// Time left, the running turn included
+// Inputs: side (true for white)
+// Output: milliseconds (never below 0)
+long long gameClock::remaining(bool white) const
+{
+    int side = white ? 0 : 1;
+    long long left = remainingMs[side] - (side == running ? chargedMs(turnMs()) : 0);
+    return left > 0 ? left : 0;
+}
+
+// Report a flag fall once
+// Inputs: set to the side that ran out (true for white)
+// Output: true the first time a side is out of time
+bool gameClock::checkFlag(bool& white)
+{
+    if (control.mode == CLOCK_OFF || control.mode == CLOCK_MOVETIME)
+    {
+        return false;
+    }
+    for (int side = 0; side < 2; side++)
+    {
+        if (!flagReported[side] && (flagged[side] || remaining(side == 0) == 0))
+        {
+            flagged[side] = true;
+            flagReported[side] = true;
+            white = side == 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Safety margin taken off every budget
+// Inputs: None
+// Output: milliseconds
+long long gameClock::overheadMarginMs() const
+{
+    // Twice the average absorbs most of the jitter around it
+    long long margin = static_cast<long long>(2.0 * overheadMs);
+    if (margin < CLOCK_MIN_OVERHEAD_MS)
+    {
+        return CLOCK_MIN_OVERHEAD_MS;
+    }
+    return margin < CLOCK_MAX_OVERHEAD_MS ? margin : CLOCK_MAX_OVERHEAD_MS;
+}
+
+// Move time the engine gets in delay and movetime modes
+// Inputs: side the engine searches for (true for white)
+// Output: milliseconds
+long long gameClock::moveBudgetMs(bool white) const
+{
+    long long budget;
+    if (control.mode == CLOCK_MOVETIME)
+    {
+        budget = control.moveTimeMs;
+    }
+    else
+    {
+        // The delay is free time, the clock is spread over the moves ahead
+        budget = control.incrementMs + remaining(white) / CLOCK_MOVES_TO_GO;
+    }
+    budget -= overheadMarginMs();
+    return budget > 1 ? budget : 1;
+}
+
+// Engine limits for the side to move (the side after it when pondering)
+// Inputs: ponder search
+// Output: "go ..." command
+std::string gameClock::goCommand(bool ponder) const
+{
+    std::string command = ponder ? "go ponder" : "go";
+    if (control.mode == CLOCK_DELAY || control.mode == CLOCK_MOVETIME)
+    {
+        // UCI has no delay field, we pick the move time ourselves (a ponder search runs on
+        // the player's clock but is for the engine's own move, so budget from the engine's time)
+        bool engineWhite = ponder ? (running == 1) : (running == 0);
+        return command + " movetime " + std::to_string(moveBudgetMs(engineWhite));
+    }
+    // The engine plans its own time, minus what the round-trip will cost
+    long long margin = overheadMarginMs();
+    long long whiteMs = remaining(true) - margin;
+    long long blackMs = remaining(false) - margin;
+    command += " wtime " + std::to_string(whiteMs > 1 ? whiteMs : 1) + " btime " + std::to_string(blackMs > 1 ? blackMs : 1);
+    if (control.mode == CLOCK_INCREMENT)
+    {
+        command += " winc " + std::to_string(control.incrementMs) + " binc " + std::to_string(control.incrementMs);
+    }
+    return command;
+}
+
+// Longest the side to move may think before the search is stopped
+// Inputs: None
+// Output: milliseconds
+long long gameClock::moveLimitMs() const
+{
+    if (control.mode == CLOCK_DELAY || control.mode == CLOCK_MOVETIME)
+    {
+        return moveBudgetMs(running == 0) + overheadMarginMs();
+    }
+    long long left = remaining(running == 0);
+    long long limit = left / CLOCK_MIN_MOVES_LEFT + (control.mode == CLOCK_INCREMENT ? control.incrementMs : 0);
+    long long ceiling = left - overheadMarginMs();
+    if (limit > ceiling)
+    {
+        limit = ceiling;
+    }
+    return limit > 1 ? limit : 1;
+}
+
+// Record a reply: the measured wait against the engine's own search time
+// Inputs: wait (ms), engine reported time (ms, -1 if unknown), reply came from a ponder hit
+// Output: None
+void gameClock::recordReply(double latencyMs, long long engineMs, bool pondered)
+{
+    stats.replies++;
+    stats.totalLatencyMs += latencyMs;
+    if (latencyMs > stats.maxLatencyMs)
+    {
+        stats.maxLatencyMs = latencyMs;
+    }
+    // A ponder hit reports time spent before our wait started
+    if (pondered || engineMs < 0)
+    {
+        return;
+    }
+    double overhead = latencyMs - static_cast<double>(engineMs);
+    if (overhead < 0.0)
+    {
+        overhead = 0.0;
+    }
+    overheadMs = stats.measured == 0 ? overhead : overheadMs + CLOCK_OVERHEAD_WEIGHT * (overhead - overheadMs);
+    stats.measured++;
+    stats.totalOverheadMs += overhead;
+    if (overhead > stats.maxOverheadMs)
+    {
+        stats.maxOverheadMs = overhead;
+    }
+}
+
+// Count a search stopped at the hard limit
+// Inputs: None
+// Output: None
+void gameClock::recordStop()
+{
+    stats.stopped++;
+}
+
+// Get the reply statistics
+// Inputs: None
+// Output: statistics
+clockStatsT gameClock::getStats() const
+{
+    return stats;
+}
+
+// Time control as typed ("5+3")
+// Inputs: None
+// Output: text
+std::string gameClock::describe() const
+{
+    char text[64];
+    switch (control.mode)
+    {
+    case CLOCK_SUDDEN_DEATH:
+        snprintf(text, sizeof(text), "%g min sudden death", control.baseMs / 60000.0);
+        break;
+    case CLOCK_INCREMENT:
+        snprintf(text, sizeof(text), "%g+%g", control.baseMs / 60000.0, control.incrementMs / 1000.0);
+        break;
+    case CLOCK_DELAY:
+        snprintf(text, sizeof(text), "%g min, %g s delay", control.baseMs / 60000.0, control.incrementMs / 1000.0);
+        break;
+    case CLOCK_MOVETIME:
+        snprintf(text, sizeof(text), "%lld ms per move", control.moveTimeMs);
+        break;
+    default:
+        return "off";
+    }
+    return text;
+}
@@ -0,0 +1,154 @@
+/*
+
+Objective:
+Chess clock for bot games: sudden death, Fischer increment, simple delay
+or a fixed time per move, kept on a monotonic timer. Builds the engine
+"go" limits from the remaining time and learns the engine overhead per
+move so replies stay inside their budget.
+*/
+
+#ifndef ECE_GAME_CLOCK_HPP
+#define ECE_GAME_CLOCK_HPP
+
+#include <chrono>
+#include <string>
+
+// Margin kept off every budget before any overhead was measured (ms)
+const long long CLOCK_MIN_OVERHEAD_MS = 30;
+// Margin ceiling, a single stall must not eat the whole budget (ms)
+const long long CLOCK_MAX_OVERHEAD_MS = 1000;
+// Weight of a new overhead sample in the running average
+const double CLOCK_OVERHEAD_WEIGHT = 0.2;
+// Moves the remaining time is spread over when we pick the move time (delay mode)
+const long long CLOCK_MOVES_TO_GO = 30;
+// Hard stop for one move: this share of the remaining time plus the increment
+const long long CLOCK_MIN_MOVES_LEFT = 8;
+
+// Time control kinds (off: the bot searches to a fixed depth)
+typedef enum
+{
+    CLOCK_OFF,
+    CLOCK_SUDDEN_DEATH,
+    CLOCK_INCREMENT,
+    CLOCK_DELAY,
+    CLOCK_MOVETIME
+} clockModeT;
+
+// Time control (milliseconds)
+typedef struct
+{
+    clockModeT mode;
+    long long baseMs;
+    // Increment added after each move, or delay before the clock runs
+    long long incrementMs;
+    // Fixed time per engine move (CLOCK_MOVETIME)
+    long long moveTimeMs;
+} timeControlT;
+
+// Engine replies under the clock
+typedef struct
+{
+    unsigned int replies;
+    double totalLatencyMs;
+    double maxLatencyMs;
+    // Replies where the engine reported its search time (overhead known)
+    unsigned int measured;
+    double totalOverheadMs;
+    double maxOverheadMs;
+    // Searches stopped at the hard limit
+    unsigned int stopped;
+} clockStatsT;
+
+// Parse a time control ("off", "5", "5+3", "5d2", "movetime 500"; minutes and seconds)
+// Inputs: text, control to fill
+// Output: true if valid
+bool parseTimeControl(const std::string& text, timeControlT& control);
+
+class gameClock
+{
+private:
+    timeControlT control = { CLOCK_OFF, 0, 0, 0 };
+    // White and black (index 0 and 1)
+    long long remainingMs[2] = { 0, 0 };
+    bool flagged[2] = { false, false };
+    bool flagReported[2] = { false, false };
+    int running = -1;
+    std::chrono::steady_clock::time_point turnStart;
+    // Running average of what the engine round-trip adds to its own search time
+    double overheadMs = 0.0;
+    clockStatsT stats = { 0, 0.0, 0.0, 0, 0.0, 0.0, 0 };
+
+    // Time the running side has used this turn
+    // Inputs: None
+    // Output: milliseconds (0 when stopped)
+    long long turnMs() const;
+    // Clock time charged for a turn (the delay is free)
+    // Inputs: time used
+    // Output: milliseconds
+    long long chargedMs(long long usedMs) const;
+    // Move time the engine gets in delay and movetime modes
+    // Inputs: side the engine searches for (true for white)
+    // Output: milliseconds
+    long long moveBudgetMs(bool white) const;
+
+public:
+    // Set a time control and start the side to move's clock
+    // Inputs: control, side to move (true for white)
+    // Output: None
+    void configure(const timeControlT& cControl, bool whiteToMove);
+    // New game on the same control
+    // Inputs: side to move (true for white)
+    // Output: None
+    void reset(bool whiteToMove);
+    // Check for a time control
+    // Inputs: None
+    // Output: true unless off
+    bool isEnabled() const;
+    // End the running side's turn and start the other one
+    // Inputs: None
+    // Output: time used (ms)
+    long long press();
+    // Time left, the running turn included
+    // Inputs: side (true for white)
+    // Output: milliseconds (never below 0)
+    long long remaining(bool white) const;
+    // Report a flag fall once
+    // Inputs: set to the side that ran out (true for white)
+    // Output: true the first time a side is out of time
+    bool checkFlag(bool& white);
+    // Engine limits for the side to move (the side after it when pondering)
+    // Inputs: ponder search
+    // Output: "go ..." command
+    std::string goCommand(bool ponder) const;
+    // Longest the side to move may think before the search is stopped
+    // Inputs: None
+    // Output: milliseconds
+    long long moveLimitMs() const;
+    // Safety margin taken off every budget
+    // Inputs: None
+    // Output: milliseconds
+    long long overheadMarginMs() const;
+    // Record a reply: the measured wait against the engine's own search time
+    // Inputs: wait (ms), engine reported time (ms, -1 if unknown), reply came from a ponder hit
+    // Output: None
+    void recordReply(double latencyMs, long long engineMs, bool pondered);
+    // Count a search stopped at the hard limit
+    // Inputs: None
+    // Output: None
+    void recordStop();
+    // Get the reply statistics
+    // Inputs: None
+    // Output: statistics
+    clockStatsT getStats() const;
+    // Time control as typed ("5+3")
+    // Inputs: None
+    // Output: text
+    std::string describe() const;
+};
+
+// Clock display of a time
+// Inputs: milliseconds
+// Output: "m:ss.s"
+std::string formatClock(long long timeMs);
+
+#endif
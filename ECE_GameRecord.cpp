@@ -0,0 +1,605 @@
+/*
+
+Objective:
+Game record definition file
+*/
+
+#include "ECE_GameRecord.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <windows.h>
+
+// Pack a position into a keyframe
+// Inputs: position, keyframe to fill
+// Output: None
+void packKeyframe(const chessPosition& position, recordKeyframeT& keyframe)
+{
+    for (int sq = 0; sq < 64; sq += 2)
+    {
+        keyframe.board[sq / 2] = static_cast<uint8_t>(position.pieceAt(sq) | (position.pieceAt(sq + 1) << 4));
+    }
+    keyframe.whiteToMove = position.isWhiteToMove() ? 1 : 0;
+    keyframe.castling = position.castlingRights();
+    keyframe.epSquare = position.enPassantSquare() == NO_SQUARE ? RECORD_NO_SQUARE : static_cast<uint8_t>(position.enPassantSquare());
+    keyframe.halfmoves = static_cast<uint8_t>((std::min)(position.halfmoves(), 255u));
+    keyframe.ply = static_cast<uint16_t>(position.ply());
+}
+
+// Unpack a keyframe
+// Inputs: keyframe, position to fill
+// Output: true if the keyframe holds a valid position
+bool unpackKeyframe(const recordKeyframeT& keyframe, chessPosition& position)
+{
+    // The FEN loader validates it (about a microsecond, once per seek)
+    char fen[96];
+    int length = 0;
+    for (int rank = 7; rank >= 0; rank--)
+    {
+        int empty = 0;
+        for (int file = 0; file < 8; file++)
+        {
+            int sq = rank * 8 + file;
+            unsigned char piece = (keyframe.board[sq / 2] >> ((sq & 1) * 4)) & 15;
+            if (piece == PIECE_NONE)
+            {
+                empty++;
+                continue;
+            }
+            if (empty > 0)
+            {
+                fen[length++] = static_cast<char>('0' + empty);
+                empty = 0;
+            }
+            fen[length++] = pieceToFenChar(piece);
+        }
+        if (empty > 0)
+        {
+            fen[length++] = static_cast<char>('0' + empty);
+        }
+        fen[length++] = rank > 0 ? '/' : ' ';
+    }
+    fen[length++] = keyframe.whiteToMove ? 'w' : 'b';
+    fen[length++] = ' ';
+    const char castleLetters[] = "KQkq";
+    const unsigned char castleBits[] = { CASTLE_WK, CASTLE_WQ, CASTLE_BK, CASTLE_BQ };
+    int rights = 0;
+    for (int it = 0; it < 4; it++)
+    {
+        if (keyframe.castling & castleBits[it])
+        {
+            fen[length++] = castleLetters[it];
+            rights++;
+        }
+    }
+    if (rights == 0)
+    {
+        fen[length++] = '-';
+    }
+    fen[length++] = ' ';
+    if (keyframe.epSquare < 64)
+    {
+        fen[length++] = static_cast<char>('a' + fileOf(keyframe.epSquare));
+        fen[length++] = static_cast<char>('1' + rankOf(keyframe.epSquare));
+    }
+    else
+    {
+        fen[length++] = '-';
+    }
+    snprintf(fen + length, sizeof(fen) - length, " %u %u", keyframe.halfmoves, keyframe.ply / 2u + 1u);
+    return position.setFromFen(fen);
+}
+
+// destructor function
+gameRecorder::~gameRecorder()
+{
+    close();
+}
+
+// Start a new record file named after the time
+// Inputs: directory, start position
+// Output: true if the file was created
+bool gameRecorder::open(const std::string& directory, const chessPosition& start)
+{
+    close();
+    CreateDirectoryA(directory.c_str(), NULL);
+
+    std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "game_%Y%m%d_%H%M%S", std::localtime(&now));
+    // Games started within the same second get a counter
+    for (int it = 1; it < 100 && file == nullptr; it++)
+    {
+        filePath = directory + "/" + stamp + (it > 1 ? "_" + std::to_string(it) : std::string()) + GAME_RECORD_EXTENSION;
+        FILE* existing = fopen(filePath.c_str(), "rb");
+        if (existing != nullptr)
+        {
+            fclose(existing);
+            continue;
+        }
+        file = fopen(filePath.c_str(), "wb");
+    }
+    if (file == nullptr)
+    {
+        std::cerr << "Game record: can not create a file in " << directory << std::endl;
+        filePath.clear();
+        return false;
+    }
+    // Our buffer is the only copy, stdio passes writes straight through
+    setvbuf(file, nullptr, _IONBF, 0);
+
+    used = 0;
+    moveCount = 0;
+    jumpPending = false;
+    bytesWritten = 0;
+    writes = 0;
+    startTime = std::chrono::steady_clock::now();
+
+    recordHeaderT* header = static_cast<recordHeaderT*>(reserve(sizeof(recordHeaderT)));
+    std::memset(header, 0, sizeof(recordHeaderT));
+    std::memcpy(header->magic, GAME_RECORD_MAGIC, sizeof(header->magic));
+    header->version = GAME_RECORD_VERSION;
+    header->keyframeInterval = GAME_RECORD_KEYFRAME_INTERVAL;
+    header->startTime = static_cast<int64_t>(now);
+    std::string fen = start.toFen();
+    std::memcpy(header->startFen, fen.c_str(), (std::min)(fen.size(), sizeof(header->startFen) - 1));
+    // Every seek finds a keyframe at or before its move
+    appendKeyframe(start, 0);
+    return flush();
+}
+
+// Write what is buffered and close the file
+// Inputs: None
+// Output: None
+void gameRecorder::close()
+{
+    if (file == nullptr)
+    {
+        return;
+    }
+    flush();
+    fclose(file);
+    file = nullptr;
+    filePath.clear();
+}
+
+// Check for an open record
+// Inputs: None
+// Output: true if recording
+bool gameRecorder::isOpen() const
+{
+    return file != nullptr;
+}
+
+// Room for the next record in the write buffer
+// Inputs: record size
+// Output: record memory (the buffer is written out first if full)
+void* gameRecorder::reserve(size_t size)
+{
+    if (used + size > GAME_RECORD_BUFFER_SIZE)
+    {
+        flush();
+    }
+    void* slot = buffer + used;
+    used += size;
+    return slot;
+}
+
+// Append a keyframe
+// Inputs: position, RECORD_JUMP or 0
+// Output: None
+void gameRecorder::appendKeyframe(const chessPosition& position, uint8_t flags)
+{
+    recordKeyframeT* keyframe = static_cast<recordKeyframeT*>(reserve(sizeof(recordKeyframeT)));
+    keyframe->kind = RECORD_KEYFRAME;
+    keyframe->flags = flags;
+    keyframe->reserved = 0;
+    keyframe->moveIndex = moveCount;
+    keyframe->reserved2 = 0;
+    packKeyframe(position, *keyframe);
+}
+
+// Append a move
+// Inputs: move played, position after it, RECORD_BY_*, evaluation (nullptr if none)
+// Output: None
+void gameRecorder::appendMove(chessMove move, const chessPosition& position, uint8_t source, const recordEvalT* eval)
+{
+    if (file == nullptr)
+    {
+        return;
+    }
+    if (jumpPending)
+    {
+        appendKeyframe(jumpPosition, RECORD_JUMP);
+        jumpPending = false;
+    }
+
+    recordMoveT* record = static_cast<recordMoveT*>(reserve(sizeof(recordMoveT)));
+    record->kind = RECORD_MOVE;
+    record->flags = source & RECORD_SOURCE_MASK;
+    record->move = move;
+    record->eval = 0;
+    record->depth = 0;
+    record->reserved = 0;
+    record->timeMs = static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count());
+    record->engineMs = RECORD_NO_TIME;
+    if (eval != nullptr)
+    {
+        if (eval->hasScore)
+        {
+            // The engine scored the position before the move, for the side that played it
+            int score = position.isWhiteToMove() ? -eval->score : eval->score;
+            record->flags |= RECORD_HAS_EVAL | (eval->isMate ? RECORD_EVAL_MATE : 0);
+            record->eval = static_cast<int16_t>((std::max)(-32767, (std::min)(32767, score)));
+            record->depth = static_cast<uint8_t>((std::max)(0, (std::min)(255, eval->depth)));
+        }
+        if (eval->engineMs >= 0)
+        {
+            record->engineMs = static_cast<uint32_t>(eval->engineMs);
+        }
+    }
+    moveCount++;
+
+    if (moveCount % GAME_RECORD_KEYFRAME_INTERVAL == 0)
+    {
+        appendKeyframe(position, 0);
+        // A crash loses at most the moves since the last keyframe
+        flush();
+    }
+}
+
+// The game continues from another position (undo, jump, variation)
+// Inputs: position now on the board
+// Output: None
+void gameRecorder::jump(const chessPosition& position)
+{
+    // Only the last position matters when the player scrubs through the game
+    jumpPosition = position;
+    jumpPending = true;
+}
+
+// Hand the buffered records to the OS
+// Inputs: None
+// Output: true if written
+bool gameRecorder::flush()
+{
+    if (file == nullptr || used == 0)
+    {
+        return file != nullptr;
+    }
+    bool written = fwrite(buffer, 1, used, file) == used;
+    if (!written)
+    {
+        std::cerr << "Game record: write failed (" << filePath << ")" << std::endl;
+    }
+    bytesWritten += used;
+    writes++;
+    used = 0;
+    return written;
+}
+
+// Get the record path
+// Inputs: None
+// Output: path ("" when closed)
+const std::string& gameRecorder::getPath() const
+{
+    return filePath;
+}
+
+// Get the moves recorded
+// Inputs: None
+// Output: count
+uint32_t gameRecorder::getMoveCount() const
+{
+    return moveCount;
+}
+
+// Get the bytes handed to the OS and the write calls it took
+// Inputs: byte count, write count
+// Output: None
+void gameRecorder::getWriteStats(unsigned long long& bytes, unsigned int& calls) const
+{
+    bytes = bytesWritten;
+    calls = writes;
+}
+
+// Map a record and index its moves and keyframes
+// Inputs: file path
+// Output: true if it is a game record (a cut off tail is dropped)
+bool gameReplay::open(const std::string& filePath)
+{
+    close();
+    if (!file.open(filePath) || file.size() < sizeof(recordHeaderT))
+    {
+        close();
+        return false;
+    }
+    header = reinterpret_cast<const recordHeaderT*>(file.data());
+    if (std::memcmp(header->magic, GAME_RECORD_MAGIC, sizeof(header->magic)) != 0 || header->version != GAME_RECORD_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    // One pass over the records, a seek then touches only the pages it needs
+    size_t offset = sizeof(recordHeaderT);
+    while (offset < file.size())
+    {
+        uint8_t kind = file.data()[offset];
+        size_t size = kind == RECORD_MOVE ? sizeof(recordMoveT) : kind == RECORD_KEYFRAME ? sizeof(recordKeyframeT) : 0;
+        if (size == 0 || offset + size > file.size())
+        {
+            break;
+        }
+        (kind == RECORD_MOVE ? moveOffsets : keyframeOffsets).push_back(static_cast<uint32_t>(offset));
+        offset += size;
+    }
+    if (keyframeOffsets.empty() || keyframeAt(keyframeOffsets[0]).moveIndex != 0)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// Unmap the record
+// Inputs: None
+// Output: None
+void gameReplay::close()
+{
+    file.close();
+    header = nullptr;
+    moveOffsets.clear();
+    keyframeOffsets.clear();
+}
+
+// Keyframe at an offset
+// Inputs: byte offset
+// Output: keyframe in the mapping
+const recordKeyframeT& gameReplay::keyframeAt(uint32_t offset) const
+{
+    return *reinterpret_cast<const recordKeyframeT*>(file.data() + offset);
+}
+
+// Get the header
+// Inputs: None
+// Output: header in the mapping
+const recordHeaderT& gameReplay::getHeader() const
+{
+    return *header;
+}
+
+// Get the moves recorded
+// Inputs: None
+// Output: count
+uint32_t gameReplay::getMoveCount() const
+{
+    return static_cast<uint32_t>(moveOffsets.size());
+}
+
+// Get the keyframes recorded
+// Inputs: None
+// Output: count
+uint32_t gameReplay::getKeyframeCount() const
+{
+    return static_cast<uint32_t>(keyframeOffsets.size());
+}
+
+// Get a move record
+// Inputs: move index (0 based)
+// Output: record in the mapping
+const recordMoveT& gameReplay::moveAt(uint32_t index) const
+{
+    return *reinterpret_cast<const recordMoveT*>(file.data() + moveOffsets[index]);
+}
+
+// Position after a number of moves: nearest keyframe, then the moves after it
+// Inputs: moves to play (0 is the start), position to fill
+// Output: false if out of range or a move does not apply
+bool gameReplay::seek(uint32_t moves, chessPosition& position) const
+{
+    if (header == nullptr || moves > moveOffsets.size())
+    {
+        return false;
+    }
+    // Keyframes are in move order: the last one before the move, or a periodic one right at it
+    // (a jump keyframe at the same index comes after that move was played)
+    auto next = std::upper_bound(keyframeOffsets.begin(), keyframeOffsets.end(), moves,
+                                 [this](uint32_t target, uint32_t offset) { return target < keyframeAt(offset).moveIndex; });
+    size_t base = static_cast<size_t>(next - keyframeOffsets.begin());
+    while (base > 0)
+    {
+        const recordKeyframeT& candidate = keyframeAt(keyframeOffsets[base - 1]);
+        if (candidate.moveIndex < moves || (candidate.flags & RECORD_JUMP) == 0)
+        {
+            break;
+        }
+        base--;
+    }
+    if (base == 0 || !unpackKeyframe(keyframeAt(keyframeOffsets[base - 1]), position))
+    {
+        return false;
+    }
+
+    uint32_t played = keyframeAt(keyframeOffsets[base - 1]).moveIndex;
+    size_t offset = keyframeOffsets[base - 1] + sizeof(recordKeyframeT);
+    while (played < moves)
+    {
+        uint8_t kind = file.data()[offset];
+        if (kind == RECORD_MOVE)
+        {
+            if (!position.applyMove(moveAt(played).move))
+            {
+                return false;
+            }
+            played++;
+            offset += sizeof(recordMoveT);
+        }
+        else
+        {
+            const recordKeyframeT& keyframe = keyframeAt(static_cast<uint32_t>(offset));
+            if ((keyframe.flags & RECORD_JUMP) && !unpackKeyframe(keyframe, position))
+            {
+                return false;
+            }
+            offset += sizeof(recordKeyframeT);
+        }
+    }
+    return true;
+}
+
+// Check every periodic keyframe against the moves replayed up to it
+// Inputs: None
+// Output: index of the first keyframe that differs (the keyframe count if none)
+uint32_t gameReplay::verify() const
+{
+    chessPosition position;
+    recordKeyframeT replayed;
+    uint32_t played = 0;
+    for (uint32_t it = 0; it < keyframeOffsets.size(); it++)
+    {
+        const recordKeyframeT& keyframe = keyframeAt(keyframeOffsets[it]);
+        for (; played < keyframe.moveIndex; played++)
+        {
+            position.applyMove(moveAt(played).move);
+        }
+        if (it == 0 || (keyframe.flags & RECORD_JUMP))
+        {
+            unpackKeyframe(keyframe, position);
+            continue;
+        }
+        packKeyframe(position, replayed);
+        if (std::memcmp(replayed.board, keyframe.board, offsetof(recordKeyframeT, reserved2) - offsetof(recordKeyframeT, board)) != 0)
+        {
+            return it;
+        }
+    }
+    return static_cast<uint32_t>(keyframeOffsets.size());
+}
+
+// Evaluation column of a move ("+0.35/18", "#-3/22", "book")
+static std::string formatRecordEval(const recordMoveT& record)
+{
+    const char* sources[] = { "player", "engine", "book", "tablebase" };
+    if ((record.flags & RECORD_HAS_EVAL) == 0)
+    {
+        return sources[record.flags & RECORD_SOURCE_MASK];
+    }
+    char text[32];
+    if (record.flags & RECORD_EVAL_MATE)
+    {
+        snprintf(text, sizeof(text), "#%d/%u", record.eval, record.depth);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "%+.2f/%u", record.eval / 100.0, record.depth);
+    }
+    return text;
+}
+
+// Command line entry for "--replay"
+// Inputs: program arguments
+// Output: process exit code
+int gameReplayMain(int argc, char* argv[])
+{
+    std::string path;
+    long long seekTo = -1;
+    bool bench = false;
+    bool valid = argc > 2;
+    for (int i = 2; i < argc && valid; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--seek" && i + 1 < argc)
+        {
+            // A whole, non-negative move count (anything else ends in the usage text)
+            std::string value = argv[++i];
+            size_t used = 0;
+            try
+            {
+                seekTo = std::stoll(value, &used);
+            }
+            catch (const std::exception&)
+            {
+                valid = false;
+            }
+            valid = valid && used == value.size() && seekTo >= 0;
+        }
+        else if (arg == "--bench") bench = true;
+        else if (path.empty()) path = arg;
+        else valid = false;
+    }
+    gameReplay replay;
+    if (!valid || path.empty())
+    {
+        std::cerr << "Usage: Lab3 --replay <game.ecgr> [--seek MOVES] [--bench]" << std::endl;
+        return -1;
+    }
+    if (!replay.open(path))
+    {
+        std::cerr << "Not a game record: " << path << std::endl;
+        return -1;
+    }
+
+    const recordHeaderT& header = replay.getHeader();
+    std::time_t started = static_cast<std::time_t>(header.startTime);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", std::localtime(&started));
+    std::cout << "Game of " << stamp << ", " << replay.getMoveCount() << " moves, " << replay.getKeyframeCount()
+              << " keyframes" << std::endl;
+    std::cout << "Start: " << header.startFen << std::endl;
+
+    if (seekTo >= 0)
+    {
+        // One position, e.g. to hand to --bench-fen
+        chessPosition position;
+        if (seekTo > replay.getMoveCount() || !replay.seek(static_cast<uint32_t>(seekTo), position))
+        {
+            std::cerr << "No position after " << seekTo << " moves" << std::endl;
+            return -1;
+        }
+        std::cout << "After " << seekTo << " moves: " << position.toFen() << std::endl;
+        return 0;
+    }
+
+    // Move list with what was known when each move was played
+    for (uint32_t it = 0; it < replay.getMoveCount(); it++)
+    {
+        const recordMoveT& record = replay.moveAt(it);
+        std::cout << it + 1 << ". " << moveToUci(record.move) << "  " << formatRecordEval(record) << "  at "
+                  << record.timeMs / 1000.0 << " s";
+        if (record.engineMs != RECORD_NO_TIME)
+        {
+            std::cout << " (engine " << record.engineMs << " ms)";
+        }
+        std::cout << std::endl;
+    }
+
+    if (bench)
+    {
+        uint32_t mismatch = replay.verify();
+        if (mismatch < replay.getKeyframeCount())
+        {
+            std::cout << "Keyframe " << mismatch << " does not match the moves before it" << std::endl;
+            return 1;
+        }
+        // Every position of the game, each from its own keyframe
+        chessPosition position;
+        const int rounds = 100;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+        {
+            for (uint32_t it = 0; it <= replay.getMoveCount(); it++)
+            {
+                replay.seek(it, position);
+            }
+        }
+        double seekUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() /
+                        (rounds * (replay.getMoveCount() + 1.0));
+        std::cout << "Keyframes consistent, seek " << seekUs << " us average" << std::endl;
+    }
+    return 0;
+}
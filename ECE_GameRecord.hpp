@@ -0,0 +1,244 @@
+/*
+
+Objective:
+Binary game records: a header with the start position, then fixed-size
+records for every move (16-bit move, time stamp, engine evaluation) and a
+packed keyframe position every few moves. The recorder builds records in
+place in its write buffer and hands full blocks to the OS; the replay side
+maps a record read-only and seeks to any move from the nearest keyframe.
+*/
+
+#ifndef ECE_GAME_RECORD_HPP
+#define ECE_GAME_RECORD_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "ECE_ChessPosition.hpp"
+#include "ECE_MappedFile.hpp"
+
+// Default location of the records, one file per game
+const char GAME_RECORD_DIR[] = "Lab3/games";
+const char GAME_RECORD_EXTENSION[] = ".ecgr";
+const char GAME_RECORD_MAGIC[4] = { 'E', 'C', 'G', 'R' };
+const uint16_t GAME_RECORD_VERSION = 1;
+// Moves between keyframes (a seek replays at most this many moves)
+const uint16_t GAME_RECORD_KEYFRAME_INTERVAL = 16;
+// Write buffer, handed to the OS when full, at keyframes and on close
+const size_t GAME_RECORD_BUFFER_SIZE = 4096;
+
+// Record kinds (first byte of every record)
+const uint8_t RECORD_MOVE = 1;
+const uint8_t RECORD_KEYFRAME = 2;
+
+// Move flags: who played it and what the evaluation holds
+const uint8_t RECORD_BY_PLAYER = 0;
+const uint8_t RECORD_BY_ENGINE = 1;
+const uint8_t RECORD_BY_BOOK = 2;
+const uint8_t RECORD_BY_TABLEBASE = 3;
+const uint8_t RECORD_SOURCE_MASK = 3;
+const uint8_t RECORD_HAS_EVAL = 4;
+const uint8_t RECORD_EVAL_MATE = 8;
+// Keyframe flag: the game left the recorded line here (undo, jump, variation)
+const uint8_t RECORD_JUMP = 1;
+// Engine time not reported
+const uint32_t RECORD_NO_TIME = 0xFFFFFFFF;
+// En passant square byte when there is none
+const uint8_t RECORD_NO_SQUARE = 64;
+
+// File header (128 bytes)
+typedef struct
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t keyframeInterval;
+    // Wall clock start (seconds since 1970)
+    int64_t startTime;
+    // Start position, zero padded
+    char startFen[112];
+} recordHeaderT;
+
+// One move (16 bytes)
+typedef struct
+{
+    uint8_t kind;
+    uint8_t flags;
+    // chessMove encoding (from, to, promotion)
+    uint16_t move;
+    // White's view: centipawns, or moves to mate (negative when black mates)
+    int16_t eval;
+    uint8_t depth;
+    uint8_t reserved;
+    // Since the record was opened
+    uint32_t timeMs;
+    // Search time the engine reported (RECORD_NO_TIME if none)
+    uint32_t engineMs;
+} recordMoveT;
+
+// Position snapshot (48 bytes)
+typedef struct
+{
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t reserved;
+    // Move records before this keyframe
+    uint32_t moveIndex;
+    // Piece codes a1..h8, two squares per byte (low nibble first)
+    uint8_t board[32];
+    uint8_t whiteToMove;
+    uint8_t castling;
+    uint8_t epSquare;
+    uint8_t halfmoves;
+    uint16_t ply;
+    uint16_t reserved2;
+} recordKeyframeT;
+
+static_assert(sizeof(recordHeaderT) == 128, "game record header layout");
+static_assert(sizeof(recordMoveT) == 16, "game record move layout");
+static_assert(sizeof(recordKeyframeT) == 48, "game record keyframe layout");
+
+// Evaluation attached to a recorded move
+typedef struct
+{
+    bool hasScore;
+    bool isMate;
+    // Side to move's view, as the engine reports it
+    int score;
+    int depth;
+    // Engine search time (-1 if unknown)
+    long long engineMs;
+} recordEvalT;
+
+class gameRecorder
+{
+private:
+    FILE* file = nullptr;
+    std::string filePath;
+    // Records are built in place here and written straight from it
+    alignas(8) unsigned char buffer[GAME_RECORD_BUFFER_SIZE];
+    size_t used = 0;
+    uint32_t moveCount = 0;
+    // Position the game jumped to, written before the next move
+    chessPosition jumpPosition;
+    bool jumpPending = false;
+    std::chrono::steady_clock::time_point startTime;
+    unsigned long long bytesWritten = 0;
+    unsigned int writes = 0;
+
+    // Room for the next record in the write buffer
+    // Inputs: record size
+    // Output: record memory (the buffer is written out first if full)
+    void* reserve(size_t size);
+    // Append a keyframe
+    // Inputs: position, RECORD_JUMP or 0
+    // Output: None
+    void appendKeyframe(const chessPosition& position, uint8_t flags);
+
+public:
+    // destructor function
+    ~gameRecorder();
+    // Start a new record file named after the time
+    // Inputs: directory, start position
+    // Output: true if the file was created
+    bool open(const std::string& directory, const chessPosition& start);
+    // Write what is buffered and close the file
+    // Inputs: None
+    // Output: None
+    void close();
+    // Check for an open record
+    // Inputs: None
+    // Output: true if recording
+    bool isOpen() const;
+    // Append a move
+    // Inputs: move played, position after it, RECORD_BY_*, evaluation (nullptr if none)
+    // Output: None
+    void appendMove(chessMove move, const chessPosition& position, uint8_t source, const recordEvalT* eval);
+    // The game continues from another position (undo, jump, variation)
+    // Inputs: position now on the board
+    // Output: None
+    void jump(const chessPosition& position);
+    // Hand the buffered records to the OS
+    // Inputs: None
+    // Output: true if written
+    bool flush();
+    // Get the record path
+    // Inputs: None
+    // Output: path ("" when closed)
+    const std::string& getPath() const;
+    // Get the moves recorded
+    // Inputs: None
+    // Output: count
+    uint32_t getMoveCount() const;
+    // Get the bytes handed to the OS and the write calls it took
+    // Inputs: byte count, write count
+    // Output: None
+    void getWriteStats(unsigned long long& bytes, unsigned int& calls) const;
+};
+
+class gameReplay
+{
+private:
+    mappedFile file;
+    const recordHeaderT* header = nullptr;
+    // Offsets of the move records, and of the keyframes by move index
+    std::vector<uint32_t> moveOffsets;
+    std::vector<uint32_t> keyframeOffsets;
+
+    // Keyframe at an offset
+    // Inputs: byte offset
+    // Output: keyframe in the mapping
+    const recordKeyframeT& keyframeAt(uint32_t offset) const;
+
+public:
+    // Map a record and index its moves and keyframes
+    // Inputs: file path
+    // Output: true if it is a game record (a cut off tail is dropped)
+    bool open(const std::string& filePath);
+    // Unmap the record
+    // Inputs: None
+    // Output: None
+    void close();
+    // Get the header
+    // Inputs: None
+    // Output: header in the mapping
+    const recordHeaderT& getHeader() const;
+    // Get the moves recorded
+    // Inputs: None
+    // Output: count
+    uint32_t getMoveCount() const;
+    // Get the keyframes recorded
+    // Inputs: None
+    // Output: count
+    uint32_t getKeyframeCount() const;
+    // Get a move record
+    // Inputs: move index (0 based)
+    // Output: record in the mapping
+    const recordMoveT& moveAt(uint32_t index) const;
+    // Position after a number of moves: nearest keyframe, then the moves after it
+    // Inputs: moves to play (0 is the start), position to fill
+    // Output: false if out of range or a move does not apply
+    bool seek(uint32_t moves, chessPosition& position) const;
+    // Check every periodic keyframe against the moves replayed up to it
+    // Inputs: None
+    // Output: index of the first keyframe that differs (the keyframe count if none)
+    uint32_t verify() const;
+};
+
+// Pack a position into a keyframe
+// Inputs: position, keyframe to fill
+// Output: None
+void packKeyframe(const chessPosition& position, recordKeyframeT& keyframe);
+
+// Unpack a keyframe
+// Inputs: keyframe, position to fill
+// Output: true if the keyframe holds a valid position
+bool unpackKeyframe(const recordKeyframeT& keyframe, chessPosition& position);
+
+// Command line entry for "--replay"
+// Inputs: program arguments
+// Output: process exit code
+int gameReplayMain(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+
+Objective:
+Latency histogram definition file
+*/
+
+#include "ECE_LatencyHistogram.hpp"
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+// Bucket of a latency in microseconds
+// Inputs: latency (us)
+// Output: bucket index
+static unsigned int bucketOf(double latencyUs)
+{
+    if (latencyUs <= 1.0)
+    {
+        return 0;
+    }
+    unsigned int bucket = static_cast<unsigned int>(std::log2(latencyUs) * LATENCY_SUB_BUCKETS);
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+// Constructor function
+latencyHistogram::latencyHistogram()
+{
+    reset();
+}
+
+// Clear all samples
+// Inputs: None
+// Output: None
+void latencyHistogram::reset()
+{
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        counts[i] = 0;
+    }
+    samples = 0;
+    totalUs = 0;
+    maxUs = 0;
+}
+
+// Record one sample (safe from any thread)
+// Inputs: latency in milliseconds
+// Output: None
+void latencyHistogram::record(double latencyMs)
+{
+    double latencyUs = latencyMs * 1000.0;
+    unsigned long long roundedUs = static_cast<unsigned long long>(latencyUs + 0.5);
+    counts[bucketOf(latencyUs)]++;
+    samples++;
+    totalUs += roundedUs;
+
+    unsigned long long previous = maxUs.load();
+    while (roundedUs > previous && !maxUs.compare_exchange_weak(previous, roundedUs))
+    {
+    }
+}
+
+// Get the number of samples
+// Inputs: None
+// Output: sample count
+unsigned long long latencyHistogram::count() const
+{
+    return samples.load();
+}
+
+// Get the mean latency
+// Inputs: None
+// Output: milliseconds
+double latencyHistogram::meanMs() const
+{
+    unsigned long long n = samples.load();
+    return n ? totalUs.load() / 1000.0 / n : 0.0;
+}
+
+// Get the largest latency
+// Inputs: None
+// Output: milliseconds
+double latencyHistogram::maxMs() const
+{
+    return maxUs.load() / 1000.0;
+}
+
+// Get a percentile (upper edge of the bucket it falls in)
+// Inputs: percentile in 0..100
+// Output: milliseconds
+double latencyHistogram::percentileMs(double percentile) const
+{
+    unsigned long long n = samples.load();
+    if (n == 0)
+    {
+        return 0.0;
+    }
+    unsigned long long rank = static_cast<unsigned long long>(std::ceil(percentile / 100.0 * n));
+    unsigned long long seen = 0;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += counts[i].load();
+        if (seen >= rank && seen > 0)
+        {
+            // Never report more than the real maximum
+            double upperMs = std::pow(2.0, static_cast<double>(i + 1) / LATENCY_SUB_BUCKETS) / 1000.0;
+            return upperMs < maxMs() ? upperMs : maxMs();
+        }
+    }
+    return maxMs();
+}
+
+// One line summary "n=.. mean=.. p50=.. p99=.. max=.."
+// Inputs: None
+// Output: text
+std::string latencyHistogram::summary() const
+{
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(2)
+         << "n=" << count() << " mean=" << meanMs() << "ms p50=" << percentileMs(50.0)
+         << "ms p99=" << percentileMs(99.0) << "ms max=" << maxMs() << "ms";
+    return text.str();
+}
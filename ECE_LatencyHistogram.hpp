@@ -0,0 +1,59 @@
+/*
+
+Objective:
+Lock-free latency histogram (log-linear buckets) for p50/p99 reporting
+*/
+
+#ifndef ECE_LATENCY_HISTOGRAM_HPP
+#define ECE_LATENCY_HISTOGRAM_HPP
+
+#include <atomic>
+#include <string>
+
+// Eight buckets per power of two (about 9% resolution)
+const unsigned int LATENCY_SUB_BUCKETS = 8;
+// 1 us up to 2^40 us
+const unsigned int LATENCY_BUCKETS = 40 * LATENCY_SUB_BUCKETS;
+
+class latencyHistogram
+{
+private:
+    std::atomic<unsigned long long> counts[LATENCY_BUCKETS];
+    std::atomic<unsigned long long> samples;
+    std::atomic<unsigned long long> totalUs;
+    std::atomic<unsigned long long> maxUs;
+
+public:
+    // Constructor function
+    latencyHistogram();
+    // Clear all samples
+    // Inputs: None
+    // Output: None
+    void reset();
+    // Record one sample (safe from any thread)
+    // Inputs: latency in milliseconds
+    // Output: None
+    void record(double latencyMs);
+    // Get the number of samples
+    // Inputs: None
+    // Output: sample count
+    unsigned long long count() const;
+    // Get the mean latency
+    // Inputs: None
+    // Output: milliseconds
+    double meanMs() const;
+    // Get the largest latency
+    // Inputs: None
+    // Output: milliseconds
+    double maxMs() const;
+    // Get a percentile (upper edge of the bucket it falls in)
+    // Inputs: percentile in 0..100
+    // Output: milliseconds
+    double percentileMs(double percentile) const;
+    // One line summary "n=.. mean=.. p50=.. p99=.. max=.."
+    // Inputs: None
+    // Output: text
+    std::string summary() const;
+};
+
+#endif
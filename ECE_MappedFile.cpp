@@ -0,0 +1,105 @@
+/*
+
+Objective:
+Read-only memory mapped file definition file
+*/
+
+#include "ECE_MappedFile.hpp"
+
+// Constructor function
+mappedFile::mappedFile()
+{
+}
+
+// Destructor function
+mappedFile::~mappedFile()
+{
+    // Release the view and the handles
+    close();
+}
+
+// Map a file read-only
+// Inputs: file path
+// Output: true if the whole file is mapped
+bool mappedFile::open(const std::string& filePath)
+{
+    // Drop any earlier mapping
+    close();
+
+    hFile = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER liSize;
+    if (!GetFileSizeEx(hFile, &liSize) || liSize.QuadPart == 0)
+    { // Empty files can not be mapped
+        close();
+        return false;
+    }
+    fileSize = static_cast<size_t>(liSize.QuadPart);
+
+    hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMapping == NULL)
+    {
+        close();
+        return false;
+    }
+
+    // Map the whole file, pages are faulted in on first touch
+    pData = static_cast<const unsigned char*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (pData == nullptr)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// Unmap the file and release the handles
+// Inputs: None
+// Output: None
+void mappedFile::close()
+{
+    if (pData != nullptr)
+    {
+        UnmapViewOfFile(pData);
+        pData = nullptr;
+    }
+    if (hMapping != NULL)
+    {
+        CloseHandle(hMapping);
+        hMapping = NULL;
+    }
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hFile);
+        hFile = INVALID_HANDLE_VALUE;
+    }
+    fileSize = 0;
+}
+
+// Check if a file is mapped
+// Inputs: None
+// Output: true if mapped
+bool mappedFile::isOpen() const
+{
+    return pData != nullptr;
+}
+
+// Get the mapped bytes
+// Inputs: None
+// Output: start of the view (nullptr if not mapped)
+const unsigned char* mappedFile::data() const
+{
+    return pData;
+}
+
+// Get the mapped size
+// Inputs: None
+// Output: size in bytes
+size_t mappedFile::size() const
+{
+    return fileSize;
+}
@@ -0,0 +1,54 @@
+/*
+
+Objective:
+Read-only memory mapped file (books, tablebases, weights, game records)
+*/
+
+#ifndef ECE_MAPPED_FILE_HPP
+#define ECE_MAPPED_FILE_HPP
+
+#include <string>
+#include <cstddef>
+#include <windows.h>
+
+class mappedFile
+{
+private:
+    // Win32 handles for the file and its mapping object
+    HANDLE hFile = INVALID_HANDLE_VALUE;
+    HANDLE hMapping = NULL;
+    // Mapped view and its size in bytes
+    const unsigned char* pData = nullptr;
+    size_t fileSize = 0;
+
+public:
+    // Constructor function
+    mappedFile();
+    // destructor function
+    ~mappedFile();
+    // The mapping owns OS handles, no copies
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+    // Map a file read-only
+    // Inputs: file path
+    // Output: true if the whole file is mapped
+    bool open(const std::string& filePath);
+    // Unmap the file and release the handles
+    // Inputs: None
+    // Output: None
+    void close();
+    // Check if a file is mapped
+    // Inputs: None
+    // Output: true if mapped
+    bool isOpen() const;
+    // Get the mapped bytes
+    // Inputs: None
+    // Output: start of the view (nullptr if not mapped)
+    const unsigned char* data() const;
+    // Get the mapped size
+    // Inputs: None
+    // Output: size in bytes
+    size_t size() const;
+};
+
+#endif
@@ -0,0 +1,574 @@
+/*
+
+Objective:
+NNUE evaluation definition file
+*/
+
+#include "ECE_Nnue.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// MSVC emits any intrinsic, GCC and Clang need the target per function
+#if defined(_MSC_VER)
+#define NNUE_TARGET_SSE41
+#define NNUE_TARGET_AVX2
+#else
+#define NNUE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define NNUE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Input feature of a piece seen from one side
+// Inputs: perspective (0 white, 1 black), piece code, square
+// Output: feature index
+static unsigned int featureIndex(int perspective, unsigned char piece, int square)
+{
+    int side = ((piece & PIECE_BLACK) ? 1 : 0) ^ perspective;
+    // Black sees the board from its own back rank
+    int relative = perspective ? square ^ 56 : square;
+    return static_cast<unsigned int>((side * 6 + (piece & PIECE_TYPE_MASK) - 1) * 64 + relative);
+}
+
+// Scalar accumulator update
+// Inputs: source, destination, added and removed feature weights
+// Output: None
+static void updateScalar(const short* src, short* dst, const short* const* adds, int addCount, const short* const* subs, int subCount)
+{
+    for (unsigned int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        int value = src[i];
+        for (int k = 0; k < addCount; k++)
+        {
+            value += adds[k][i];
+        }
+        for (int k = 0; k < subCount; k++)
+        {
+            value -= subs[k][i];
+        }
+        dst[i] = static_cast<short>(value);
+    }
+}
+
+// Scalar output layer
+// Inputs: side to move and opponent accumulators, output weights
+// Output: raw network output
+static int outputScalar(const short* us, const short* them, const short* weights)
+{
+    int sum = 0;
+    for (unsigned int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        int a = us[i] < 0 ? 0 : (us[i] > NNUE_QA ? NNUE_QA : us[i]);
+        int b = them[i] < 0 ? 0 : (them[i] > NNUE_QA ? NNUE_QA : them[i]);
+        sum += a * weights[i] + b * weights[NNUE_HIDDEN + i];
+    }
+    return sum;
+}
+
+// SSE4.1 accumulator update (8 lanes)
+// Inputs: source, destination, added and removed feature weights
+// Output: None
+NNUE_TARGET_SSE41 static void updateSse41(const short* src, short* dst, const short* const* adds, int addCount,
+                                          const short* const* subs, int subCount)
+{
+    for (unsigned int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        for (int k = 0; k < addCount; k++)
+        {
+            value = _mm_add_epi16(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(adds[k] + i)));
+        }
+        for (int k = 0; k < subCount; k++)
+        {
+            value = _mm_sub_epi16(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(subs[k] + i)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), value);
+    }
+}
+
+// SSE4.1 output layer (clip, multiply-add pairs, horizontal sum)
+// Inputs: side to move and opponent accumulators, output weights
+// Output: raw network output
+NNUE_TARGET_SSE41 static int outputSse41(const short* us, const short* them, const short* weights)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ceiling = _mm_set1_epi16(NNUE_QA);
+    __m128i sum = _mm_setzero_si128();
+    for (unsigned int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i a = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(us + i)), zero), ceiling);
+        __m128i b = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(them + i)), zero), ceiling);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i))));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(b, _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + NNUE_HIDDEN + i))));
+    }
+    return _mm_extract_epi32(sum, 0) + _mm_extract_epi32(sum, 1) + _mm_extract_epi32(sum, 2) + _mm_extract_epi32(sum, 3);
+}
+
+// AVX2 accumulator update (16 lanes)
+// Inputs: source, destination, added and removed feature weights
+// Output: None
+NNUE_TARGET_AVX2 static void updateAvx2(const short* src, short* dst, const short* const* adds, int addCount,
+                                        const short* const* subs, int subCount)
+{
+    for (unsigned int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        for (int k = 0; k < addCount; k++)
+        {
+            value = _mm256_add_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(adds[k] + i)));
+        }
+        for (int k = 0; k < subCount; k++)
+        {
+            value = _mm256_sub_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(subs[k] + i)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), value);
+    }
+}
+
+// AVX2 output layer (clip, multiply-add pairs, horizontal sum)
+// Inputs: side to move and opponent accumulators, output weights
+// Output: raw network output
+NNUE_TARGET_AVX2 static int outputAvx2(const short* us, const short* them, const short* weights)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ceiling = _mm256_set1_epi16(NNUE_QA);
+    __m256i sum = _mm256_setzero_si256();
+    for (unsigned int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i a = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(us + i)), zero), ceiling);
+        __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(them + i)), zero), ceiling);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i))));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(b, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + NNUE_HIDDEN + i))));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+}
+
+// Highest kernel level this CPU (and OS) supports
+// Inputs: None
+// Output: instruction set level
+nnueIsaT nnueSupportedIsa()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    // AVX registers must also be saved by the OS (OSXSAVE and XCR0 bits 1-2)
+    bool avxState = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = avxState && (info[1] & (1 << 5)) != 0;
+    }
+#else
+    bool sse41 = __builtin_cpu_supports("sse4.1");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return avx2 ? NNUE_AVX2 : (sse41 ? NNUE_SSE41 : NNUE_SCALAR);
+}
+
+// Name of a kernel level
+// Inputs: instruction set level
+// Output: "AVX2", "SSE4.1" or "scalar"
+const char* nnueIsaName(nnueIsaT isa)
+{
+    return isa == NNUE_AVX2 ? "AVX2" : (isa == NNUE_SSE41 ? "SSE4.1" : "scalar");
+}
+
+// Map a network file
+// Inputs: file path
+// Output: true if the header and size match this build
+bool nnueNetwork::load(const std::string& filePath)
+{
+    ownedWeights.clear();
+    featureWeights = featureBias = outputWeights = nullptr;
+    if (!weightsFile.open(filePath))
+    {
+        return false;
+    }
+
+    // Header, then int16 feature weights, int16 biases, int16 output weights, int32 output bias
+    size_t expected = NNUE_HEADER_SIZE + sizeof(short) * (NNUE_INPUTS * NNUE_HIDDEN + 3 * NNUE_HIDDEN) + sizeof(int);
+    unsigned int header[4] = { 0 };
+    if (weightsFile.size() >= NNUE_HEADER_SIZE)
+    {
+        memcpy(header, weightsFile.data(), sizeof(header));
+    }
+    if (weightsFile.size() != expected || header[0] != NNUE_MAGIC || header[1] != NNUE_VERSION ||
+        header[2] != NNUE_INPUTS || header[3] != NNUE_HIDDEN)
+    {
+        std::cout << "Network " << filePath << " does not match this build (" << NNUE_INPUTS << "x" << NNUE_HIDDEN
+                  << ", version " << NNUE_VERSION << ")" << std::endl;
+        weightsFile.close();
+        return false;
+    }
+
+    // Used in place, pages are faulted in as features are first touched
+    const short* weights = reinterpret_cast<const short*>(weightsFile.data() + NNUE_HEADER_SIZE);
+    featureWeights = weights;
+    featureBias = featureWeights + NNUE_INPUTS * NNUE_HIDDEN;
+    outputWeights = featureBias + NNUE_HIDDEN;
+    memcpy(&outputBias, outputWeights + 2 * NNUE_HIDDEN, sizeof(int));
+    return true;
+}
+
+// Fill the network with random weights (speed tests only, scores are meaningless)
+// Inputs: random seed
+// Output: None
+void nnueNetwork::randomize(unsigned int seed)
+{
+    weightsFile.close();
+    std::mt19937 rng(seed);
+    // Small enough that 32 pieces never overflow the int16 accumulator
+    std::uniform_int_distribution<int> range(-NNUE_QB, NNUE_QB);
+    ownedWeights.resize(NNUE_INPUTS * NNUE_HIDDEN + 3 * NNUE_HIDDEN);
+    for (auto& weight : ownedWeights)
+    {
+        weight = static_cast<short>(range(rng));
+    }
+    featureWeights = ownedWeights.data();
+    featureBias = featureWeights + NNUE_INPUTS * NNUE_HIDDEN;
+    outputWeights = featureBias + NNUE_HIDDEN;
+    outputBias = 0;
+}
+
+// Check if weights are present
+// Inputs: None
+// Output: true if loaded or generated
+bool nnueNetwork::isLoaded() const
+{
+    return featureWeights != nullptr;
+}
+
+// Weights of one input feature
+// Inputs: feature index
+// Output: NNUE_HIDDEN weights
+const short* nnueNetwork::feature(unsigned int index) const
+{
+    return featureWeights + index * NNUE_HIDDEN;
+}
+
+// First layer biases
+// Inputs: None
+// Output: NNUE_HIDDEN biases
+const short* nnueNetwork::bias() const
+{
+    return featureBias;
+}
+
+// Output layer weights (side to move half first)
+// Inputs: None
+// Output: 2 * NNUE_HIDDEN weights
+const short* nnueNetwork::output() const
+{
+    return outputWeights;
+}
+
+// Output layer bias
+// Inputs: None
+// Output: bias (scaled by QA * QB)
+int nnueNetwork::outputOffset() const
+{
+    return outputBias;
+}
+
+// Constructor function
+// Inputs: network, kernel level (clamped to what the CPU supports)
+nnueEvaluator::nnueEvaluator(const nnueNetwork& cNetwork, nnueIsaT cIsa) : network(cNetwork), stack(NNUE_MAX_PLY + 1)
+{
+    nnueIsaT supported = nnueSupportedIsa();
+    isa = (cIsa > supported) ? supported : cIsa;
+    if (isa == NNUE_AVX2)
+    {
+        kernels = { updateAvx2, outputAvx2 };
+    }
+    else if (isa == NNUE_SSE41)
+    {
+        kernels = { updateSse41, outputSse41 };
+    }
+    else
+    {
+        kernels = { updateScalar, outputScalar };
+    }
+}
+
+// Kernel level in use
+// Inputs: None
+// Output: instruction set level
+nnueIsaT nnueEvaluator::getIsa() const
+{
+    return isa;
+}
+
+// Rebuild the root accumulator from every piece (empties the stack)
+// Inputs: position
+// Output: None
+void nnueEvaluator::reset(const chessPosition& position)
+{
+    ply = 0;
+    nnueAccumulatorT& root = stack[0];
+    for (int perspective = 0; perspective < 2; perspective++)
+    {
+        memcpy(root.values[perspective], network.bias(), sizeof(root.values[perspective]));
+        for (int square = 0; square < 64; square++)
+        {
+            unsigned char piece = position.pieceAt(square);
+            if (piece != PIECE_NONE)
+            {
+                const short* add = network.feature(featureIndex(perspective, piece, square));
+                kernels.update(root.values[perspective], root.values[perspective], &add, 1, nullptr, 0);
+            }
+        }
+    }
+}
+
+// Make: derive the next accumulator from the move's feature changes
+// Inputs: position before the move, move
+// Output: false if the stack is full
+bool nnueEvaluator::push(const chessPosition& position, chessMove move)
+{
+    if (ply + 1 >= stack.size())
+    {
+        return false;
+    }
+
+    // Same board changes as chessPosition::applyMove
+    int from = moveFrom(move);
+    int to = moveTo(move);
+    unsigned char piece = position.pieceAt(from);
+    unsigned char colour = piece & PIECE_BLACK;
+    int type = piece & PIECE_TYPE_MASK;
+    unsigned char removed[NNUE_MAX_CHANGES], added[NNUE_MAX_CHANGES];
+    int removedSquares[NNUE_MAX_CHANGES], addedSquares[NNUE_MAX_CHANGES];
+    int removedCount = 0, addedCount = 0;
+
+    removed[removedCount] = piece;
+    removedSquares[removedCount++] = from;
+    unsigned char placed = piece;
+    if (type == PIECE_PAWN && (rankOf(to) == 0 || rankOf(to) == 7))
+    {
+        placed = static_cast<unsigned char>((movePromotion(move) != PIECE_NONE ? movePromotion(move) : PIECE_QUEEN) | colour);
+    }
+    added[addedCount] = placed;
+    addedSquares[addedCount++] = to;
+
+    if (position.pieceAt(to) != PIECE_NONE)
+    {
+        removed[removedCount] = position.pieceAt(to);
+        removedSquares[removedCount++] = to;
+    }
+    else if (type == PIECE_PAWN && to == position.enPassantSquare() && fileOf(from) != fileOf(to))
+    {
+        int victim = squareOf(fileOf(to), rankOf(from));
+        removed[removedCount] = position.pieceAt(victim);
+        removedSquares[removedCount++] = victim;
+    }
+    else if (type == PIECE_KING && (fileOf(to) - fileOf(from) == 2 || fileOf(from) - fileOf(to) == 2))
+    {
+        int rank = rankOf(from);
+        bool kingSide = fileOf(to) > fileOf(from);
+        removed[removedCount] = position.pieceAt(squareOf(kingSide ? 7 : 0, rank));
+        removedSquares[removedCount++] = squareOf(kingSide ? 7 : 0, rank);
+        added[addedCount] = removed[removedCount - 1];
+        addedSquares[addedCount++] = squareOf(kingSide ? 5 : 3, rank);
+    }
+
+    // Parent plus the changed feature rows, one pass per perspective
+    const nnueAccumulatorT& parent = stack[ply];
+    nnueAccumulatorT& child = stack[ply + 1];
+    for (int perspective = 0; perspective < 2; perspective++)
+    {
+        const short* adds[NNUE_MAX_CHANGES];
+        const short* subs[NNUE_MAX_CHANGES];
+        for (int k = 0; k < addedCount; k++)
+        {
+            adds[k] = network.feature(featureIndex(perspective, added[k], addedSquares[k]));
+        }
+        for (int k = 0; k < removedCount; k++)
+        {
+            subs[k] = network.feature(featureIndex(perspective, removed[k], removedSquares[k]));
+        }
+        kernels.update(parent.values[perspective], child.values[perspective], adds, addedCount, subs, removedCount);
+    }
+    ply++;
+    return true;
+}
+
+// Unmake the last pushed move
+// Inputs: None
+// Output: None
+void nnueEvaluator::pop()
+{
+    if (ply > 0)
+    {
+        ply--;
+    }
+}
+
+// Evaluate the current accumulator
+// Inputs: side to move (true for white)
+// Output: centipawns from the side to move's view
+int nnueEvaluator::evaluate(bool whiteToMove) const
+{
+    const nnueAccumulatorT& current = stack[ply];
+    int us = whiteToMove ? 0 : 1;
+    long long raw = kernels.output(current.values[us], current.values[us ^ 1], network.output()) + network.outputOffset();
+    return static_cast<int>(raw * NNUE_SCALE / (NNUE_QA * NNUE_QB));
+}
+
+// Command line entry for "--bench-nnue"
+// Inputs: program arguments
+// Output: process exit code
+int nnueBenchmarkMain(int argc, char* argv[])
+{
+    std::string networkPath = NNUE_FILE;
+    int iterations = 2000;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc)
+        {
+            // Anything but a whole number in range ends in the usage text
+            std::string value = argv[++i];
+            size_t used = 0;
+            try
+            {
+                iterations = std::stoi(value, &used);
+            }
+            catch (const std::exception&)
+            {
+                iterations = 0;
+            }
+            if (used != value.size()) iterations = 0;
+        }
+        else networkPath = arg;
+    }
+    if (iterations <= 0)
+    {
+        std::cerr << "Usage: Lab3 --bench-nnue [network.nnue] [--iterations N]" << std::endl;
+        return -1;
+    }
+
+    nnueNetwork network;
+    if (!network.load(networkPath))
+    {
+        std::cout << "No network at " << networkPath << ", timing random weights (scores are meaningless)" << std::endl;
+        network.randomize(1);
+    }
+
+    // Opening, middlegame (castling, en passant, promotions) and endgame positions
+    const char* fens[] = {
+        START_FEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/3PP3/5N2/PPP2PPP/RNBQKB1R b KQkq d3 0 3",
+    };
+    std::vector<chessPosition> positions;
+    std::vector<std::vector<chessMove>> moveLists;
+    for (const char* fen : fens)
+    {
+        chessPosition position;
+        position.setFromFen(fen);
+        chessMove moves[MAX_MOVES];
+        int count = position.generateLegalMoves(moves);
+        positions.push_back(position);
+        moveLists.push_back(std::vector<chessMove>(moves, moves + count));
+    }
+
+    // Every level must agree with the scalar kernels, and make/unmake with a full rebuild
+    std::vector<int> reference;
+    nnueIsaT supported = nnueSupportedIsa();
+    std::cout << "CPU supports up to " << nnueIsaName(supported) << std::endl;
+    for (int level = NNUE_SCALAR; level <= supported; level++)
+    {
+        nnueEvaluator evaluator(network, static_cast<nnueIsaT>(level));
+        std::vector<int> scores;
+        for (size_t p = 0; p < positions.size(); p++)
+        {
+            for (chessMove move : moveLists[p])
+            {
+                chessPosition next = positions[p];
+                next.applyMove(move);
+                evaluator.reset(positions[p]);
+                evaluator.push(positions[p], move);
+                int incremental = evaluator.evaluate(next.isWhiteToMove());
+                evaluator.reset(next);
+                if (evaluator.evaluate(next.isWhiteToMove()) != incremental)
+                {
+                    std::cout << nnueIsaName(evaluator.getIsa()) << ": incremental update differs after "
+                              << moveToUci(move) << " in " << positions[p].toFen() << std::endl;
+                    return -1;
+                }
+                scores.push_back(incremental);
+            }
+        }
+        if (level == NNUE_SCALAR)
+        {
+            reference = scores;
+        }
+        else if (scores != reference)
+        {
+            std::cout << nnueIsaName(evaluator.getIsa()) << " kernels differ from scalar" << std::endl;
+            return -1;
+        }
+
+        // Incremental: push, evaluate, pop for every legal move
+        unsigned long long evaluations = 0;
+        volatile int sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            for (size_t p = 0; p < positions.size(); p++)
+            {
+                evaluator.reset(positions[p]);
+                bool whiteNext = !positions[p].isWhiteToMove();
+                for (chessMove move : moveLists[p])
+                {
+                    evaluator.push(positions[p], move);
+                    sink = sink + evaluator.evaluate(whiteNext);
+                    evaluator.pop();
+                    evaluations++;
+                }
+            }
+        }
+        double incrementalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        unsigned long long incrementalCount = evaluations;
+
+        // Full rebuild of the first layer per evaluation
+        evaluations = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations / 10 + 1; i++)
+        {
+            for (size_t p = 0; p < positions.size(); p++)
+            {
+                for (chessMove move : moveLists[p])
+                {
+                    chessPosition next = positions[p];
+                    next.applyMove(move);
+                    evaluator.reset(next);
+                    sink = sink + evaluator.evaluate(next.isWhiteToMove());
+                    evaluations++;
+                }
+            }
+        }
+        double refreshSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << nnueIsaName(evaluator.getIsa()) << ": " << incrementalCount / incrementalSeconds / 1e6
+                  << " M evals/s incremental, " << evaluations / refreshSeconds / 1e6 << " M evals/s with full refresh" << std::endl;
+    }
+    nnueEvaluator evaluator(network);
+    evaluator.reset(positions[0]);
+    std::cout << "Start position: " << evaluator.evaluate(true) << " cp" << std::endl;
+    return 0;
+}
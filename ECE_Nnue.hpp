@@ -0,0 +1,154 @@
+/*
+
+Objective:
+In-process NNUE style evaluation: a piece-square first layer whose
+accumulator is updated incrementally on make/unmake, and SIMD inference
+kernels (AVX2, SSE4.1, scalar) picked at runtime
+*/
+
+#ifndef ECE_NNUE_HPP
+#define ECE_NNUE_HPP
+
+#include <string>
+#include <vector>
+#include "ECE_MappedFile.hpp"
+#include "ECE_ChessPosition.hpp"
+
+// Default network file (relative to the working directory)
+const char NNUE_FILE[] = "Lab3/nnue/network.nnue";
+// Network file header: magic "ECNN", version, input count, hidden size (padded to 64 bytes)
+const unsigned int NNUE_MAGIC = 0x4E4E4345;
+const unsigned int NNUE_VERSION = 1;
+const unsigned int NNUE_HEADER_SIZE = 64;
+// Inputs per perspective: own/their piece type (6 each) on 64 squares
+const unsigned int NNUE_INPUTS = 768;
+// First layer width per perspective
+const unsigned int NNUE_HIDDEN = 256;
+// Quantization: activations clipped to [0, QA], output weights scaled by QB
+const int NNUE_QA = 255;
+const int NNUE_QB = 64;
+// Network output to centipawns
+const int NNUE_SCALE = 400;
+// Deepest make/unmake stack
+const unsigned int NNUE_MAX_PLY = 128;
+// At most two features leave and two enter per move (castling, captures)
+const int NNUE_MAX_CHANGES = 2;
+
+// Instruction set levels of the inference kernels
+typedef enum
+{
+    NNUE_SCALAR,
+    NNUE_SSE41,
+    NNUE_AVX2
+} nnueIsaT;
+
+// First layer output of one position (white and black perspective)
+typedef struct
+{
+    short values[2][NNUE_HIDDEN];
+} nnueAccumulatorT;
+
+// Kernels of one instruction set level
+typedef struct
+{
+    // dst = src + sum(adds) - sum(subs) over one perspective
+    void (*update)(const short* src, short* dst, const short* const* adds, int addCount, const short* const* subs, int subCount);
+    // Clipped activations of both perspectives dotted with the output weights
+    int (*output)(const short* us, const short* them, const short* weights);
+} nnueKernelsT;
+
+// Highest kernel level this CPU (and OS) supports
+// Inputs: None
+// Output: instruction set level
+nnueIsaT nnueSupportedIsa();
+
+// Name of a kernel level
+// Inputs: instruction set level
+// Output: "AVX2", "SSE4.1" or "scalar"
+const char* nnueIsaName(nnueIsaT isa);
+
+class nnueNetwork
+{
+private:
+    // Weights are used in place from the mapped file
+    mappedFile weightsFile;
+    // Storage for generated weights (benchmarks without a network file)
+    std::vector<short> ownedWeights;
+    const short* featureWeights = nullptr;
+    const short* featureBias = nullptr;
+    const short* outputWeights = nullptr;
+    int outputBias = 0;
+
+public:
+    // Map a network file
+    // Inputs: file path
+    // Output: true if the header and size match this build
+    bool load(const std::string& filePath);
+    // Fill the network with random weights (speed tests only, scores are meaningless)
+    // Inputs: random seed
+    // Output: None
+    void randomize(unsigned int seed);
+    // Check if weights are present
+    // Inputs: None
+    // Output: true if loaded or generated
+    bool isLoaded() const;
+    // Weights of one input feature
+    // Inputs: feature index
+    // Output: NNUE_HIDDEN weights
+    const short* feature(unsigned int index) const;
+    // First layer biases
+    // Inputs: None
+    // Output: NNUE_HIDDEN biases
+    const short* bias() const;
+    // Output layer weights (side to move half first)
+    // Inputs: None
+    // Output: 2 * NNUE_HIDDEN weights
+    const short* output() const;
+    // Output layer bias
+    // Inputs: None
+    // Output: bias (scaled by QA * QB)
+    int outputOffset() const;
+};
+
+class nnueEvaluator
+{
+private:
+    const nnueNetwork& network;
+    nnueKernelsT kernels;
+    nnueIsaT isa;
+    // One accumulator per ply, unmake is a pop
+    std::vector<nnueAccumulatorT> stack;
+    unsigned int ply = 0;
+
+public:
+    // Constructor function
+    // Inputs: network, kernel level (clamped to what the CPU supports)
+    nnueEvaluator(const nnueNetwork& cNetwork, nnueIsaT cIsa = nnueSupportedIsa());
+    // Kernel level in use
+    // Inputs: None
+    // Output: instruction set level
+    nnueIsaT getIsa() const;
+    // Rebuild the root accumulator from every piece (empties the stack)
+    // Inputs: position
+    // Output: None
+    void reset(const chessPosition& position);
+    // Make: derive the next accumulator from the move's feature changes
+    // Inputs: position before the move, move
+    // Output: false if the stack is full
+    bool push(const chessPosition& position, chessMove move);
+    // Unmake the last pushed move
+    // Inputs: None
+    // Output: None
+    void pop();
+    // Evaluate the current accumulator
+    // Inputs: side to move (true for white)
+    // Output: centipawns from the side to move's view
+    int evaluate(bool whiteToMove) const;
+};
+
+// Command line entry for "--bench-nnue"
+// Inputs: program arguments
+// Output: process exit code
+int nnueBenchmarkMain(int argc, char* argv[]);
+
+#endif
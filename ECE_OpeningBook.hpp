@@ -0,0 +1,74 @@
+/*
+
+Objective:
+Polyglot (.bin) opening book consulted before the engine is asked for a move
+*/
+
+#ifndef ECE_OPENING_BOOK_HPP
+#define ECE_OPENING_BOOK_HPP
+
+#include <string>
+#include <random>
+#include "ECE_MappedFile.hpp"
+#include "ECE_ChessPosition.hpp"
+
+// Default book file (relative to the working directory)
+const char BOOK_FILE[] = "Lab3/book/book.bin";
+// Default number of half moves the book is used for
+const unsigned int BOOK_DEFAULT_DEPTH = 16;
+// Polyglot key layout: 12 * 64 piece keys, 4 castling, 8 en passant, 1 turn
+const unsigned int POLYGLOT_RANDOM_COUNT = 781;
+// Polyglot entry size: key (8), move (2), weight (2), learn (4)
+const unsigned int POLYGLOT_ENTRY_SIZE = 16;
+
+class openingBook
+{
+private:
+    // Memory mapped book entries (sorted by key, big endian)
+    mappedFile bookFile;
+    // Number of entries in the book
+    size_t entryCount = 0;
+    // Book is only used up to this ply
+    unsigned int maxPly = BOOK_DEFAULT_DEPTH;
+    // Random source for weighted selection
+    std::mt19937 rng;
+
+    // Read the key of an entry
+    // Inputs: entry index
+    // Output: Zobrist key
+    unsigned long long entryKey(size_t index) const;
+    // Convert a Polyglot move to UCI notation
+    // Inputs: encoded move and the position it is played in
+    // Output: move string
+    std::string decodeMove(unsigned short bookMove, const chessPosition& position) const;
+
+public:
+    // Constructor function
+    openingBook();
+    // Map the book
+    // Inputs: book path
+    // Output: true if the book is usable
+    bool open(const std::string& bookPath);
+    // Check if a book is loaded
+    // Inputs: None
+    // Output: true if loaded
+    bool isOpen() const;
+    // Set the book depth
+    // Inputs: number of half moves (0 disables the book)
+    // Output: None
+    void setMaxPly(unsigned int plies);
+    // Get the book depth
+    // Inputs: None
+    // Output: number of half moves
+    unsigned int getMaxPly() const;
+    // Compute the Polyglot Zobrist key of a position
+    // Inputs: position
+    // Output: key
+    unsigned long long polyglotKey(const chessPosition& position) const;
+    // Pick a book move (weighted random among the entries of the position)
+    // Inputs: position, output move in UCI notation
+    // Output: true if the book has a move
+    bool probe(const chessPosition& position, std::string& uciMove);
+};
+
+#endif
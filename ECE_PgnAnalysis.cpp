@@ -0,0 +1,575 @@
+/*
+
+Objective:
+Batch PGN analysis definition file
+*/
+
+#include "ECE_PgnAnalysis.hpp"
+#include "ECE_EnginePool.hpp"
+#include "ECE_ChessEngine.hpp"
+#include "ECE_CommandLine.hpp"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <cctype>
+#include <iostream>
+#include <condition_variable>
+
+// Game with its converted moves and the engine result after every ply
+struct analysedGame
+{
+    pgnGameT game;
+    std::vector<std::string> uciMoves;
+    std::vector<engineReplyT> evals;
+    // Plies whose search gave a score (the others are written without an eval)
+    std::vector<bool> evaluated;
+    unsigned int remaining = 0;
+    // Start position ("" for the standard one) and its ply number
+    std::string startFen;
+    unsigned int startPly = 0;
+};
+
+// One position handed to a worker (position after "ply" moves)
+struct analysisJob
+{
+    analysedGame* game;
+    unsigned int ply;
+};
+
+// Open a PGN file
+// Inputs: file path
+// Output: true if opened
+bool pgnReader::open(const std::string& filePath)
+{
+    file.open(filePath);
+    hasPendingLine = false;
+    return file.is_open();
+}
+
+// Split movetext into SAN tokens, skipping comments, variations and NAGs
+// Inputs: movetext line, game being read, comment/variation state
+// Output: None
+void pgnReader::tokenizeMovetext(const std::string& line, pgnGameT& game, bool& inComment, int& variationDepth)
+{
+    size_t i = 0;
+    while (i < line.size())
+    {
+        char c = line[i];
+        if (inComment)
+        { // { ... } comments may span lines
+            inComment = (c != '}');
+            i++;
+        }
+        else if (c == '{')
+        {
+            inComment = true;
+            i++;
+        }
+        else if (c == ';')
+        { // Rest of line comment
+            return;
+        }
+        else if (c == '(')
+        {
+            variationDepth++;
+            i++;
+        }
+        else if (c == ')')
+        {
+            variationDepth--;
+            i++;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r')
+        {
+            i++;
+        }
+        else
+        {
+            size_t end = line.find_first_of(" \t\r{}();", i);
+            if (end == std::string::npos)
+            {
+                end = line.size();
+            }
+            std::string token = line.substr(i, end - i);
+            i = end;
+            if (variationDepth > 0 || token[0] == '$')
+            {
+                continue;
+            }
+            if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*")
+            {
+                game.result = token;
+                continue;
+            }
+            // Strip move numbers ("12." "12..." or glued "12.e4")
+            size_t moveStart = 0;
+            while (moveStart < token.size() && (isdigit(static_cast<unsigned char>(token[moveStart])) || token[moveStart] == '.'))
+            {
+                moveStart++;
+            }
+            if (moveStart > 0 && moveStart < token.size() && token[moveStart - 1] != '.')
+            { // Digits not followed by a dot (not a move number), e.g. "0-0"
+                moveStart = 0;
+            }
+            if (moveStart < token.size())
+            {
+                game.sanMoves.push_back(token.substr(moveStart));
+            }
+        }
+    }
+}
+
+// Read the next game
+// Inputs: game to fill
+// Output: false at end of file
+bool pgnReader::nextGame(pgnGameT& game)
+{
+    game.tags.clear();
+    game.sanMoves.clear();
+    game.result = "*";
+
+    bool inComment = false;
+    bool inMovetext = false;
+    int variationDepth = 0;
+    std::string line;
+    while (hasPendingLine || std::getline(file, line))
+    {
+        if (hasPendingLine)
+        {
+            line = pendingLine;
+            hasPendingLine = false;
+        }
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        if (!inComment && !line.empty() && line[0] == '[')
+        {
+            if (inMovetext)
+            { // Next game starts without a blank line
+                pendingLine = line;
+                hasPendingLine = true;
+                return true;
+            }
+            // [Name "Value"]
+            size_t nameEnd = line.find(' ');
+            size_t valueStart = line.find('"');
+            size_t valueEnd = line.rfind('"');
+            if (nameEnd != std::string::npos && valueStart != std::string::npos && valueEnd > valueStart)
+            {
+                game.tags.push_back(std::make_pair(line.substr(1, nameEnd - 1),
+                                                   line.substr(valueStart + 1, valueEnd - valueStart - 1)));
+            }
+            continue;
+        }
+        if (line.empty() && !inComment)
+        {
+            if (inMovetext)
+            {
+                return true;
+            }
+            continue;
+        }
+        inMovetext = true;
+        tokenizeMovetext(line, game, inComment, variationDepth);
+    }
+    return inMovetext || !game.tags.empty();
+}
+
+// Escape a string for JSON output
+// Inputs: text
+// Output: escaped text (without quotes)
+static std::string jsonEscape(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+// Format an engine score from white's point of view
+// Inputs: engine reply, game ply the position was reached at
+// Output: "0.35", "-1.20" or "#3"/"#-2" for mates
+static std::string formatEval(const engineReplyT& reply, unsigned int gamePly)
+{
+    // Engines score from the side to move; black moves after odd plies
+    int score = (gamePly % 2 == 0) ? reply.scoreCp : -reply.scoreCp;
+    std::ostringstream text;
+    if (reply.isMate)
+    {
+        text << "#" << score;
+    }
+    else
+    {
+        text << std::fixed << std::setprecision(2) << score / 100.0;
+    }
+    return text.str();
+}
+
+// Write a game with [%eval] comments
+// Inputs: output stream, analysed game
+// Output: None
+static void writeAnnotatedPgn(std::ostream& out, const analysedGame& entry)
+{
+    for (const auto& tag : entry.game.tags)
+    {
+        out << "[" << tag.first << " \"" << tag.second << "\"]\n";
+    }
+    out << "\n";
+
+    std::string line;
+    for (unsigned int ply = 1; ply <= entry.uciMoves.size(); ply++)
+    {
+        // Game ply of the move (even plies are white moves)
+        unsigned int gamePly = entry.startPly + ply - 1;
+        std::string token;
+        if (gamePly % 2 == 0)
+        {
+            token = std::to_string(gamePly / 2 + 1) + ". ";
+        }
+        else if (ply == 1)
+        {
+            token = std::to_string(gamePly / 2 + 1) + "... ";
+        }
+        token += entry.game.sanMoves[ply - 1];
+        if (entry.evaluated[ply - 1])
+        {
+            token += " { [%eval " + formatEval(entry.evals[ply - 1], gamePly + 1) + "] }";
+        }
+        if (!line.empty() && line.size() + token.size() + 1 > 80)
+        {
+            out << line << "\n";
+            line.clear();
+        }
+        line += (line.empty() ? "" : " ") + token;
+    }
+    out << line << (line.empty() ? "" : " ") << entry.game.result << "\n\n";
+}
+
+// Write a game as one JSON line
+// Inputs: output stream, analysed game, game number
+// Output: None
+static void writeJsonGame(std::ostream& out, const analysedGame& entry, unsigned long long gameNumber)
+{
+    out << "{\"game\":" << gameNumber << ",\"tags\":{";
+    for (size_t i = 0; i < entry.game.tags.size(); i++)
+    {
+        out << (i ? "," : "") << "\"" << jsonEscape(entry.game.tags[i].first) << "\":\""
+            << jsonEscape(entry.game.tags[i].second) << "\"";
+    }
+    out << "},\"result\":\"" << entry.game.result << "\",\"moves\":[";
+    for (unsigned int ply = 1; ply <= entry.uciMoves.size(); ply++)
+    {
+        const engineReplyT& reply = entry.evals[ply - 1];
+        out << (ply > 1 ? "," : "") << "{\"ply\":" << ply
+            << ",\"san\":\"" << jsonEscape(entry.game.sanMoves[ply - 1]) << "\""
+            << ",\"uci\":\"" << entry.uciMoves[ply - 1] << "\""
+            << ",\"eval\":" << (entry.evaluated[ply - 1] ? "\"" + formatEval(reply, entry.startPly + ply) + "\"" : "null")
+            << ",\"depth\":" << reply.depth
+            << ",\"best\":\"" << reply.bestMove << "\"}";
+    }
+    out << "]}\n";
+}
+
+// Analyse every game of a PGN file
+// Inputs: options, totals to fill
+// Output: true if the input could be read and the engines started (false if no worker got one)
+bool analysePgnFile(const pgnAnalysisOptionsT& options, pgnAnalysisStatsT& stats)
+{
+    stats = pgnAnalysisStatsT();
+    pgnReader reader;
+    if (!reader.open(options.inputPath))
+    {
+        std::cerr << "Failed to open PGN file " << options.inputPath << std::endl;
+        return false;
+    }
+    std::ofstream pgnOut;
+    std::ofstream jsonOut;
+    if (!options.pgnOutPath.empty()) pgnOut.open(options.pgnOutPath);
+    if (!options.jsonOutPath.empty()) jsonOut.open(options.jsonOutPath);
+
+    enginePool pool;
+    if (!pool.start(options.workers, ENGINE_PATH))
+    {
+        pool.stop();
+        return false;
+    }
+    auto startTime = std::chrono::steady_clock::now();
+    const std::string goCommand = "go depth " + std::to_string(options.depth);
+
+    // Work queue shared with the workers
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::condition_variable doneCondition;
+    std::deque<analysisJob> jobs;
+    bool inputDone = false;
+    // Workers that got an engine (none left: the queued positions are never searched)
+    unsigned int engineWorkers = options.workers;
+
+    // Each worker holds one engine for the whole run
+    std::vector<std::thread> workers;
+    for (unsigned int w = 0; w < options.workers; w++)
+    {
+        workers.push_back(std::thread([&]() {
+            int engineId = pool.lease();
+            if (engineId < 0)
+            {
+                // The other workers take its share, the run stops if none has an engine
+                std::lock_guard<std::mutex> lock(queueMutex);
+                engineWorkers--;
+                doneCondition.notify_all();
+                return;
+            }
+            while (engineId >= 0)
+            {
+                analysisJob job;
+                {
+                    std::unique_lock<std::mutex> lock(queueMutex);
+                    queueCondition.wait(lock, [&]() { return !jobs.empty() || inputDone; });
+                    if (jobs.empty())
+                    {
+                        break;
+                    }
+                    job = jobs.front();
+                    jobs.pop_front();
+                }
+
+                std::string positionCommand = job.game->startFen.empty() ? "position startpos moves" :
+                                              "position fen " + job.game->startFen + " moves";
+                for (unsigned int i = 0; i < job.ply; i++)
+                {
+                    positionCommand += " " + job.game->uciMoves[i];
+                }
+                engineReplyT reply;
+                // A finished game position answers "bestmove (none)" but still carries a score
+                bool searched = pool.search(engineId, positionCommand, goCommand, reply) || reply.bestMove == "(none)";
+                bool evaluated = searched && reply.hasScore;
+
+                std::lock_guard<std::mutex> lock(queueMutex);
+                job.game->evals[job.ply - 1] = reply;
+                job.game->evaluated[job.ply - 1] = evaluated;
+                if (!evaluated)
+                {
+                    stats.unevaluatedPositions++;
+                }
+                if (--job.game->remaining == 0)
+                {
+                    doneCondition.notify_all();
+                }
+            }
+            pool.release(engineId);
+        }));
+    }
+
+    // Games are written in input order once all their positions are back
+    std::deque<std::unique_ptr<analysedGame>> inFlight;
+    auto hasEngines = [&]() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        return engineWorkers > 0;
+    };
+    auto writeFront = [&](bool wait) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (!wait && inFlight.front()->remaining != 0)
+        {
+            return false;
+        }
+        // Without a worker holding an engine the game would never be finished
+        doneCondition.wait(lock, [&]() { return inFlight.front()->remaining == 0 || engineWorkers == 0; });
+        if (inFlight.front()->remaining != 0)
+        {
+            return false;
+        }
+        lock.unlock();
+        if (pgnOut.is_open()) writeAnnotatedPgn(pgnOut, *inFlight.front());
+        if (jsonOut.is_open()) writeJsonGame(jsonOut, *inFlight.front(), stats.games - inFlight.size() + 1);
+        inFlight.pop_front();
+        return true;
+    };
+
+    std::unique_ptr<analysedGame> entry(new analysedGame);
+    while (hasEngines() && reader.nextGame(entry->game))
+    {
+        // Games may start from a set-up position
+        bool valid = true;
+        chessPosition position;
+        for (const auto& tag : entry->game.tags)
+        {
+            if (tag.first == "FEN")
+            {
+                valid = position.setFromFen(tag.second);
+                entry->startFen = position.toFen();
+                if (!valid)
+                {
+                    std::cerr << "Skipping game " << stats.games + stats.skippedGames + 1
+                              << ": bad FEN " << tag.second << std::endl;
+                }
+            }
+        }
+        entry->startPly = position.ply();
+
+        // SAN to internal moves, stops at the first illegal move
+        for (size_t i = 0; valid && i < entry->game.sanMoves.size(); i++)
+        {
+            chessMove move = position.parseSan(entry->game.sanMoves[i]);
+            if (move == NO_MOVE)
+            {
+                std::cerr << "Skipping game " << stats.games + stats.skippedGames + 1
+                          << ": illegal move " << entry->game.sanMoves[i] << std::endl;
+                valid = false;
+                break;
+            }
+            entry->uciMoves.push_back(moveToUci(move));
+            position.applyMove(move);
+        }
+        if (!valid)
+        {
+            stats.skippedGames++;
+            entry.reset(new analysedGame);
+            continue;
+        }
+
+        unsigned int plies = static_cast<unsigned int>(entry->uciMoves.size());
+        entry->evals.resize(plies);
+        entry->evaluated.assign(plies, false);
+        entry->remaining = plies;
+        stats.games++;
+        stats.positions += plies;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            for (unsigned int ply = 1; ply <= plies; ply++)
+            {
+                jobs.push_back({ entry.get(), ply });
+            }
+        }
+        queueCondition.notify_all();
+        inFlight.push_back(std::move(entry));
+        entry.reset(new analysedGame);
+
+        // Bound the games held in memory, flush whatever is finished
+        while (inFlight.size() > PGN_GAMES_PER_WORKER * options.workers && writeFront(true))
+        {
+        }
+        while (!inFlight.empty() && writeFront(false))
+        {
+        }
+    }
+
+    while (!inFlight.empty() && writeFront(true))
+    {
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        inputDone = true;
+    }
+    queueCondition.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    pool.reportStats(std::cout);
+    pool.stop();
+    if (!hasEngines())
+    {
+        std::cerr << "No engine could be leased, " << inFlight.size() << " games were not analysed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Command line entry for "--analyze" and "--bench-pgn"
+// Inputs: program arguments
+// Output: process exit code
+int pgnAnalysisMain(int argc, char* argv[])
+{
+    bool benchmark = std::string(argv[1]) == "--bench-pgn";
+    pgnAnalysisOptionsT options;
+    options.inputPath = benchmark ? PGN_SAMPLE_FILE : "";
+
+    bool valid = true;
+    unsigned long number = 0;
+    for (int i = 2; i < argc && valid; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--pgn" && hasValue) options.pgnOutPath = argv[++i];
+        else if (arg == "--json" && hasValue) options.jsonOutPath = argv[++i];
+        else if (arg == "--workers" && hasValue)
+        {
+            valid = parseBoundedNumber(argv[++i], 1, ENGINE_POOL_MAX, number);
+            options.workers = static_cast<unsigned int>(number);
+        }
+        else if (arg == "--depth" && hasValue)
+        {
+            valid = parseBoundedNumber(argv[++i], 1, PGN_MAX_DEPTH, number);
+            options.depth = static_cast<int>(number);
+        }
+        else if (arg.compare(0, 2, "--") != 0) options.inputPath = arg;
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (!valid || options.inputPath.empty())
+    {
+        std::cerr << "Usage: Lab3 --analyze games.pgn [--pgn out.pgn] [--json out.json] [--workers N (1.." << ENGINE_POOL_MAX
+                  << ")] [--depth D (1.." << PGN_MAX_DEPTH << ")]" << std::endl;
+        std::cerr << "       Lab3 --bench-pgn [games.pgn] [--workers N] [--depth D]" << std::endl;
+        return -1;
+    }
+
+    pgnAnalysisStatsT stats;
+    if (!benchmark)
+    {
+        if (!analysePgnFile(options, stats))
+        {
+            return -1;
+        }
+        std::cout << stats.games << " games (" << stats.skippedGames << " skipped), " << stats.positions
+                  << " positions (" << stats.unevaluatedPositions << " without eval) in " << stats.seconds << " s: "
+                  << (stats.seconds > 0 ? stats.positions / stats.seconds : 0.0) << " positions/s" << std::endl;
+        return 0;
+    }
+
+    // Throughput for 1, 2, 4 ... up to the requested worker count
+    std::vector<unsigned int> workerCounts;
+    for (unsigned int workers = 1; workers < options.workers; workers *= 2)
+    {
+        workerCounts.push_back(workers);
+    }
+    workerCounts.push_back(options.workers);
+
+    double basePositionsPerSecond = 0.0;
+    std::cout << "workers  positions  seconds  positions/s  speedup" << std::endl;
+    for (unsigned int workers : workerCounts)
+    {
+        options.workers = workers;
+        if (!analysePgnFile(options, stats) || stats.seconds <= 0)
+        {
+            return -1;
+        }
+        double positionsPerSecond = stats.positions / stats.seconds;
+        if (workers == 1)
+        {
+            basePositionsPerSecond = positionsPerSecond;
+        }
+        std::cout << std::setw(7) << workers << std::setw(11) << stats.positions
+                  << std::setw(9) << std::fixed << std::setprecision(2) << stats.seconds
+                  << std::setw(13) << positionsPerSecond
+                  << std::setw(9) << positionsPerSecond / basePositionsPerSecond << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+
+Objective:
+Headless batch analysis of PGN archives with a pool of engine workers
+*/
+
+#ifndef ECE_PGN_ANALYSIS_HPP
+#define ECE_PGN_ANALYSIS_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <fstream>
+#include "ECE_ChessPosition.hpp"
+
+// Bundled sample used by the throughput benchmark
+const char PGN_SAMPLE_FILE[] = "Lab3/pgn/sample.pgn";
+// Default search depth per analysed position
+const int PGN_DEFAULT_DEPTH = 10;
+// Deepest search accepted on the command line
+const int PGN_MAX_DEPTH = 100;
+// Games kept in flight per worker (bounds memory on large archives)
+const unsigned int PGN_GAMES_PER_WORKER = 2;
+
+// One game read from a PGN stream
+typedef struct
+{
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::vector<std::string> sanMoves;
+    std::string result;
+} pgnGameT;
+
+// Batch analysis settings
+typedef struct
+{
+    std::string inputPath;
+    std::string pgnOutPath;
+    std::string jsonOutPath;
+    unsigned int workers = 1;
+    int depth = PGN_DEFAULT_DEPTH;
+} pgnAnalysisOptionsT;
+
+// Batch analysis totals
+typedef struct
+{
+    unsigned long long games = 0;
+    unsigned long long skippedGames = 0;
+    unsigned long long positions = 0;
+    // Positions whose search failed or returned no score (written without an eval)
+    unsigned long long unevaluatedPositions = 0;
+    double seconds = 0.0;
+} pgnAnalysisStatsT;
+
+class pgnReader
+{
+private:
+    // Input stream (read line by line, one game in memory at a time)
+    std::ifstream file;
+    // Tag line that ended the previous game's movetext
+    std::string pendingLine;
+    bool hasPendingLine = false;
+
+    // Split movetext into SAN tokens, skipping comments, variations and NAGs
+    // Inputs: movetext line, game being read, comment/variation state
+    // Output: None
+    void tokenizeMovetext(const std::string& line, pgnGameT& game, bool& inComment, int& variationDepth);
+
+public:
+    // Open a PGN file
+    // Inputs: file path
+    // Output: true if opened
+    bool open(const std::string& filePath);
+    // Read the next game
+    // Inputs: game to fill
+    // Output: false at end of file
+    bool nextGame(pgnGameT& game);
+};
+
+// Analyse every game of a PGN file
+// Inputs: options, totals to fill
+// Output: true if the input could be read and the engines started (false if no worker got one)
+bool analysePgnFile(const pgnAnalysisOptionsT& options, pgnAnalysisStatsT& stats);
+
+// Command line entry for "--analyze" and "--bench-pgn"
+// Inputs: program arguments
+// Output: process exit code
+int pgnAnalysisMain(int argc, char* argv[]);
+
+#endif
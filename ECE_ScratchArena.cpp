@@ -0,0 +1,199 @@
+/*
+
+Objective:
+Scratch arena and allocation counter definition file
+*/
+
+#include "ECE_ScratchArena.hpp"
+#include <cstdlib>
+#include <new>
+
+// Heap allocations of each thread (plain counter, no contention between threads)
+static thread_local unsigned long long allocationCount = 0;
+
+// Counted replacements of the global allocation functions (the aligned forms are left to the library)
+void* operator new(std::size_t size)
+{
+    allocationCount++;
+    void* memory = std::malloc(size != 0 ? size : 1);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    allocationCount++;
+    return std::malloc(size != 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    allocationCount++;
+    return std::malloc(size != 0 ? size : 1);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+// Constructor function (the block is allocated once here)
+// Inputs: block size in bytes
+scratchArena::scratchArena(size_t capacity)
+    : block(capacity)
+{
+    spills.reserve(SCRATCH_SPILL_SLOTS);
+}
+
+// destructor function
+scratchArena::~scratchArena()
+{
+    reset();
+}
+
+// Bump allocate (std::pmr hook)
+// Inputs: size, alignment
+// Output: memory valid until the arena is rewound past it
+void* scratchArena::do_allocate(size_t bytes, size_t alignment)
+{
+    size_t start = (used + alignment - 1) & ~(alignment - 1);
+    if (start + bytes <= block.size())
+    {
+        used = start + bytes;
+        highWater = (used > highWater) ? used : highWater;
+        return block.data() + start;
+    }
+    // Past the block: from the heap until the next rewind (counted, the block should grow)
+    // (plain operator new when it can, so the spill also shows in the allocation count)
+    spillCount++;
+    void* memory = (alignment <= alignof(std::max_align_t)) ? ::operator new(bytes)
+                                                            : std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    spills.push_back({ memory, bytes, alignment });
+    return memory;
+}
+
+// Nothing to do, memory comes back on rewind (std::pmr hook)
+// Inputs: memory, size, alignment
+// Output: None
+void scratchArena::do_deallocate(void* /*memory*/, size_t /*bytes*/, size_t /*alignment*/)
+{
+}
+
+// Arenas only free their own memory (std::pmr hook)
+// Inputs: other resource
+// Output: true if it is this arena
+bool scratchArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+// Get the current position
+// Inputs: None
+// Output: mark to rewind to
+scratchMarkT scratchArena::mark() const
+{
+    scratchMarkT position = { used, spills.size() };
+    return position;
+}
+
+// Hand back everything allocated after a mark
+// Inputs: mark
+// Output: None
+void scratchArena::rewind(const scratchMarkT& start)
+{
+    while (spills.size() > start.spills)
+    {
+        const scratchSpillT& spill = spills.back();
+        if (spill.alignment <= alignof(std::max_align_t))
+        {
+            ::operator delete(spill.memory);
+        }
+        else
+        {
+            std::pmr::new_delete_resource()->deallocate(spill.memory, spill.bytes, spill.alignment);
+        }
+        spills.pop_back();
+    }
+    used = (start.used < used) ? start.used : used;
+}
+
+// Hand back everything
+// Inputs: None
+// Output: None
+void scratchArena::reset()
+{
+    scratchMarkT start = { 0, 0 };
+    rewind(start);
+}
+
+// Get the counters
+// Inputs: None
+// Output: statistics
+scratchStatsT scratchArena::getStats() const
+{
+    scratchStatsT stats = { block.size(), used, highWater, spillCount };
+    return stats;
+}
+
+// Constructor function
+// Inputs: arena
+scratchScope::scratchScope(scratchArena& cArena)
+    : arena(cArena), start(cArena.mark())
+{
+}
+
+// destructor function (rewinds)
+scratchScope::~scratchScope()
+{
+    arena.rewind(start);
+}
+
+// Arena of the calling thread for engine replies (created on first use)
+// Inputs: None
+// Output: arena
+scratchArena& searchArena()
+{
+    static thread_local scratchArena arena(SEARCH_ARENA_BYTES);
+    return arena;
+}
+
+// Heap allocations (operator new) made by the calling thread so far
+// Inputs: None
+// Output: count
+unsigned long long threadAllocations()
+{
+    return allocationCount;
+}
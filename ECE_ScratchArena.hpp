@@ -0,0 +1,121 @@
+/*
+
+Objective:
+Scratch memory for hot paths: a linear arena exposed as a std::pmr memory
+resource (bump allocation, handed back all at once), one per frame on the
+render thread and one per thread talking to the engine, plus a heap
+allocation counter to check that those paths stay off the heap.
+*/
+
+#ifndef ECE_SCRATCH_ARENA_HPP
+#define ECE_SCRATCH_ARENA_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Frame arena (render thread, rewound at the start of every frame)
+const size_t FRAME_ARENA_BYTES = 64 * 1024;
+// Search arena (one per thread reading the engine, rewound after every search)
+const size_t SEARCH_ARENA_BYTES = 16 * 1024;
+// Requests past the block that are tracked without a heap allocation of their own
+const size_t SCRATCH_SPILL_SLOTS = 64;
+
+// Position in an arena to rewind to
+typedef struct
+{
+    size_t used;
+    size_t spills;
+} scratchMarkT;
+
+// Arena counters
+typedef struct
+{
+    size_t capacity;
+    size_t used;
+    // Most ever in use at once
+    size_t highWater;
+    // Requests that did not fit and went to the heap (the block should be larger)
+    unsigned long long spills;
+} scratchStatsT;
+
+// One spilled request, freed on rewind
+typedef struct
+{
+    void* memory;
+    size_t bytes;
+    size_t alignment;
+} scratchSpillT;
+
+class scratchArena : public std::pmr::memory_resource
+{
+private:
+    std::vector<unsigned char> block;
+    size_t used = 0;
+    size_t highWater = 0;
+    unsigned long long spillCount = 0;
+    std::vector<scratchSpillT> spills;
+
+    // Bump allocate (std::pmr hook)
+    // Inputs: size, alignment
+    // Output: memory valid until the arena is rewound past it
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    // Nothing to do, memory comes back on rewind (std::pmr hook)
+    // Inputs: memory, size, alignment
+    // Output: None
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override;
+    // Arenas only free their own memory (std::pmr hook)
+    // Inputs: other resource
+    // Output: true if it is this arena
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+public:
+    // Constructor function (the block is allocated once here)
+    // Inputs: block size in bytes
+    explicit scratchArena(size_t capacity);
+    // destructor function
+    ~scratchArena();
+    // Get the current position
+    // Inputs: None
+    // Output: mark to rewind to
+    scratchMarkT mark() const;
+    // Hand back everything allocated after a mark
+    // Inputs: mark
+    // Output: None
+    void rewind(const scratchMarkT& start);
+    // Hand back everything
+    // Inputs: None
+    // Output: None
+    void reset();
+    // Get the counters
+    // Inputs: None
+    // Output: statistics
+    scratchStatsT getStats() const;
+};
+
+// Rewinds an arena to where it was when the scope opened
+class scratchScope
+{
+private:
+    scratchArena& arena;
+    scratchMarkT start;
+
+public:
+    // Constructor function
+    // Inputs: arena
+    explicit scratchScope(scratchArena& cArena);
+    // destructor function (rewinds)
+    ~scratchScope();
+};
+
+// Arena of the calling thread for engine replies (created on first use)
+// Inputs: None
+// Output: arena
+scratchArena& searchArena();
+
+// Heap allocations (operator new) made by the calling thread so far
+// Inputs: None
+// Output: count
+unsigned long long threadAllocations();
+
+#endif
@@ -0,0 +1,424 @@
+/*
+
+Objective:
+Self-play match runner definition file
+*/
+
+#include "ECE_SelfPlay.hpp"
+#include "ECE_EnginePool.hpp"
+#include "ECE_ChessEngine.hpp"
+#include "ECE_ChessPosition.hpp"
+#include "ECE_LatencyHistogram.hpp"
+#include "ECE_CommandLine.hpp"
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+
+// Opening lines (UCI); each is played twice with colours swapped
+static const char* SELF_PLAY_OPENINGS[] = {
+    "e2e4 e7e5 g1f3 b8c6 f1b5",         // Ruy Lopez
+    "e2e4 e7e5 g1f3 b8c6 f1c4 f8c5",    // Italian
+    "e2e4 c7c5 g1f3 d7d6 d2d4",         // Sicilian
+    "e2e4 e7e6 d2d4 d7d5",              // French
+    "e2e4 c7c6 d2d4 d7d5",              // Caro-Kann
+    "e2e4 d7d5 e4d5 d8d5",              // Scandinavian
+    "d2d4 d7d5 c2c4 e7e6",              // Queen's Gambit Declined
+    "d2d4 d7d5 c2c4 d5c4",              // Queen's Gambit Accepted
+    "d2d4 g8f6 c2c4 g7g6 b1c3 f8g7",    // King's Indian
+    "d2d4 g8f6 c2c4 e7e6 b1c3 f8b4",    // Nimzo-Indian
+    "c2c4 e7e5 b1c3 g8f6",              // English
+    "g1f3 d7d5 g2g3 g8f6"               // Reti
+};
+const unsigned int SELF_PLAY_OPENING_COUNT = sizeof(SELF_PLAY_OPENINGS) / sizeof(SELF_PLAY_OPENINGS[0]);
+
+// Game result from the first engine's point of view
+enum gameOutcome { OUTCOME_LOSS = -1, OUTCOME_DRAW = 0, OUTCOME_WIN = 1 };
+
+// Parse "depth=10,threads=2,hash=64,movetime=100,nodes=N,path=engine.exe"
+// Inputs: settings text, engine to fill
+// Output: true if every key was understood
+bool parseEngineSettings(const std::string& settings, selfPlayEngineT& engine)
+{
+    engine.name = settings;
+    engine.options.clear();
+    std::istringstream items(settings);
+    std::string item;
+    while (std::getline(items, item, ','))
+    {
+        size_t split = item.find('=');
+        if (split == std::string::npos)
+        {
+            return false;
+        }
+        std::string key = item.substr(0, split);
+        std::string value = item.substr(split + 1);
+        if (key == "depth" || key == "movetime" || key == "nodes") engine.goCommand = "go " + key + " " + value;
+        else if (key == "threads") engine.options.push_back("setoption name Threads value " + value);
+        else if (key == "hash") engine.options.push_back("setoption name Hash value " + value);
+        else if (key == "path") engine.path = value;
+        else return false;
+    }
+    return true;
+}
+
+// Elo difference for a match score
+// Inputs: score, error margin (95%) output
+// Output: Elo difference
+double matchElo(const matchScoreT& score, double& margin)
+{
+    double games = static_cast<double>(score.wins + score.losses + score.draws);
+    margin = 0.0;
+    if (games == 0)
+    {
+        return 0.0;
+    }
+    double mean = (score.wins + 0.5 * score.draws) / games;
+    double variance = (score.wins * (1.0 - mean) * (1.0 - mean) + score.losses * mean * mean +
+                       score.draws * (0.5 - mean) * (0.5 - mean)) / games;
+    double deviation = std::sqrt(variance / games);
+
+    // Keep the logistic finite for one-sided results
+    auto eloOf = [](double s) {
+        s = (s < 1e-6) ? 1e-6 : (s > 1.0 - 1e-6) ? 1.0 - 1e-6 : s;
+        return -400.0 * std::log10(1.0 / s - 1.0);
+    };
+    margin = (eloOf(mean + 1.959964 * deviation) - eloOf(mean - 1.959964 * deviation)) / 2.0;
+    return eloOf(mean);
+}
+
+// Log-likelihood ratio of H1 (elo1) against H0 (elo0)
+// Inputs: score, Elo bounds
+// Output: LLR
+double sprtLlr(const matchScoreT& score, double elo0, double elo1)
+{
+    // Normal approximation of the trinomial GSPRT
+    if (score.wins + score.losses + score.draws == 0)
+    {
+        return 0.0;
+    }
+    // Half a game added to each outcome keeps the variance positive on one-sided results (40-0, all draws)
+    double wins = score.wins + 0.5;
+    double losses = score.losses + 0.5;
+    double draws = score.draws + 0.5;
+    double games = wins + losses + draws;
+    double win = wins / games;
+    double draw = draws / games;
+    double mean = win + draw / 2.0;
+    double variance = (win + draw / 4.0 - mean * mean) / games;
+    double score0 = 1.0 / (1.0 + std::pow(10.0, -elo0 / 400.0));
+    double score1 = 1.0 / (1.0 + std::pow(10.0, -elo1 / 400.0));
+    return (score1 - score0) * (2.0 * mean - score0 - score1) / (2.0 * variance);
+}
+
+// Position part of the FEN (repetition key)
+// Inputs: position
+// Output: placement, side, castling and en passant fields
+static std::string repetitionKey(const chessPosition& position)
+{
+    std::string fen = position.toFen();
+    size_t end = fen.size();
+    for (int fields = 0; fields < 2; fields++)
+    {
+        end = fen.rfind(' ', end - 1);
+    }
+    return fen.substr(0, end);
+}
+
+// Check for a dead position (no mating material)
+// Inputs: position
+// Output: true if only kings and at most one minor piece are left
+static bool insufficientMaterial(const chessPosition& position)
+{
+    int minors = 0;
+    for (int sq = 0; sq < 64; sq++)
+    {
+        int type = position.pieceAt(sq) & PIECE_TYPE_MASK;
+        if (type == PIECE_PAWN || type == PIECE_ROOK || type == PIECE_QUEEN)
+        {
+            return false;
+        }
+        if (type == PIECE_KNIGHT || type == PIECE_BISHOP)
+        {
+            minors++;
+        }
+    }
+    return minors <= 1;
+}
+
+// Play one game between the two leased engines
+// Inputs: pools, leased engine ids, colour of engine 0, opening, settings, histograms, reason output
+// Output: outcome for engine 0
+static gameOutcome playGame(enginePool* pools, const int* engineIds, bool firstIsWhite, const char* opening,
+                            const selfPlayOptionsT& options, latencyHistogram* histograms, std::string& reason)
+{
+    chessPosition position;
+    std::string moves;
+    std::istringstream openingMoves(opening);
+    std::string uciMove;
+    while (openingMoves >> uciMove)
+    {
+        position.applyUciMove(uciMove);
+        moves += " " + uciMove;
+    }
+    for (int side = 0; side < 2; side++)
+    {
+        pools[side].sendCommand(engineIds[side], "ucinewgame");
+    }
+
+    std::vector<std::string> history(1, repetitionKey(position));
+    unsigned int resignCount[2] = { 0, 0 };
+    unsigned int drawCount = 0;
+    while (true)
+    {
+        // Engine index of the side to move and the result if it loses
+        int side = (position.isWhiteToMove() == firstIsWhite) ? 0 : 1;
+        gameOutcome moverLoses = side == 0 ? OUTCOME_LOSS : OUTCOME_WIN;
+
+        // Rules
+        chessMove legal[MAX_MOVES];
+        int legalCount = position.generateLegalMoves(legal);
+        if (legalCount == 0)
+        {
+            reason = position.inCheck() ? "checkmate" : "stalemate";
+            return position.inCheck() ? moverLoses : OUTCOME_DRAW;
+        }
+        if (position.halfmoves() >= 100)
+        {
+            reason = "fifty moves";
+            return OUTCOME_DRAW;
+        }
+        unsigned int repetitions = 0;
+        for (const auto& key : history)
+        {
+            repetitions += (key == history.back()) ? 1 : 0;
+        }
+        if (repetitions >= 3)
+        {
+            reason = "repetition";
+            return OUTCOME_DRAW;
+        }
+        if (insufficientMaterial(position))
+        {
+            reason = "insufficient material";
+            return OUTCOME_DRAW;
+        }
+        if (history.size() > options.maxPlies)
+        {
+            reason = "move limit";
+            return OUTCOME_DRAW;
+        }
+
+        // Engine move
+        engineReplyT reply;
+        bool replied = pools[side].search(engineIds[side], "position startpos moves" + moves,
+                                          options.engines[side].goCommand, reply);
+        // A failed search has no latency (the pool counts it under failed searches)
+        if (replied)
+        {
+            histograms[side].record(reply.latencyMs);
+        }
+        chessMove played = NO_MOVE;
+        for (int i = 0; replied && i < legalCount; i++)
+        {
+            if (moveToUci(legal[i]) == reply.bestMove)
+            {
+                played = legal[i];
+                break;
+            }
+        }
+        if (played == NO_MOVE)
+        {
+            reason = replied ? "illegal move " + reply.bestMove : "no reply";
+            return moverLoses;
+        }
+
+        // Score adjudication (scores are from the mover's point of view)
+        bool losing = reply.isMate ? reply.scoreCp < 0 : reply.scoreCp <= -options.resignCp;
+        resignCount[side] = losing ? resignCount[side] + 1 : 0;
+        if (resignCount[side] >= options.resignMoves)
+        {
+            reason = "resign";
+            return moverLoses;
+        }
+        bool level = !reply.isMate && std::abs(reply.scoreCp) <= options.drawCp && position.ply() >= options.drawStartPly;
+        drawCount = level ? drawCount + 1 : 0;
+        if (drawCount >= 2 * options.drawMoves)
+        {
+            reason = "draw adjudication";
+            return OUTCOME_DRAW;
+        }
+
+        position.applyMove(played);
+        moves += " " + reply.bestMove;
+        history.push_back(repetitionKey(position));
+    }
+}
+
+// Print the running match result
+// Inputs: settings, score, games finished
+// Output: None
+static void reportMatch(const selfPlayOptionsT& options, const matchScoreT& score, unsigned long long finished)
+{
+    double margin = 0.0;
+    double elo = matchElo(score, margin);
+    std::cout << std::fixed << std::setprecision(1)
+              << "Games " << finished << "/" << options.games << ": +" << score.wins << " -" << score.losses
+              << " =" << score.draws << "  Elo " << elo << " +/- " << margin;
+    if (options.sprt)
+    {
+        double lower = std::log(options.beta / (1.0 - options.alpha));
+        double upper = std::log((1.0 - options.beta) / options.alpha);
+        std::cout << std::setprecision(2) << "  LLR " << sprtLlr(score, options.elo0, options.elo1)
+                  << " [" << lower << ", " << upper << "]";
+    }
+    std::cout << std::endl;
+}
+
+// Command line entry for "--selfplay"
+// Inputs: program arguments
+// Output: process exit code
+int selfPlayMain(int argc, char* argv[])
+{
+    selfPlayOptionsT options;
+    for (int side = 0; side < 2; side++)
+    {
+        options.engines[side].path = ENGINE_PATH;
+        options.engines[side].goCommand = "go depth 10";
+    }
+
+    bool valid = true;
+    unsigned long number = 0;
+    for (int i = 2; i < argc && valid; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue)
+        {
+            valid = parseBoundedNumber(argv[++i], 1, SELFPLAY_MAX_GAMES, number);
+            options.games = static_cast<unsigned int>(number);
+        }
+        else if (arg == "--concurrency" && hasValue)
+        {
+            valid = parseBoundedNumber(argv[++i], 1, ENGINE_POOL_MAX, number);
+            options.concurrency = static_cast<unsigned int>(number);
+        }
+        else if (arg == "--a" && hasValue) valid = parseEngineSettings(argv[++i], options.engines[0]);
+        else if (arg == "--b" && hasValue) valid = parseEngineSettings(argv[++i], options.engines[1]);
+        else if (arg == "--max-plies" && hasValue)
+        {
+            valid = parseBoundedNumber(argv[++i], 1, SELFPLAY_MAX_PLIES, number);
+            options.maxPlies = static_cast<unsigned int>(number);
+        }
+        else if (arg == "--resign" && hasValue)
+        {
+            valid = parseBoundedNumber(argv[++i], 1, SELFPLAY_MAX_RESIGN_CP, number);
+            options.resignCp = static_cast<int>(number);
+        }
+        else if (arg == "--sprt" && i + 2 < argc)
+        {
+            options.sprt = true;
+            valid = parseBoundedReal(argv[i + 1], -SELFPLAY_MAX_SPRT_ELO, SELFPLAY_MAX_SPRT_ELO, options.elo0) &&
+                    parseBoundedReal(argv[i + 2], -SELFPLAY_MAX_SPRT_ELO, SELFPLAY_MAX_SPRT_ELO, options.elo1) &&
+                    options.elo1 > options.elo0;
+            i += 2;
+        }
+        else valid = false;
+    }
+    if (!valid)
+    {
+        std::cerr << "Usage: Lab3 --selfplay [--games N (1.." << SELFPLAY_MAX_GAMES << ")] [--concurrency C (1.."
+                  << ENGINE_POOL_MAX << ")]" << std::endl;
+        std::cerr << "       [--a depth=10,threads=1,hash=16] [--b movetime=100,path=engine.exe]" << std::endl;
+        std::cerr << "       [--max-plies P] [--resign CP] [--sprt ELO0 ELO1 (ELO0 < ELO1)]" << std::endl;
+        return -1;
+    }
+    if (options.engines[0].name.empty()) options.engines[0].name = "A";
+    if (options.engines[1].name.empty()) options.engines[1].name = "B";
+
+    // One pool per setting, every game thread holds one engine of each
+    enginePool pools[2];
+    for (int side = 0; side < 2; side++)
+    {
+        if (!pools[side].start(options.concurrency, options.engines[side].path))
+        {
+            return -1;
+        }
+    }
+
+    latencyHistogram histograms[2];
+    matchScoreT score;
+    std::mutex scoreMutex;
+    std::atomic<unsigned int> nextGame(0);
+    std::atomic<bool> decided(false);
+    unsigned long long finished = 0;
+    double sprtLower = std::log(options.beta / (1.0 - options.alpha));
+    double sprtUpper = std::log((1.0 - options.beta) / options.alpha);
+
+    std::vector<std::thread> gameThreads;
+    for (unsigned int t = 0; t < options.concurrency; t++)
+    {
+        gameThreads.push_back(std::thread([&]() {
+            int engineIds[2] = { pools[0].lease(), pools[1].lease() };
+            for (int side = 0; side < 2; side++)
+            {
+                for (const auto& option : options.engines[side].options)
+                {
+                    pools[side].sendCommand(engineIds[side], option);
+                }
+            }
+
+            unsigned int game;
+            while (engineIds[0] >= 0 && engineIds[1] >= 0 && !decided && (game = nextGame++) < options.games)
+            {
+                // Game pairs share an opening with colours swapped
+                std::string reason;
+                gameOutcome outcome = playGame(pools, engineIds, game % 2 == 0,
+                                               SELF_PLAY_OPENINGS[(game / 2) % SELF_PLAY_OPENING_COUNT],
+                                               options, histograms, reason);
+
+                std::lock_guard<std::mutex> lock(scoreMutex);
+                if (outcome == OUTCOME_WIN) score.wins++;
+                else if (outcome == OUTCOME_LOSS) score.losses++;
+                else score.draws++;
+                finished++;
+                if (finished % 10 == 0)
+                {
+                    reportMatch(options, score, finished);
+                }
+                if (options.sprt)
+                {
+                    double llr = sprtLlr(score, options.elo0, options.elo1);
+                    if (llr <= sprtLower || llr >= sprtUpper)
+                    {
+                        decided = true;
+                    }
+                }
+            }
+            pools[0].release(engineIds[0]);
+            pools[1].release(engineIds[1]);
+        }));
+    }
+    for (auto& gameThread : gameThreads)
+    {
+        gameThread.join();
+    }
+
+    std::cout << "Final result (" << options.engines[0].name << " vs " << options.engines[1].name << ")" << std::endl;
+    reportMatch(options, score, finished);
+    if (options.sprt)
+    {
+        double llr = sprtLlr(score, options.elo0, options.elo1);
+        std::cout << "SPRT: " << (llr >= sprtUpper ? "H1 accepted" : llr <= sprtLower ? "H0 accepted" : "inconclusive") << std::endl;
+    }
+    for (int side = 0; side < 2; side++)
+    {
+        std::cout << "Move latency " << options.engines[side].name << ": " << histograms[side].summary() << std::endl;
+        pools[side].reportStats(std::cout);
+        pools[side].stop();
+    }
+    return 0;
+}
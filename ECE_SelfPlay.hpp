@@ -0,0 +1,78 @@
+/*
+
+Objective:
+Headless self-play matches between two engine settings with adjudication,
+Elo/SPRT statistics and per-move latency histograms
+*/
+
+#ifndef ECE_SELF_PLAY_HPP
+#define ECE_SELF_PLAY_HPP
+
+#include <string>
+#include <vector>
+
+// Command line bounds
+const unsigned int SELFPLAY_MAX_GAMES = 1000000;
+const unsigned int SELFPLAY_MAX_PLIES = 10000;
+const unsigned int SELFPLAY_MAX_RESIGN_CP = 100000;
+const double SELFPLAY_MAX_SPRT_ELO = 1000.0;
+
+// One side of the match
+typedef struct
+{
+    std::string name;
+    std::string path;
+    std::string goCommand;
+    std::vector<std::string> options;
+} selfPlayEngineT;
+
+// Match settings
+typedef struct
+{
+    unsigned int games = 100;
+    unsigned int concurrency = 4;
+    selfPlayEngineT engines[2];
+    // Adjudication
+    unsigned int maxPlies = 400;
+    int resignCp = 1000;
+    unsigned int resignMoves = 3;
+    int drawCp = 10;
+    unsigned int drawMoves = 8;
+    unsigned int drawStartPly = 80;
+    // Sequential probability ratio test (stops the match once decided)
+    bool sprt = false;
+    double elo0 = 0.0;
+    double elo1 = 5.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+} selfPlayOptionsT;
+
+// Match score from the first engine's point of view
+typedef struct
+{
+    unsigned long long wins = 0;
+    unsigned long long losses = 0;
+    unsigned long long draws = 0;
+} matchScoreT;
+
+// Parse "depth=10,threads=2,hash=64,movetime=100,nodes=N,path=engine.exe"
+// Inputs: settings text, engine to fill
+// Output: true if every key was understood
+bool parseEngineSettings(const std::string& settings, selfPlayEngineT& engine);
+
+// Elo difference for a match score
+// Inputs: score, error margin (95%) output
+// Output: Elo difference
+double matchElo(const matchScoreT& score, double& margin);
+
+// Log-likelihood ratio of H1 (elo1) against H0 (elo0)
+// Inputs: score, Elo bounds
+// Output: LLR
+double sprtLlr(const matchScoreT& score, double elo0, double elo1);
+
+// Command line entry for "--selfplay"
+// Inputs: program arguments
+// Output: process exit code
+int selfPlayMain(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+
+Objective:
+Syzygy tablebase registration definition file
+*/
+
+#include "ECE_Syzygy.hpp"
+#include <sstream>
+#include <windows.h>
+
+// Register every table file in the directories
+// Inputs: directories separated by ';'
+// Output: number of tables found
+unsigned int syzygyTablebase::init(const std::string& directories)
+{
+    tables.clear();
+    maxPieces = 0;
+    wdlCount = 0;
+    dtzCount = 0;
+    paths = directories;
+
+    std::stringstream list(directories);
+    std::string directory;
+    while (std::getline(list, directory, ';'))
+    {
+        if (directory.empty())
+        {
+            continue;
+        }
+        for (const char* extension : { ".rtbw", ".rtbz" })
+        {
+            WIN32_FIND_DATAA found;
+            HANDLE hFind = FindFirstFileA((directory + "/*" + extension).c_str(), &found);
+            if (hFind == INVALID_HANDLE_VALUE)
+            {
+                continue;
+            }
+            do
+            {
+                std::string fileName = found.cFileName;
+                std::string name = fileName.substr(0, fileName.size() - 5);
+                size_t split = name.find('v');
+                if (split == std::string::npos || name[0] != 'K' || split + 1 >= name.size() || name[split + 1] != 'K' ||
+                    name.size() - 1 > SYZYGY_MAX_PIECES || name.find_first_not_of("KQRBNPv") != std::string::npos ||
+                    tables.count(fileName) != 0)
+                {
+                    continue;
+                }
+
+                syzygyTableT& table = tables[fileName];
+                table.path = directory + "/" + fileName;
+                table.isDtz = std::string(extension) == ".rtbz";
+                table.pieceCount = static_cast<int>(name.size() - 1);
+                (table.isDtz ? dtzCount : wdlCount)++;
+                if (!table.isDtz && table.pieceCount > maxPieces)
+                {
+                    maxPieces = table.pieceCount;
+                }
+            } while (FindNextFileA(hFind, &found));
+            FindClose(hFind);
+        }
+    }
+    return static_cast<unsigned int>(tables.size());
+}
+
+// Largest piece count with a WDL table
+// Inputs: None
+// Output: piece count (0 without tables)
+int syzygyTablebase::getMaxPieces() const
+{
+    return maxPieces;
+}
+
+// Directories given to init
+// Inputs: None
+// Output: directories separated by ';'
+const std::string& syzygyTablebase::getPaths() const
+{
+    return paths;
+}
+
+// Get the number of tables found
+// Inputs: WDL and DTZ counts to fill
+// Output: None
+void syzygyTablebase::getTableCounts(unsigned int& wdl, unsigned int& dtz) const
+{
+    wdl = wdlCount;
+    dtz = dtzCount;
+}
+
+// Check if the engine can probe a position (few enough pieces, no castling rights)
+// Inputs: position
+// Output: true if in range
+bool syzygyTablebase::covers(const chessPosition& position) const
+{
+    int pieces = 0;
+    for (int square = 0; square < 64; square++)
+    {
+        pieces += position.pieceAt(square) != PIECE_NONE;
+    }
+    return pieces <= maxPieces && position.castlingRights() == 0;
+}
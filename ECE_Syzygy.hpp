@@ -0,0 +1,62 @@
+/*
+
+Objective:
+Syzygy endgame tablebase registration for a local directory. The table files
+found are handed to the engine ("SyzygyPath"), which probes them in its own search.
+*/
+
+#ifndef ECE_SYZYGY_HPP
+#define ECE_SYZYGY_HPP
+
+#include <map>
+#include <string>
+#include "ECE_ChessPosition.hpp"
+
+// Default tablebase directory (several may be given separated by ';')
+const char SYZYGY_DIR[] = "Lab3/syzygy";
+// Largest tables in the Syzygy format
+const int SYZYGY_MAX_PIECES = 7;
+
+// One table file (WDL or DTZ) of a material signature
+typedef struct
+{
+    std::string path;
+    bool isDtz = false;
+    // Material from the file name ("KRPvKR": white KRP, black KR)
+    int pieceCount = 0;
+} syzygyTableT;
+
+class syzygyTablebase
+{
+private:
+    // Tables by file name ("KRvK.rtbw"), found at init
+    std::map<std::string, syzygyTableT> tables;
+    std::string paths;
+    int maxPieces = 0;
+    unsigned int wdlCount = 0;
+    unsigned int dtzCount = 0;
+
+public:
+    // Register every table file in the directories
+    // Inputs: directories separated by ';'
+    // Output: number of tables found
+    unsigned int init(const std::string& directories);
+    // Largest piece count with a WDL table
+    // Inputs: None
+    // Output: piece count (0 without tables)
+    int getMaxPieces() const;
+    // Directories given to init
+    // Inputs: None
+    // Output: directories separated by ';'
+    const std::string& getPaths() const;
+    // Get the number of tables found
+    // Inputs: WDL and DTZ counts to fill
+    // Output: None
+    void getTableCounts(unsigned int& wdl, unsigned int& dtz) const;
+    // Check if the engine can probe a position (few enough pieces, no castling rights)
+    // Inputs: position
+    // Output: true if in range
+    bool covers(const chessPosition& position) const;
+};
+
+#endif
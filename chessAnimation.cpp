@@ -0,0 +1,124 @@
+/*
+
+Objective:
+Chess piece animation definition file
+*/
+
+#include "chessAnimation.h"
+#include <cmath>
+
+
+// Render offset of a tween at its current time
+// Inputs: tween
+// Output: offset from tPos
+glm::vec3 chessAnimator::offsetAt(const tweenT& tween) const
+{
+    double t = (tween.elapsed - tween.delay) / tween.duration;
+    t = (t < 0.0) ? 0.0 : (t > 1.0) ? 1.0 : t;
+
+    // Smoothstep easing for the travel, half sine for the lift
+    float eased = static_cast<float>(t * t * (3.0 - 2.0 * t));
+    glm::vec3 offset = tween.startOffset * (1.0f - eased);
+    offset.z += tween.lift * static_cast<float>(std::sin(3.14159265358979 * t));
+    return offset;
+}
+
+// Start animating a piece whose tPos was just updated
+// Inputs: piece transform, its tPos before the update, kind, start delay (s)
+// Output: None
+void chessAnimator::start(tPosition& piece, const glm::vec3& previousPos, animationKindT kind, double delay)
+{
+    // A piece already in flight continues from where it is drawn now
+    unsigned int slot = activeCount;
+    for (unsigned int i = 0; i < activeCount; i++)
+    {
+        if (tweens[i].piece == &piece)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == ANIMATION_POOL_SIZE)
+    {
+        // Pool exhausted: finish the oldest tween at once and reuse it
+        tweens[0].piece->aOffset = glm::vec3(0.f);
+        slot = 0;
+    }
+    else if (slot == activeCount)
+    {
+        activeCount++;
+    }
+
+    tweenT& tween = tweens[slot];
+    tween.piece = &piece;
+    tween.startOffset = previousPos + piece.aOffset - piece.tPos;
+    tween.delay = delay;
+    tween.elapsed = 0.0;
+    switch (kind)
+    {
+    case ANIM_KNIGHT_ARC:
+        tween.lift = ANIMATION_KNIGHT_LIFT;
+        tween.duration = ANIMATION_KNIGHT_TIME;
+        break;
+    case ANIM_CAPTURE:
+        tween.lift = ANIMATION_CAPTURE_LIFT;
+        tween.duration = ANIMATION_CAPTURE_TIME;
+        break;
+    default:
+        tween.lift = 0.f;
+        tween.duration = ANIMATION_SLIDE_TIME;
+        break;
+    }
+
+    // Keep drawing the piece at its old place until the tween runs
+    piece.aOffset = tween.startOffset;
+}
+
+// Advance every tween by the wall clock delta
+// Inputs: elapsed seconds since the last frame
+// Output: true if any render offset changed
+bool chessAnimator::update(double deltaTime)
+{
+    bool changed = false;
+    unsigned int i = 0;
+    while (i < activeCount)
+    {
+        tweenT& tween = tweens[i];
+        tween.elapsed += deltaTime;
+        if (tween.elapsed <= tween.delay)
+        {
+            i++;
+            continue;
+        }
+
+        changed = true;
+        if (tween.elapsed >= tween.delay + tween.duration)
+        {
+            // Done: land exactly on the logical position and free the slot
+            tween.piece->aOffset = glm::vec3(0.f);
+            tweens[i] = tweens[--activeCount];
+        }
+        else
+        {
+            tween.piece->aOffset = offsetAt(tween);
+            i++;
+        }
+    }
+    return changed;
+}
+
+// Drop every tween (transform map about to be rebuilt)
+// Inputs: None
+// Output: None
+void chessAnimator::clear()
+{
+    activeCount = 0;
+}
+
+// Check for running tweens
+// Inputs: None
+// Output: true if nothing is moving
+bool chessAnimator::isIdle() const
+{
+    return activeCount == 0;
+}
@@ -0,0 +1,72 @@
+/*
+Objective:
+Chess piece animation header file (time based tweens for moves and captures)
+*/
+
+#ifndef CHESS_ANIMATION_H
+#define CHESS_ANIMATION_H
+
+#include "chessCommon.h"
+
+// Tweens kept in flight at once (a move plus its capture needs two)
+const unsigned int ANIMATION_POOL_SIZE = 32;
+// Durations in seconds
+const double ANIMATION_SLIDE_TIME = 0.35;
+const double ANIMATION_KNIGHT_TIME = 0.45;
+const double ANIMATION_CAPTURE_TIME = 0.6;
+// Peak lift above the board (knight hop, captured piece leaving)
+const float ANIMATION_KNIGHT_LIFT = 0.6f * CHESS_BOX_SIZE;
+const float ANIMATION_CAPTURE_LIFT = 1.2f * CHESS_BOX_SIZE;
+
+// Kind of movement
+typedef enum
+{
+    ANIM_SLIDE,
+    ANIM_KNIGHT_ARC,
+    ANIM_CAPTURE
+} animationKindT;
+
+// One running tween. The logical position (tPos) is already final,
+// the tween only drives the render offset from the old place to zero.
+typedef struct
+{
+    tPosition* piece;
+    glm::vec3 startOffset;
+    float lift;
+    double delay;
+    double duration;
+    double elapsed;
+} tweenT;
+
+class chessAnimator
+{
+private:
+    // Preallocated pool, active tweens are packed at the front
+    tweenT tweens[ANIMATION_POOL_SIZE];
+    unsigned int activeCount = 0;
+
+    // Render offset of a tween at its current time
+    // Inputs: tween
+    // Output: offset from tPos
+    glm::vec3 offsetAt(const tweenT& tween) const;
+
+public:
+    // Start animating a piece whose tPos was just updated
+    // Inputs: piece transform, its tPos before the update, kind, start delay (s)
+    // Output: None
+    void start(tPosition& piece, const glm::vec3& previousPos, animationKindT kind, double delay = 0.0);
+    // Advance every tween by the wall clock delta
+    // Inputs: elapsed seconds since the last frame
+    // Output: true if any render offset changed
+    bool update(double deltaTime);
+    // Drop every tween (transform map about to be rebuilt)
+    // Inputs: None
+    // Output: None
+    void clear();
+    // Check for running tweens
+    // Inputs: None
+    // Output: true if nothing is moving
+    bool isIdle() const;
+};
+
+#endif
@@ -0,0 +1,195 @@
+/*
+
+Objective:
+Background asset loader definition file
+*/
+
+#include "chessAssetLoader.h"
+#include <chrono>
+// OBJ loading through assimp
+#include <common/objloader.hpp>
+
+
+// Queue work for the pool
+// Inputs: task
+// Output: None
+void chessAssetLoader::post(std::function<void()> task)
+{
+    outstanding++;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        tasks.push_back(std::move(task));
+    }
+    taskReady.notify_one();
+}
+
+// Worker thread body
+// Inputs: None
+// Output: None
+void chessAssetLoader::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(taskMutex);
+            taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+        outstanding--;
+    }
+}
+
+// Parse one OBJ file and queue its components for preparation
+// Inputs: OBJ file path
+// Output: None
+void chessAssetLoader::parseFile(const std::string& objFile)
+{
+    std::vector<chessComponent> components;
+    if (!loadAssImpLab3(objFile.c_str(), components))
+    {
+        failed = true;
+        return;
+    }
+
+    // Move into the long lived storage before handing out pointers
+    std::vector<chessComponent>* stored;
+    {
+        std::lock_guard<std::mutex> lock(parsedMutex);
+        parsedFiles.emplace_back();
+        parsedFiles.back().swap(components);
+        stored = &parsedFiles.back();
+    }
+    // One task per component, meshes of one file are prepared in parallel
+    for (auto cit = stored->begin(); cit != stored->end(); cit++)
+    {
+        chessComponent* component = &(*cit);
+        post([this, component] { prepareComponent(component); });
+    }
+}
+
+// CPU side preparation of one component (mesh optimization, quantization, texture decode)
+// Inputs: component
+// Output: None
+void chessAssetLoader::prepareComponent(chessComponent* component)
+{
+    // Vertex cache friendly order (stored in Lab3/cache after the first run)
+    component->optimizeMesh();
+    component->prepareGLBuffers();
+    component->prepareTexture();
+
+    std::lock_guard<std::mutex> lock(readyMutex);
+    readyQueue.push_back(component);
+}
+
+// destructor function
+chessAssetLoader::~chessAssetLoader()
+{
+    stop();
+}
+
+// Start loading in the background
+// Inputs: OBJ files
+// Output: None
+void chessAssetLoader::start(const std::vector<std::string>& objFiles)
+{
+    for (const auto& objFile : objFiles)
+    {
+        post([this, objFile] { parseFile(objFile); });
+    }
+
+    unsigned int threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+    {
+        threadCount = 2;
+    }
+    threadCount = (threadCount < ASSET_LOADER_MAX_THREADS) ? threadCount : ASSET_LOADER_MAX_THREADS;
+    for (unsigned int it = 0; it < threadCount; it++)
+    {
+        workers.emplace_back(&chessAssetLoader::workerLoop, this);
+    }
+}
+
+// Upload prepared components (render thread only)
+// Inputs: scene to append uploaded components to, arena receiving the meshes, time budget in seconds
+// Output: number of components added to the scene
+unsigned int chessAssetLoader::pump(std::vector<chessComponent*>& scene, chessGeometryArena& arena, double budgetSeconds)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    unsigned int uploaded = 0;
+    while (true)
+    {
+        chessComponent* component;
+        {
+            std::lock_guard<std::mutex> lock(readyMutex);
+            if (readyQueue.empty())
+            {
+                break;
+            }
+            component = readyQueue.front();
+            readyQueue.pop_front();
+        }
+        // Setup VBO buffers
+        component->setupGLBuffers(arena);
+        // Setup Texture
+        component->setupTextureBuffers();
+        scene.push_back(component);
+        uploaded++;
+
+        // At least one upload per call, the rest waits for the next frame
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        if (elapsed.count() >= budgetSeconds)
+        {
+            break;
+        }
+    }
+    return uploaded;
+}
+
+// Check for the end of loading
+// Inputs: None
+// Output: true once every component is uploaded (or loading failed)
+bool chessAssetLoader::isDone()
+{
+    if (failed)
+    {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(readyMutex);
+    return outstanding == 0 && readyQueue.empty();
+}
+
+// Check for a failed OBJ file
+// Inputs: None
+// Output: true if any file failed to load
+bool chessAssetLoader::hasFailed() const
+{
+    return failed;
+}
+
+// Join the worker threads
+// Inputs: None
+// Output: None
+void chessAssetLoader::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        stopping = true;
+        tasks.clear();
+    }
+    taskReady.notify_all();
+    for (auto& worker : workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
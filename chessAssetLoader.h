@@ -0,0 +1,86 @@
+/*
+Objective:
+Background asset loading: OBJ parsing, mesh optimization and texture decoding
+run on worker threads, GL uploads are handed back to the render thread
+*/
+
+#ifndef CHESS_ASSET_LOADER_H
+#define CHESS_ASSET_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chessComponent.h"
+
+// Upper bound on loader threads (the engine process needs the other cores)
+const unsigned int ASSET_LOADER_MAX_THREADS = 4;
+// Render thread time spent on uploads per frame (seconds)
+const double ASSET_UPLOAD_BUDGET = 0.004;
+
+class chessAssetLoader
+{
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex taskMutex;
+    std::condition_variable taskReady;
+    bool stopping = false;
+    // Queued or running tasks
+    std::atomic<unsigned int> outstanding{ 0 };
+    std::atomic<bool> failed{ false };
+
+    // Components of every parsed file (deque keeps their addresses stable)
+    std::deque<std::vector<chessComponent>> parsedFiles;
+    std::mutex parsedMutex;
+    // Prepared components waiting for their GL upload
+    std::deque<chessComponent*> readyQueue;
+    std::mutex readyMutex;
+
+    // Queue work for the pool
+    // Inputs: task
+    // Output: None
+    void post(std::function<void()> task);
+    // Worker thread body
+    // Inputs: None
+    // Output: None
+    void workerLoop();
+    // Parse one OBJ file and queue its components for preparation
+    // Inputs: OBJ file path
+    // Output: None
+    void parseFile(const std::string& objFile);
+    // CPU side preparation of one component (mesh optimization, quantization, texture decode)
+    // Inputs: component
+    // Output: None
+    void prepareComponent(chessComponent* component);
+
+public:
+    // destructor function
+    ~chessAssetLoader();
+    // Start loading in the background
+    // Inputs: OBJ files
+    // Output: None
+    void start(const std::vector<std::string>& objFiles);
+    // Upload prepared components (render thread only)
+    // Inputs: scene to append uploaded components to, arena receiving the meshes, time budget in seconds
+    // Output: number of components added to the scene
+    unsigned int pump(std::vector<chessComponent*>& scene, chessGeometryArena& arena, double budgetSeconds);
+    // Check for the end of loading
+    // Inputs: None
+    // Output: true once every component is uploaded (or loading failed)
+    bool isDone();
+    // Check for a failed OBJ file
+    // Inputs: None
+    // Output: true if any file failed to load
+    bool hasFailed() const;
+    // Join the worker threads
+    // Inputs: None
+    // Output: None
+    void stop();
+};
+
+#endif
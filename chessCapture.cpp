@@ -0,0 +1,529 @@
+/*
+
+Objective:
+Asynchronous frame capture definition file
+*/
+
+#include "chessCapture.h"
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <windows.h>
+
+// Fences are polled without waiting, except when the ring wraps or capture stops
+const GLuint64 CAPTURE_WAIT_TIMEOUT = 1000000000ULL;
+
+// CRC-32 (PNG chunks)
+// Inputs: data, size, running crc
+// Output: crc
+static unsigned int crc32(const unsigned char* data, size_t size, unsigned int crc = 0)
+{
+    static unsigned int table[256];
+    static bool tableReady = false;
+    if (!tableReady)
+    {
+        for (unsigned int n = 0; n < 256; n++)
+        {
+            unsigned int c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        tableReady = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Append a big endian 32-bit value
+// Inputs: output bytes, value
+// Output: None
+static void putBigEndian(std::vector<unsigned char>& out, unsigned int value)
+{
+    out.push_back(static_cast<unsigned char>(value >> 24));
+    out.push_back(static_cast<unsigned char>(value >> 16));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+// Append one PNG chunk (length, type, data, CRC)
+// Inputs: output bytes, chunk type, chunk data
+// Output: None
+static void putChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+{
+    putBigEndian(out, static_cast<unsigned int>(data.size()));
+    size_t typeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBigEndian(out, crc32(&out[typeStart], out.size() - typeStart));
+}
+
+// Write an RGB PNG (stored deflate blocks: no zlib in the tree, and the
+// writer thread should keep up with the frame rate rather than compress)
+// Inputs: file path, frame
+// Output: true if written
+static bool writePng(const std::string& filePath, const capturedFrameT& frame)
+{
+    // Scanlines top row first, filter type 0, alpha dropped (the clear colour has none)
+    size_t rowBytes = static_cast<size_t>(frame.width) * 3 + 1;
+    std::vector<unsigned char> raw(rowBytes * frame.height);
+    for (int y = 0; y < frame.height; y++)
+    {
+        const unsigned char* source = &frame.pixels[static_cast<size_t>(frame.height - 1 - y) * frame.width * 4];
+        unsigned char* row = &raw[y * rowBytes];
+        row[0] = 0;
+        for (int x = 0; x < frame.width; x++)
+        {
+            row[1 + 3 * x] = source[4 * x];
+            row[2 + 3 * x] = source[4 * x + 1];
+            row[3 + 3 * x] = source[4 * x + 2];
+        }
+    }
+
+    // zlib stream of stored blocks plus the Adler-32 of the raw data
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    unsigned int adlerA = 1;
+    unsigned int adlerB = 0;
+    for (size_t offset = 0; offset < raw.size(); offset += 65535)
+    {
+        size_t blockSize = (raw.size() - offset < 65535) ? raw.size() - offset : 65535;
+        zlib.push_back((offset + blockSize == raw.size()) ? 1 : 0);
+        zlib.push_back(static_cast<unsigned char>(blockSize));
+        zlib.push_back(static_cast<unsigned char>(blockSize >> 8));
+        zlib.push_back(static_cast<unsigned char>(~blockSize));
+        zlib.push_back(static_cast<unsigned char>(~blockSize >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        for (size_t i = offset; i < offset + blockSize; i++)
+        {
+            adlerA = (adlerA + raw[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+    }
+    putBigEndian(zlib, (adlerB << 16) | adlerA);
+
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> header;
+    putBigEndian(header, static_cast<unsigned int>(frame.width));
+    putBigEndian(header, static_cast<unsigned int>(frame.height));
+    // 8 bits, truecolour, deflate, adaptive filtering, no interlace
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", zlib);
+    putChunk(png, "IEND", std::vector<unsigned char>());
+
+    FILE* file = fopen(filePath.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    bool written = fwrite(png.data(), 1, png.size(), file) == png.size();
+    fclose(file);
+    return written;
+}
+
+// Append a frame to a Y4M stream (4:4:4, BT.601 studio range)
+// Inputs: stream, frame
+// Output: true if written
+static bool writeY4mFrame(FILE* file, const capturedFrameT& frame)
+{
+    size_t planeSize = static_cast<size_t>(frame.width) * frame.height;
+    std::vector<unsigned char> planes(planeSize * 3);
+    for (int y = 0; y < frame.height; y++)
+    {
+        const unsigned char* source = &frame.pixels[static_cast<size_t>(frame.height - 1 - y) * frame.width * 4];
+        size_t rowStart = static_cast<size_t>(y) * frame.width;
+        for (int x = 0; x < frame.width; x++)
+        {
+            int r = source[4 * x];
+            int g = source[4 * x + 1];
+            int b = source[4 * x + 2];
+            planes[rowStart + x] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            planes[planeSize + rowStart + x] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            planes[2 * planeSize + rowStart + x] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    fputs("FRAME\n", file);
+    return fwrite(planes.data(), 1, planes.size(), file) == planes.size();
+}
+
+// Hand a frame to the writer (dropped when it is too far behind)
+// Inputs: frame (moved)
+// Output: None
+void chessCapture::enqueue(capturedFrameT& frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.size() >= CAPTURE_QUEUE_LIMIT)
+        {
+            framesDropped++;
+            return;
+        }
+        queue.push_back(std::move(frame));
+    }
+    queueReady.notify_one();
+}
+
+// Map the oldest readback once its fence has passed
+// Inputs: true to block until the GPU is done
+// Output: true if a slot was collected
+bool chessCapture::collectOldest(bool wait)
+{
+    if (slotsInFlight == 0)
+    {
+        return false;
+    }
+    unsigned int slot = oldestSlot;
+    GLenum state = glClientWaitSync(fences[slot], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? CAPTURE_WAIT_TIMEOUT : 0);
+    if (state == GL_TIMEOUT_EXPIRED)
+    {
+        return false;
+    }
+    glDeleteSync(fences[slot]);
+    fences[slot] = 0;
+
+    // The copy already happened on the GPU, mapping does not wait
+    capturedFrameT frame;
+    frame.width = slotWidth[slot];
+    frame.height = slotHeight[slot];
+    size_t size = static_cast<size_t>(frame.width) * frame.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[slot]);
+    void* pixels = (state == GL_WAIT_FAILED) ? nullptr : glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (pixels != nullptr)
+    {
+        frame.pixels.resize(size);
+        memcpy(frame.pixels.data(), pixels, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        enqueue(frame);
+    }
+    else
+    {
+        framesDropped++;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Ticks with nothing drawn after this frame
+    for (; repeatsAfterSlot[slot] > 0; repeatsAfterSlot[slot]--)
+    {
+        capturedFrameT repeat;
+        repeat.repeat = true;
+        enqueue(repeat);
+    }
+    oldestSlot = (oldestSlot + 1) % CAPTURE_RING_SIZE;
+    slotsInFlight--;
+    return true;
+}
+
+// Writer thread body
+// Inputs: None
+// Output: None
+void chessCapture::writerLoop()
+{
+    while (true)
+    {
+        capturedFrameT frame;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueReady.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty())
+            {
+                // Stopping and drained
+                return;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        writeFrame(frame);
+    }
+}
+
+// Encode one frame
+// Inputs: frame
+// Output: None
+void chessCapture::writeFrame(const capturedFrameT& frame)
+{
+    if (!frame.repeat)
+    {
+        lastFrame = frame;
+    }
+    else if (lastFrame.pixels.empty())
+    {
+        return;
+    }
+
+    if (mode == CAPTURE_Y4M)
+    {
+        if (videoFile == nullptr)
+        {
+            return;
+        }
+        // The stream header takes the size of the first frame, resized frames cannot follow
+        if (fileIndex == 0)
+        {
+            videoWidth = lastFrame.width;
+            videoHeight = lastFrame.height;
+            fprintf(videoFile, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C444\n", videoWidth, videoHeight, framesPerSecond);
+        }
+        else if (lastFrame.width != videoWidth || lastFrame.height != videoHeight)
+        {
+            return;
+        }
+        if (writeY4mFrame(videoFile, lastFrame))
+        {
+            fileIndex++;
+            framesWritten++;
+        }
+        return;
+    }
+
+    std::string filePath = target;
+    if (mode == CAPTURE_PNG_SEQUENCE)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/frame_%05llu.png", fileIndex);
+        filePath += name;
+    }
+    if (writePng(filePath, lastFrame))
+    {
+        fileIndex++;
+        framesWritten++;
+        if (mode == CAPTURE_SCREENSHOT)
+        {
+            std::cout << "Screenshot saved to " << filePath << std::endl;
+        }
+    }
+    else
+    {
+        std::cout << "Capture could not write " << filePath << std::endl;
+    }
+}
+
+// destructor function
+chessCapture::~chessCapture()
+{
+    stop();
+}
+
+// Begin a capture session
+// Inputs: mode, output (file, directory or "|command" for Y4M), frame rate of the video
+// Output: true if started
+bool chessCapture::start(captureModeT cMode, const std::string& cTarget, unsigned int cFramesPerSecond)
+{
+    stop();
+    mode = cMode;
+    target = cTarget;
+    framesPerSecond = cFramesPerSecond;
+    framesRead = framesWritten = framesDropped = framesRepeated = 0;
+    fileIndex = 0;
+    lastFrame = capturedFrameT();
+
+    CreateDirectoryA(CAPTURE_DIR, NULL);
+    if (mode == CAPTURE_PNG_SEQUENCE)
+    {
+        CreateDirectoryA(target.c_str(), NULL);
+    }
+    else if (mode == CAPTURE_Y4M)
+    {
+        // "|command" pipes the stream into a local encoder
+        videoPipe = !target.empty() && target[0] == '|';
+        videoFile = videoPipe ? _popen(target.c_str() + 1, "wb") : fopen(target.c_str(), "wb");
+        if (videoFile == nullptr)
+        {
+            std::cout << "Capture could not open " << target << std::endl;
+            mode = CAPTURE_OFF;
+            return false;
+        }
+    }
+
+    if (packBuffers[0] == 0)
+    {
+        glGenBuffers(CAPTURE_RING_SIZE, packBuffers);
+    }
+    stopping = false;
+    writer = std::thread(&chessCapture::writerLoop, this);
+    armed = true;
+    return true;
+}
+
+// Finish every readback and write, then close the output
+// Inputs: None
+// Output: None
+void chessCapture::stop()
+{
+    if (mode == CAPTURE_OFF)
+    {
+        return;
+    }
+    armed = false;
+    while (collectOldest(true))
+    {
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    if (writer.joinable())
+    {
+        writer.join();
+    }
+    if (videoFile != nullptr)
+    {
+        if (videoPipe)
+        {
+            _pclose(videoFile);
+        }
+        else
+        {
+            fclose(videoFile);
+        }
+        videoFile = nullptr;
+    }
+    if (mode != CAPTURE_SCREENSHOT)
+    {
+        std::cout << "Capture stopped: " << status() << std::endl;
+    }
+    mode = CAPTURE_OFF;
+}
+
+// Check for frames to read this tick
+// Inputs: None
+// Output: true while capturing
+bool chessCapture::isActive() const
+{
+    return armed;
+}
+
+// Read the frame just drawn (after drawing, before the swap)
+// Inputs: framebuffer to read (0 for the window back buffer), size in pixels
+// Output: None
+void chessCapture::readFrame(GLuint framebuffer, int width, int height)
+{
+    if (!armed || width <= 0 || height <= 0)
+    {
+        return;
+    }
+    // Ring full: the oldest read is several frames old and done in practice
+    if (slotsInFlight == CAPTURE_RING_SIZE)
+    {
+        collectOldest(true);
+    }
+    unsigned int slot = (oldestSlot + slotsInFlight) % CAPTURE_RING_SIZE;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[slot]);
+    size_t size = static_cast<size_t>(width) * height * 4;
+    if (slotCapacity[slot] != size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slotCapacity[slot] = size;
+    }
+    // Into the pack buffer: glReadPixels returns at once, the copy is queued on the GPU
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    slotWidth[slot] = width;
+    slotHeight[slot] = height;
+    repeatsAfterSlot[slot] = 0;
+    slotsInFlight++;
+    framesRead++;
+    // One frame is all a screenshot needs
+    if (mode == CAPTURE_SCREENSHOT)
+    {
+        armed = false;
+    }
+}
+
+// Nothing was drawn this tick (video keeps its frame rate)
+// Inputs: None
+// Output: None
+void chessCapture::repeatFrame()
+{
+    if (!armed || mode == CAPTURE_SCREENSHOT)
+    {
+        return;
+    }
+    framesRepeated++;
+    if (slotsInFlight > 0)
+    {
+        // Keep it behind the readback still in flight
+        repeatsAfterSlot[(oldestSlot + slotsInFlight - 1) % CAPTURE_RING_SIZE]++;
+        return;
+    }
+    capturedFrameT repeat;
+    repeat.repeat = true;
+    enqueue(repeat);
+}
+
+// Collect finished readbacks without waiting (once per frame)
+// Inputs: None
+// Output: None
+void chessCapture::poll()
+{
+    while (collectOldest(false))
+    {
+    }
+    // Screenshot read back: finish the file and end the session
+    if (mode == CAPTURE_SCREENSHOT && !armed && slotsInFlight == 0)
+    {
+        stop();
+    }
+}
+
+// Create a single sample offscreen target (hidden window rendering)
+// Inputs: size in pixels
+// Output: true if complete
+bool chessCapture::createOffscreen(int width, int height)
+{
+    glGenRenderbuffers(1, &offscreenColor);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &offscreenDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &offscreenFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, offscreenDepth);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete)
+    {
+        glDeleteFramebuffers(1, &offscreenFramebuffer);
+        glDeleteRenderbuffers(1, &offscreenColor);
+        glDeleteRenderbuffers(1, &offscreenDepth);
+        offscreenFramebuffer = offscreenColor = offscreenDepth = 0;
+    }
+    return complete;
+}
+
+// Offscreen target to draw into
+// Inputs: None
+// Output: framebuffer (0 when drawing to the window)
+GLuint chessCapture::getOffscreenFramebuffer() const
+{
+    return offscreenFramebuffer;
+}
+
+// Counters for the console
+// Inputs: None
+// Output: one line status
+std::string chessCapture::status()
+{
+    std::ostringstream line;
+    line << (armed ? "recording" : "idle") << ", " << framesRead << " read, " << framesWritten << " written, "
+         << framesRepeated << " repeated, " << framesDropped << " dropped";
+    return line.str();
+}
@@ -0,0 +1,148 @@
+/*
+Objective:
+Frame capture without pipeline stalls: frames are read into a ring of pixel
+pack buffers with fences and written (PNG or Y4M) on a worker thread
+*/
+
+#ifndef CHESS_CAPTURE_H
+#define CHESS_CAPTURE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// Include GLEW
+#include <GL/glew.h>
+
+// Readbacks in flight (a slot is mapped about this many frames after its read)
+const unsigned int CAPTURE_RING_SIZE = 3;
+// Frames waiting for the writer before new ones are dropped (the renderer never waits)
+const unsigned int CAPTURE_QUEUE_LIMIT = 8;
+// Default output location
+const char CAPTURE_DIR[] = "Lab3/capture";
+
+// What the capture writes
+typedef enum
+{
+    CAPTURE_OFF,
+    CAPTURE_SCREENSHOT,
+    CAPTURE_PNG_SEQUENCE,
+    CAPTURE_Y4M
+} captureModeT;
+
+// One frame handed to the writer (RGBA rows, bottom row first as read)
+typedef struct
+{
+    std::vector<unsigned char> pixels;
+    int width = 0;
+    int height = 0;
+    // Nothing was drawn this tick, the writer repeats the previous frame
+    bool repeat = false;
+} capturedFrameT;
+
+class chessCapture
+{
+private:
+    // Readback ring
+    GLuint packBuffers[CAPTURE_RING_SIZE] = { 0 };
+    GLsync fences[CAPTURE_RING_SIZE] = { 0 };
+    int slotWidth[CAPTURE_RING_SIZE] = { 0 };
+    int slotHeight[CAPTURE_RING_SIZE] = { 0 };
+    size_t slotCapacity[CAPTURE_RING_SIZE] = { 0 };
+    unsigned int oldestSlot = 0;
+    unsigned int slotsInFlight = 0;
+    // Repeats seen while readbacks are in flight (kept in order with them)
+    unsigned int repeatsAfterSlot[CAPTURE_RING_SIZE] = { 0 };
+
+    // Offscreen colour/depth target for hidden windows
+    GLuint offscreenFramebuffer = 0;
+    GLuint offscreenColor = 0;
+    GLuint offscreenDepth = 0;
+
+    // Session
+    captureModeT mode = CAPTURE_OFF;
+    bool armed = false;
+    std::string target;
+    unsigned int framesPerSecond = 60;
+    unsigned long long framesRead = 0;
+    std::atomic<unsigned long long> framesWritten{ 0 };
+    unsigned long long framesDropped = 0;
+    unsigned long long framesRepeated = 0;
+
+    // Writer thread
+    std::thread writer;
+    std::deque<capturedFrameT> queue;
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    bool stopping = false;
+    FILE* videoFile = nullptr;
+    bool videoPipe = false;
+    // Y4M size is fixed by the stream header
+    int videoWidth = 0;
+    int videoHeight = 0;
+    capturedFrameT lastFrame;
+    unsigned long long fileIndex = 0;
+
+    // Hand a frame to the writer (dropped when it is too far behind)
+    // Inputs: frame (moved)
+    // Output: None
+    void enqueue(capturedFrameT& frame);
+    // Map the oldest readback once its fence has passed
+    // Inputs: true to block until the GPU is done
+    // Output: true if a slot was collected
+    bool collectOldest(bool wait);
+    // Writer thread body
+    // Inputs: None
+    // Output: None
+    void writerLoop();
+    // Encode one frame
+    // Inputs: frame
+    // Output: None
+    void writeFrame(const capturedFrameT& frame);
+
+public:
+    // destructor function
+    ~chessCapture();
+    // Begin a capture session
+    // Inputs: mode, output (file, directory or "|command" for Y4M), frame rate of the video
+    // Output: true if started
+    bool start(captureModeT cMode, const std::string& cTarget, unsigned int cFramesPerSecond);
+    // Finish every readback and write, then close the output
+    // Inputs: None
+    // Output: None
+    void stop();
+    // Check for frames to read this tick
+    // Inputs: None
+    // Output: true while capturing
+    bool isActive() const;
+    // Read the frame just drawn (after drawing, before the swap)
+    // Inputs: framebuffer to read (0 for the window back buffer), size in pixels
+    // Output: None
+    void readFrame(GLuint framebuffer, int width, int height);
+    // Nothing was drawn this tick (video keeps its frame rate)
+    // Inputs: None
+    // Output: None
+    void repeatFrame();
+    // Collect finished readbacks without waiting (once per frame)
+    // Inputs: None
+    // Output: None
+    void poll();
+    // Create a single sample offscreen target (hidden window rendering)
+    // Inputs: size in pixels
+    // Output: true if complete
+    bool createOffscreen(int width, int height);
+    // Offscreen target to draw into
+    // Inputs: None
+    // Output: framebuffer (0 when drawing to the window)
+    GLuint getOffscreenFramebuffer() const;
+    // Counters for the console
+    // Inputs: None
+    // Output: one line status
+    std::string status();
+};
+
+#endif
@@ -8,8 +8,11 @@ Game of Chess common file
 #define COMMON_H
 
 #include <unordered_map>
+#include <string>
 // Include GLM
 #include <glm/glm.hpp>
+// Rules side position (FEN setup)
+#include "ECE_ChessPosition.hpp"
 
 // Mesh properties has table
 typedef struct 
@@ -36,6 +39,10 @@ typedef struct
     glm::vec3 tPos;
     bool alive = true;
     bool player;
+    // Render only offset driven by animations (tPos stays the logical square)
+    glm::vec3 aOffset = glm::vec3(0.f);
+    // Level of detail drawn last frame (hysteresis state)
+    unsigned int lod = 0;
 } tPosition;
 
 // Chess board scaling
@@ -47,13 +54,17 @@ const float CHESS_BOX_SIZE = (float)(CBSCALE * 5.4);
 const float CPSCALE = 0.015f;
 // Platform height
 const float PHEIGHT = -3.0f;
+// Name of the board component
+const char BOARD_COMPONENT[] = "12951_Stone_Chess_Board";
 // Hash to hold the target Model matrix spec for each Chess component
 typedef std::unordered_map <std::string, tPosition> tModelMap;
 
 void setupChessBoard(tModelMap& cTModelMap);
+void setupChessBoard(const chessPosition& position, tModelMap& cTModelMap);
+glm::vec3 squareToBoardPosition(int square);
 bool movePiece(const std::string& sourceNotation, const std::string& targetNotation, tModelMap& cTModelMap);
 bool commandChecker(const std::string& command, tModelMap& cTModelMap);
 bool isThisACapture(const std::string& pieceName, const std::string& targetName, tModelMap& cTModelMap);
-std::string getPieceAtPosition(const glm::vec3& position, tModelMap& cTModelMap);
+const std::string& getPieceAtPosition(const glm::vec3& position, tModelMap& cTModelMap);
 
 #endif
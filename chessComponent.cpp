@@ -5,6 +5,7 @@ Chess component class definition file
 */
 
 #include "chessComponent.h"
+#include <sstream>
 
 
 // Compute the Geometric center
@@ -38,6 +39,10 @@ void chessComponent::getGeometricCenter()
 // Output: None
 void chessComponent::getBoundingBox()
 {
+    if (vertices.empty())
+    {
+        return;
+    }
     // Initialize the min and max
     cBoundingLimitsMin = vertices.front();
     cBoundingLimitsMax = vertices.front();
@@ -70,11 +75,11 @@ chessComponent::chessComponent()
     uvs.clear();
     normals.clear();
 
-    // OpenGL Buffers management
-    vertexbuffer = 0;
-    uvbuffer = 0;
-    normalbuffer = 0;
-    elementbuffer = 0;
+    // Location inside the geometry arena
+    baseVertex = 0;
+    firstIndex = 0;
+    vertexCount = 0;
+    indexCount = 0;
 
     // Component ID
     cName = "";
@@ -83,7 +88,7 @@ chessComponent::chessComponent()
     // Reset the geometric center
     cGeometricCener = glm::vec3(0.0f);
     cBoundingLimitsMin = glm::vec3(0.0f);
-    cBoundingLimitsMin = glm::vec3(0.0f);
+    cBoundingLimitsMax = glm::vec3(0.0f);
 
     // Reset the Texture handle
     Texture = 0;
@@ -150,34 +155,80 @@ void chessComponent::addFaceIndices(unsigned int *objFaceIndice)
     indices.push_back(objFaceIndice[2]);
 }
 
-// Setup rendering buffers
+// Weld and reorder the mesh for the vertex cache (before setupGLBuffers)
 // Inputs: None
 // Output: None
-void chessComponent::setupGLBuffers()
+void chessComponent::optimizeMesh()
 {
-    // Load it into a VBO
-    glGenBuffers(1, &vertexbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-    
-    // Load it into UV Buffer
-    glGenBuffers(1, &uvbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
-    
-    // Load it into the normals buffer
-    glGenBuffers(1, &normalbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
-
-    // Generate a buffer for the indices as well
-    glGenBuffers(1, &elementbuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), &indices[0], GL_STATIC_DRAW);
+    if (indices.empty() || vertices.empty())
+    {
+        return;
+    }
 
-    // Compute the Geometric center
+    // Center from the mesh as loaded, placement must not depend on welding
     getGeometricCenter();
+    geometricCenterValid = true;
+
+    meshOptStatsT stats;
+    ::optimizeMesh(cName, vertices, uvs, normals, indices, lodIndexCounts, stats);
+    // One write per line, loader threads report concurrently
+    std::ostringstream report;
+    report << cName << ": " << stats.verticesBefore << " -> " << stats.verticesAfter << " vertices, ACMR "
+           << stats.acmrBefore << " -> " << stats.acmrAfter << ", LOD triangles";
+    for (unsigned int lod = 0; lod < stats.lodLevels; lod++)
+    {
+        report << " " << stats.lodTriangles[lod];
+    }
+    report << (stats.fromCache ? " (cached)" : "") << "\n";
+    std::cout << report.str() << std::flush;
+}
+
+// Build the GPU vertex stream without touching OpenGL (any thread)
+// Inputs: None
+// Output: None
+void chessComponent::prepareGLBuffers()
+{
+    // Compute the Geometric center and the AABB (kept for dequantization, picking and culling)
+    if (!geometricCenterValid)
+    {
+        getGeometricCenter();
+        geometricCenterValid = true;
+    }
+    getBoundingBox();
+
+    // Quantize into one interleaved stream
+    quantizeMesh(vertices, uvs, normals, cBoundingLimitsMin, cBoundingLimitsMax, packedVertices);
+    vertexCount = static_cast<unsigned int>(packedVertices.size());
+    indexCount = static_cast<GLsizei>(indices.size());
+    if (lodIndexCounts.empty())
+    {
+        // Not optimized: the full mesh is the only level
+        lodIndexCounts.assign(1, static_cast<unsigned int>(indices.size()));
+    }
+
+    // Only the packed stream and the indices are needed from here on
+    std::vector<glm::vec3>().swap(vertices);
+    std::vector<glm::vec2>().swap(uvs);
+    std::vector<glm::vec3>().swap(normals);
+    buffersPrepared = true;
+}
+
+// Setup rendering buffers
+// Inputs: shared geometry arena
+// Output: None
+void chessComponent::setupGLBuffers(chessGeometryArena& arena)
+{
+    if (!buffersPrepared)
+    {
+        prepareGLBuffers();
+    }
+
+    // Append the mesh to the shared vertex/index buffers
+    arena.addMesh(packedVertices, indices, baseVertex, firstIndex);
 
+    // The GPU owns the mesh from here on, release the CPU copies
+    std::vector<unsigned short>().swap(indices);
+    std::vector<packedVertexT>().swap(packedVertices);
 }
 
 // Setup Texture buffers
@@ -192,10 +243,10 @@ void chessComponent::setupTexture(GLuint& TextureID)
     glUniform1i(TextureID, 0);
 }
 
-// Setup rendering buffers
+// Resolve and decode the texture file without touching OpenGL (any thread)
 // Inputs: None
 // Output: None
-void chessComponent::setupTextureBuffers()
+void chessComponent::prepareTexture()
 {
     // Matching pattern and rule creation
     // Any combination of 0-9, space in the beginning or end is allowed!
@@ -231,66 +282,82 @@ void chessComponent::setupTextureBuffers()
         std::cout << "Texture file not found for chess compoent!" << cName << std::endl;
     }
 
-    // Load the texture
-    Texture = loadBMP_custom(&cTextureFile[0]);
+    // Decode the texture, the upload happens on the render thread
+    decodeBMP(cTextureFile, textureImage);
+    texturePrepared = true;
 }
 
-// Render a mesh
+// Setup Texture buffers
 // Inputs: None
 // Output: None
-void chessComponent::renderMesh()
+void chessComponent::setupTextureBuffers()
 {
-    // 1rst attribute buffer : vertices
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-    glVertexAttribPointer(
-        0,                  // attribute
-        3,                  // size
-        GL_FLOAT,           // type
-        GL_FALSE,           // normalized?
-        0,                  // stride
-        (void*)0            // array buffer offset
-    );
-
-    // 2nd attribute buffer : UVs
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-    glVertexAttribPointer(
-        1,                                // attribute
-        2,                                // size
-        GL_FLOAT,                         // type
-        GL_FALSE,                         // normalized?
-        0,                                // stride
-        (void*)0                          // array buffer offset
-    );
-
-    // 3rd attribute buffer : normals
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-    glVertexAttribPointer(
-        2,                                // attribute
-        3,                                // size
-        GL_FLOAT,                         // type
-        GL_FALSE,                         // normalized?
-        0,                                // stride
-        (void*)0                          // array buffer offset
-    );
-
-    // Index buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
-
-    // Draw the triangles !
-    glDrawElements(
-        GL_TRIANGLES,      // mode
-        indices.size(),    // count
-        GL_UNSIGNED_SHORT,   // type
-        (void*)0           // element array buffer offset
-    );
-
-    // Disable the arrays
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-    glDisableVertexAttribArray(2);
+    if (!texturePrepared)
+    {
+        prepareTexture();
+    }
+    // Load the texture (pixels go through a pixel unpack buffer)
+    Texture = stagedTextureBMP(textureImage);
+    // Release the decoded copy
+    textureImage.pixels = std::vector<unsigned char>();
+}
+
+// Queue this mesh for the frame
+// Inputs: arena collecting the frame, model matrix, level of detail (0 is full resolution), window tile
+// Output: None
+void chessComponent::queueDraw(chessGeometryArena& arena, const glm::mat4& model, unsigned int lod, const glm::vec4& tile)
+{
+    if (lodIndexCounts.empty())
+    {
+        return;
+    }
+    // Levels are stored back to back after the mesh's first index
+    GLuint lodFirstIndex = firstIndex;
+    lod = (lod < lodIndexCounts.size()) ? lod : static_cast<unsigned int>(lodIndexCounts.size()) - 1;
+    for (unsigned int level = 0; level < lod; level++)
+    {
+        lodFirstIndex += lodIndexCounts[level];
+    }
+    // Positions are dequantized with the mesh AABB
+    arena.addDraw(Texture, lodIndexCounts[lod], lodFirstIndex, baseVertex, model,
+                  cBoundingLimitsMin, cBoundingLimitsMax - cBoundingLimitsMin, tile);
+}
+
+// Pick the level of detail for an instance
+// Inputs: projected bounding radius in pixels, level used last frame
+// Output: level of detail
+unsigned int chessComponent::selectLod(float projectedRadius, unsigned int currentLod)
+{
+    unsigned int lodCount = static_cast<unsigned int>(lodIndexCounts.size());
+    unsigned int lod = (currentLod < lodCount) ? currentLod : lodCount - 1;
+    // Coarser once clearly below the current level's threshold
+    while (lod + 1 < lodCount && lod < LOD_SWITCH_COUNT && projectedRadius < LOD_SWITCH_PIXELS[lod] * (1.f - LOD_HYSTERESIS))
+    {
+        lod++;
+    }
+    // Finer once clearly above the previous level's threshold
+    while (lod > 0 && projectedRadius > LOD_SWITCH_PIXELS[lod - 1] * (1.f + LOD_HYSTERESIS))
+    {
+        lod--;
+    }
+    return lod;
+}
+
+// Get the bounding sphere radius (model space)
+// Inputs: None
+// Output: radius
+float chessComponent::getBoundingRadius()
+{
+    return 0.5f * glm::length(cBoundingLimitsMax - cBoundingLimitsMin);
+}
+
+// Get the mesh AABB (model space)
+// Inputs: corners to fill
+// Output: None
+void chessComponent::getModelBounds(glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    boundsMin = cBoundingLimitsMin;
+    boundsMax = cBoundingLimitsMax;
 }
 
 // Render a mesh
@@ -298,13 +365,14 @@ void chessComponent::renderMesh()
 // Output: None
 void chessComponent::deleteGLBuffers()
 {
-    // Cleanup VBO
-    glDeleteBuffers(1, &vertexbuffer);
-    glDeleteBuffers(1, &uvbuffer);
-    glDeleteBuffers(1, &normalbuffer);
-    glDeleteBuffers(1, &elementbuffer);
-    // Cleanup Texture buffer
+    // Never uploaded (copies held by the loader threads must not call OpenGL)
+    if (Texture == 0)
+    {
+        return;
+    }
+    // Mesh data lives in the geometry arena, only the texture is ours
     glDeleteTextures(1, &Texture);
+    Texture = 0;
 }
 
 // Stores a component ID
@@ -314,6 +382,7 @@ void chessComponent::storeComponentID(std::string cName)
 {
     // Capture the component name
     this->cName = cName;
+    instanceKeys.clear();
     // Testing
     // std::cout << "The child name is " << this->cName << std::endl;
 }
@@ -345,7 +414,7 @@ glm::mat4 chessComponent::genModelMatrix(tPosition& cTPosition)
     // Start with the Identity matrix
     glm::mat4 tModel = glm::mat4(1.0f);
     // Target World Coordinates
-    tModel = glm::translate(tModel, cTPosition.tPos);
+    tModel = glm::translate(tModel, cTPosition.tPos + cTPosition.aOffset);
     // Apply target rotation
     if (cTPosition.rAngle != 0.f)
     {
@@ -378,7 +447,45 @@ glm::mat4 chessComponent::genModelMatrix(tPosition& cTPosition)
 // Get ID
 // Inputs: None
 // Output: ID
-std::string chessComponent::getComponentID()
+const std::string& chessComponent::getComponentID()
 {
     return cName;
 }
+
+// Get the model map key of an instance
+// Inputs: instance number
+// Output: key
+const std::string& chessComponent::getInstanceKey(unsigned int instance)
+{
+    // The renderer asks every frame, the strings are only built the first time
+    while (instanceKeys.size() <= instance)
+    {
+        size_t next = instanceKeys.size();
+        instanceKeys.push_back((next == 0) ? cName : cName + std::to_string(next));
+    }
+    return instanceKeys[instance];
+}
+
+// Get the uploaded mesh size
+// Inputs: None
+// Output: vertex count
+unsigned int chessComponent::getVertexCount()
+{
+    return vertexCount;
+}
+
+// Get the uploaded mesh size
+// Inputs: None
+// Output: index count (all levels of detail)
+unsigned int chessComponent::getIndexCount()
+{
+    return static_cast<unsigned int>(indexCount);
+}
+
+// Get the size of one level of detail
+// Inputs: level of detail
+// Output: index count
+unsigned int chessComponent::getLodIndexCount(unsigned int lod)
+{
+    return (lod < lodIndexCounts.size()) ? lodIndexCounts[lod] : 0;
+}
@@ -11,6 +11,9 @@ Chess component class header file
 #include <vector>
 #include <regex>
 #include "chessCommon.h"
+#include "chessMeshOptimizer.h"
+#include "chessUpload.h"
+#include "chessGeometryArena.h"
 
 // Include GLM
 #include <glm/glm.hpp>
@@ -18,27 +21,37 @@ Chess component class header file
 // Include GLEW
 #include <GL/glew.h>
 
-// Load BMP function support
-#include <common/texture.hpp>
+// Projected bounding radius (pixels) below which the next coarser LOD is drawn
+const float LOD_SWITCH_PIXELS[] = { 90.f, 45.f, 22.f };
+const unsigned int LOD_SWITCH_COUNT = sizeof(LOD_SWITCH_PIXELS) / sizeof(LOD_SWITCH_PIXELS[0]);
+// A switch back needs the threshold crossed by this fraction (no popping back and forth)
+const float LOD_HYSTERESIS = 0.15f;
 
 class chessComponent
 {
 private:
     // Properties of a Chess component
-    // mesh
+    // mesh (CPU copies are released once uploaded)
     std::vector<unsigned short> indices;
     std::vector<glm::vec3> vertices;
     std::vector<glm::vec2> uvs;
     std::vector<glm::vec3> normals;
+    unsigned int vertexCount = 0;
+    GLsizei indexCount = 0;
+    // Index count per level of detail (levels are stored back to back)
+    std::vector<unsigned int> lodIndexCounts;
+    // Quantized stream built off the render thread, waiting for its upload
+    std::vector<packedVertexT> packedVertices;
+    bool buffersPrepared = false;
 
-    // OpenGL Buffers management
-    GLuint vertexbuffer = 0;
-    GLuint uvbuffer = 0;
-    GLuint normalbuffer = 0;
-    GLuint elementbuffer = 0;
+    // Location of the mesh inside the shared geometry arena
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
 
     // Component ID
     std::string cName;
+    // Model map keys of the instances ("name", "name1", ...), built once on first use
+    std::vector<std::string> instanceKeys;
     std::string cTextureFile;
 
     // Mesh properties
@@ -46,9 +59,14 @@ private:
     glm::vec3 cGeometricCener = { 0, 0, 0 };
     glm::vec3 cBoundingLimitsMin = { 0, 0, 0 };
     glm::vec3 cBoundingLimitsMax = { 0, 0, 0 };
+    // Center is taken from the loaded mesh (welding would shift the average)
+    bool geometricCenterValid = false;
 
     // Texture properties
     GLuint Texture;
+    // Decoded texture waiting for its upload
+    bmpImageT textureImage;
+    bool texturePrepared = false;
 
     // Compute the Geometric center
     // Inputs: None
@@ -86,10 +104,22 @@ public:
     // Inputs: Face vertices read from OBJ file
     // Output: None
     void addFaceIndices(unsigned int *objFaceIndice);
+    // Weld and reorder the mesh for the vertex cache (before setupGLBuffers)
+    // Inputs: None
+    // Output: None
+    void optimizeMesh();
+    // Build the GPU vertex stream without touching OpenGL (any thread)
+    // Inputs: None
+    // Output: None
+    void prepareGLBuffers();
     // Setup rendering buffers
+    // Inputs: shared geometry arena
+    // Output: None
+    void setupGLBuffers(chessGeometryArena& arena);
+    // Resolve and decode the texture file without touching OpenGL (any thread)
     // Inputs: None
     // Output: None
-    void setupGLBuffers();
+    void prepareTexture();
     // Setup Texture buffers
     // Inputs: None
     // Output: None
@@ -98,10 +128,23 @@ public:
     // Inputs: None
     // Output: None
     void setupTexture(GLuint & TextureID);
-    // Render a mesh
+    // Queue this mesh for the frame
+    // Inputs: arena collecting the frame, model matrix, level of detail (0 is full resolution), window tile
+    // Output: None
+    void queueDraw(chessGeometryArena& arena, const glm::mat4& model, unsigned int lod = 0,
+                   const glm::vec4& tile = ARENA_FULL_WINDOW);
+    // Pick the level of detail for an instance
+    // Inputs: projected bounding radius in pixels, level used last frame
+    // Output: level of detail
+    unsigned int selectLod(float projectedRadius, unsigned int currentLod);
+    // Get the bounding sphere radius (model space)
     // Inputs: None
+    // Output: radius
+    float getBoundingRadius();
+    // Get the mesh AABB (model space)
+    // Inputs: corners to fill
     // Output: None
-    void renderMesh();
+    void getModelBounds(glm::vec3& boundsMin, glm::vec3& boundsMax);
     // Render a mesh
     // Inputs: None
     // Output: None
@@ -125,7 +168,23 @@ public:
     // Get ID
     // Inputs: None
     // Output: ID
-    std::string getComponentID();
+    const std::string& getComponentID();
+    // Get the model map key of an instance
+    // Inputs: instance number
+    // Output: key
+    const std::string& getInstanceKey(unsigned int instance);
+    // Get the uploaded mesh size
+    // Inputs: None
+    // Output: vertex count
+    unsigned int getVertexCount();
+    // Get the uploaded mesh size
+    // Inputs: None
+    // Output: index count (all levels of detail)
+    unsigned int getIndexCount();
+    // Get the size of one level of detail
+    // Inputs: level of detail
+    // Output: index count
+    unsigned int getLodIndexCount(unsigned int lod);
 };
 
 #endif
@@ -0,0 +1,306 @@
+/*
+
+Objective:
+Geometry arena and draw submission definition file
+*/
+
+#include "chessGeometryArena.h"
+#include "chessUpload.h"
+#include <algorithm>
+#include <cstddef>
+
+
+// Move a buffer into larger storage
+// Inputs: buffer handle (replaced), bytes in use, new size in bytes
+// Output: None
+void chessGeometryArena::growBuffer(GLuint& buffer, size_t usedBytes, size_t newBytes)
+{
+    GLuint grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+    if (buffer != 0 && usedBytes > 0)
+    {
+        // GPU side copy, the meshes already in the arena never come back to the CPU
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (buffer != 0)
+    {
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = grown;
+}
+
+// Point the vertex array at the arena buffers
+// Inputs: None
+// Output: None
+void chessGeometryArena::setupVertexFormat()
+{
+    glBindVertexArray(vertexArray);
+
+    // Quantized vertices, same layout as packedVertexT
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(packedVertexT), (void*)offsetof(packedVertexT, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(packedVertexT), (void*)offsetof(packedVertexT, uv));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(packedVertexT), (void*)offsetof(packedVertexT, normal));
+
+    // Per draw data advances once per instance (baseInstance picks the draw)
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (GLuint column = 0; column < ARENA_INSTANCE_ATTRIBUTES; column++)
+    {
+        glEnableVertexAttribArray(ARENA_INSTANCE_ATTRIBUTE + column);
+        glVertexAttribDivisor(ARENA_INSTANCE_ATTRIBUTE + column, 1);
+    }
+    setInstanceOffset(0);
+
+    // Element binding is part of the vertex array state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+}
+
+// Point the per draw attributes at one instance
+// Inputs: instance index
+// Output: None
+void chessGeometryArena::setInstanceOffset(size_t instance)
+{
+    size_t base = instance * sizeof(instanceDataT);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glVertexAttribPointer(ARENA_INSTANCE_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, sizeof(instanceDataT),
+                              (void*)(base + offsetof(instanceDataT, model) + column * sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(ARENA_INSTANCE_ATTRIBUTE + 4, 3, GL_FLOAT, GL_FALSE, sizeof(instanceDataT),
+                          (void*)(base + offsetof(instanceDataT, positionMin)));
+    glVertexAttribPointer(ARENA_INSTANCE_ATTRIBUTE + 5, 3, GL_FLOAT, GL_FALSE, sizeof(instanceDataT),
+                          (void*)(base + offsetof(instanceDataT, positionExtent)));
+    glVertexAttribPointer(ARENA_INSTANCE_ATTRIBUTE + 6, 4, GL_FLOAT, GL_FALSE, sizeof(instanceDataT),
+                          (void*)(base + offsetof(instanceDataT, tile)));
+}
+
+// destructor function
+chessGeometryArena::~chessGeometryArena()
+{
+    destroy();
+}
+
+// Create the buffers and pick the submission path (GL thread)
+// Inputs: None
+// Output: true if created
+bool chessGeometryArena::create()
+{
+    destroy();
+    // Indirect commands need baseInstance to select the per draw data
+    useIndirect = GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &instanceBuffer);
+    glGenBuffers(1, &indirectBuffer);
+    growBuffer(vertexBuffer, 0, ARENA_INITIAL_VERTICES * sizeof(packedVertexT));
+    growBuffer(indexBuffer, 0, ARENA_INITIAL_INDICES * sizeof(unsigned short));
+    vertexCapacity = ARENA_INITIAL_VERTICES;
+    indexCapacity = ARENA_INITIAL_INDICES;
+    vertexUsed = 0;
+    indexUsed = 0;
+    setupVertexFormat();
+    glBindVertexArray(vertexArray);
+    return glGetError() == GL_NO_ERROR;
+}
+
+// Release the buffers
+// Inputs: None
+// Output: None
+void chessGeometryArena::destroy()
+{
+    if (vertexArray == 0)
+    {
+        return;
+    }
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteBuffers(1, &indirectBuffer);
+    vertexArray = vertexBuffer = indexBuffer = instanceBuffer = indirectBuffer = 0;
+    vertexCapacity = vertexUsed = indexCapacity = indexUsed = 0;
+}
+
+// Check for the multi-draw indirect path
+// Inputs: None
+// Output: true if a frame is a few glMultiDrawElementsIndirect calls
+bool chessGeometryArena::isIndirect() const
+{
+    return useIndirect;
+}
+
+// Append one mesh
+// Inputs: packed vertices, 16-bit indices (relative to the mesh), mesh location to fill
+// Output: None
+void chessGeometryArena::addMesh(const std::vector<packedVertexT>& vertices, const std::vector<unsigned short>& indices,
+                                 GLint& baseVertex, GLuint& firstIndex)
+{
+    // Double until the mesh fits
+    bool regrown = false;
+    if (vertexUsed + vertices.size() > vertexCapacity)
+    {
+        size_t capacity = vertexCapacity;
+        while (vertexUsed + vertices.size() > capacity)
+        {
+            capacity *= 2;
+        }
+        growBuffer(vertexBuffer, vertexUsed * sizeof(packedVertexT), capacity * sizeof(packedVertexT));
+        vertexCapacity = capacity;
+        regrown = true;
+    }
+    if (indexUsed + indices.size() > indexCapacity)
+    {
+        size_t capacity = indexCapacity;
+        while (indexUsed + indices.size() > capacity)
+        {
+            capacity *= 2;
+        }
+        growBuffer(indexBuffer, indexUsed * sizeof(unsigned short), capacity * sizeof(unsigned short));
+        indexCapacity = capacity;
+        regrown = true;
+    }
+    if (regrown)
+    {
+        setupVertexFormat();
+    }
+
+    // Copy into the free tail (the copy targets keep the vertex array untouched)
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    stagedBufferSubData(GL_COPY_WRITE_BUFFER, vertexUsed * sizeof(packedVertexT), vertices.data(), vertices.size() * sizeof(packedVertexT));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    stagedBufferSubData(GL_COPY_WRITE_BUFFER, indexUsed * sizeof(unsigned short), indices.data(), indices.size() * sizeof(unsigned short));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    baseVertex = static_cast<GLint>(vertexUsed);
+    firstIndex = static_cast<GLuint>(indexUsed);
+    vertexUsed += vertices.size();
+    indexUsed += indices.size();
+}
+
+// Start collecting the draws of a frame
+// Inputs: None
+// Output: None
+void chessGeometryArena::beginFrame()
+{
+    queued.clear();
+}
+
+// Queue one draw
+// Inputs: texture, index count, first index and base vertex in the arena, model matrix, mesh AABB, window tile
+// Output: None
+void chessGeometryArena::addDraw(GLuint texture, GLuint count, GLuint firstIndex, GLint baseVertex, const glm::mat4& model,
+                                 const glm::vec3& positionMin, const glm::vec3& positionExtent, const glm::vec4& tile)
+{
+    queuedDrawT draw;
+    draw.texture = texture;
+    draw.command.count = count;
+    draw.command.instanceCount = 1;
+    draw.command.firstIndex = firstIndex;
+    draw.command.baseVertex = baseVertex;
+    draw.command.baseInstance = 0;
+    draw.instance.model = model;
+    draw.instance.positionMin = positionMin;
+    draw.instance.positionExtent = positionExtent;
+    draw.instance.tile = tile;
+    queued.push_back(draw);
+}
+
+// Sort the queued draws by texture and mesh, and submit them with every
+// draw of the same mesh as one instanced command (texture unit 0)
+// Inputs: None
+// Output: number of GL draw calls issued
+unsigned int chessGeometryArena::submit()
+{
+    if (queued.empty() || vertexArray == 0)
+    {
+        return 0;
+    }
+
+    // One texture bind per group, the same mesh and level back to back inside it
+    std::sort(queued.begin(), queued.end(), [](const queuedDrawT& a, const queuedDrawT& b) {
+        if (a.texture != b.texture)
+        {
+            return a.texture < b.texture;
+        }
+        if (a.command.firstIndex != b.command.firstIndex)
+        {
+            return a.command.firstIndex < b.command.firstIndex;
+        }
+        return a.command.baseVertex < b.command.baseVertex;
+    });
+    commands.clear();
+    commandTextures.clear();
+    instances.resize(queued.size());
+    for (size_t it = 0; it < queued.size(); it++)
+    {
+        instances[it] = queued[it].instance;
+        const drawCommandT& command = queued[it].command;
+        if (!commands.empty() && commandTextures.back() == queued[it].texture &&
+            commands.back().firstIndex == command.firstIndex && commands.back().baseVertex == command.baseVertex)
+        {
+            // Same mesh again (another board or square): one more instance
+            commands.back().instanceCount++;
+            continue;
+        }
+        commands.push_back(command);
+        commands.back().baseInstance = static_cast<GLuint>(it);
+        commandTextures.push_back(queued[it].texture);
+    }
+
+    // Both streams are rebuilt every frame, orphaning avoids waiting on the last one
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(instanceDataT), instances.data(), GL_STREAM_DRAW);
+    if (useIndirect)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(drawCommandT), commands.data(), GL_STREAM_DRAW);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    unsigned int drawCalls = 0;
+    size_t first = 0;
+    while (first < commands.size())
+    {
+        size_t last = first;
+        while (last < commands.size() && commandTextures[last] == commandTextures[first])
+        {
+            last++;
+        }
+        glBindTexture(GL_TEXTURE_2D, commandTextures[first]);
+
+        if (useIndirect)
+        {
+            // The whole group in one call
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*)(first * sizeof(drawCommandT)),
+                                        static_cast<GLsizei>(last - first), 0);
+            drawCalls++;
+        }
+        else
+        {
+            // GL 3.3: no baseInstance, the per draw attributes are moved to the first instance instead
+            for (size_t it = first; it < last; it++)
+            {
+                setInstanceOffset(commands[it].baseInstance);
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, commands[it].count, GL_UNSIGNED_SHORT,
+                                                  (void*)(commands[it].firstIndex * sizeof(unsigned short)),
+                                                  commands[it].instanceCount, commands[it].baseVertex);
+                drawCalls++;
+            }
+        }
+        first = last;
+    }
+    if (!useIndirect)
+    {
+        setInstanceOffset(0);
+    }
+    return drawCalls;
+}
@@ -0,0 +1,124 @@
+/*
+Objective:
+Shared vertex/index arena for every component mesh and per frame draw
+submission (multi-draw indirect, instanced base vertex draws on plain GL 3.3)
+*/
+
+#ifndef CHESS_GEOMETRY_ARENA_H
+#define CHESS_GEOMETRY_ARENA_H
+
+#include <vector>
+// Include GLM
+#include <glm/glm.hpp>
+// Include GLEW
+#include <GL/glew.h>
+#include "chessMeshOptimizer.h"
+
+// Starting arena size, grown by doubling
+const size_t ARENA_INITIAL_VERTICES = 1 << 16;
+const size_t ARENA_INITIAL_INDICES = 1 << 18;
+// First attribute location of the per draw data (model matrix takes 4)
+const GLuint ARENA_INSTANCE_ATTRIBUTE = 3;
+// Per draw attribute locations (model matrix, AABB min and extent, tile)
+const GLuint ARENA_INSTANCE_ATTRIBUTES = 7;
+// Tile covering the whole window (clip xy scale, then offset)
+const glm::vec4 ARENA_FULL_WINDOW = glm::vec4(1.f, 1.f, 0.f, 0.f);
+
+// Layout of one glMultiDrawElementsIndirect command
+typedef struct
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+} drawCommandT;
+
+// Per draw attributes (instanced stream, one instance per queued draw)
+typedef struct
+{
+    glm::mat4 model;
+    glm::vec3 positionMin;
+    glm::vec3 positionExtent;
+    // Part of the window the draw lands in (multi-board tiles)
+    glm::vec4 tile;
+} instanceDataT;
+
+// One draw queued for this frame
+typedef struct
+{
+    GLuint texture;
+    drawCommandT command;
+    instanceDataT instance;
+} queuedDrawT;
+
+class chessGeometryArena
+{
+private:
+    GLuint vertexArray = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLuint instanceBuffer = 0;
+    GLuint indirectBuffer = 0;
+    size_t vertexCapacity = 0;
+    size_t vertexUsed = 0;
+    size_t indexCapacity = 0;
+    size_t indexUsed = 0;
+    bool useIndirect = false;
+
+    // Frame scratch (kept between frames, no allocation once warm)
+    std::vector<queuedDrawT> queued;
+    std::vector<drawCommandT> commands;
+    std::vector<GLuint> commandTextures;
+    std::vector<instanceDataT> instances;
+
+    // Move a buffer into larger storage
+    // Inputs: buffer handle (replaced), bytes in use, new size in bytes
+    // Output: None
+    void growBuffer(GLuint& buffer, size_t usedBytes, size_t newBytes);
+    // Point the vertex array at the arena buffers
+    // Inputs: None
+    // Output: None
+    void setupVertexFormat();
+    // Point the per draw attributes at one instance
+    // Inputs: instance index
+    // Output: None
+    void setInstanceOffset(size_t instance);
+
+public:
+    // destructor function
+    ~chessGeometryArena();
+    // Create the buffers and pick the submission path (GL thread)
+    // Inputs: None
+    // Output: true if created
+    bool create();
+    // Release the buffers
+    // Inputs: None
+    // Output: None
+    void destroy();
+    // Check for the multi-draw indirect path
+    // Inputs: None
+    // Output: true if a frame is a few glMultiDrawElementsIndirect calls
+    bool isIndirect() const;
+    // Append one mesh
+    // Inputs: packed vertices, 16-bit indices (relative to the mesh), mesh location to fill
+    // Output: None
+    void addMesh(const std::vector<packedVertexT>& vertices, const std::vector<unsigned short>& indices,
+                 GLint& baseVertex, GLuint& firstIndex);
+    // Start collecting the draws of a frame
+    // Inputs: None
+    // Output: None
+    void beginFrame();
+    // Queue one draw
+    // Inputs: texture, index count, first index and base vertex in the arena, model matrix, mesh AABB, window tile
+    // Output: None
+    void addDraw(GLuint texture, GLuint count, GLuint firstIndex, GLint baseVertex, const glm::mat4& model,
+                 const glm::vec3& positionMin, const glm::vec3& positionExtent, const glm::vec4& tile);
+    // Sort the queued draws by texture and mesh, and submit them with every
+    // draw of the same mesh as one instanced command (texture unit 0)
+    // Inputs: None
+    // Output: number of GL draw calls issued
+    unsigned int submit();
+};
+
+#endif
@@ -0,0 +1,24 @@
+/*
+Objective:
+Hashing shared by the on-disk caches and the vertex welder
+*/
+
+#ifndef CHESS_HASH_H
+#define CHESS_HASH_H
+
+#include <cstddef>
+
+// FNV-1a over a block of bytes
+// Inputs: data, size, running hash
+// Output: hash
+inline unsigned long long fnv1a(const void* data, size_t size, unsigned long long hash = 14695981039346656037ULL)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+#endif
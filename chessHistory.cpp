@@ -0,0 +1,399 @@
+/*
+
+Objective:
+Game history definition file
+*/
+
+#include "chessHistory.h"
+#include <cstring>
+
+
+// Constructor function (the pool is allocated once here)
+chessHistory::chessHistory()
+    : pool(HISTORY_CAPACITY)
+{
+    for (unsigned int it = 0; it < HISTORY_CAPACITY; it++)
+    {
+        refs[it] = 0;
+        freeNodes[it] = static_cast<unsigned short>(HISTORY_CAPACITY - 1 - it);
+    }
+    freeCount = HISTORY_CAPACITY;
+    for (unsigned int it = 0; it < HISTORY_MAX_VARIATIONS; it++)
+    {
+        lines[it].used = false;
+        lines[it].count = 0;
+    }
+}
+
+// Pool index of a ply
+// Inputs: variation, ply
+// Output: snapshot index
+unsigned short chessHistory::nodeAt(const historyLineT& line, unsigned int ply) const
+{
+    return line.nodes[(line.start + ply - line.firstPly) % HISTORY_MAX_PLY];
+}
+
+// Drop a snapshot reference (freed at zero)
+// Inputs: snapshot index
+// Output: None
+void chessHistory::release(unsigned short node)
+{
+    if (--refs[node] == 0)
+    {
+        freeNodes[freeCount++] = node;
+    }
+}
+
+// Drop a variation and its references
+// Inputs: variation index
+// Output: None
+void chessHistory::dropLine(unsigned int index)
+{
+    historyLineT& line = lines[index];
+    for (unsigned int it = 0; it < line.count; it++)
+    {
+        release(line.nodes[(line.start + it) % HISTORY_MAX_PLY]);
+    }
+    line.count = 0;
+    line.used = false;
+}
+
+// Drop the oldest ply of a variation
+// Inputs: variation
+// Output: None
+void chessHistory::dropOldest(historyLineT& line)
+{
+    release(line.nodes[line.start]);
+    line.start = (line.start + 1) % HISTORY_MAX_PLY;
+    line.firstPly++;
+    line.count--;
+    if (line.cursor < line.firstPly)
+    {
+        line.cursor = line.firstPly;
+    }
+}
+
+// Take a free snapshot, making room if the pool is full
+// Inputs: None
+// Output: snapshot index
+unsigned short chessHistory::allocate()
+{
+    // Other variations give way first, oldest use first
+    while (freeCount == 0)
+    {
+        unsigned int victim = HISTORY_MAX_VARIATIONS;
+        for (unsigned int it = 0; it < HISTORY_MAX_VARIATIONS; it++)
+        {
+            if (it != current && lines[it].used && (victim == HISTORY_MAX_VARIATIONS || lines[it].lastUse < lines[victim].lastUse))
+            {
+                victim = it;
+            }
+        }
+        if (victim == HISTORY_MAX_VARIATIONS)
+        {
+            // Only this line is left: its oldest plies go
+            dropOldest(lines[current]);
+        }
+        else
+        {
+            dropLine(victim);
+        }
+    }
+    unsigned short node = freeNodes[--freeCount];
+    refs[node] = 1;
+    return node;
+}
+
+// Append a snapshot of the bound transforms to the current variation
+// Inputs: move, rules position, graveyard counts, move list length
+// Output: None
+void chessHistory::push(const std::string& move, const chessPosition& position, const unsigned int captured[2], unsigned int movesLength)
+{
+    historyLineT& line = lines[current];
+    if (line.count == HISTORY_MAX_PLY)
+    {
+        dropOldest(line);
+    }
+    unsigned short node = allocate();
+
+    positionSnapshotT& snapshot = pool[node];
+    snapshot.position = position;
+    for (unsigned int it = 0; it < boundCount; it++)
+    {
+        snapshot.pieces[it].tPos = bound[it]->tPos;
+        snapshot.pieces[it].alive = bound[it]->alive;
+    }
+    snapshot.captured[0] = captured[0];
+    snapshot.captured[1] = captured[1];
+    size_t length = move.size() < sizeof(snapshot.move) ? move.size() : sizeof(snapshot.move) - 1;
+    std::memcpy(snapshot.move, move.c_str(), length);
+    snapshot.move[length] = '\0';
+    snapshot.movesLength = movesLength;
+    snapshot.layout = layout;
+
+    unsigned int ply = line.firstPly + line.count;
+    line.nodes[(line.start + line.count) % HISTORY_MAX_PLY] = node;
+    line.count++;
+    line.cursor = ply;
+    line.lastUse = ++useClock;
+}
+
+// Free variation slot (the least recently used one is dropped if none)
+// Inputs: None
+// Output: variation index
+unsigned int chessHistory::freeLine()
+{
+    unsigned int victim = HISTORY_MAX_VARIATIONS;
+    for (unsigned int it = 0; it < HISTORY_MAX_VARIATIONS; it++)
+    {
+        if (!lines[it].used)
+        {
+            return it;
+        }
+        if (it != current && (victim == HISTORY_MAX_VARIATIONS || lines[it].lastUse < lines[victim].lastUse))
+        {
+            victim = it;
+        }
+    }
+    dropLine(victim);
+    return victim;
+}
+
+// Take the transforms of a map in slot order
+// Inputs: transform map
+// Output: None
+void chessHistory::bind(tModelMap& cTModelMap)
+{
+    // Map elements keep their address until the map is cleared (next setup, next reset)
+    boundCount = 0;
+    for (auto it = cTModelMap.begin(); it != cTModelMap.end() && boundCount < HISTORY_SLOTS; it++)
+    {
+        if (!it->first.empty() && it->first != BOARD_COMPONENT)
+        {
+            bound[boundCount++] = &it->second;
+        }
+    }
+    layout++;
+}
+
+// Bind a freshly set up transform map and make its position the root
+// Inputs: transform map, rules position (move list empty)
+// Output: None
+void chessHistory::reset(tModelMap& cTModelMap, const chessPosition& position)
+{
+    for (unsigned int it = 0; it < HISTORY_MAX_VARIATIONS; it++)
+    {
+        if (lines[it].used)
+        {
+            dropLine(it);
+        }
+    }
+
+    bind(cTModelMap);
+
+    current = 0;
+    historyLineT& line = lines[0];
+    line.used = true;
+    line.start = 0;
+    line.firstPly = 0;
+    line.count = 0;
+    line.cursor = 0;
+    unsigned int noCaptures[2] = { 0, 0 };
+    push("", position, noCaptures, 0);
+}
+
+// Bind a map rebuilt in the middle of a game, the variations are kept
+// (their earlier snapshots no longer fit the slots, see isBound)
+// Inputs: transform map
+// Output: None
+void chessHistory::rebind(tModelMap& cTModelMap)
+{
+    bind(cTModelMap);
+}
+
+// Record the board after a ply: advances along the line when the move
+// is the next one already there, otherwise branches a new variation
+// Inputs: move, rules position, graveyard counts, move list length
+// Output: None
+void chessHistory::record(const std::string& move, const chessPosition& position, const unsigned int captured[2], unsigned int movesLength)
+{
+    historyLineT& line = lines[current];
+    unsigned int next = line.cursor + 1;
+    if (next < line.firstPly + line.count)
+    {
+        // Replaying the line: nothing new to keep
+        if (move == pool[nodeAt(line, next)].move)
+        {
+            line.cursor = next;
+            line.lastUse = ++useClock;
+            return;
+        }
+        // New move off the line: the branch shares every ply up to the cursor
+        unsigned int branch = freeLine();
+        historyLineT& source = lines[current];
+        historyLineT& variation = lines[branch];
+        variation.used = true;
+        variation.start = 0;
+        variation.firstPly = source.firstPly;
+        variation.count = source.cursor - source.firstPly + 1;
+        variation.cursor = source.cursor;
+        for (unsigned int it = 0; it < variation.count; it++)
+        {
+            unsigned short node = source.nodes[(source.start + it) % HISTORY_MAX_PLY];
+            variation.nodes[it] = node;
+            refs[node]++;
+        }
+        current = branch;
+    }
+    push(move, position, captured, movesLength);
+}
+
+// Move the cursor of the current variation
+// Inputs: ply, move list to trim or extend to that ply
+// Output: false if the ply is not kept
+bool chessHistory::seek(unsigned int ply, std::string& moves)
+{
+    historyLineT& line = lines[current];
+    if (ply < line.firstPly || ply >= line.firstPly + line.count)
+    {
+        return false;
+    }
+    if (ply <= line.cursor)
+    {
+        // Back: the text up to that ply is a prefix of the current one
+        moves.resize(pool[nodeAt(line, ply)].movesLength);
+    }
+    else
+    {
+        // Forward: only the plies crossed are appended
+        for (unsigned int it = line.cursor + 1; it <= ply; it++)
+        {
+            moves += ' ';
+            moves += pool[nodeAt(line, it)].move;
+        }
+    }
+    line.cursor = ply;
+    line.lastUse = ++useClock;
+    return true;
+}
+
+// Switch to another variation (its cursor is kept)
+// Inputs: variation index, move list to rewrite from the first differing ply
+// Output: false if there is no such variation
+bool chessHistory::selectVariation(unsigned int index, std::string& moves)
+{
+    if (index >= HISTORY_MAX_VARIATIONS || !lines[index].used)
+    {
+        return false;
+    }
+    // Back to the last snapshot both lines share, then forward along the new one
+    const historyLineT& from = lines[current];
+    const historyLineT& to = lines[index];
+    unsigned int shared = from.firstPly > to.firstPly ? from.firstPly : to.firstPly;
+    if (shared > from.cursor || shared > to.cursor || nodeAt(from, shared) != nodeAt(to, shared))
+    {
+        // Split before the oldest kept ply, the move list can not be rebuilt
+        return false;
+    }
+    while (shared + 1 <= from.cursor && shared + 1 <= to.cursor && nodeAt(from, shared + 1) == nodeAt(to, shared + 1))
+    {
+        shared++;
+    }
+    moves.resize(pool[nodeAt(to, shared)].movesLength);
+    for (unsigned int it = shared + 1; it <= to.cursor; it++)
+    {
+        moves += ' ';
+        moves += pool[nodeAt(to, it)].move;
+    }
+    current = index;
+    lines[current].lastUse = ++useClock;
+    return true;
+}
+
+// Put the bound transforms back as the cursor's snapshot has them
+// (left alone if the snapshot was taken from an earlier map)
+// Inputs: None
+// Output: snapshot shown
+const positionSnapshotT& chessHistory::apply()
+{
+    const positionSnapshotT& snapshot = at();
+    for (unsigned int it = 0; isBound(snapshot) && it < boundCount; it++)
+    {
+        bound[it]->tPos = snapshot.pieces[it].tPos;
+        bound[it]->alive = snapshot.pieces[it].alive;
+        bound[it]->aOffset = glm::vec3(0.f);
+    }
+    return snapshot;
+}
+
+// Check that a snapshot was taken from the bound map
+// Inputs: snapshot
+// Output: false if the board has to be set up from its rules position
+bool chessHistory::isBound(const positionSnapshotT& snapshot) const
+{
+    return snapshot.layout == layout;
+}
+
+// Snapshot at the cursor
+// Inputs: None
+// Output: snapshot
+const positionSnapshotT& chessHistory::at() const
+{
+    return at(lines[current].cursor);
+}
+
+// Snapshot of a ply of the current variation
+// Inputs: ply (must be kept)
+// Output: snapshot
+const positionSnapshotT& chessHistory::at(unsigned int ply) const
+{
+    return pool[nodeAt(lines[current], ply)];
+}
+
+// Cursor of the current variation
+// Inputs: None
+// Output: ply
+unsigned int chessHistory::getPly() const
+{
+    return lines[current].cursor;
+}
+
+// Oldest ply still kept
+// Inputs: None
+// Output: ply
+unsigned int chessHistory::getFirstPly() const
+{
+    return lines[current].firstPly;
+}
+
+// Last ply of the current variation
+// Inputs: None
+// Output: ply
+unsigned int chessHistory::getLastPly() const
+{
+    return lines[current].firstPly + lines[current].count - 1;
+}
+
+// Variation slots in use
+// Inputs: index to check
+// Output: true if the slot holds a variation
+bool chessHistory::hasVariation(unsigned int index) const
+{
+    return index < HISTORY_MAX_VARIATIONS && lines[index].used;
+}
+
+// Selected variation
+// Inputs: None
+// Output: index
+unsigned int chessHistory::getVariation() const
+{
+    return current;
+}
+
+// Snapshots held by the pool
+// Inputs: None
+// Output: count
+unsigned int chessHistory::getSnapshotCount() const
+{
+    return HISTORY_CAPACITY - freeCount;
+}
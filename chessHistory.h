@@ -0,0 +1,176 @@
+/*
+Objective:
+Game history as fixed-size position snapshots (rules position plus piece
+transforms) in a preallocated pool. Each variation is a ring of snapshot
+indices, and a branch shares the plies before it (copy-on-write), so undo,
+redo and jumps copy one snapshot and never allocate
+*/
+
+#ifndef CHESS_HISTORY_H
+#define CHESS_HISTORY_H
+
+#include <string>
+#include <vector>
+#include "chessCommon.h"
+
+// Piece instances captured per snapshot (every transform but the board)
+const unsigned int HISTORY_SLOTS = 128;
+// Plies kept per variation (the oldest fall off the ring)
+const unsigned int HISTORY_MAX_PLY = 512;
+// Snapshots in the shared pool
+const unsigned int HISTORY_CAPACITY = 1024;
+// Variations kept at once (the least recently used one gives way)
+const unsigned int HISTORY_MAX_VARIATIONS = 8;
+
+// Logical place of one piece instance
+typedef struct
+{
+    glm::vec3 tPos;
+    bool alive;
+} pieceTransformT;
+
+// Everything needed to show a ply again
+typedef struct
+{
+    chessPosition position;
+    pieceTransformT pieces[HISTORY_SLOTS];
+    unsigned int captured[2];
+    // Move that led here ("" at the root) and the move list length after it
+    char move[6];
+    unsigned int movesLength;
+    // Transform map the pieces were taken from (a rebuilt map has other slots)
+    unsigned int layout;
+} positionSnapshotT;
+
+// One variation: ply p sits at nodes[(start + p - firstPly) % HISTORY_MAX_PLY]
+typedef struct
+{
+    unsigned short nodes[HISTORY_MAX_PLY];
+    unsigned int start;
+    unsigned int firstPly;
+    unsigned int count;
+    // Ply on the board while this variation is selected
+    unsigned int cursor;
+    unsigned long long lastUse;
+    bool used;
+} historyLineT;
+
+class chessHistory
+{
+private:
+    // Snapshot pool and its reference counts (a snapshot may sit in several variations)
+    std::vector<positionSnapshotT> pool;
+    unsigned short refs[HISTORY_CAPACITY];
+    unsigned short freeNodes[HISTORY_CAPACITY];
+    unsigned int freeCount = 0;
+    historyLineT lines[HISTORY_MAX_VARIATIONS];
+    unsigned int current = 0;
+    unsigned long long useClock = 0;
+    // Transforms of the current map, in snapshot slot order
+    tPosition* bound[HISTORY_SLOTS];
+    unsigned int boundCount = 0;
+    // Bumped every time a map is bound
+    unsigned int layout = 0;
+
+    // Pool index of a ply
+    // Inputs: variation, ply
+    // Output: snapshot index
+    unsigned short nodeAt(const historyLineT& line, unsigned int ply) const;
+    // Drop a snapshot reference (freed at zero)
+    // Inputs: snapshot index
+    // Output: None
+    void release(unsigned short node);
+    // Drop a variation and its references
+    // Inputs: variation index
+    // Output: None
+    void dropLine(unsigned int index);
+    // Drop the oldest ply of a variation
+    // Inputs: variation
+    // Output: None
+    void dropOldest(historyLineT& line);
+    // Take a free snapshot, making room if the pool is full
+    // Inputs: None
+    // Output: snapshot index
+    unsigned short allocate();
+    // Append a snapshot of the bound transforms to the current variation
+    // Inputs: move, rules position, graveyard counts, move list length
+    // Output: None
+    void push(const std::string& move, const chessPosition& position, const unsigned int captured[2], unsigned int movesLength);
+    // Free variation slot (the least recently used one is dropped if none)
+    // Inputs: None
+    // Output: variation index
+    unsigned int freeLine();
+    // Take the transforms of a map in slot order
+    // Inputs: transform map
+    // Output: None
+    void bind(tModelMap& cTModelMap);
+
+public:
+    // Constructor function (the pool is allocated once here)
+    chessHistory();
+    // Bind a freshly set up transform map and make its position the root
+    // Inputs: transform map, rules position (move list empty)
+    // Output: None
+    void reset(tModelMap& cTModelMap, const chessPosition& position);
+    // Bind a map rebuilt in the middle of a game, the variations are kept
+    // (their earlier snapshots no longer fit the slots, see isBound)
+    // Inputs: transform map
+    // Output: None
+    void rebind(tModelMap& cTModelMap);
+    // Record the board after a ply: advances along the line when the move
+    // is the next one already there, otherwise branches a new variation
+    // Inputs: move, rules position, graveyard counts, move list length
+    // Output: None
+    void record(const std::string& move, const chessPosition& position, const unsigned int captured[2], unsigned int movesLength);
+    // Move the cursor of the current variation
+    // Inputs: ply, move list to trim or extend to that ply
+    // Output: false if the ply is not kept
+    bool seek(unsigned int ply, std::string& moves);
+    // Switch to another variation (its cursor is kept)
+    // Inputs: variation index, move list to rewrite from the first differing ply
+    // Output: false if there is no such variation
+    bool selectVariation(unsigned int index, std::string& moves);
+    // Put the bound transforms back as the cursor's snapshot has them
+    // (left alone if the snapshot was taken from an earlier map)
+    // Inputs: None
+    // Output: snapshot shown
+    const positionSnapshotT& apply();
+    // Check that a snapshot was taken from the bound map
+    // Inputs: snapshot
+    // Output: false if the board has to be set up from its rules position
+    bool isBound(const positionSnapshotT& snapshot) const;
+    // Snapshot at the cursor
+    // Inputs: None
+    // Output: snapshot
+    const positionSnapshotT& at() const;
+    // Snapshot of a ply of the current variation
+    // Inputs: ply (must be kept)
+    // Output: snapshot
+    const positionSnapshotT& at(unsigned int ply) const;
+    // Cursor of the current variation
+    // Inputs: None
+    // Output: ply
+    unsigned int getPly() const;
+    // Oldest ply still kept
+    // Inputs: None
+    // Output: ply
+    unsigned int getFirstPly() const;
+    // Last ply of the current variation
+    // Inputs: None
+    // Output: ply
+    unsigned int getLastPly() const;
+    // Variation slots in use
+    // Inputs: index to check
+    // Output: true if the slot holds a variation
+    bool hasVariation(unsigned int index) const;
+    // Selected variation
+    // Inputs: None
+    // Output: index
+    unsigned int getVariation() const;
+    // Snapshots held by the pool
+    // Inputs: None
+    // Output: count
+    unsigned int getSnapshotCount() const;
+};
+
+#endif
@@ -0,0 +1,804 @@
+/*
+
+Objective:
+Mesh optimizer definition file
+*/
+
+#include "chessMeshOptimizer.h"
+#include "chessHash.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <windows.h>
+
+// Forsyth scoring constants
+const float FORSYTH_LAST_TRI_SCORE = 0.75f;
+const float FORSYTH_DECAY_POWER = 1.5f;
+const float FORSYTH_VALENCE_SCALE = 2.0f;
+const float FORSYTH_VALENCE_POWER = -0.5f;
+// Cache file tag ("CMSH")
+const unsigned int MESH_CACHE_MAGIC = 0x48534D43;
+
+// One vertex as raw attribute bits (welding key)
+typedef struct
+{
+    float data[8];
+} weldKeyT;
+
+struct weldKeyHash
+{
+    size_t operator()(const weldKeyT& key) const
+    {
+        return static_cast<size_t>(fnv1a(key.data, sizeof(key.data)));
+    }
+};
+
+struct weldKeyEqual
+{
+    bool operator()(const weldKeyT& a, const weldKeyT& b) const
+    {
+        return std::memcmp(a.data, b.data, sizeof(a.data)) == 0;
+    }
+};
+
+// Average cache miss ratio (transformed vertices per triangle)
+// Inputs: triangle indices, FIFO size
+// Output: ACMR (0.5 is ideal for large grids, 3 is the worst case)
+float computeAcmr(const std::vector<unsigned short>& indices, unsigned int cacheSize)
+{
+    if (indices.size() < 3)
+    {
+        return 0.f;
+    }
+
+    // A vertex is cached if it was inserted within the last cacheSize misses
+    std::vector<long long> insertedAt(65536, -(1LL << 40));
+    long long misses = 0;
+    for (unsigned short index : indices)
+    {
+        if (insertedAt[index] <= misses - static_cast<long long>(cacheSize))
+        {
+            misses++;
+            insertedAt[index] = misses;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+// Merge vertices whose position, UV and normal are bit identical
+// Inputs: mesh arrays (modified in place)
+// Output: number of vertices left
+unsigned int weldVertices(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                          std::vector<glm::vec3>& normals, std::vector<unsigned short>& indices)
+{
+    std::unordered_map<weldKeyT, unsigned short, weldKeyHash, weldKeyEqual> unique;
+    unique.reserve(vertices.size());
+    std::vector<unsigned short> remap(vertices.size());
+    std::vector<glm::vec3> weldedVertices;
+    std::vector<glm::vec2> weldedUvs;
+    std::vector<glm::vec3> weldedNormals;
+    weldedVertices.reserve(vertices.size());
+    weldedUvs.reserve(vertices.size());
+    weldedNormals.reserve(vertices.size());
+
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        weldKeyT key = { { vertices[v].x, vertices[v].y, vertices[v].z, uvs[v].x, uvs[v].y,
+                           normals[v].x, normals[v].y, normals[v].z } };
+        auto found = unique.find(key);
+        if (found != unique.end())
+        {
+            remap[v] = found->second;
+            continue;
+        }
+        remap[v] = static_cast<unsigned short>(weldedVertices.size());
+        unique.emplace(key, remap[v]);
+        weldedVertices.push_back(vertices[v]);
+        weldedUvs.push_back(uvs[v]);
+        weldedNormals.push_back(normals[v]);
+    }
+
+    for (auto& index : indices)
+    {
+        index = remap[index];
+    }
+    vertices.swap(weldedVertices);
+    uvs.swap(weldedUvs);
+    normals.swap(weldedNormals);
+    return static_cast<unsigned int>(vertices.size());
+}
+
+// Forsyth score of one vertex
+// Inputs: position in the simulated cache (-1 if not cached), triangles still using it
+// Output: score (-1 once fully used)
+static float vertexScore(int cachePosition, unsigned int remaining)
+{
+    if (remaining == 0)
+    {
+        return -1.f;
+    }
+    float score = 0.f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // Vertices of the last triangle, a fixed score so strips are not favoured
+            score = FORSYTH_LAST_TRI_SCORE;
+        }
+        else
+        {
+            float scaler = 1.f / (MESH_CACHE_SIZE - 3);
+            score = std::pow(1.f - (cachePosition - 3) * scaler, FORSYTH_DECAY_POWER);
+        }
+    }
+    // Favour finishing off vertices with few triangles left
+    score += FORSYTH_VALENCE_SCALE * std::pow(static_cast<float>(remaining), FORSYTH_VALENCE_POWER);
+    return score;
+}
+
+// Reorder triangles for the post-transform vertex cache
+// Inputs: triangle indices (modified in place), vertex count
+// Output: None
+void optimizeVertexCache(std::vector<unsigned short>& indices, unsigned int vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles per vertex (packed lists, the unused part shrinks as triangles are emitted)
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned short index : indices)
+    {
+        remaining[index]++;
+    }
+    std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; v++)
+    {
+        adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> scores(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; v++)
+    {
+        scores[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScores[t] = scores[indices[3 * t]] + scores[indices[3 * t + 1]] + scores[indices[3 * t + 2]];
+    }
+
+    std::vector<unsigned short> ordered;
+    ordered.reserve(indices.size());
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> nextCache;
+    long long best = -1;
+    for (size_t n = 0; n < triangleCount; n++)
+    {
+        // Nothing in the cache is usable: full scan (rare, once per disconnected part)
+        if (best < 0)
+        {
+            float bestScore = -1e30f;
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                if (!emitted[t] && triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    best = static_cast<long long>(t);
+                }
+            }
+        }
+
+        // Emit and drop the triangle from its vertices' lists
+        const unsigned short* corner = &indices[3 * best];
+        ordered.insert(ordered.end(), corner, corner + 3);
+        emitted[best] = true;
+        nextCache.clear();
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = corner[k];
+            unsigned int* list = &adjacency[adjacencyStart[v]];
+            for (unsigned int i = 0; i < remaining[v]; i++)
+            {
+                if (list[i] == best)
+                {
+                    list[i] = list[remaining[v] - 1];
+                    remaining[v]--;
+                    break;
+                }
+            }
+            bool listed = false;
+            for (unsigned int cached : nextCache)
+            {
+                listed = listed || cached == v;
+            }
+            if (!listed)
+            {
+                nextCache.push_back(v);
+            }
+        }
+
+        // The emitted vertices move to the front of the LRU cache
+        for (unsigned int v : cache)
+        {
+            if (v != corner[0] && v != corner[1] && v != corner[2])
+            {
+                nextCache.push_back(v);
+            }
+        }
+        for (size_t i = 0; i < nextCache.size(); i++)
+        {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = (i < MESH_CACHE_SIZE) ? static_cast<int>(i) : -1;
+            scores[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // Rescore the triangles around cached vertices and pick the next one among them
+        best = -1;
+        float bestScore = -1e30f;
+        for (unsigned int v : nextCache)
+        {
+            const unsigned int* list = &adjacency[adjacencyStart[v]];
+            for (unsigned int i = 0; i < remaining[v]; i++)
+            {
+                unsigned int t = list[i];
+                triangleScores[t] = scores[indices[3 * t]] + scores[indices[3 * t + 1]] + scores[indices[3 * t + 2]];
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+        if (nextCache.size() > MESH_CACHE_SIZE)
+        {
+            nextCache.resize(MESH_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+    }
+    indices.swap(ordered);
+}
+
+// Reorder vertices in first use order (drops unused ones)
+// Inputs: mesh arrays (modified in place)
+// Output: None
+void optimizeVertexFetch(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                         std::vector<glm::vec3>& normals, std::vector<unsigned short>& indices)
+{
+    std::vector<int> remap(vertices.size(), -1);
+    std::vector<glm::vec3> orderedVertices;
+    std::vector<glm::vec2> orderedUvs;
+    std::vector<glm::vec3> orderedNormals;
+    orderedVertices.reserve(vertices.size());
+    orderedUvs.reserve(vertices.size());
+    orderedNormals.reserve(vertices.size());
+
+    for (auto& index : indices)
+    {
+        if (remap[index] < 0)
+        {
+            remap[index] = static_cast<int>(orderedVertices.size());
+            orderedVertices.push_back(vertices[index]);
+            orderedUvs.push_back(uvs[index]);
+            orderedNormals.push_back(normals[index]);
+        }
+        index = static_cast<unsigned short>(remap[index]);
+    }
+    vertices.swap(orderedVertices);
+    uvs.swap(orderedUvs);
+    normals.swap(orderedNormals);
+}
+
+// Hash of the loaded mesh (cache key)
+// Inputs: mesh arrays
+// Output: hash
+static unsigned long long meshSourceHash(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& uvs,
+                                         const std::vector<glm::vec3>& normals, const std::vector<unsigned short>& indices)
+{
+    unsigned long long hash = fnv1a(&MESH_CACHE_VERSION, sizeof(MESH_CACHE_VERSION));
+    hash = fnv1a(vertices.data(), vertices.size() * sizeof(glm::vec3), hash);
+    hash = fnv1a(uvs.data(), uvs.size() * sizeof(glm::vec2), hash);
+    hash = fnv1a(normals.data(), normals.size() * sizeof(glm::vec3), hash);
+    return fnv1a(indices.data(), indices.size() * sizeof(unsigned short), hash);
+}
+
+// Read a stored optimization result
+// Inputs: cache file, expected source hash, mesh arrays and LOD index counts to fill
+// Output: true if the file matched the loaded mesh
+static bool loadMeshCache(const std::string& cachePath, unsigned long long sourceHash, std::vector<glm::vec3>& vertices,
+                          std::vector<glm::vec2>& uvs, std::vector<glm::vec3>& normals, std::vector<unsigned short>& indices,
+                          std::vector<unsigned int>& lodIndexCounts)
+{
+    std::ifstream file(cachePath, std::ios::binary);
+    unsigned int magic = 0;
+    unsigned long long storedHash = 0;
+    unsigned int vertexCount = 0;
+    unsigned int indexCount = 0;
+    unsigned int lodLevels = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&storedHash), sizeof(storedHash));
+    file.read(reinterpret_cast<char*>(&vertexCount), sizeof(vertexCount));
+    file.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount));
+    file.read(reinterpret_cast<char*>(&lodLevels), sizeof(lodLevels));
+    if (!file || magic != MESH_CACHE_MAGIC || storedHash != sourceHash || vertexCount > 65536 ||
+        lodLevels == 0 || lodLevels > MESH_LOD_LEVELS)
+    {
+        return false;
+    }
+    std::vector<unsigned int> cachedLodCounts(lodLevels);
+    file.read(reinterpret_cast<char*>(cachedLodCounts.data()), lodLevels * sizeof(unsigned int));
+    unsigned int lodTotal = 0;
+    for (unsigned int count : cachedLodCounts)
+    {
+        lodTotal += count;
+    }
+    if (!file || lodTotal != indexCount)
+    {
+        return false;
+    }
+
+    std::vector<glm::vec3> cachedVertices(vertexCount);
+    std::vector<glm::vec2> cachedUvs(vertexCount);
+    std::vector<glm::vec3> cachedNormals(vertexCount);
+    std::vector<unsigned short> cachedIndices(indexCount);
+    file.read(reinterpret_cast<char*>(cachedVertices.data()), vertexCount * sizeof(glm::vec3));
+    file.read(reinterpret_cast<char*>(cachedUvs.data()), vertexCount * sizeof(glm::vec2));
+    file.read(reinterpret_cast<char*>(cachedNormals.data()), vertexCount * sizeof(glm::vec3));
+    file.read(reinterpret_cast<char*>(cachedIndices.data()), indexCount * sizeof(unsigned short));
+    if (!file)
+    {
+        return false;
+    }
+    // A stale or damaged file must not index past the vertex buffer
+    for (unsigned short index : cachedIndices)
+    {
+        if (index >= vertexCount)
+        {
+            return false;
+        }
+    }
+    vertices.swap(cachedVertices);
+    uvs.swap(cachedUvs);
+    normals.swap(cachedNormals);
+    indices.swap(cachedIndices);
+    lodIndexCounts.swap(cachedLodCounts);
+    return true;
+}
+
+// Store an optimization result
+// Inputs: cache file, source hash, optimized mesh arrays, LOD index counts
+// Output: true if written
+static bool saveMeshCache(const std::string& cachePath, unsigned long long sourceHash, const std::vector<glm::vec3>& vertices,
+                          const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& normals,
+                          const std::vector<unsigned short>& indices, const std::vector<unsigned int>& lodIndexCounts)
+{
+    CreateDirectoryA(MESH_CACHE_DIR, NULL);
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    unsigned int vertexCount = static_cast<unsigned int>(vertices.size());
+    unsigned int indexCount = static_cast<unsigned int>(indices.size());
+    unsigned int lodLevels = static_cast<unsigned int>(lodIndexCounts.size());
+    file.write(reinterpret_cast<const char*>(&MESH_CACHE_MAGIC), sizeof(MESH_CACHE_MAGIC));
+    file.write(reinterpret_cast<const char*>(&sourceHash), sizeof(sourceHash));
+    file.write(reinterpret_cast<const char*>(&vertexCount), sizeof(vertexCount));
+    file.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
+    file.write(reinterpret_cast<const char*>(&lodLevels), sizeof(lodLevels));
+    file.write(reinterpret_cast<const char*>(lodIndexCounts.data()), lodLevels * sizeof(unsigned int));
+    file.write(reinterpret_cast<const char*>(vertices.data()), vertexCount * sizeof(glm::vec3));
+    file.write(reinterpret_cast<const char*>(uvs.data()), vertexCount * sizeof(glm::vec2));
+    file.write(reinterpret_cast<const char*>(normals.data()), vertexCount * sizeof(glm::vec3));
+    file.write(reinterpret_cast<const char*>(indices.data()), indexCount * sizeof(unsigned short));
+    return static_cast<bool>(file);
+}
+
+// Error quadric (symmetric 4x4 matrix, upper triangle)
+typedef struct
+{
+    double q[10];
+} quadricT;
+
+// Accumulate the quadric of a plane
+// Inputs: quadric, plane normal (unit) and offset
+// Output: None
+static void addPlane(quadricT& quadric, const glm::vec3& normal, float offset)
+{
+    double a = normal.x, b = normal.y, c = normal.z, d = offset;
+    quadric.q[0] += a * a; quadric.q[1] += a * b; quadric.q[2] += a * c; quadric.q[3] += a * d;
+    quadric.q[4] += b * b; quadric.q[5] += b * c; quadric.q[6] += b * d;
+    quadric.q[7] += c * c; quadric.q[8] += c * d;
+    quadric.q[9] += d * d;
+}
+
+// Squared distance sum of a point to the planes of two quadrics
+// Inputs: quadrics, point
+// Output: error
+static double quadricError(const quadricT& first, const quadricT& second, const glm::vec3& point)
+{
+    double q[10];
+    for (int i = 0; i < 10; i++)
+    {
+        q[i] = first.q[i] + second.q[i];
+    }
+    double x = point.x, y = point.y, z = point.z;
+    double error = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                 + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                 + q[7] * z * z + 2 * q[8] * z + q[9];
+    return error < 0.0 ? 0.0 : error;
+}
+
+// Check if moving one vertex onto another flips any of its triangles
+// Inputs: positions, indices, triangles around the moved vertex, moved and kept vertex
+// Output: true if a triangle would turn over
+static bool collapseFlips(const std::vector<glm::vec3>& vertices, const std::vector<unsigned short>& indices,
+                          const unsigned int* triangles, unsigned int triangleCount, unsigned short from, unsigned short to)
+{
+    for (unsigned int i = 0; i < triangleCount; i++)
+    {
+        const unsigned short* corner = &indices[3 * triangles[i]];
+        if (corner[0] == to || corner[1] == to || corner[2] == to)
+        {
+            // Collapses away
+            continue;
+        }
+        glm::vec3 before[3], after[3];
+        for (int k = 0; k < 3; k++)
+        {
+            before[k] = vertices[corner[k]];
+            after[k] = (corner[k] == from) ? vertices[to] : vertices[corner[k]];
+        }
+        glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(normalBefore, normalAfter) <= 0.f)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// One candidate half edge collapse
+typedef struct
+{
+    unsigned short from;
+    unsigned short to;
+    double cost;
+} collapseT;
+
+// Simplify by quadric error edge collapse (vertices are kept, only indices change)
+// Inputs: vertex positions, triangle indices, wanted index count, largest error (distance), result
+// Output: None
+void simplifyMesh(const std::vector<glm::vec3>& vertices, const std::vector<unsigned short>& indices,
+                  size_t targetIndexCount, float maxError, std::vector<unsigned short>& simplified)
+{
+    size_t vertexCount = vertices.size();
+    double errorLimit = static_cast<double>(maxError) * maxError;
+
+    // Plane quadrics of the original surface
+    quadricT zero = { { 0 } };
+    std::vector<quadricT> quadrics(vertexCount, zero);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const glm::vec3& p0 = vertices[indices[i]];
+        glm::vec3 normal = glm::cross(vertices[indices[i + 1]] - p0, vertices[indices[i + 2]] - p0);
+        float length = glm::length(normal);
+        if (length <= 0.f)
+        {
+            continue;
+        }
+        normal = normal / length;
+        for (int k = 0; k < 3; k++)
+        {
+            addPlane(quadrics[indices[i + k]], normal, -glm::dot(normal, p0));
+        }
+    }
+
+    // Open edges (mesh borders and UV/normal seams) keep their vertices
+    std::unordered_map<unsigned int, unsigned int> edgeUse;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+            edgeUse[a < b ? (a << 16) | b : (b << 16) | a]++;
+        }
+    }
+    std::vector<bool> locked(vertexCount, false);
+    for (const auto& edge : edgeUse)
+    {
+        if (edge.second == 1)
+        {
+            locked[edge.first >> 16] = true;
+            locked[edge.first & 0xFFFF] = true;
+        }
+    }
+
+    simplified = indices;
+    std::vector<unsigned short> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<collapseT> candidates;
+    std::vector<unsigned int> adjacencyStart(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    while (simplified.size() > targetIndexCount)
+    {
+        // Cheapest direction of every interior edge (each is seen from both triangles, keep one)
+        candidates.clear();
+        for (size_t i = 0; i < simplified.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned short a = simplified[i + k], b = simplified[i + (k + 1) % 3];
+                if (a > b)
+                {
+                    continue;
+                }
+                double costAB = locked[a] ? 1e300 : quadricError(quadrics[a], quadrics[b], vertices[b]);
+                double costBA = locked[b] ? 1e300 : quadricError(quadrics[a], quadrics[b], vertices[a]);
+                if (costAB <= costBA && costAB <= errorLimit)
+                {
+                    candidates.push_back({ a, b, costAB });
+                }
+                else if (costBA < costAB && costBA <= errorLimit)
+                {
+                    candidates.push_back({ b, a, costBA });
+                }
+            }
+        }
+        if (candidates.empty())
+        {
+            break;
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const collapseT& x, const collapseT& y) { return x.cost < y.cost; });
+
+        // Triangles per vertex for the flip test
+        std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+        for (unsigned short index : simplified)
+        {
+            adjacencyStart[index + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyStart[v + 1] += adjacencyStart[v];
+        }
+        adjacency.resize(simplified.size());
+        std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < simplified.size(); i++)
+        {
+            adjacency[fill[simplified[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        // Independent collapses, cheapest first; each removes about two triangles
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            remap[v] = static_cast<unsigned short>(v);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+        size_t triangles = simplified.size() / 3;
+        size_t collapses = 0;
+        for (const auto& candidate : candidates)
+        {
+            if (triangles <= targetIndexCount / 3)
+            {
+                break;
+            }
+            if (touched[candidate.from] || touched[candidate.to])
+            {
+                continue;
+            }
+            const unsigned int* around = &adjacency[adjacencyStart[candidate.from]];
+            unsigned int aroundCount = adjacencyStart[candidate.from + 1] - adjacencyStart[candidate.from];
+            if (collapseFlips(vertices, simplified, around, aroundCount, candidate.from, candidate.to))
+            {
+                continue;
+            }
+
+            remap[candidate.from] = candidate.to;
+            for (int i = 0; i < 10; i++)
+            {
+                quadrics[candidate.to].q[i] += quadrics[candidate.from].q[i];
+            }
+            // The neighbourhood is final for this pass
+            for (unsigned int i = 0; i < aroundCount; i++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    touched[simplified[3 * around[i] + k]] = true;
+                }
+            }
+            triangles -= 2;
+            collapses++;
+        }
+        if (collapses == 0)
+        {
+            break;
+        }
+
+        // Apply the pass and drop collapsed triangles
+        size_t kept = 0;
+        for (size_t i = 0; i < simplified.size(); i += 3)
+        {
+            unsigned short a = remap[simplified[i]], b = remap[simplified[i + 1]], c = remap[simplified[i + 2]];
+            if (a != b && b != c && a != c)
+            {
+                simplified[kept++] = a;
+                simplified[kept++] = b;
+                simplified[kept++] = c;
+            }
+        }
+        simplified.resize(kept);
+    }
+}
+
+// Convert to IEEE half precision (round to nearest)
+// Inputs: value
+// Output: half float bits
+unsigned short floatToHalf(float value)
+{
+    unsigned int bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    unsigned int sign = (bits >> 16) & 0x8000;
+    unsigned int mantissa = bits & 0x7FFFFF;
+    int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+
+    if (((bits >> 23) & 0xFF) == 0xFF)
+    {
+        // Inf stays inf, NaN stays NaN
+        return static_cast<unsigned short>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31)
+    {
+        // Too large for half
+        return static_cast<unsigned short>(sign | 0x7C00);
+    }
+    if (exponent <= 0)
+    {
+        // Half subnormal (or zero)
+        if (exponent < -10)
+        {
+            return static_cast<unsigned short>(sign);
+        }
+        mantissa |= 0x800000;
+        unsigned int shift = static_cast<unsigned int>(14 - exponent);
+        unsigned int half = mantissa >> shift;
+        half += (mantissa >> (shift - 1)) & 1;
+        return static_cast<unsigned short>(sign | half);
+    }
+    // A rounding carry correctly moves into the exponent
+    unsigned int half = sign | (static_cast<unsigned int>(exponent) << 10) | (mantissa >> 13);
+    half += (mantissa >> 12) & 1;
+    return static_cast<unsigned short>(half);
+}
+
+// Pack a unit normal as signed normalized 10:10:10:2
+// Inputs: normal
+// Output: GL_INT_2_10_10_10_REV bits
+unsigned int packNormal(const glm::vec3& normal)
+{
+    unsigned int packed = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float value = normal[axis];
+        value = (value < -1.f) ? -1.f : (value > 1.f) ? 1.f : value;
+        int quantized = static_cast<int>(std::floor(value * 511.f + 0.5f));
+        packed |= (static_cast<unsigned int>(quantized) & 0x3FF) << (10 * axis);
+    }
+    return packed;
+}
+
+// Build the quantized vertex stream
+// Inputs: mesh arrays, mesh AABB, packed vertices to fill
+// Output: None
+void quantizeMesh(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& normals,
+                  const glm::vec3& aabbMin, const glm::vec3& aabbMax, std::vector<packedVertexT>& packed)
+{
+    packed.resize(vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float extent = aabbMax[axis] - aabbMin[axis];
+            float unit = (extent > 0.f) ? (vertices[v][axis] - aabbMin[axis]) / extent : 0.f;
+            unit = (unit < 0.f) ? 0.f : (unit > 1.f) ? 1.f : unit;
+            packed[v].position[axis] = static_cast<unsigned short>(unit * 65535.f + 0.5f);
+        }
+        packed[v].position[3] = 0;
+        packed[v].uv[0] = floatToHalf(v < uvs.size() ? uvs[v].x : 0.f);
+        packed[v].uv[1] = floatToHalf(v < uvs.size() ? uvs[v].y : 0.f);
+        packed[v].normal = packNormal(v < normals.size() ? normals[v] : glm::vec3(0.f, 0.f, 1.f));
+    }
+}
+
+// Run every stage, or load the stored result of an earlier run
+// Inputs: mesh name (cache file), mesh arrays (modified in place, indices end up holding
+//         every LOD back to back), index count per LOD to fill, statistics to fill
+// Output: None
+void optimizeMesh(const std::string& meshName, std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                  std::vector<glm::vec3>& normals, std::vector<unsigned short>& indices,
+                  std::vector<unsigned int>& lodIndexCounts, meshOptStatsT& stats)
+{
+    // Missing attributes are zero filled so every stage can index them
+    uvs.resize(vertices.size());
+    normals.resize(vertices.size());
+
+    stats.verticesBefore = static_cast<unsigned int>(vertices.size());
+    stats.triangles = static_cast<unsigned int>(indices.size() / 3);
+    stats.acmrBefore = computeAcmr(indices, ACMR_FIFO_SIZE);
+
+    // Nothing to weld or simplify, and no bounds for the LOD error: kept as one level
+    if (vertices.empty() || indices.empty())
+    {
+        lodIndexCounts.assign(1, static_cast<unsigned int>(indices.size()));
+        stats.fromCache = false;
+        stats.verticesAfter = stats.verticesBefore;
+        stats.acmrAfter = stats.acmrBefore;
+        stats.lodLevels = 1;
+        stats.lodTriangles[0] = stats.triangles;
+        return;
+    }
+
+    unsigned long long sourceHash = meshSourceHash(vertices, uvs, normals, indices);
+    std::string cachePath = std::string(MESH_CACHE_DIR) + "/" + meshName + ".mesh";
+    stats.fromCache = loadMeshCache(cachePath, sourceHash, vertices, uvs, normals, indices, lodIndexCounts);
+    if (!stats.fromCache)
+    {
+        unsigned int vertexCount = weldVertices(vertices, uvs, normals, indices);
+        optimizeVertexCache(indices, vertexCount);
+        optimizeVertexFetch(vertices, uvs, normals, indices);
+
+        // LOD chain, each level simplified from the previous one and appended
+        glm::vec3 aabbMin = vertices.front();
+        glm::vec3 aabbMax = vertices.front();
+        for (const auto& vertex : vertices)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                aabbMin[axis] = vertex[axis] < aabbMin[axis] ? vertex[axis] : aabbMin[axis];
+                aabbMax[axis] = vertex[axis] > aabbMax[axis] ? vertex[axis] : aabbMax[axis];
+            }
+        }
+        float maxError = MESH_LOD_MAX_ERROR * glm::length(aabbMax - aabbMin);
+        lodIndexCounts.assign(1, static_cast<unsigned int>(indices.size()));
+        std::vector<unsigned short> level(indices);
+        std::vector<unsigned short> coarser;
+        while (lodIndexCounts.size() < MESH_LOD_LEVELS)
+        {
+            size_t target = static_cast<size_t>(level.size() / 3 * MESH_LOD_RATIO) * 3;
+            simplifyMesh(vertices, level, target, maxError, coarser);
+            // Not worth a level if the error bound stopped it early
+            if (coarser.empty() || coarser.size() > level.size() * 0.8)
+            {
+                break;
+            }
+            optimizeVertexCache(coarser, vertexCount);
+            indices.insert(indices.end(), coarser.begin(), coarser.end());
+            lodIndexCounts.push_back(static_cast<unsigned int>(coarser.size()));
+            level.swap(coarser);
+        }
+
+        if (!saveMeshCache(cachePath, sourceHash, vertices, uvs, normals, indices, lodIndexCounts))
+        {
+            std::cerr << "Mesh cache not written: " << cachePath << std::endl;
+        }
+    }
+
+    stats.verticesAfter = static_cast<unsigned int>(vertices.size());
+    std::vector<unsigned short> finest(indices.begin(), indices.begin() + lodIndexCounts[0]);
+    stats.acmrAfter = computeAcmr(finest, ACMR_FIFO_SIZE);
+    stats.lodLevels = static_cast<unsigned int>(lodIndexCounts.size());
+    for (unsigned int lod = 0; lod < stats.lodLevels; lod++)
+    {
+        stats.lodTriangles[lod] = lodIndexCounts[lod] / 3;
+    }
+}
@@ -0,0 +1,104 @@
+/*
+Objective:
+Load time mesh optimization: vertex welding, post-transform cache ordering
+(Forsyth), vertex fetch ordering and a quadric simplified LOD chain, with an
+on-disk cache of the results
+*/
+
+#ifndef CHESS_MESH_OPTIMIZER_H
+#define CHESS_MESH_OPTIMIZER_H
+
+#include <string>
+#include <vector>
+// Include GLM
+#include <glm/glm.hpp>
+
+// Simulated LRU cache the triangle order is tuned for
+const unsigned int MESH_CACHE_SIZE = 32;
+// FIFO size used to report ACMR (typical post-transform cache)
+const unsigned int ACMR_FIFO_SIZE = 16;
+// Optimized meshes are stored here, one file per component
+const char MESH_CACHE_DIR[] = "Lab3/cache";
+// Bump when the optimizer output changes
+const unsigned int MESH_CACHE_VERSION = 2;
+// Level of detail chain: each level keeps about half the triangles of the previous one
+const unsigned int MESH_LOD_LEVELS = 4;
+const float MESH_LOD_RATIO = 0.5f;
+// Largest allowed collapse error, as a fraction of the AABB diagonal
+const float MESH_LOD_MAX_ERROR = 0.02f;
+
+// Quantized vertex (16 bytes instead of 32): 16-bit unorm position inside
+// the mesh AABB, half-float UV and a GL_INT_2_10_10_10_REV normal
+typedef struct
+{
+    unsigned short position[4];
+    unsigned short uv[2];
+    unsigned int normal;
+} packedVertexT;
+
+// Before/after figures for one mesh
+typedef struct
+{
+    unsigned int verticesBefore = 0;
+    unsigned int verticesAfter = 0;
+    unsigned int triangles = 0;
+    float acmrBefore = 0.f;
+    float acmrAfter = 0.f;
+    unsigned int lodTriangles[MESH_LOD_LEVELS] = { 0 };
+    unsigned int lodLevels = 0;
+    bool fromCache = false;
+} meshOptStatsT;
+
+// Average cache miss ratio (transformed vertices per triangle)
+// Inputs: triangle indices, FIFO size
+// Output: ACMR (0.5 is ideal for large grids, 3 is the worst case)
+float computeAcmr(const std::vector<unsigned short>& indices, unsigned int cacheSize);
+
+// Merge vertices whose position, UV and normal are bit identical
+// Inputs: mesh arrays (modified in place)
+// Output: number of vertices left
+unsigned int weldVertices(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                          std::vector<glm::vec3>& normals, std::vector<unsigned short>& indices);
+
+// Reorder triangles for the post-transform vertex cache
+// Inputs: triangle indices (modified in place), vertex count
+// Output: None
+void optimizeVertexCache(std::vector<unsigned short>& indices, unsigned int vertexCount);
+
+// Reorder vertices in first use order (drops unused ones)
+// Inputs: mesh arrays (modified in place)
+// Output: None
+void optimizeVertexFetch(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                         std::vector<glm::vec3>& normals, std::vector<unsigned short>& indices);
+
+// Simplify by quadric error edge collapse (vertices are kept, only indices change)
+// Inputs: vertex positions, triangle indices, wanted index count, largest error (distance), result
+// Output: None
+void simplifyMesh(const std::vector<glm::vec3>& vertices, const std::vector<unsigned short>& indices,
+                  size_t targetIndexCount, float maxError, std::vector<unsigned short>& simplified);
+
+// Convert to IEEE half precision (round to nearest)
+// Inputs: value
+// Output: half float bits
+unsigned short floatToHalf(float value);
+
+// Pack a unit normal as signed normalized 10:10:10:2
+// Inputs: normal
+// Output: GL_INT_2_10_10_10_REV bits
+unsigned int packNormal(const glm::vec3& normal);
+
+// Build the quantized vertex stream
+// Inputs: mesh arrays, mesh AABB, packed vertices to fill
+// Output: None
+void quantizeMesh(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& normals,
+                  const glm::vec3& aabbMin, const glm::vec3& aabbMax, std::vector<packedVertexT>& packed);
+
+// Run every stage, or load the stored result of an earlier run
+// Inputs: mesh name (cache file), mesh arrays (modified in place, indices end up holding
+//         every LOD back to back), index count per LOD to fill, statistics to fill
+// Output: None
+void optimizeMesh(const std::string& meshName, std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                  std::vector<glm::vec3>& normals, std::vector<unsigned short>& indices,
+                  std::vector<unsigned int>& lodIndexCounts, meshOptStatsT& stats);
+
+#endif
@@ -0,0 +1,383 @@
+/*
+
+Objective:
+Multi-board view definition file
+*/
+
+#include "chessMultiBoard.h"
+#include "ECE_PgnAnalysis.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+
+// Bounding sphere of a placed mesh
+// Inputs: mesh, model matrix, placement scale
+// Output: center (world space) and radius
+static glm::vec4 boundingSphere(chessComponent* mesh, const glm::mat4& model, float scale)
+{
+    glm::vec3 boundsMin, boundsMax;
+    mesh->getModelBounds(boundsMin, boundsMax);
+    glm::vec3 center = glm::vec3(model * glm::vec4(0.5f * (boundsMin + boundsMax), 1.f));
+    return glm::vec4(center, mesh->getBoundingRadius() * scale);
+}
+
+// Constructor function
+chessMultiBoard::chessMultiBoard()
+{
+    for (unsigned int code = 0; code < MULTI_BOARD_PIECE_CODES; code++)
+    {
+        pieceMeshes[code] = nullptr;
+        for (int sq = 0; sq < 64; sq++)
+        {
+            piecePixels[code][sq] = -1.f;
+        }
+    }
+    stats.piecesDrawn = 0;
+    stats.piecesCulled = 0;
+    stats.triangles = 0;
+}
+
+// Work out the tile grid for the boards
+// Inputs: None
+// Output: None
+void chessMultiBoard::layout()
+{
+    unsigned int count = static_cast<unsigned int>(boards.size());
+    columns = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    rows = (count + columns - 1) / columns;
+
+    // Same scale on both axes keeps the window's aspect in every tile
+    float scale = (1.f - MULTI_BOARD_MARGIN) / (std::max)(columns, rows);
+    tiles.resize(count);
+    for (unsigned int it = 0; it < count; it++)
+    {
+        unsigned int column = it % columns;
+        unsigned int row = it / columns;
+        tiles[it] = glm::vec4(scale, scale, -1.f + (2.f * column + 1.f) / columns, 1.f - (2.f * row + 1.f) / rows);
+    }
+}
+
+// Projected radius of a sphere in a tile
+// Inputs: sphere (center, radius), frustum planes, view and projection matrices, tile height in pixels
+// Output: pixels, negative if the sphere is out of view
+float chessMultiBoard::projectSphere(const glm::vec4& sphere, const glm::vec4 planes[6], const glm::mat4& view,
+                                     const glm::mat4& projection, float tileHeight) const
+{
+    glm::vec3 center = glm::vec3(sphere);
+    for (int plane = 0; plane < 6; plane++)
+    {
+        if (glm::dot(glm::vec3(planes[plane]), center) + planes[plane].w < -sphere.w)
+        {
+            return -1.f;
+        }
+    }
+    // Same measure as the single board LOD selection, at the tile's size
+    glm::vec4 viewPosition = view * glm::vec4(center, 1.f);
+    return (-viewPosition.z > 1e-3f) ? sphere.w * projection[1][1] / -viewPosition.z * 0.5f * tileHeight : 1e9f;
+}
+
+// Show the games of a PGN file, cycled over the boards and staggered
+// Inputs: PGN file, board count, time now (seconds)
+// Output: true if at least one game could be read
+bool chessMultiBoard::load(const std::string& pgnPath, unsigned int count, double now)
+{
+    count = (std::min)((std::max)(count, 1U), MULTI_BOARD_MAX);
+    pgnReader reader;
+    if (!reader.open(pgnPath))
+    {
+        std::cout << "Could not open " << pgnPath << std::endl;
+        return false;
+    }
+
+    // Games beyond the board count would never be shown
+    std::vector<multiBoardGameT> loaded;
+    pgnGameT game;
+    while (loaded.size() < count && reader.nextGame(game))
+    {
+        multiBoardGameT entry;
+        bool valid = true;
+        for (const auto& tag : game.tags)
+        {
+            if (tag.first == "FEN")
+            {
+                valid = entry.start.setFromFen(tag.second);
+            }
+        }
+        if (!valid)
+        {
+            continue;
+        }
+        // Played up to the first move that does not resolve
+        chessPosition position = entry.start;
+        for (size_t it = 0; it < game.sanMoves.size() && entry.moves.size() < 0xFFFF; it++)
+        {
+            chessMove move = position.parseSan(game.sanMoves[it]);
+            if (move == NO_MOVE)
+            {
+                break;
+            }
+            entry.moves.push_back(move);
+            position.applyMove(move);
+        }
+        loaded.push_back(std::move(entry));
+    }
+    if (loaded.empty())
+    {
+        std::cout << "No games in " << pgnPath << std::endl;
+        return false;
+    }
+    games.swap(loaded);
+
+    boards.resize(count);
+    unsigned int gameCount = static_cast<unsigned int>(games.size());
+    for (unsigned int it = 0; it < count; it++)
+    {
+        boardStateT& board = boards[it];
+        board.game = static_cast<unsigned short>(it % gameCount);
+        const multiBoardGameT& shown = games[board.game];
+        // Boards repeating a game are further into it, moves land at different times
+        board.next = static_cast<unsigned short>((it / gameCount) * MULTI_BOARD_REPEAT_PLIES % (shown.moves.size() + 1));
+        board.position = shown.start;
+        for (unsigned int ply = 0; ply < board.next; ply++)
+        {
+            board.position.applyMove(shown.moves[ply]);
+        }
+        board.nextStep = now + MULTI_BOARD_STEP_SECONDS * it / count;
+        std::memset(board.lod, 0, sizeof(board.lod));
+    }
+    layout();
+    active = true;
+    paused = false;
+    return true;
+}
+
+// Back to the single game
+// Inputs: None
+// Output: None
+void chessMultiBoard::close()
+{
+    active = false;
+    boards.clear();
+    games.clear();
+    tiles.clear();
+    columns = rows = 0;
+}
+
+// Check for multi-board mode
+// Inputs: None
+// Output: true while boards are shown
+bool chessMultiBoard::isActive() const
+{
+    return active;
+}
+
+// Stop or resume playing the games
+// Inputs: true to stop, time now (seconds)
+// Output: None
+void chessMultiBoard::setPaused(bool cPaused, double now)
+{
+    if (cPaused == paused)
+    {
+        return;
+    }
+    paused = cPaused;
+    if (paused)
+    {
+        pausedAt = now;
+        return;
+    }
+    // Every board picks up where it stopped, still staggered
+    for (auto& board : boards)
+    {
+        board.nextStep += now - pausedAt;
+    }
+}
+
+// Play the moves that are due
+// Inputs: time now (seconds)
+// Output: true if a board changed
+bool chessMultiBoard::update(double now)
+{
+    if (!active || paused)
+    {
+        return false;
+    }
+    bool changed = false;
+    for (auto& board : boards)
+    {
+        if (now < board.nextStep)
+        {
+            continue;
+        }
+        const multiBoardGameT& game = games[board.game];
+        if (board.next < game.moves.size())
+        {
+            board.position.applyMove(game.moves[board.next++]);
+        }
+        else
+        {
+            // Game over: it starts again
+            board.position = game.start;
+            board.next = 0;
+        }
+        board.nextStep = now + (board.next < game.moves.size() ? MULTI_BOARD_STEP_SECONDS : MULTI_BOARD_END_PAUSE);
+        changed = true;
+    }
+    return changed;
+}
+
+// Find the shared meshes and place them on every square (again as components finish loading)
+// Inputs: components, component name of every piece code (nullptr if none)
+// Output: None
+void chessMultiBoard::resolveMeshes(const std::vector<chessComponent*>& components, const char* const pieceNames[MULTI_BOARD_PIECE_CODES])
+{
+    boardMesh = nullptr;
+    for (unsigned int code = 0; code < MULTI_BOARD_PIECE_CODES; code++)
+    {
+        pieceMeshes[code] = nullptr;
+    }
+    for (auto component = components.begin(); component != components.end(); component++)
+    {
+        const std::string& name = (*component)->getComponentID();
+        if (name == BOARD_COMPONENT)
+        {
+            boardMesh = *component;
+        }
+        for (unsigned int code = 0; code < MULTI_BOARD_PIECE_CODES; code++)
+        {
+            if (pieceNames[code] != nullptr && name == pieceNames[code])
+            {
+                pieceMeshes[code] = *component;
+            }
+        }
+    }
+
+    // Every board has the same local layout, only its tile differs
+    if (boardMesh != nullptr)
+    {
+        tPosition placement = {1, 0, 0.f, {1, 0, 0}, glm::vec3(CBSCALE), {0.f, 0.f, PHEIGHT}};
+        boardModel = boardMesh->genModelMatrix(placement);
+        boardSphere = boundingSphere(boardMesh, boardModel, CBSCALE);
+    }
+    for (unsigned int code = 0; code < MULTI_BOARD_PIECE_CODES; code++)
+    {
+        if (pieceMeshes[code] == nullptr)
+        {
+            continue;
+        }
+        for (int sq = 0; sq < 64; sq++)
+        {
+            tPosition placement = {1, 0, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), squareToBoardPosition(sq), true, (code & PIECE_BLACK) == 0};
+            pieceModels[code][sq] = pieceMeshes[code]->genModelMatrix(placement);
+            pieceSpheres[code][sq] = boundingSphere(pieceMeshes[code], pieceModels[code][sq], CPSCALE);
+        }
+    }
+}
+
+// Queue every board and piece in view
+// Inputs: arena collecting the frame, view and projection matrices, window height in pixels, LOD switch, what to draw
+// Output: None
+void chessMultiBoard::queueFrame(chessGeometryArena& arena, const glm::mat4& view, const glm::mat4& projection, int viewportHeight,
+                                 bool lodEnabled, bool drawBoards, bool drawPieces)
+{
+    stats.piecesDrawn = 0;
+    stats.piecesCulled = 0;
+    stats.triangles = 0;
+    if (!active || boards.empty())
+    {
+        return;
+    }
+
+    // Frustum planes from the rows of the view projection, the same in every tile
+    glm::mat4 viewProjection = projection * view;
+    glm::vec4 rowW(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    glm::vec4 planes[6];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        glm::vec4 row(viewProjection[0][axis], viewProjection[1][axis], viewProjection[2][axis], viewProjection[3][axis]);
+        planes[2 * axis] = rowW + row;
+        planes[2 * axis + 1] = rowW - row;
+    }
+    for (int plane = 0; plane < 6; plane++)
+    {
+        planes[plane] /= glm::length(glm::vec3(planes[plane]));
+    }
+
+    // What is in view on each square and how large: once per frame, not per board
+    float tileHeight = tiles[0].y * viewportHeight;
+    boardPixels = (boardMesh != nullptr) ? projectSphere(boardSphere, planes, view, projection, tileHeight) : -1.f;
+    for (unsigned int code = 0; code < MULTI_BOARD_PIECE_CODES; code++)
+    {
+        for (int sq = 0; pieceMeshes[code] != nullptr && sq < 64; sq++)
+        {
+            piecePixels[code][sq] = projectSphere(pieceSpheres[code][sq], planes, view, projection, tileHeight);
+        }
+    }
+
+    for (size_t it = 0; it < boards.size(); it++)
+    {
+        boardStateT& board = boards[it];
+        const glm::vec4& tile = tiles[it];
+        if (drawBoards && boardPixels >= 0.f)
+        {
+            unsigned int lod = lodEnabled ? boardMesh->selectLod(boardPixels, board.lod[MULTI_BOARD_SLOT]) : 0;
+            board.lod[MULTI_BOARD_SLOT] = static_cast<unsigned char>(lod);
+            boardMesh->queueDraw(arena, boardModel, lod, tile);
+            stats.triangles += boardMesh->getLodIndexCount(lod) / 3;
+        }
+        for (int sq = 0; drawPieces && sq < 64; sq++)
+        {
+            unsigned char piece = board.position.pieceAt(sq);
+            if (piece == PIECE_NONE || pieceMeshes[piece] == nullptr)
+            {
+                continue;
+            }
+            if (piecePixels[piece][sq] < 0.f)
+            {
+                stats.piecesCulled++;
+                continue;
+            }
+            // Hysteresis is kept per square, a new piece there takes over its level
+            unsigned int lod = lodEnabled ? pieceMeshes[piece]->selectLod(piecePixels[piece][sq], board.lod[sq]) : 0;
+            board.lod[sq] = static_cast<unsigned char>(lod);
+            pieceMeshes[piece]->queueDraw(arena, pieceModels[piece][sq], lod, tile);
+            stats.piecesDrawn++;
+            stats.triangles += pieceMeshes[piece]->getLodIndexCount(lod) / 3;
+        }
+    }
+}
+
+// Get the last frame counters
+// Inputs: None
+// Output: statistics
+const multiBoardStatsT& chessMultiBoard::getStats() const
+{
+    return stats;
+}
+
+// Get the boards shown
+// Inputs: None
+// Output: count
+unsigned int chessMultiBoard::getBoardCount() const
+{
+    return static_cast<unsigned int>(boards.size());
+}
+
+// Get the games read
+// Inputs: None
+// Output: count
+unsigned int chessMultiBoard::getGameCount() const
+{
+    return static_cast<unsigned int>(games.size());
+}
+
+// Get the tile grid
+// Inputs: columns and rows to fill
+// Output: None
+void chessMultiBoard::getGrid(unsigned int& cColumns, unsigned int& cRows) const
+{
+    cColumns = columns;
+    cRows = rows;
+}
@@ -0,0 +1,147 @@
+/*
+Objective:
+Several games in one window (simuls, tournament monitoring): each game keeps
+only its rules board and its place in a move list, and is drawn into its own
+tile of the window from the shared meshes. Every tile sees its board through
+the same camera, so what is in view and at which level of detail is worked
+out once per square per frame, and each mesh goes out as one instanced draw
+for all boards.
+*/
+
+#ifndef CHESS_MULTI_BOARD_H
+#define CHESS_MULTI_BOARD_H
+
+#include <string>
+#include <vector>
+#include "chessCommon.h"
+#include "chessComponent.h"
+#include "chessGeometryArena.h"
+#include "ECE_ChessPosition.hpp"
+
+// Boards shown at most (a 10 x 10 grid)
+const unsigned int MULTI_BOARD_MAX = 100;
+// Each board plays its next move this often (seconds, boards are staggered)
+const double MULTI_BOARD_STEP_SECONDS = 1.5;
+// Final position is kept this long before the game starts over (seconds)
+const double MULTI_BOARD_END_PAUSE = 5.0;
+// Boards showing the same game start this many plies apart
+const unsigned int MULTI_BOARD_REPEAT_PLIES = 10;
+// Empty border around each board (fraction of its tile)
+const float MULTI_BOARD_MARGIN = 0.04f;
+// Board slot in the per square tables (after the 64 squares)
+const unsigned int MULTI_BOARD_SLOT = 64;
+// Piece codes (PIECE_* | PIECE_BLACK)
+const unsigned int MULTI_BOARD_PIECE_CODES = 15;
+
+// One game of the source file (shared by every board showing it)
+typedef struct
+{
+    chessPosition start;
+    std::vector<chessMove> moves;
+} multiBoardGameT;
+
+// One board on screen (rules board, place in its game, LOD hysteresis)
+typedef struct
+{
+    chessPosition position;
+    unsigned short game;
+    unsigned short next;
+    double nextStep;
+    // Level of detail drawn last frame: squares a1..h8, then the board
+    unsigned char lod[MULTI_BOARD_SLOT + 1];
+} boardStateT;
+
+// Last frame counters
+typedef struct
+{
+    unsigned int piecesDrawn;
+    unsigned int piecesCulled;
+    unsigned long long triangles;
+} multiBoardStatsT;
+
+class chessMultiBoard
+{
+private:
+    std::vector<multiBoardGameT> games;
+    std::vector<boardStateT> boards;
+    // Clip space scale and offset of every board's tile
+    std::vector<glm::vec4> tiles;
+    unsigned int columns = 0;
+    unsigned int rows = 0;
+    bool active = false;
+    bool paused = false;
+    double pausedAt = 0.0;
+
+    // Shared meshes, with the model matrix and bounding sphere of every piece on every square
+    chessComponent* boardMesh = nullptr;
+    chessComponent* pieceMeshes[MULTI_BOARD_PIECE_CODES];
+    glm::mat4 boardModel;
+    glm::vec4 boardSphere;
+    glm::mat4 pieceModels[MULTI_BOARD_PIECE_CODES][64];
+    glm::vec4 pieceSpheres[MULTI_BOARD_PIECE_CODES][64];
+    // This frame: projected radius in a tile (pixels), negative when out of view
+    float boardPixels = -1.f;
+    float piecePixels[MULTI_BOARD_PIECE_CODES][64];
+    multiBoardStatsT stats;
+
+    // Work out the tile grid for the boards
+    // Inputs: None
+    // Output: None
+    void layout();
+    // Projected radius of a sphere in a tile
+    // Inputs: sphere (center, radius), frustum planes, view and projection matrices, tile height in pixels
+    // Output: pixels, negative if the sphere is out of view
+    float projectSphere(const glm::vec4& sphere, const glm::vec4 planes[6], const glm::mat4& view,
+                        const glm::mat4& projection, float tileHeight) const;
+
+public:
+    // Constructor function
+    chessMultiBoard();
+    // Show the games of a PGN file, cycled over the boards and staggered
+    // Inputs: PGN file, board count, time now (seconds)
+    // Output: true if at least one game could be read
+    bool load(const std::string& pgnPath, unsigned int count, double now);
+    // Back to the single game
+    // Inputs: None
+    // Output: None
+    void close();
+    // Check for multi-board mode
+    // Inputs: None
+    // Output: true while boards are shown
+    bool isActive() const;
+    // Stop or resume playing the games
+    // Inputs: true to stop, time now (seconds)
+    // Output: None
+    void setPaused(bool cPaused, double now);
+    // Play the moves that are due
+    // Inputs: time now (seconds)
+    // Output: true if a board changed
+    bool update(double now);
+    // Find the shared meshes and place them on every square (again as components finish loading)
+    // Inputs: components, component name of every piece code (nullptr if none)
+    // Output: None
+    void resolveMeshes(const std::vector<chessComponent*>& components, const char* const pieceNames[MULTI_BOARD_PIECE_CODES]);
+    // Queue every board and piece in view
+    // Inputs: arena collecting the frame, view and projection matrices, window height in pixels, LOD switch, what to draw
+    // Output: None
+    void queueFrame(chessGeometryArena& arena, const glm::mat4& view, const glm::mat4& projection, int viewportHeight,
+                    bool lodEnabled, bool drawBoards, bool drawPieces);
+    // Get the last frame counters
+    // Inputs: None
+    // Output: statistics
+    const multiBoardStatsT& getStats() const;
+    // Get the boards shown
+    // Inputs: None
+    // Output: count
+    unsigned int getBoardCount() const;
+    // Get the games read
+    // Inputs: None
+    // Output: count
+    unsigned int getGameCount() const;
+    // Get the tile grid
+    // Inputs: columns and rows to fill
+    // Output: None
+    void getGrid(unsigned int& cColumns, unsigned int& cRows) const;
+};
+
+#endif
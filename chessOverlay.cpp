@@ -0,0 +1,185 @@
+/*
+
+Objective:
+Scene overlay definition file
+*/
+
+#include "chessOverlay.h"
+#include <cmath>
+#include <cstddef>
+
+// Arrow head size relative to the shaft width
+const float OVERLAY_HEAD_LENGTH = 2.5f;
+const float OVERLAY_HEAD_WIDTH = 2.2f;
+
+
+// destructor function
+chessOverlay::~chessOverlay()
+{
+    destroy();
+}
+
+// Create the vertex buffer
+// Inputs: overlay program (Overlay.vertexshader/fragmentshader)
+// Output: true if created
+bool chessOverlay::create(GLuint cProgram)
+{
+    destroy();
+    program = cProgram;
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(overlayVertexT), (void*)offsetof(overlayVertexT, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(overlayVertexT), (void*)offsetof(overlayVertexT, color));
+    glBindVertexArray(0);
+    return program != 0 && vertexArray != 0 && vertexBuffer != 0;
+}
+
+// Release the buffers
+// Inputs: None
+// Output: None
+void chessOverlay::destroy()
+{
+    if (vertexBuffer != 0)
+    {
+        glDeleteBuffers(1, &vertexBuffer);
+        vertexBuffer = 0;
+    }
+    if (vertexArray != 0)
+    {
+        glDeleteVertexArrays(1, &vertexArray);
+        vertexArray = 0;
+    }
+}
+
+// Use another program (shader reload)
+// Inputs: overlay program
+// Output: None
+void chessOverlay::setProgram(GLuint cProgram)
+{
+    program = cProgram;
+}
+
+// Drop everything queued
+// Inputs: None
+// Output: None
+void chessOverlay::clear()
+{
+    worldVertices.clear();
+    screenVertices.clear();
+}
+
+// Check if anything is queued
+// Inputs: None
+// Output: true if nothing would be drawn
+bool chessOverlay::isEmpty() const
+{
+    return worldVertices.empty() && screenVertices.empty();
+}
+
+// Queue a quad as two triangles
+// Inputs: target list, corners in order around the quad, colour
+// Output: None
+void chessOverlay::addQuad(std::vector<overlayVertexT>& vertices, const glm::vec4& a, const glm::vec4& b,
+                           const glm::vec4& c, const glm::vec4& d, const glm::vec4& color)
+{
+    vertices.push_back({ a, color });
+    vertices.push_back({ b, color });
+    vertices.push_back({ c, color });
+    vertices.push_back({ a, color });
+    vertices.push_back({ c, color });
+    vertices.push_back({ d, color });
+}
+
+// Queue the evaluation bar (white fills from the bottom)
+// Inputs: white's share 0..1
+// Output: None
+void chessOverlay::addEvalBar(float whiteShare)
+{
+    whiteShare = whiteShare < 0.f ? 0.f : (whiteShare > 1.f ? 1.f : whiteShare);
+    float bottom = -OVERLAY_BAR_HEIGHT;
+    float split = bottom + 2.f * OVERLAY_BAR_HEIGHT * whiteShare;
+    glm::vec4 white(0.95f, 0.95f, 0.92f, 0.9f);
+    glm::vec4 black(0.12f, 0.12f, 0.12f, 0.9f);
+    glm::vec4 marker(0.9f, 0.2f, 0.2f, 1.f);
+
+    addQuad(screenVertices, glm::vec4(OVERLAY_BAR_LEFT, bottom, 0.f, 1.f), glm::vec4(OVERLAY_BAR_RIGHT, bottom, 0.f, 1.f),
+            glm::vec4(OVERLAY_BAR_RIGHT, split, 0.f, 1.f), glm::vec4(OVERLAY_BAR_LEFT, split, 0.f, 1.f), white);
+    addQuad(screenVertices, glm::vec4(OVERLAY_BAR_LEFT, split, 0.f, 1.f), glm::vec4(OVERLAY_BAR_RIGHT, split, 0.f, 1.f),
+            glm::vec4(OVERLAY_BAR_RIGHT, OVERLAY_BAR_HEIGHT, 0.f, 1.f), glm::vec4(OVERLAY_BAR_LEFT, OVERLAY_BAR_HEIGHT, 0.f, 1.f), black);
+    // Equal position mark
+    addQuad(screenVertices, glm::vec4(OVERLAY_BAR_LEFT, -0.003f, 0.f, 1.f), glm::vec4(OVERLAY_BAR_RIGHT, -0.003f, 0.f, 1.f),
+            glm::vec4(OVERLAY_BAR_RIGHT, 0.003f, 0.f, 1.f), glm::vec4(OVERLAY_BAR_LEFT, 0.003f, 0.f, 1.f), marker);
+}
+
+// Queue an arrow lying on the board
+// Inputs: start and tip (world space), shaft width, colour
+// Output: None
+void chessOverlay::addArrow(const glm::vec3& from, const glm::vec3& to, float width, const glm::vec4& color)
+{
+    glm::vec3 delta = to - from;
+    float length = std::sqrt(delta.x * delta.x + delta.y * delta.y);
+    if (length < 1e-4f)
+    {
+        return;
+    }
+    // The board lies in the XY plane, the arrow is lifted off its surface
+    glm::vec3 direction(delta.x / length, delta.y / length, 0.f);
+    glm::vec3 side(-direction.y, direction.x, 0.f);
+    glm::vec3 lift(0.f, 0.f, OVERLAY_LIFT);
+    float headLength = width * OVERLAY_HEAD_LENGTH < length ? width * OVERLAY_HEAD_LENGTH : length;
+    glm::vec3 base = from + lift;
+    glm::vec3 neck = to + lift - direction * headLength;
+    glm::vec3 shaft = side * (0.5f * width);
+    glm::vec3 head = side * (0.5f * width * OVERLAY_HEAD_WIDTH);
+
+    addQuad(worldVertices, glm::vec4(base - shaft, 1.f), glm::vec4(neck - shaft, 1.f),
+            glm::vec4(neck + shaft, 1.f), glm::vec4(base + shaft, 1.f), color);
+    worldVertices.push_back({ glm::vec4(neck - head, 1.f), color });
+    worldVertices.push_back({ glm::vec4(to + lift, 1.f), color });
+    worldVertices.push_back({ glm::vec4(neck + head, 1.f), color });
+}
+
+// Project, upload and draw everything queued (blended, over the depth buffer)
+// Inputs: view projection matrix
+// Output: draw calls issued (0 or 1)
+unsigned int chessOverlay::draw(const glm::mat4& viewProjection)
+{
+    if (isEmpty() || program == 0 || vertexArray == 0)
+    {
+        return 0;
+    }
+    // World geometry is projected here so both kinds share one draw
+    batch.clear();
+    batch.reserve(worldVertices.size() + screenVertices.size());
+    for (const overlayVertexT& vertex : worldVertices)
+    {
+        batch.push_back({ viewProjection * vertex.position, vertex.color });
+    }
+    batch.insert(batch.end(), screenVertices.begin(), screenVertices.end());
+
+    GLint previousProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+    glUseProgram(program);
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    // Rebuilt every frame, orphaning avoids waiting on the last one
+    glBufferData(GL_ARRAY_BUFFER, batch.size() * sizeof(overlayVertexT), batch.data(), GL_STREAM_DRAW);
+
+    // Flat and translucent: no depth test, no culling (arrows wind either way)
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(batch.size()));
+    glDisable(GL_BLEND);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+
+    glBindVertexArray(0);
+    glUseProgram(previousProgram);
+    return 1;
+}
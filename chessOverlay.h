@@ -0,0 +1,85 @@
+/*
+Objective:
+Flat overlay drawn over the scene (engine eval bar, best-move arrows):
+everything queued in a frame goes to the GPU in one batched draw
+*/
+
+#ifndef CHESS_OVERLAY_H
+#define CHESS_OVERLAY_H
+
+#include <vector>
+// Include GLEW
+#include <GL/glew.h>
+// Include GLM
+#include <glm/glm.hpp>
+
+// Eval bar placement in normalized device coordinates (left edge of the window)
+const float OVERLAY_BAR_LEFT = -0.98f;
+const float OVERLAY_BAR_RIGHT = -0.94f;
+const float OVERLAY_BAR_HEIGHT = 0.9f;
+// Arrows float this far above the board so the squares do not cover them
+const float OVERLAY_LIFT = 0.1f;
+
+// Overlay vertex: clip space position and colour
+typedef struct
+{
+    glm::vec4 position;
+    glm::vec4 color;
+} overlayVertexT;
+
+class chessOverlay
+{
+private:
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    GLuint vertexBuffer = 0;
+    // Queued this frame: world space triangles (projected at draw) and screen space ones
+    std::vector<overlayVertexT> worldVertices;
+    std::vector<overlayVertexT> screenVertices;
+    // Upload staging, reused between frames
+    std::vector<overlayVertexT> batch;
+
+    // Queue a quad as two triangles
+    // Inputs: target list, corners in order around the quad, colour
+    // Output: None
+    void addQuad(std::vector<overlayVertexT>& vertices, const glm::vec4& a, const glm::vec4& b,
+                 const glm::vec4& c, const glm::vec4& d, const glm::vec4& color);
+
+public:
+    // destructor function
+    ~chessOverlay();
+    // Create the vertex buffer
+    // Inputs: overlay program (Overlay.vertexshader/fragmentshader)
+    // Output: true if created
+    bool create(GLuint cProgram);
+    // Release the buffers
+    // Inputs: None
+    // Output: None
+    void destroy();
+    // Use another program (shader reload)
+    // Inputs: overlay program
+    // Output: None
+    void setProgram(GLuint cProgram);
+    // Drop everything queued
+    // Inputs: None
+    // Output: None
+    void clear();
+    // Check if anything is queued
+    // Inputs: None
+    // Output: true if nothing would be drawn
+    bool isEmpty() const;
+    // Queue the evaluation bar (white fills from the bottom)
+    // Inputs: white's share 0..1
+    // Output: None
+    void addEvalBar(float whiteShare);
+    // Queue an arrow lying on the board
+    // Inputs: start and tip (world space), shaft width, colour
+    // Output: None
+    void addArrow(const glm::vec3& from, const glm::vec3& to, float width, const glm::vec4& color);
+    // Project, upload and draw everything queued (blended, over the depth buffer)
+    // Inputs: view projection matrix
+    // Output: draw calls issued (0 or 1)
+    unsigned int draw(const glm::mat4& viewProjection);
+};
+
+#endif
@@ -0,0 +1,230 @@
+/*
+
+Objective:
+Mouse picking definition file
+*/
+
+#include "chessPicking.h"
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+
+// Board square of a world position
+// Inputs: world position, file and rank to fill
+// Output: true if on the board
+static bool boardCell(float x, float y, int& file, int& rank)
+{
+    // a1 is on the -x/-y corner, squares are CHESS_BOX_SIZE wide
+    file = static_cast<int>(std::floor(x / CHESS_BOX_SIZE + 4.f));
+    rank = static_cast<int>(std::floor(y / CHESS_BOX_SIZE + 4.f));
+    return file >= 0 && file < 8 && rank >= 0 && rank < 8;
+}
+
+// Ray against an axis aligned box (slab test)
+// Inputs: ray origin and direction, box, distance to fill (ray parameter)
+// Output: true if the ray enters the box in front of the origin
+static bool rayHitsBox(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& boxMin,
+                       const glm::vec3& boxMax, float& tHit)
+{
+    float tNear = 0.f;
+    float tFar = std::numeric_limits<float>::max();
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (std::fabs(direction[axis]) < 1e-12f)
+        {
+            // Parallel to the slab: inside or never
+            if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis])
+            {
+                return false;
+            }
+            continue;
+        }
+        float t1 = (boxMin[axis] - origin[axis]) / direction[axis];
+        float t2 = (boxMax[axis] - origin[axis]) / direction[axis];
+        if (t1 > t2)
+        {
+            float swap = t1;
+            t1 = t2;
+            t2 = swap;
+        }
+        tNear = (t1 > tNear) ? t1 : tNear;
+        tFar = (t2 < tFar) ? t2 : tFar;
+        if (tNear > tFar)
+        {
+            return false;
+        }
+    }
+    tHit = tNear;
+    return true;
+}
+
+// Rebuild the index from the current transforms
+// Inputs: transforms, components
+// Output: None
+void chessPicker::rebuild(tModelMap& cTModelMap, const std::vector<chessComponent*>& components)
+{
+    for (auto& cell : cells)
+    {
+        cell.clear();
+    }
+    maxHeight = 0.f;
+
+    // Same instance walk as the renderer
+    for (auto component = components.begin(); component != components.end(); component++)
+    {
+        if ((*component)->getComponentID() == BOARD_COMPONENT)
+        {
+            continue;
+        }
+        glm::vec3 modelMin, modelMax;
+        (*component)->getModelBounds(modelMin, modelMax);
+        unsigned int instances = cTModelMap[(*component)->getComponentID()].rCnt;
+        for (unsigned int pit = 0; pit < instances; pit++)
+        {
+            const std::string& instanceKey = (*component)->getInstanceKey(pit);
+            // Logical square only, animation and selection offsets are left out
+            tPosition logical = cTModelMap[instanceKey];
+            int file, rank;
+            if (!logical.alive || !boardCell(logical.tPos.x, logical.tPos.y, file, rank))
+            {
+                continue;
+            }
+            logical.aOffset = glm::vec3(0.f);
+            glm::mat4 model = (*component)->genModelMatrix(logical);
+
+            // World box around the transformed model box corners
+            pickEntryT entry;
+            entry.key = instanceKey;
+            for (int corner = 0; corner < 8; corner++)
+            {
+                glm::vec3 local((corner & 1) ? modelMax.x : modelMin.x, (corner & 2) ? modelMax.y : modelMin.y,
+                                (corner & 4) ? modelMax.z : modelMin.z);
+                glm::vec3 world = glm::vec3(model * glm::vec4(local, 1.f));
+                entry.boundsMin = (corner == 0) ? world : glm::min(entry.boundsMin, world);
+                entry.boundsMax = (corner == 0) ? world : glm::max(entry.boundsMax, world);
+            }
+            float height = entry.boundsMax.z - PHEIGHT;
+            maxHeight = (height > maxHeight) ? height : maxHeight;
+            cells[rank * 8 + file].push_back(entry);
+        }
+    }
+    dirty = false;
+}
+
+// Mark the index stale (pieces moved or were set up)
+// Inputs: None
+// Output: None
+void chessPicker::invalidate()
+{
+    dirty = true;
+}
+
+// Find what is under the cursor
+// Inputs: cursor in window coordinates, window size, view and projection matrices, transforms, components
+// Output: square and piece under the cursor
+pickResultT chessPicker::pick(double cursorX, double cursorY, int width, int height, const glm::mat4& view,
+                              const glm::mat4& projection, tModelMap& cTModelMap, const std::vector<chessComponent*>& components)
+{
+    pickResultT result;
+    if (dirty)
+    {
+        rebuild(cTModelMap, components);
+    }
+    if (width <= 0 || height <= 0)
+    {
+        return result;
+    }
+
+    // Unproject the cursor at the near and far planes
+    float ndcX = static_cast<float>(2.0 * cursorX / width - 1.0);
+    float ndcY = static_cast<float>(1.0 - 2.0 * cursorY / height);
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.f, 1.f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.f, 1.f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+    if (direction.z >= 0.f)
+    {
+        // Looking away from the board
+        return result;
+    }
+
+    // Only the stretch between the tallest piece top and the board plane can hit anything
+    float tBoard = (PHEIGHT - origin.z) / direction.z;
+    float tTop = (PHEIGHT + maxHeight - origin.z) / direction.z;
+    if (tBoard < 0.f)
+    {
+        return result;
+    }
+    tTop = (tTop > 0.f) ? tTop : 0.f;
+
+    // Walk the squares under that stretch (2D DDA in square units)
+    glm::vec2 start = (glm::vec2(origin) + glm::vec2(direction) * tTop) / CHESS_BOX_SIZE + glm::vec2(4.f);
+    glm::vec2 end = (glm::vec2(origin) + glm::vec2(direction) * tBoard) / CHESS_BOX_SIZE + glm::vec2(4.f);
+    glm::vec2 delta = end - start;
+    int cellX = static_cast<int>(std::floor(start.x));
+    int cellY = static_cast<int>(std::floor(start.y));
+    int endX = static_cast<int>(std::floor(end.x));
+    int endY = static_cast<int>(std::floor(end.y));
+    int stepX = (delta.x > 0.f) ? 1 : -1;
+    int stepY = (delta.y > 0.f) ? 1 : -1;
+    const float infinity = std::numeric_limits<float>::max();
+    float tDeltaX = (delta.x != 0.f) ? 1.f / std::fabs(delta.x) : infinity;
+    float tDeltaY = (delta.y != 0.f) ? 1.f / std::fabs(delta.y) : infinity;
+    float tMaxX = (delta.x != 0.f) ? ((stepX > 0) ? cellX + 1 - start.x : start.x - cellX) * tDeltaX : infinity;
+    float tMaxY = (delta.y != 0.f) ? ((stepY > 0) ? cellY + 1 - start.y : start.y - cellY) * tDeltaY : infinity;
+    int cellsLeft = std::abs(endX - cellX) + std::abs(endY - cellY);
+
+    float bestT = tBoard;
+    int hitCell = -1;
+    while (true)
+    {
+        if (cellX >= 0 && cellX < 8 && cellY >= 0 && cellY < 8)
+        {
+            for (const auto& entry : cells[cellY * 8 + cellX])
+            {
+                float tHit;
+                if (rayHitsBox(origin, direction, entry.boundsMin, entry.boundsMax, tHit) && tHit < bestT)
+                {
+                    bestT = tHit;
+                    hitCell = cellY * 8 + cellX;
+                    result.piece = entry.key;
+                }
+            }
+        }
+        if (cellsLeft-- <= 0)
+        {
+            break;
+        }
+        if (tMaxX < tMaxY)
+        {
+            tMaxX += tDeltaX;
+            cellX += stepX;
+        }
+        else
+        {
+            tMaxY += tDeltaY;
+            cellY += stepY;
+        }
+    }
+
+    // A piece gives its own square, otherwise the board plane point does
+    int file, rank;
+    if (hitCell >= 0)
+    {
+        file = hitCell % 8;
+        rank = hitCell / 8;
+    }
+    else
+    {
+        file = endX;
+        rank = endY;
+        if (file < 0 || file >= 8 || rank < 0 || rank >= 8)
+        {
+            return result;
+        }
+    }
+    result.square = std::string(1, static_cast<char>('a' + file)) + static_cast<char>('1' + rank);
+    return result;
+}
@@ -0,0 +1,61 @@
+/*
+Objective:
+Mouse picking: cursor ray against the board plane and the piece bounding
+boxes, found through a per square spatial index (no GPU readback)
+*/
+
+#ifndef CHESS_PICKING_H
+#define CHESS_PICKING_H
+
+#include <string>
+#include <vector>
+#include "chessCommon.h"
+#include "chessComponent.h"
+
+// Selected piece is raised by this much
+const float PICK_LIFT = 0.25f * CHESS_BOX_SIZE;
+
+// One piece in the index (bounding box at its logical square)
+typedef struct
+{
+    std::string key;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+} pickEntryT;
+
+// What the cursor is over
+typedef struct
+{
+    // Square in notation ("e2"), empty when off the board
+    std::string square;
+    // Instance key of the piece hit, empty for a bare square
+    std::string piece;
+} pickResultT;
+
+class chessPicker
+{
+private:
+    // Pieces bucketed by square (rank * 8 + file)
+    std::vector<pickEntryT> cells[64];
+    // Tallest piece above the board (limits the cells a ray can hit)
+    float maxHeight = 0.f;
+    bool dirty = true;
+
+    // Rebuild the index from the current transforms
+    // Inputs: transforms, components
+    // Output: None
+    void rebuild(tModelMap& cTModelMap, const std::vector<chessComponent*>& components);
+
+public:
+    // Mark the index stale (pieces moved or were set up)
+    // Inputs: None
+    // Output: None
+    void invalidate();
+    // Find what is under the cursor
+    // Inputs: cursor in window coordinates, window size, view and projection matrices, transforms, components
+    // Output: square and piece under the cursor
+    pickResultT pick(double cursorX, double cursorY, int width, int height, const glm::mat4& view,
+                     const glm::mat4& projection, tModelMap& cTModelMap, const std::vector<chessComponent*>& components);
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+
+Objective:
+Static board cache definition file
+*/
+
+#include "chessSceneCache.h"
+
+
+// destructor function
+chessSceneCache::~chessSceneCache()
+{
+    destroy();
+}
+
+// Create the offscreen target matching the default framebuffer
+// Inputs: framebuffer size in pixels
+// Output: true if the target is complete
+bool chessSceneCache::create(int cWidth, int cHeight)
+{
+    destroy();
+    if (cWidth <= 0 || cHeight <= 0)
+    {
+        return false;
+    }
+    width = cWidth;
+    height = cHeight;
+
+    // Same sample count as the window, blits between them must match
+    GLint samples = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glGetIntegerv(GL_SAMPLES, &samples);
+
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete)
+    {
+        destroy();
+    }
+    return complete;
+}
+
+// Release the offscreen target
+// Inputs: None
+// Output: None
+void chessSceneCache::destroy()
+{
+    if (framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+    }
+    if (colorBuffer != 0)
+    {
+        glDeleteRenderbuffers(1, &colorBuffer);
+        colorBuffer = 0;
+    }
+    if (depthBuffer != 0)
+    {
+        glDeleteRenderbuffers(1, &depthBuffer);
+        depthBuffer = 0;
+    }
+}
+
+// Check for a usable target
+// Inputs: None
+// Output: true if created
+bool chessSceneCache::isValid() const
+{
+    return framebuffer != 0;
+}
+
+// Redirect drawing into the cache
+// Inputs: None
+// Output: None
+void chessSceneCache::bindForDrawing()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+// Copy colour and depth into the frame target, which stays bound for the pieces
+// Inputs: destination framebuffer (0 for the window, the capture target when hidden)
+// Output: false if the driver refused the copy (formats differ)
+bool chessSceneCache::blitToScreen(GLuint target)
+{
+    // Drop stale errors so the check below only sees the blit
+    while (glGetError() != GL_NO_ERROR)
+    {
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    return glGetError() == GL_NO_ERROR;
+}
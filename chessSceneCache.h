@@ -0,0 +1,56 @@
+/*
+Objective:
+Offscreen cache of the static board (colour + depth) and scene damage flags
+*/
+
+#ifndef CHESS_SCENE_CACHE_H
+#define CHESS_SCENE_CACHE_H
+
+// Include GLEW
+#include <GL/glew.h>
+
+// What changed since the last drawn frame
+const unsigned int DAMAGE_NONE = 0;
+// Pieces moved or were set up (board unchanged)
+const unsigned int DAMAGE_PIECES = 1;
+// Camera, light or window size changed (everything is redrawn)
+const unsigned int DAMAGE_BOARD = 2;
+// Overlay content changed (drawn over the finished frame)
+const unsigned int DAMAGE_OVERLAY = 4;
+const unsigned int DAMAGE_ALL = DAMAGE_PIECES | DAMAGE_BOARD | DAMAGE_OVERLAY;
+
+class chessSceneCache
+{
+private:
+    GLuint framebuffer = 0;
+    GLuint colorBuffer = 0;
+    GLuint depthBuffer = 0;
+    GLint width = 0;
+    GLint height = 0;
+
+public:
+    // destructor function
+    ~chessSceneCache();
+    // Create the offscreen target matching the default framebuffer
+    // Inputs: framebuffer size in pixels
+    // Output: true if the target is complete
+    bool create(int cWidth, int cHeight);
+    // Release the offscreen target
+    // Inputs: None
+    // Output: None
+    void destroy();
+    // Check for a usable target
+    // Inputs: None
+    // Output: true if created
+    bool isValid() const;
+    // Redirect drawing into the cache
+    // Inputs: None
+    // Output: None
+    void bindForDrawing();
+    // Copy colour and depth into the frame target, which stays bound for the pieces
+    // Inputs: destination framebuffer (0 for the window, the capture target when hidden)
+    // Output: false if the driver refused the copy (formats differ)
+    bool blitToScreen(GLuint target);
+};
+
+#endif
@@ -0,0 +1,373 @@
+/*
+
+Objective:
+Shader program cache definition file
+*/
+
+#include "chessShaderCache.h"
+#include "chessHash.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <windows.h>
+
+// Cache file tag ("CPRG")
+const unsigned int SHADER_CACHE_MAGIC = 0x47525043;
+
+// Read a whole text file
+// Inputs: file path, text to fill
+// Output: true if read
+static bool readSource(const std::string& filePath, std::string& source)
+{
+    std::ifstream file(filePath);
+    if (!file)
+    {
+        std::cout << "Impossible to open " << filePath << ". Are you in the right directory ?" << std::endl;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    source = text.str();
+    return true;
+}
+
+// Last write time of a file
+// Inputs: file path
+// Output: time stamp (0 if the file is missing)
+static unsigned long long fileWriteTime(const std::string& filePath)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(filePath.c_str(), GetFileExInfoStandard, &attributes))
+    {
+        return 0;
+    }
+    return (static_cast<unsigned long long>(attributes.ftLastWriteTime.dwHighDateTime) << 32) |
+           attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+// Compile one shader stage
+// Inputs: stage, source, file name (messages)
+// Output: shader (0 on a compile error)
+static GLuint compileShader(GLenum stage, const std::string& source, const std::string& filePath)
+{
+    GLuint shader = glCreateShader(stage);
+    const char* sourcePointer = source.c_str();
+    glShaderSource(shader, 1, &sourcePointer, NULL);
+    glCompileShader(shader);
+
+    GLint result = GL_FALSE;
+    GLint infoLogLength = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+    if (infoLogLength > 1)
+    {
+        std::vector<char> message(infoLogLength + 1);
+        glGetShaderInfoLog(shader, infoLogLength, NULL, message.data());
+        std::cout << filePath << ": " << message.data() << std::endl;
+    }
+    if (result != GL_TRUE)
+    {
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Compile and link from source (same steps as LoadShaders, binary kept retrievable)
+// Inputs: vertex and fragment source, file names (messages)
+// Output: program (0 on failure)
+static GLuint compileProgram(const std::string& vertexSource, const std::string& fragmentSource,
+                             const std::string& vertexFile, const std::string& fragmentFile)
+{
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, vertexFile);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource, fragmentFile);
+    if (vertexShader == 0 || fragmentShader == 0)
+    {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+
+    GLint result = GL_FALSE;
+    GLint infoLogLength = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &result);
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+    if (infoLogLength > 1)
+    {
+        std::vector<char> message(infoLogLength + 1);
+        glGetProgramInfoLog(program, infoLogLength, NULL, message.data());
+        std::cout << message.data() << std::endl;
+    }
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    if (result != GL_TRUE)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Check for driver support of program binaries
+// Inputs: None
+// Output: true if binaries can be stored and loaded
+static bool programBinarySupported()
+{
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+    {
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// Cache file for the current sources
+// Inputs: None
+// Output: path
+std::string chessShaderCache::cachePath()
+{
+    // File name from the vertex shader ("StandardShading.vertexshader" -> StandardShading.program)
+    std::string name = vertexFile.substr(vertexFile.find_last_of("/\\") + 1);
+    name = name.substr(0, name.find('.'));
+    return std::string(SHADER_CACHE_DIR) + "/" + name + ".program";
+}
+
+// Cache key from the sources and the driver
+// Inputs: vertex and fragment source
+// Output: key
+unsigned long long chessShaderCache::cacheKey(const std::string& vertexSource, const std::string& fragmentSource)
+{
+    unsigned long long hash = fnv1a(&SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION));
+    hash = fnv1a(vertexSource.data(), vertexSource.size() + 1, hash);
+    hash = fnv1a(fragmentSource.data(), fragmentSource.size() + 1, hash);
+    // A driver update or another GPU invalidates the binary
+    const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum name : driverStrings)
+    {
+        const char* text = reinterpret_cast<const char*>(glGetString(name));
+        std::string value = (text != NULL) ? text : "";
+        hash = fnv1a(value.data(), value.size() + 1, hash);
+    }
+    return hash;
+}
+
+// Load a stored binary
+// Inputs: expected key
+// Output: program (0 if missing, stale or refused by the driver)
+GLuint chessShaderCache::loadBinary(unsigned long long key)
+{
+    std::ifstream file(cachePath(), std::ios::binary);
+    unsigned int magic = 0;
+    unsigned long long storedKey = 0;
+    GLenum binaryFormat = 0;
+    GLint length = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+    file.read(reinterpret_cast<char*>(&binaryFormat), sizeof(binaryFormat));
+    file.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if (!file || magic != SHADER_CACHE_MAGIC || storedKey != key || length <= 0)
+    {
+        return 0;
+    }
+    std::vector<char> binary(length);
+    file.read(binary.data(), length);
+    if (!file)
+    {
+        return 0;
+    }
+
+    // The driver may still refuse it (format no longer accepted)
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, binaryFormat, binary.data(), length);
+    GLint result = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &result);
+    if (result != GL_TRUE)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Store the binary of a linked program
+// Inputs: program, key
+// Output: true if written
+bool chessShaderCache::saveBinary(GLuint program, unsigned long long key)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return false;
+    }
+    std::vector<char> binary(length);
+    GLenum binaryFormat = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &binaryFormat, binary.data());
+    if (written <= 0)
+    {
+        return false;
+    }
+
+    CreateDirectoryA(SHADER_CACHE_DIR, NULL);
+    std::ofstream file(cachePath(), std::ios::binary | std::ios::trunc);
+    GLint storedLength = written;
+    file.write(reinterpret_cast<const char*>(&SHADER_CACHE_MAGIC), sizeof(SHADER_CACHE_MAGIC));
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char*>(&binaryFormat), sizeof(binaryFormat));
+    file.write(reinterpret_cast<const char*>(&storedLength), sizeof(storedLength));
+    file.write(binary.data(), written);
+    return static_cast<bool>(file);
+}
+
+// Build the program, from the cache when the sources and driver match
+// Inputs: vertex and fragment shader files, false to force a source compile
+// Output: program (0 on a compile or link failure)
+GLuint chessShaderCache::load(const char* cVertexFile, const char* cFragmentFile, bool useCache)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    vertexFile = cVertexFile;
+    fragmentFile = cFragmentFile;
+    vertexWriteTime = fileWriteTime(vertexFile);
+    fragmentWriteTime = fileWriteTime(fragmentFile);
+
+    std::string vertexSource;
+    std::string fragmentSource;
+    if (!readSource(vertexFile, vertexSource) || !readSource(fragmentFile, fragmentSource))
+    {
+        return 0;
+    }
+
+    bool binarySupported = programBinarySupported();
+    unsigned long long key = cacheKey(vertexSource, fragmentSource);
+    GLuint program = 0;
+    lastFromCache = false;
+    if (useCache && binarySupported)
+    {
+        program = loadBinary(key);
+        lastFromCache = program != 0;
+    }
+    if (program == 0)
+    {
+        // Missing or stale binary: compile, then store for the next start
+        program = compileProgram(vertexSource, fragmentSource, vertexFile, fragmentFile);
+        if (program != 0 && binarySupported)
+        {
+            saveBinary(program, key);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    lastSeconds = elapsed.count();
+    return program;
+}
+
+// Check how the last program was built
+// Inputs: None
+// Output: true if it came from the cache
+bool chessShaderCache::loadedFromCache() const
+{
+    return lastFromCache;
+}
+
+// Time spent building the last program
+// Inputs: None
+// Output: seconds
+double chessShaderCache::loadSeconds() const
+{
+    return lastSeconds;
+}
+
+// Start or stop watching the source files
+// Inputs: true to watch
+// Output: None
+void chessShaderCache::setWatching(bool cWatching)
+{
+    watching = cWatching;
+    lastCheck = std::chrono::steady_clock::now();
+}
+
+// Check the watch state
+// Inputs: None
+// Output: true if watching
+bool chessShaderCache::isWatching() const
+{
+    return watching;
+}
+
+// Rebuild when a source file changed (rate limited)
+// Inputs: None
+// Output: new program (0 if nothing changed or the new sources failed)
+GLuint chessShaderCache::pollReload()
+{
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> sinceCheck = now - lastCheck;
+    if (!watching || vertexFile.empty() || sinceCheck.count() < SHADER_WATCH_INTERVAL)
+    {
+        return 0;
+    }
+    lastCheck = now;
+
+    unsigned long long vertexTime = fileWriteTime(vertexFile);
+    unsigned long long fragmentTime = fileWriteTime(fragmentFile);
+    if (vertexTime == vertexWriteTime && fragmentTime == fragmentWriteTime)
+    {
+        return 0;
+    }
+
+    // Editors write in steps, the time stamps are taken again by load()
+    GLuint program = load(vertexFile.c_str(), fragmentFile.c_str());
+    if (program == 0)
+    {
+        std::cout << "Shader reload failed, keeping the previous program" << std::endl;
+        return 0;
+    }
+    std::cout << "Shaders reloaded in " << 1000.0 * lastSeconds << " ms" << std::endl;
+    return program;
+}
+
+// Time source compiles against cache loads
+// Inputs: None
+// Output: None
+void chessShaderCache::benchmark()
+{
+    if (vertexFile.empty())
+    {
+        return;
+    }
+    std::string cVertexFile = vertexFile;
+    std::string cFragmentFile = fragmentFile;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        double total = 0.0;
+        unsigned int cached = 0;
+        for (unsigned int run = 0; run < SHADER_BENCH_RUNS; run++)
+        {
+            GLuint program = load(cVertexFile.c_str(), cFragmentFile.c_str(), pass == 1);
+            glFinish();
+            total += lastSeconds;
+            cached += lastFromCache ? 1 : 0;
+            glDeleteProgram(program);
+        }
+        std::cout << (pass == 0 ? "Source compile: " : "Binary cache:   ") << 1000.0 * total / SHADER_BENCH_RUNS
+                  << " ms/program";
+        if (pass == 1)
+        {
+            std::cout << " (" << cached << "/" << SHADER_BENCH_RUNS << " from cache)";
+        }
+        std::cout << std::endl;
+    }
+}
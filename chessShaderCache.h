@@ -0,0 +1,86 @@
+/*
+Objective:
+Shader program cache: linked program binaries stored on disk, keyed by the
+shader sources and the driver, plus a file watch for hot reloading
+*/
+
+#ifndef CHESS_SHADER_CACHE_H
+#define CHESS_SHADER_CACHE_H
+
+#include <chrono>
+#include <string>
+// Include GLEW
+#include <GL/glew.h>
+
+// Program binaries are stored next to the optimized meshes
+const char SHADER_CACHE_DIR[] = "Lab3/cache";
+// Bump when the cache file layout changes
+const unsigned int SHADER_CACHE_VERSION = 1;
+// Source files are checked this often while watching (seconds)
+const double SHADER_WATCH_INTERVAL = 0.5;
+// Builds per path in "shaders bench"
+const unsigned int SHADER_BENCH_RUNS = 5;
+
+class chessShaderCache
+{
+private:
+    std::string vertexFile;
+    std::string fragmentFile;
+    // Last write times of the sources (hot reload)
+    unsigned long long vertexWriteTime = 0;
+    unsigned long long fragmentWriteTime = 0;
+    bool watching = false;
+    std::chrono::steady_clock::time_point lastCheck;
+    // How the last program was built
+    bool lastFromCache = false;
+    double lastSeconds = 0.0;
+
+    // Cache file for the current sources
+    // Inputs: None
+    // Output: path
+    std::string cachePath();
+    // Cache key from the sources and the driver
+    // Inputs: vertex and fragment source
+    // Output: key
+    unsigned long long cacheKey(const std::string& vertexSource, const std::string& fragmentSource);
+    // Load a stored binary
+    // Inputs: expected key
+    // Output: program (0 if missing, stale or refused by the driver)
+    GLuint loadBinary(unsigned long long key);
+    // Store the binary of a linked program
+    // Inputs: program, key
+    // Output: true if written
+    bool saveBinary(GLuint program, unsigned long long key);
+
+public:
+    // Build the program, from the cache when the sources and driver match
+    // Inputs: vertex and fragment shader files, false to force a source compile
+    // Output: program (0 on a compile or link failure)
+    GLuint load(const char* cVertexFile, const char* cFragmentFile, bool useCache = true);
+    // Check how the last program was built
+    // Inputs: None
+    // Output: true if it came from the cache
+    bool loadedFromCache() const;
+    // Time spent building the last program
+    // Inputs: None
+    // Output: seconds
+    double loadSeconds() const;
+    // Start or stop watching the source files
+    // Inputs: true to watch
+    // Output: None
+    void setWatching(bool cWatching);
+    // Check the watch state
+    // Inputs: None
+    // Output: true if watching
+    bool isWatching() const;
+    // Rebuild when a source file changed (rate limited)
+    // Inputs: None
+    // Output: new program (0 if nothing changed or the new sources failed)
+    GLuint pollReload();
+    // Time source compiles against cache loads
+    // Inputs: None
+    // Output: None
+    void benchmark();
+};
+
+#endif
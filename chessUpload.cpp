@@ -0,0 +1,175 @@
+/*
+
+Objective:
+Off-thread BMP decoding and staged GL upload definition file
+*/
+
+#include "chessUpload.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// One staging buffer for every upload, orphaned before each fill so the
+// driver never waits for the previous copy to finish
+static GLuint stagingBuffer = 0;
+
+// Read a little endian 32-bit value from the BMP header
+// Inputs: header bytes, offset
+// Output: value
+static unsigned int readHeaderInt(const unsigned char* header, size_t offset)
+{
+    return header[offset] | (header[offset + 1] << 8) | (header[offset + 2] << 16) | (header[offset + 3] << 24);
+}
+
+// Map the staging buffer bound to a target with room for a copy
+// Inputs: target, size in bytes
+// Output: write pointer (nullptr if the driver refused the mapping)
+static void* mapStagingBuffer(GLenum target, size_t size)
+{
+    if (stagingBuffer == 0)
+    {
+        glGenBuffers(1, &stagingBuffer);
+    }
+    glBindBuffer(target, stagingBuffer);
+    // Orphan the old storage, a pending copy keeps its own
+    glBufferData(target, size, nullptr, GL_STREAM_DRAW);
+    return glMapBufferRange(target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+// Read a 24-bit BMP file (any thread, no GL calls)
+// Inputs: file path, image to fill
+// Output: true if decoded
+bool decodeBMP(const std::string& filePath, bmpImageT& image)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+    {
+        std::cout << filePath << " could not be opened." << std::endl;
+        return false;
+    }
+
+    // 54 byte header: 'BM', data offset, size and pixel format
+    unsigned char header[54];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != 'B' || header[1] != 'M')
+    {
+        std::cout << filePath << " is not a correct BMP file" << std::endl;
+        return false;
+    }
+    if (readHeaderInt(header, 0x1E) != 0 || (header[0x1C] | (header[0x1D] << 8)) != 24)
+    {
+        std::cout << filePath << " is not a 24bpp uncompressed BMP file" << std::endl;
+        return false;
+    }
+    unsigned int dataPos = readHeaderInt(header, 0x0A);
+    int width = static_cast<int>(readHeaderInt(header, 0x12));
+    int height = static_cast<int>(readHeaderInt(header, 0x16));
+    if (width <= 0 || height <= 0)
+    {
+        std::cout << filePath << " has an unsupported size" << std::endl;
+        return false;
+    }
+    if (dataPos == 0)
+    {
+        dataPos = sizeof(header);
+    }
+
+    // Rows are padded to 4 bytes, same as the default GL_UNPACK_ALIGNMENT
+    size_t rowBytes = (static_cast<size_t>(width) * 3 + 3) & ~static_cast<size_t>(3);
+    image.pixels.resize(rowBytes * height);
+    file.seekg(dataPos);
+    if (!file.read(reinterpret_cast<char*>(image.pixels.data()), image.pixels.size()))
+    {
+        std::cout << filePath << " is truncated" << std::endl;
+        std::vector<unsigned char>().swap(image.pixels);
+        return false;
+    }
+    image.width = width;
+    image.height = height;
+    return true;
+}
+
+// Fill the buffer bound to a target through the staging buffer (GL thread)
+// Inputs: target (GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, ...), data, size in bytes
+// Output: None
+void stagedBufferData(GLenum target, const void* data, size_t size)
+{
+    // Allocate the destination without data, the copy runs on the GPU timeline
+    glBufferData(target, size, nullptr, GL_STATIC_DRAW);
+    stagedBufferSubData(target, 0, data, size);
+}
+
+// Write part of the buffer bound to a target through the staging buffer (GL thread)
+// Inputs: target (not GL_COPY_READ_BUFFER, the staging buffer uses it), byte offset, data, size in bytes
+// Output: None
+void stagedBufferSubData(GLenum target, size_t offset, const void* data, size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    void* staging = mapStagingBuffer(GL_COPY_READ_BUFFER, size);
+    if (staging == nullptr)
+    {
+        // Mapping refused, let the driver copy it
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBufferSubData(target, offset, size, data);
+        return;
+    }
+    memcpy(staging, data, size);
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, target, 0, offset, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+// Create a mipmapped texture from a decoded BMP through a pixel unpack buffer (GL thread)
+// Inputs: decoded image
+// Output: texture handle
+GLuint stagedTextureBMP(const bmpImageT& image)
+{
+    if (image.pixels.empty())
+    {
+        return 0;
+    }
+
+    // Create one OpenGL texture
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+
+    // Pixels come from the unpack buffer, glTexImage2D returns without touching client memory
+    void* staging = mapStagingBuffer(GL_PIXEL_UNPACK_BUFFER, image.pixels.size());
+    if (staging != nullptr)
+    {
+        memcpy(staging, image.pixels.data(), image.pixels.size());
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+        // Later uploads read client memory again
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    else
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, GL_BGR, GL_UNSIGNED_BYTE, image.pixels.data());
+    }
+
+    // Trilinear filtering, same as loadBMP_custom
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    return textureID;
+}
+
+// Release the staging buffer
+// Inputs: None
+// Output: None
+void releaseStagingBuffer()
+{
+    if (stagingBuffer != 0)
+    {
+        glDeleteBuffers(1, &stagingBuffer);
+        stagingBuffer = 0;
+    }
+}
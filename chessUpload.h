@@ -0,0 +1,47 @@
+/*
+Objective:
+Off-thread BMP decoding and staged (pixel/copy buffer) GL uploads
+*/
+
+#ifndef CHESS_UPLOAD_H
+#define CHESS_UPLOAD_H
+
+#include <string>
+#include <vector>
+// Include GLEW
+#include <GL/glew.h>
+
+// Decoded 24-bit BMP (BGR rows, 4-byte aligned as in the file)
+typedef struct
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+} bmpImageT;
+
+// Read a 24-bit BMP file (any thread, no GL calls)
+// Inputs: file path, image to fill
+// Output: true if decoded
+bool decodeBMP(const std::string& filePath, bmpImageT& image);
+
+// Fill the buffer bound to a target through the staging buffer (GL thread)
+// Inputs: target (GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, ...), data, size in bytes
+// Output: None
+void stagedBufferData(GLenum target, const void* data, size_t size);
+
+// Write part of the buffer bound to a target through the staging buffer (GL thread)
+// Inputs: target (not GL_COPY_READ_BUFFER, the staging buffer uses it), byte offset, data, size in bytes
+// Output: None
+void stagedBufferSubData(GLenum target, size_t offset, const void* data, size_t size);
+
+// Create a mipmapped texture from a decoded BMP through a pixel unpack buffer (GL thread)
+// Inputs: decoded image
+// Output: texture handle
+GLuint stagedTextureBMP(const bmpImageT& image);
+
+// Release the staging buffer
+// Inputs: None
+// Output: None
+void releaseStagingBuffer();
+
+#endif
@@ -21,8 +21,39 @@ using namespace glm;
 // Lab3 specific chess class
 #include "chessComponent.h"
 #include "chessCommon.h"
+#include "chessAnimation.h"
+#include "chessSceneCache.h"
+#include "chessMeshOptimizer.h"
+#include "chessAssetLoader.h"
+#include "chessShaderCache.h"
+#include "chessPicking.h"
+#include "chessCapture.h"
+#include "chessOverlay.h"
+#include "chessHistory.h"
+#include "chessMultiBoard.h"
 #include "ECE_ChessEngine.hpp"
+#include "ECE_ChessPosition.hpp"
+#include "ECE_OpeningBook.hpp"
+#include "ECE_PgnAnalysis.hpp"
+#include "ECE_EnginePool.hpp"
+#include "ECE_SelfPlay.hpp"
+#include "ECE_LatencyHistogram.hpp"
+#include "ECE_Nnue.hpp"
+#include "ECE_Syzygy.hpp"
+#include "ECE_Analysis.hpp"
+#include "ECE_GameClock.hpp"
+#include "ECE_GameRecord.hpp"
+#include "ECE_Broadcast.hpp"
+#include "ECE_ScratchArena.hpp"
+#include "ECE_CommandLine.hpp"
 #include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <future>
+#include <ctime>
+#include <cstring>
 
 // Global light variable
 glm::vec3 lightPos = glm::vec3(0, 0, 15);
@@ -30,11 +61,121 @@ glm::vec3 deathSpawn = glm::vec3( -5.5 * CHESS_BOX_SIZE, -3.5 * CHESS_BOX_SIZE,
 GLfloat lightPower = 400.0;
 
 // Global variables
-std::vector<chessComponent> gchessComponents;
+// Components on screen (owned by the asset loader, appended as they finish loading)
+std::vector<chessComponent*> gchessComponents;
 tModelMap cTModelMap;
-GLuint MatrixID, ViewMatrixID, ModelMatrixID;
+GLuint MatrixID, ViewMatrixID;
 GLuint LightID, LightSwitchID, TextureID;
+// Every mesh lives in one vertex/index arena
+chessGeometryArena gGeometryArena;
 GLuint programID;
+// Program binaries on disk, hot reload while developing shaders
+chessShaderCache gShaderCache;
+
+// Game state on the rules side (moves sent to the engine and book lookups)
+chessPosition gamePosition;
+std::string gameStartFen;   // Empty for the standard start position
+std::string gameMoves;
+// Move list capacity reserved up front (about 800 plies, appending a move stays off the heap)
+const size_t GAME_MOVES_RESERVE = 4096;
+openingBook gOpeningBook;
+// In-process evaluation network (optional, mapped from NNUE_FILE)
+nnueNetwork gNetwork;
+// Endgame tablebases (optional, the engine probes them in its own search)
+syzygyTablebase gTablebase;
+// Snapshot per ply for undo/redo, jumps and variations
+chessHistory gHistory;
+// Binary record of every game (GAME_RECORD_DIR, one file per game)
+gameRecorder gRecorder;
+// Spectator stream ("broadcast on"), and the one this process renders with --watch
+broadcastServer gBroadcast;
+broadcastViewer gViewer;
+bool watchMode = false;
+// Many games tiled in the window ("boards N"), drawn instead of the game board
+chessMultiBoard gMultiBoard;
+
+// Piece animations and the graveyard slots used per side (white, black)
+chessAnimator gAnimator;
+unsigned int capturedCount[2] = { 0, 0 };
+
+// Damage tracking: frames are drawn only when something changed
+unsigned int sceneDamage = DAMAGE_ALL;
+bool renderOnDemand = true;
+// Static board kept offscreen, pieces are drawn over a copy of it
+bool useBoardCache = false;
+chessSceneCache boardCache;
+unsigned long long framesDrawn = 0;
+unsigned long long framesSkipped = 0;
+// Render statistics (triangles of the last drawn frame, total draw time)
+unsigned long long frameTriangles = 0;
+unsigned int frameDrawCalls = 0;
+double frameTimeTotal = 0.0;
+// Scratch memory of the frame loop (rewound every iteration)
+scratchArena gFrameArena(FRAME_ARENA_BYTES);
+// Heap allocations of the last drawn frame and the last move played, and how often either was not zero
+unsigned long long lastFrameAllocations = 0;
+unsigned long long framesWithAllocations = 0;
+unsigned long long lastMoveAllocations = 0;
+unsigned long long movesMeasured = 0;
+unsigned long long movesWithAllocations = 0;
+// "alloc check on": every frame or move that reached the heap is reported
+bool allocationCheck = false;
+// Distance based level of detail for the pieces
+bool lodEnabled = true;
+int viewportHeight = 768;
+// Frames per pass of "render bench"
+const unsigned int RENDER_BENCH_FRAMES = 200;
+// Headless allocation check ("--check-alloc [frames]"): frames drawn, a move every so many frames,
+// and the frames (two moves) left out while containers reach their working size
+const unsigned int ALLOC_CHECK_FRAMES = 300;
+const unsigned int ALLOC_CHECK_MOVE_FRAMES = 20;
+const unsigned int ALLOC_CHECK_WARMUP_FRAMES = 2 * ALLOC_CHECK_MOVE_FRAMES;
+const unsigned int ALLOC_CHECK_MAX_FRAMES = 1000000;
+// Quiet opening played by the check (no captures or castling): white moves are typed through the
+// console queue like the player's, black replies are played the way the bot's are
+const char* const ALLOC_CHECK_MOVES[] = { "e2e4", "e7e5", "g1f3", "b8c6", "f1c4", "g8f6", "d2d3", "f8c5", "c2c3", "d7d6" };
+const unsigned int ALLOC_CHECK_MOVE_COUNT = sizeof(ALLOC_CHECK_MOVES) / sizeof(ALLOC_CHECK_MOVES[0]);
+
+// Console lines queued by the input thread (the frame loop never blocks on stdin)
+std::mutex consoleMutex;
+std::deque<std::string> consoleLines;
+
+// Mouse picking: hover is shown in the title bar, clicks select and move
+chessPicker gPicker;
+latencyHistogram pickLatency;
+double cursorX = 0.0;
+double cursorY = 0.0;
+bool hoverDirty = false;
+std::string hoverLabel;
+std::string selectedPiece;
+std::string selectedSquare;
+
+// Screenshots and video, read back without stalling the frame loop
+chessCapture gCapture;
+// Hidden window (--hidden): frames go to an offscreen target, only capture sees them
+bool hiddenWindow = false;
+
+// Live analysis on a second engine, shown as an eval bar and best-move arrows
+engineAnalysis gAnalysis;
+chessOverlay gOverlay;
+chessShaderCache gOverlayShaders;
+bool analysisEnabled = false;
+// Game state the running search belongs to (restarted when it moves on)
+std::string analysisFen;
+std::string analysisMoves;
+bool analysisRestart = false;
+unsigned long long analysisPositionId = 0;
+// Lines on screen (a newer version redraws the overlay)
+unsigned long long analysisDrawnVersion = 0;
+// Lines last sent to the spectators
+unsigned long long analysisBroadcastVersion = 0;
+// Lines received while watching (drawn in place of local analysis)
+analysisSnapshotT watchedAnalysis;
+// Centipawns at which the eval bar is about three quarters full
+const float ANALYSIS_BAR_SCALE = 400.f;
+// Arrow colour per line rank (best first, the rest share the last)
+const glm::vec4 ANALYSIS_ARROW_COLORS[] = { {0.15f, 0.8f, 0.25f, 0.85f}, {0.95f, 0.75f, 0.1f, 0.7f},
+                                            {0.95f, 0.4f, 0.1f, 0.6f}, {0.7f, 0.7f, 0.7f, 0.5f} };
 
 
 // Sets up the chess board
@@ -42,10 +183,303 @@ GLuint programID;
 //bool movePiece(const std::string& sourceNotation, const std::string& targetNotation, tModelMap& cTModelMap);
 //bool commandChecker(const std::string& command, tModelMap& cTModelMap);
 //bool isThisACapture(const std::string& pieceName, const std::string& targetName, tModelMap& cTModelMap);
-//std::string getPieceAtPosition(const glm::vec3& position, tModelMap& cTModelMap);
+//const std::string& getPieceAtPosition(const glm::vec3& position, tModelMap& cTModelMap);
 
 
-double targetFrameTime = 1.0 / 10.0; // 10 FPS
+// Build the engine "position" command for the current game
+std::string enginePositionCommand()
+{
+    std::string command = gameStartFen.empty() ? "position startpos" : "position fen " + gameStartFen;
+    if (!gameMoves.empty())
+    {
+        command += " moves" + gameMoves;
+    }
+    return command;
+}
+
+// FEN setup timing and an optional engine search on one position
+int fenBenchmarkMain(int argc, char* argv[]);
+// Hand the piece meshes to the multi-board view
+void resolveMultiBoardMeshes();
+
+// Read console commands until stdin closes
+void consoleReader()
+{
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        std::lock_guard<std::mutex> lock(consoleMutex);
+        consoleLines.push_back(line);
+    }
+}
+
+// Take the next queued console command
+// Inputs: line to fill
+// Output: false if nothing was typed yet
+bool nextConsoleLine(std::string& line)
+{
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    if (consoleLines.empty())
+    {
+        return false;
+    }
+    line = consoleLines.front();
+    consoleLines.pop_front();
+    return true;
+}
+
+// Engine reply: best move, the reply it expects from the player and its own search time
+typedef struct
+{
+    std::string move;
+    std::string ponder;
+    long long engineMs;
+    // Score and search time kept with the move in the game record
+    recordEvalT eval;
+} botReplyT;
+
+// Search limits of the bot without a clock (pondering uses the same, in ponder mode)
+const char BOT_GO_COMMAND[] = "go depth 10";
+const char BOT_PONDER_COMMAND[] = "go ponder depth 10";
+// Game clock ("clock 5+3"): the engine gets time limits instead of the fixed depth
+gameClock gClock;
+
+// Search limits for the next bot search
+std::string botGoCommand(bool ponder)
+{
+    if (gClock.isEnabled())
+    {
+        return gClock.goCommand(ponder);
+    }
+    return ponder ? BOT_PONDER_COMMAND : BOT_GO_COMMAND;
+}
+
+// Pondering: the engine searches the expected reply during the player's turn
+typedef struct
+{
+    // This game: replies predicted and guessed right, time waited after a hit
+    unsigned int predictions;
+    unsigned int hits;
+    double hitSeconds;
+    // All games: searches started cold and their time (the saving estimate)
+    unsigned int coldSearches;
+    double coldSeconds;
+} ponderStatsT;
+bool ponderEnabled = true;
+std::future<botReplyT> ponderReply;
+std::string ponderMove;
+ponderStatsT ponderStats = { 0, 0, 0.0, 0, 0.0 };
+
+// Start an engine search on the frame loop, so a later "stop" or "ponderhit"
+// can never reach the engine ahead of the search it is meant for
+void sendSearch(const std::string& positionCommand, const std::string& goCommand)
+{
+    sendMove(positionCommand);
+    sendMove(goCommand);
+}
+
+// Wait for the reply of the search sent last (runs off the frame loop, returns
+// after bestmove, so a ponder search returns once it is hit or stopped)
+botReplyT readBotReply()
+{
+    botReplyT reply;
+    getResponseMove(reply.move, reply.ponder);
+    reply.engineMs = getLastSearchTime();
+    reply.eval.hasScore = getLastSearchScore(reply.eval.score, reply.eval.isMate, reply.eval.depth);
+    reply.eval.engineMs = reply.engineMs;
+    return reply;
+}
+
+// Think on the predicted reply while the player decides
+void startPondering(const botReplyT& reply)
+{
+    if (!ponderEnabled || reply.ponder.empty() || gameMoves.empty())
+    {
+        return;
+    }
+    ponderMove = reply.ponder;
+    ponderStats.predictions++;
+    sendSearch(enginePositionCommand() + " " + ponderMove, botGoCommand(true));
+    ponderReply = std::async(std::launch::async, readBotReply);
+}
+
+// Wrong guess or new position: end the ponder search (its bestmove is dropped)
+void stopPondering()
+{
+    if (ponderReply.valid())
+    {
+        sendMove("stop");
+        ponderReply.get();
+    }
+}
+
+// Ponder hit rate and the time it saved this game
+void reportPondering()
+{
+    if (ponderStats.predictions == 0)
+    {
+        std::cout << "Pondering: no predictions this game" << std::endl;
+        return;
+    }
+    // A hit saves what a cold search takes on average, minus what was still waited
+    double coldAverage = ponderStats.coldSearches ? ponderStats.coldSeconds / ponderStats.coldSearches : 0.0;
+    double saved = ponderStats.hits * coldAverage - ponderStats.hitSeconds;
+    std::cout << "Pondering: " << ponderStats.hits << "/" << ponderStats.predictions << " replies predicted ("
+              << 100.0 * ponderStats.hits / ponderStats.predictions << "%), about " << (saved > 0.0 ? saved : 0.0)
+              << " s saved this game (cold search " << coldAverage << " s)" << std::endl;
+}
+
+// Clock times and how the engine kept to its budgets
+void reportClock()
+{
+    if (!gClock.isEnabled())
+    {
+        std::cout << "Clock off, the bot searches to a fixed depth" << std::endl;
+        return;
+    }
+    clockStatsT stats = gClock.getStats();
+    std::cout << "Clock " << gClock.describe() << ": white " << formatClock(gClock.remaining(true)) << ", black "
+              << formatClock(gClock.remaining(false)) << " (" << (gamePosition.isWhiteToMove() ? "white" : "black")
+              << " to move)" << std::endl;
+    if (stats.replies > 0)
+    {
+        std::cout << "  " << stats.replies << " engine replies, wait avg " << stats.totalLatencyMs / stats.replies
+                  << " ms, max " << stats.maxLatencyMs << " ms, " << stats.stopped << " stopped at the limit" << std::endl;
+    }
+    if (stats.measured > 0)
+    {
+        std::cout << "  Engine overhead avg " << stats.totalOverheadMs / stats.measured << " ms, max " << stats.maxOverheadMs
+                  << " ms (margin now " << gClock.overheadMarginMs() << " ms)" << std::endl;
+    }
+}
+
+
+// Check a move against the rules side (the 3D board only checks how pieces move:
+// not whose turn it is, checks, castling rights or en passant)
+// Inputs: move in UCI notation
+// Output: true if it is one of the legal moves of the game position
+bool isLegalGameMove(const std::string& uciMove)
+{
+    chessMove move = uciToMove(uciMove);
+    chessMove moves[MAX_MOVES];
+    int count = gamePosition.generateLegalMoves(moves);
+    for (int i = 0; i < count; i++)
+    {
+        if (moves[i] == move)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Opening book reply, checked against the legal moves (a bad entry or a key collision goes to the engine)
+// Inputs: move to fill
+// Output: true if the book has a legal move for the game position
+bool bookBotMove(std::string& botResponse)
+{
+    if (!gOpeningBook.probe(gamePosition, botResponse))
+    {
+        return false;
+    }
+    if (!isLegalGameMove(botResponse))
+    {
+        std::cout << "Book move " << botResponse << " is not legal here, asking the engine" << std::endl;
+        return false;
+    }
+    std::cout << "Book move: " << botResponse << std::endl;
+    return true;
+}
+
+// Castling, en passant and promotions move more than one model (the 3D board moves one piece)
+// Inputs: move, before it is played on the game position
+// Output: true if the board has to be set up again after it
+bool movesSeveralModels(chessMove move)
+{
+    int from = moveFrom(move);
+    int to = moveTo(move);
+    unsigned char mover = gamePosition.pieceAt(from) & PIECE_TYPE_MASK;
+    return movePromotion(move) != PIECE_NONE ||
+           (mover == PIECE_KING && std::abs(fileOf(from) - fileOf(to)) == 2) ||
+           (mover == PIECE_PAWN && fileOf(from) != fileOf(to) && gamePosition.pieceAt(to) == PIECE_NONE);
+}
+
+// Promote to a queen when a pawn reaches the last rank with no piece given ("move e7e8")
+// Inputs: command, completed in place
+void completePromotion(std::string& command)
+{
+    if (command.size() != 9 || command.compare(0, 5, "move ") != 0)
+    {
+        return;
+    }
+    int from = notationToSquare(command.substr(5, 2));
+    int to = notationToSquare(command.substr(7, 2));
+    if (from != NO_SQUARE && to != NO_SQUARE && (gamePosition.pieceAt(from) & PIECE_TYPE_MASK) == PIECE_PAWN &&
+        (rankOf(to) == 0 || rankOf(to) == 7))
+    {
+        command += 'q';
+    }
+}
+
+// Set the 3D board up again from the game position (the history keeps its lines)
+void rebuildBoardModels()
+{
+    setupChessBoard(gamePosition, cTModelMap);
+    gHistory.rebind(cTModelMap);
+}
+
+// Keep a ply both boards have played: move list, history, game record and spectators
+// Inputs: move, where it came from (RECORD_BY_*), engine evaluation (nullptr if none)
+void commitPly(const std::string& move, uint8_t source, const recordEvalT* eval)
+{
+    // Appended in place (no temporary string per move)
+    gameMoves += ' ';
+    gameMoves += move;
+    gHistory.record(move, gamePosition, capturedCount, static_cast<unsigned int>(gameMoves.size()));
+    gRecorder.appendMove(uciToMove(move), gamePosition, source, eval);
+    gBroadcast.publishMove(uciToMove(move), gamePosition, source);
+}
+
+// Keep the heap allocations of a move just played
+// Inputs: thread allocation count when the move started
+void recordMoveAllocations(unsigned long long allocationsBefore)
+{
+    lastMoveAllocations = threadAllocations() - allocationsBefore;
+    movesMeasured++;
+    if (lastMoveAllocations > 0)
+    {
+        movesWithAllocations++;
+        if (allocationCheck)
+        {
+            std::cout << "Allocation check: move " << gameMoves.substr(gameMoves.find_last_of(' ') + 1) << " made "
+                      << lastMoveAllocations << " heap allocations" << std::endl;
+        }
+    }
+}
+
+// Play the bot's reply on both boards
+// Inputs: move, where it came from (RECORD_BY_*), engine evaluation (nullptr if none)
+// Output: false if the reply is empty or not legal (nothing is played, the bot is still on the move)
+bool playBotMove(const std::string& botResponse, uint8_t source, const recordEvalT* eval)
+{
+    unsigned long long allocationsBefore = threadAllocations();
+    bool special = movesSeveralModels(uciToMove(botResponse));
+    if (!isLegalGameMove(botResponse) || !gamePosition.applyUciMove(botResponse))
+    {
+        std::cout << "Bot reply \"" << botResponse << "\" is not a legal move here, not played" << std::endl;
+        return false;
+    }
+    // The history snapshot is taken next, the board has to show the move first
+    if (special || !movePiece(botResponse.substr(0, 2), botResponse.substr(2, 2), cTModelMap))
+    {
+        rebuildBoardModels();
+    }
+    commitPly(botResponse, source, eval);
+    recordMoveAllocations(allocationsBefore);
+    return true;
+}
+
+double targetFrameTime = 1.0 / 60.0; // 60 FPS (animations are time based)
 double lastFrameTime = glfwGetTime(); // Initialize with the current time
 
 void waitForNextFrame() {
@@ -53,6 +487,10 @@ void waitForNextFrame() {
     double elapsedTime = currentTime - lastFrameTime;
 
     while (elapsedTime < targetFrameTime) {
+        // Sleep instead of spinning, only the last couple of ms are polled
+        if (targetFrameTime - elapsedTime > 0.002) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
         // Re-check elapsed time to stay in the loop
         currentTime = glfwGetTime();
         elapsedTime = currentTime - lastFrameTime;
@@ -62,56 +500,539 @@ void waitForNextFrame() {
     lastFrameTime = currentTime;
 }
 
-void renderScene() {
-    // Clear the screen
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Pass light intensity to Fragment Shader
-    glUniform1f(LightSwitchID, lightPower);
-
+// Draw the board and/or the pieces
+void drawComponents(bool drawBoard, bool drawPieces) {
     // Compute projection and view matrices
     glm::mat4 ProjectionMatrix = getProjectionMatrix();
     glm::mat4 ViewMatrix = getViewMatrix();
+    glm::mat4 ViewProjectionMatrix = ProjectionMatrix * ViewMatrix;
+
+    // Frame wide uniforms, everything per draw goes through the arena
+    glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &ViewProjectionMatrix[0][0]);
+    glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrix[0][0]);
+    // Pass the light position
+    glUniform3f(LightID, lightPos.x, lightPos.y, lightPos.z);
+    // Set our "myTextureSampler" sampler to use Texture Unit 0
+    glUniform1i(TextureID, 0);
+
+    // Every board in its own tile, each mesh instanced across all of them
+    if (gMultiBoard.isActive()) {
+        gGeometryArena.beginFrame();
+        gMultiBoard.queueFrame(gGeometryArena, ViewMatrix, ProjectionMatrix, viewportHeight, lodEnabled, drawBoard, drawPieces);
+        frameTriangles += gMultiBoard.getStats().triangles;
+        // Tiles clip against their own frustum (the overlay program does not write the distances)
+        for (GLenum plane = 0; plane < 4; plane++) {
+            glEnable(GL_CLIP_DISTANCE0 + plane);
+        }
+        frameDrawCalls += gGeometryArena.submit();
+        for (GLenum plane = 0; plane < 4; plane++) {
+            glDisable(GL_CLIP_DISTANCE0 + plane);
+        }
+        return;
+    }
 
-    // Render all chess game components
+    // Queue all chess game components
+    gGeometryArena.beginFrame();
     for (auto component = gchessComponents.begin(); component != gchessComponents.end(); component++) {
-        tPosition cTPosition = cTModelMap[component->getComponentID()];
+        bool isBoard = (*component)->getComponentID() == BOARD_COMPONENT;
+        if ((isBoard && !drawBoard) || (!isBoard && !drawPieces)) {
+            continue;
+        }
+        tPosition cTPosition = cTModelMap[(*component)->getComponentID()];
 
         // Render multiple instances if required
         for (unsigned int pit = 0; pit < cTPosition.rCnt; pit++) {
-            tPosition cTPositionMorph = cTPosition;
-            if (pit != 0) {
-                cTPositionMorph = cTModelMap[component->getComponentID() + std::to_string(pit)];
+            tPosition& cTPositionMorph = cTModelMap[(*component)->getInstanceKey(pit)];
+
+            // Level of detail from the projected size (hysteresis state kept per instance)
+            unsigned int lod = 0;
+            if (lodEnabled) {
+                glm::vec4 viewPosition = ViewMatrix * glm::vec4(cTPositionMorph.tPos + cTPositionMorph.aOffset, 1.f);
+                float radius = (*component)->getBoundingRadius() * cTPositionMorph.cScale.x;
+                float pixels = (-viewPosition.z > 1e-3f) ? radius * ProjectionMatrix[1][1] / -viewPosition.z * 0.5f * viewportHeight : 1e9f;
+                lod = (*component)->selectLod(pixels, cTPositionMorph.lod);
             }
+            cTPositionMorph.lod = lod;
+            frameTriangles += (*component)->getLodIndexCount(lod) / 3;
 
             // Generate the Model matrix
-            glm::mat4 ModelMatrix = component->genModelMatrix(cTPositionMorph);
-            // Generate the MVP matrix
-            glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
+            glm::mat4 ModelMatrix = (*component)->genModelMatrix(cTPositionMorph);
+            (*component)->queueDraw(gGeometryArena, ModelMatrix, lod);
+        }
+    }
 
-            // Pass matrices to the shader
-            glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-            glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrix[0][0]);
-            glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrix[0][0]);
+    // Sorted by texture and mesh, one multi-draw per texture when supported
+    frameDrawCalls += gGeometryArena.submit();
+}
+
+// Eval bar and arrows from the latest lines of the game position
+// Output: draw calls issued
+unsigned int drawAnalysisOverlay() {
+    const analysisSnapshotT& snapshot = watchMode ? watchedAnalysis : gAnalysis.latest();
+    analysisDrawnVersion = snapshot.linesVersion;
+    gOverlay.clear();
+    // Lines of an earlier position are not shown
+    if (snapshot.positionId != analysisPositionId || snapshot.lineCount == 0) {
+        return 0;
+    }
 
-            // Pass the light position
-            glUniform3f(LightID, lightPos.x, lightPos.y, lightPos.z);
+    // Mate scores fill the bar (mate 0: the side to move is mated)
+    const analysisLineT& best = snapshot.lines[0];
+    float whiteShare;
+    if (best.isMate) {
+        bool sideWins = best.score > 0;
+        whiteShare = (sideWins == snapshot.whiteToMove) ? 1.f : 0.f;
+    }
+    else {
+        float whiteScore = static_cast<float>(snapshot.whiteToMove ? best.score : -best.score);
+        whiteShare = 0.5f + 0.5f * std::tanh(whiteScore / ANALYSIS_BAR_SCALE);
+    }
+    gOverlay.addEvalBar(whiteShare);
+
+    // First move of each line, worst first so the best arrow ends on top
+    const unsigned int colorCount = sizeof(ANALYSIS_ARROW_COLORS) / sizeof(ANALYSIS_ARROW_COLORS[0]);
+    for (unsigned int it = snapshot.lineCount; it-- > 0;) {
+        const analysisLineT& line = snapshot.lines[it];
+        const char* move = line.moves[0];
+        if (line.moveCount == 0 || move[0] < 'a' || move[0] > 'h' || move[1] < '1' || move[1] > '8' ||
+            move[2] < 'a' || move[2] > 'h' || move[3] < '1' || move[3] > '8') {
+            continue;
+        }
+        glm::vec3 from = squareToBoardPosition(squareOf(move[0] - 'a', move[1] - '1'));
+        glm::vec3 to = squareToBoardPosition(squareOf(move[2] - 'a', move[3] - '1'));
+        float width = CHESS_BOX_SIZE * (it == 0 ? 0.22f : 0.14f);
+        gOverlay.addArrow(from, to, width, ANALYSIS_ARROW_COLORS[it < colorCount ? it : colorCount - 1]);
+    }
+    return gOverlay.draw(getProjectionMatrix() * getViewMatrix());
+}
 
-            // Bind and set up the texture
-            component->setupTexture(TextureID);
+// Evaluation of a line for the console, from white's view ("+0.31", "#-3")
+std::string formatAnalysisScore(const analysisLineT& line, bool whiteToMove) {
+    int score = whiteToMove ? line.score : -line.score;
+    char text[32];
+    if (line.isMate) {
+        snprintf(text, sizeof(text), "#%d", score);
+    }
+    else {
+        snprintf(text, sizeof(text), "%+.2f", score / 100.0);
+    }
+    return text;
+}
 
-            // Render the mesh
-            component->renderMesh();
+// Engine throughput, depth over time and the current lines
+void reportAnalysis() {
+    const analysisSnapshotT& snapshot = gAnalysis.latest();
+    if (!analysisEnabled || snapshot.positionId != analysisPositionId) {
+        std::cout << "Analysis " << (analysisEnabled ? "starting" : "off") << std::endl;
+        return;
+    }
+    std::cout << "Analysis: depth " << snapshot.depth << ", " << snapshot.nps / 1000 << " knps, " << snapshot.nodes
+              << " nodes in " << snapshot.timeMs / 1000.0 << " s, hash " << snapshot.hashfull / 10.0 << "% full, "
+              << gAnalysis.getInfoLines() << " info lines parsed" << std::endl;
+    for (unsigned int it = 0; it < snapshot.lineCount; it++) {
+        const analysisLineT& line = snapshot.lines[it];
+        std::cout << "  " << it + 1 << ". " << formatAnalysisScore(line, snapshot.whiteToMove)
+                  << (line.bound == BOUND_LOWER ? "+" : (line.bound == BOUND_UPPER ? "-" : "")) << " d" << line.depth;
+        for (unsigned int mit = 0; mit < line.moveCount; mit++) {
+            std::cout << " " << line.moves[mit];
         }
+        std::cout << std::endl;
+    }
+    std::cout << "  Depth over time:";
+    for (unsigned int depth = 1; depth < ANALYSIS_MAX_DEPTH; depth++) {
+        if (snapshot.depthTimeMs[depth] >= 0) {
+            std::cout << " d" << depth << "=" << snapshot.depthTimeMs[depth] << "ms";
+        }
+    }
+    std::cout << std::endl;
+}
+
+void renderScene() {
+    // Pieces moved or were set up: the picking index follows
+    if (sceneDamage & DAMAGE_PIECES) {
+        gPicker.invalidate();
+    }
+
+    // Static scene: keep the last frame on screen
+    if (renderOnDemand && sceneDamage == DAMAGE_NONE) {
+        framesSkipped++;
+        // Video keeps its frame rate with the frame still on screen
+        if (gCapture.isActive()) {
+            gCapture.repeatFrame();
+        }
+        glfwPollEvents();
+        return;
+    }
+
+    double drawStart = glfwGetTime();
+    unsigned long long allocationsBefore = threadAllocations();
+    frameTriangles = 0;
+    frameDrawCalls = 0;
+
+    // Pass light intensity to Fragment Shader
+    glUniform1f(LightSwitchID, lightPower);
+
+    // Frames go to the window, or to the offscreen target when the window is hidden
+    GLuint frameTarget = gCapture.getOffscreenFramebuffer();
+    if (useBoardCache && boardCache.isValid()) {
+        // Board only re-rendered for camera/light/size changes
+        if (sceneDamage & DAMAGE_BOARD) {
+            boardCache.bindForDrawing();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawComponents(true, false);
+        }
+        // Pieces are drawn over the copy in the frame target (left bound by the blit)
+        if (boardCache.blitToScreen(frameTarget)) {
+            drawComponents(false, true);
+        }
+        else {
+            // Window format cannot take the copy, draw everything from now on
+            std::cout << "Board cache unsupported by this framebuffer, disabled" << std::endl;
+            boardCache.destroy();
+            useBoardCache = false;
+            glBindFramebuffer(GL_FRAMEBUFFER, frameTarget);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawComponents(true, true);
+        }
+    }
+    else {
+        // Clear the screen (the offscreen target when the window is hidden)
+        glBindFramebuffer(GL_FRAMEBUFFER, frameTarget);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawComponents(true, true);
+    }
+    // Engine lines over the finished scene (of the game board only)
+    if ((analysisEnabled || watchMode) && !gMultiBoard.isActive()) {
+        frameDrawCalls += drawAnalysisOverlay();
+    }
+    sceneDamage = DAMAGE_NONE;
+    framesDrawn++;
+
+    // Queue the readback before the swap, it is collected frames later
+    if (gCapture.isActive()) {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        gCapture.readFrame(gCapture.getOffscreenFramebuffer(), width, height);
     }
 
     // Swap buffers and poll events
     glfwSwapBuffers(window);
+    frameTimeTotal += glfwGetTime() - drawStart;
     glfwPollEvents();
 
+    // A drawn frame is expected to stay off the heap
+    lastFrameAllocations = threadAllocations() - allocationsBefore;
+    if (lastFrameAllocations > 0) {
+        framesWithAllocations++;
+        if (allocationCheck) {
+            std::cout << "Allocation check: frame " << framesDrawn << " made " << lastFrameAllocations
+                      << " heap allocations" << std::endl;
+        }
+    }
+
+}
+
+// Window resized: new viewport, cache and a full redraw
+void framebufferSizeCallback(GLFWwindow* cWindow, int width, int height) {
+    glViewport(0, 0, width, height);
+    viewportHeight = height;
+    if (useBoardCache) {
+        boardCache.create(width, height);
+    }
+    sceneDamage = DAMAGE_ALL;
+}
+
+// Vertex memory with quantized attributes against the float layout
+void reportMeshMemory() {
+    size_t packedBytes = 0;
+    size_t floatBytes = 0;
+    for (auto cit = gchessComponents.begin(); cit != gchessComponents.end(); cit++) {
+        size_t indexBytes = (*cit)->getIndexCount() * sizeof(unsigned short);
+        packedBytes += (*cit)->getVertexCount() * sizeof(packedVertexT) + indexBytes;
+        floatBytes += (*cit)->getVertexCount() * (2 * sizeof(glm::vec3) + sizeof(glm::vec2)) + indexBytes;
+    }
+    std::cout << "Mesh memory: " << packedBytes / 1024 << " KB on the GPU (" << floatBytes / 1024
+              << " KB as floats), CPU copies released" << std::endl;
+}
+
+// Use the program and look up its uniforms (again after a shader reload)
+void setupProgram() {
+    // Use our shader (Not changing the shader per chess component)
+    glUseProgram(programID);
+
+    // Get a handle for our "VP" uniform (model matrices are per draw attributes)
+    MatrixID = glGetUniformLocation(programID, "VP");
+    ViewMatrixID = glGetUniformLocation(programID, "V");
+
+    // Get a handle for our "myTextureSampler" uniform
+    TextureID = glGetUniformLocation(programID, "myTextureSampler");
+
+    // Get a handle for our "lightToggleSwitch" uniform
+    LightSwitchID = glGetUniformLocation(programID, "lightIntensity");
+
+    // Get a handle for our "LightPosition" uniform
+    LightID = glGetUniformLocation(programID, "LightPosition_worldspace");
+}
+
+// Pick under the cursor (timed)
+pickResultT pickUnderCursor() {
+    double start = glfwGetTime();
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+    pickResultT result = gPicker.pick(cursorX, cursorY, width, height, getViewMatrix(), getProjectionMatrix(),
+                                      cTModelMap, gchessComponents);
+    pickLatency.record(1000.0 * (glfwGetTime() - start));
+    return result;
 }
 
-int main(void) {
+// Drop the selected piece back onto its square
+void clearSelection() {
+    if (!selectedPiece.empty()) {
+        cTModelMap[selectedPiece].aOffset.z = 0.f;
+        sceneDamage |= DAMAGE_PIECES;
+    }
+    selectedPiece.clear();
+    selectedSquare.clear();
+}
+
+// Put the board, rules position and graveyards back as the history cursor has them
+void showHistorySnapshot() {
+    gAnimator.clear();
+    clearSelection();
+    const positionSnapshotT& snapshot = gHistory.apply();
+    gamePosition = snapshot.position;
+    if (gHistory.isBound(snapshot)) {
+        capturedCount[0] = snapshot.captured[0];
+        capturedCount[1] = snapshot.captured[1];
+    }
+    else {
+        // Taken before the board was last rebuilt: set up from the rules position
+        rebuildBoardModels();
+    }
+    sceneDamage |= DAMAGE_PIECES;
+}
+
+// Show another ply of the current line (the engine's ponder search is for the old one)
+bool jumpToPly(unsigned int ply) {
+    stopPondering();
+    if (!gHistory.seek(ply, gameMoves)) {
+        return false;
+    }
+    showHistorySnapshot();
+    gRecorder.jump(gamePosition);
+    gBroadcast.publishPosition(gamePosition);
+    return true;
+}
+
+// New game from a position on both boards (a new record file is started)
+void newGameFrom(const chessPosition& position) {
+    stopPondering();
+    reportPondering();
+    ponderStats.predictions = ponderStats.hits = 0;
+    ponderStats.hitSeconds = 0.0;
+    gamePosition = position;
+    gameStartFen = position.toFen();
+    gameMoves.clear();
+    gClock.reset(gamePosition.isWhiteToMove());
+    setupChessBoard(gamePosition, cTModelMap);
+    gHistory.reset(cTModelMap, gamePosition);
+    gRecorder.open(GAME_RECORD_DIR, gamePosition);
+    gBroadcast.publishPosition(gamePosition);
+}
+
+// Commands that change the game (a viewer only shows the broadcast one)
+bool isGameCommand(const std::string& command) {
+    const char* prefixes[] = { "move ", "fen ", "undo", "redo", "ply ", "variation ", "replay " };
+    for (const char* prefix : prefixes) {
+        if (command.compare(0, std::strlen(prefix), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Watching: play the received frames on the board (snapshots rebuild it, moves animate)
+void applyBroadcastFrames() {
+    broadcastEventT event;
+    while (gViewer.poll(event)) {
+        if (event.type == BROADCAST_SNAPSHOT) {
+            gamePosition = event.position;
+            rebuildBoardModels();
+        }
+        else if (event.type == BROADCAST_MOVE) {
+            chessMove move = event.move.move;
+            // Castling, en passant and promotions move more than one model: the board is rebuilt
+            bool special = movesSeveralModels(move);
+            if (!gamePosition.applyMove(move)) {
+                // Out of step: the next snapshot puts it right
+                continue;
+            }
+            std::string uciMove = moveToUci(move);
+            if (special || !movePiece(uciMove.substr(0, 2), uciMove.substr(2, 2), cTModelMap)) {
+                rebuildBoardModels();
+            }
+        }
+        else if (event.type == BROADCAST_ANALYSIS) {
+            watchedAnalysis.positionId = analysisPositionId;
+            watchedAnalysis.whiteToMove = event.analysis.whiteToMove != 0;
+            watchedAnalysis.lineCount = event.analysis.lineCount;
+            for (unsigned int it = 0; it < watchedAnalysis.lineCount; it++) {
+                const broadcastLineT& line = event.analysis.lines[it];
+                analysisLineT& shown = watchedAnalysis.lines[it];
+                shown.score = line.score;
+                shown.isMate = line.isMate != 0;
+                shown.depth = line.depth;
+                shown.moveCount = line.move != NO_MOVE ? 1 : 0;
+                snprintf(shown.moves[0], sizeof(shown.moves[0]), "%s", moveToUci(line.move).c_str());
+            }
+            sceneDamage |= DAMAGE_OVERLAY;
+            continue;
+        }
+        // Lines of the previous position come off the board
+        analysisPositionId++;
+        sceneDamage |= DAMAGE_OVERLAY;
+    }
+}
+
+// Moves of the current line around the cursor, and the variations kept
+void reportHistory() {
+    std::cout << "Ply " << gHistory.getPly() << " of " << gHistory.getLastPly() << " (variation " << gHistory.getVariation()
+              << ", " << gHistory.getSnapshotCount() << " snapshots):";
+    for (unsigned int ply = gHistory.getFirstPly() + 1; ply <= gHistory.getLastPly(); ply++) {
+        std::cout << (ply == gHistory.getPly() + 1 ? " |" : "") << " " << gHistory.at(ply).move;
+    }
+    std::cout << std::endl;
+    for (unsigned int it = 0; it < HISTORY_MAX_VARIATIONS; it++) {
+        if (gHistory.hasVariation(it) && it != gHistory.getVariation()) {
+            std::cout << "  variation " << it << " kept" << std::endl;
+        }
+    }
+}
+
+// Arrow keys scrub through the game (held keys repeat), Home/End jump to its ends
+void keyCallback(GLFWwindow* cWindow, int key, int scancode, int action, int mods) {
+    if (action != GLFW_PRESS && action != GLFW_REPEAT) {
+        return;
+    }
+    const char* command = nullptr;
+    switch (key) {
+    case GLFW_KEY_LEFT: command = "undo"; break;
+    case GLFW_KEY_RIGHT: command = "redo"; break;
+    case GLFW_KEY_HOME: command = "ply 0"; break;
+    case GLFW_KEY_END: command = "ply end"; break;
+    default: return;
+    }
+    // Same queue as typed commands, so nothing moves while the bot is thinking
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    consoleLines.push_back(command);
+}
+
+// Cursor moved: the hover pick runs once per frame
+void cursorPosCallback(GLFWwindow* cWindow, double x, double y) {
+    cursorX = x;
+    cursorY = y;
+    hoverDirty = true;
+}
+
+// Left click selects a piece then its target square, right click cancels
+void mouseButtonCallback(GLFWwindow* cWindow, int button, int action, int mods) {
+    if (action != GLFW_PRESS) {
+        return;
+    }
+    if (button == GLFW_MOUSE_BUTTON_RIGHT) {
+        clearSelection();
+        return;
+    }
+    // Tiled boards are watched, not played
+    if (button != GLFW_MOUSE_BUTTON_LEFT || gMultiBoard.isActive()) {
+        return;
+    }
+    pickResultT hit = pickUnderCursor();
+    if (hit.square.empty()) {
+        clearSelection();
+        return;
+    }
+
+    // A piece with nothing selected, or one of the same side, becomes the selection
+    if (!hit.piece.empty() && (selectedPiece.empty() || cTModelMap[hit.piece].player == cTModelMap[selectedPiece].player)) {
+        bool reselect = hit.piece != selectedPiece;
+        clearSelection();
+        if (reselect) {
+            selectedPiece = hit.piece;
+            selectedSquare = hit.square;
+            cTModelMap[selectedPiece].aOffset.z = PICK_LIFT;
+            sceneDamage |= DAMAGE_PIECES;
+            std::cout << "Selected " << selectedSquare << std::endl;
+        }
+        return;
+    }
+    if (selectedPiece.empty()) {
+        return;
+    }
+
+    // Target square: goes through the same queue as a typed move
+    std::string command = "move " + selectedSquare + hit.square;
+    clearSelection();
+    std::cout << command << std::endl;
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    consoleLines.push_back(command);
+}
+
+// Window uncovered or restored: the OS needs the frame again
+void windowRefreshCallback(GLFWwindow* cWindow) {
+    sceneDamage = DAMAGE_ALL;
+}
+
+int main(int argc, char* argv[]) {
+    // Headless batch modes (no window, no interactive engine)
+    if (argc > 1 && (std::string(argv[1]) == "--analyze" || std::string(argv[1]) == "--bench-pgn"))
+    {
+        return pgnAnalysisMain(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-fen")
+    {
+        return fenBenchmarkMain(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--selfplay")
+    {
+        return selfPlayMain(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-nnue")
+    {
+        return nnueBenchmarkMain(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--replay")
+    {
+        return gameReplayMain(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-broadcast")
+    {
+        return broadcastBenchmarkMain(argc, argv);
+    }
+    // Draws and moves that must stay off the heap, hidden and without the engine (exit code 1 if any allocates)
+    bool allocCheckMode = argc > 1 && std::string(argv[1]) == "--check-alloc";
+    unsigned long allocCheckFrames = ALLOC_CHECK_FRAMES;
+    if (allocCheckMode && argc > 2 && !parseBoundedNumber(argv[2], ALLOC_CHECK_WARMUP_FRAMES + 1, ALLOC_CHECK_MAX_FRAMES, allocCheckFrames))
+    {
+        std::cerr << "Usage: Lab3 --check-alloc [frames (" << ALLOC_CHECK_WARMUP_FRAMES + 1 << ".." << ALLOC_CHECK_MAX_FRAMES
+                  << ")]" << std::endl;
+        return -1;
+    }
+    // Rendering without a visible window (commands from stdin, output through capture)
+    hiddenWindow = argc > 1 && (std::string(argv[1]) == "--hidden" || allocCheckMode);
+    // Rendering a broadcast game ("--watch [port]"): no engine, no local moves
+    watchMode = argc > 1 && std::string(argv[1]) == "--watch";
+    unsigned long watchPort = BROADCAST_PORT;
+    if (watchMode && argc > 2 && !parseBoundedNumber(argv[2], 1, 65535, watchPort))
+    {
+        std::cerr << "Usage: Lab3 --watch [port (1..65535)]" << std::endl;
+        return -1;
+    }
+    if (watchMode && !gViewer.connect(static_cast<unsigned short>(watchPort)))
+    {
+        return -1;
+    }
+
     // Initialize GLFW
     if (!glfwInit())
     {
@@ -125,6 +1046,7 @@ int main(void) {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make macOS happy; should not be needed
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, hiddenWindow ? GL_FALSE : GL_TRUE);
 
     // Open a window and create its OpenGL context
     window = glfwCreateWindow(1024, 768, "Game Of Chess 3D", NULL, NULL);
@@ -145,10 +1067,29 @@ int main(void) {
         return -1;
     }
 
+    // A hidden window has no reliable back buffer, draw offscreen at the window size
+    if (hiddenWindow)
+    {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        if (!gCapture.createOffscreen(width, height))
+        {
+            std::cout << "Program failed to create the offscreen target, please CHECK!" << std::endl;
+            return -1;
+        }
+    }
+
+    // Redraw on resize and expose (render-on-demand)
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSetWindowRefreshCallback(window, windowRefreshCallback);
+
     // Ensure we can capture the escape key being pressed below
     glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
-    // Hide the mouse and enable unlimited movement
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    // Visible cursor for picking (the camera is set by commands)
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    glfwSetCursorPosCallback(window, cursorPosCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    glfwSetKeyCallback(window, keyCallback);
 
     // Set the mouse at the center of the screen
     glfwPollEvents();
@@ -169,144 +1110,910 @@ int main(void) {
     glGenVertexArrays(1, &VertexArrayID);
     glBindVertexArray(VertexArrayID);
 
-    // Create and compile our GLSL program from the shaders
-     programID = LoadShaders("StandardShading.vertexshader", "StandardShading.fragmentshader");
-
-    // Get a handle for our "MVP" uniform
-     MatrixID = glGetUniformLocation(programID, "MVP");
-     ViewMatrixID = glGetUniformLocation(programID, "V");
-     ModelMatrixID = glGetUniformLocation(programID, "M");
-
-    // Get a handle for our "myTextureSampler" uniform
-     TextureID = glGetUniformLocation(programID, "myTextureSampler");
-
-    // Get a handle for our "lightToggleSwitch" uniform
-     LightSwitchID = glGetUniformLocation(programID, "lightIntensity");
-
-
-    // Create a vector of chess components class
-    // Each component is fully self sufficient
-
-    // Load the OBJ files
-    bool cBoard = loadAssImpLab3("Lab3/Stone_Chess_Board/12951_Stone_Chess_Board_v1_L3.obj", gchessComponents);
-    bool cComps = loadAssImpLab3("Lab3/Chess/chess-mod.obj", gchessComponents);
+    // Create our GLSL program from the shaders (stored binary when the sources and driver match)
+     programID = gShaderCache.load("StandardShading.vertexshader", "StandardShading.fragmentshader");
+    if (programID == 0)
+    {
+        std::cout << "Program failed due to shader build failure, please CHECK!" << std::endl;
+        return -1;
+    }
+    std::cout << "Shader program " << (gShaderCache.loadedFromCache() ? "loaded from the binary cache" : "compiled from source")
+              << " in " << 1000.0 * gShaderCache.loadSeconds() << " ms" << std::endl;
+    setupProgram();
+    // Analysis overlay (eval bar and arrows in one draw), optional
+    GLuint overlayProgram = gOverlayShaders.load("Overlay.vertexshader", "Overlay.fragmentshader");
+    if (overlayProgram == 0 || !gOverlay.create(overlayProgram))
+    {
+        std::cout << "Overlay shaders failed, analysis is reported on the console only" << std::endl;
+    }
 
-    // Proceed if OBJ loading is successful
-    if (!cBoard || !cComps)
+    // Shared mesh buffers, filled as the loader finishes components
+    if (!gGeometryArena.create())
     {
-        // Quit the program (Failed OBJ loading)
-        std::cout << "Program failed due to OBJ loading failure, please CHECK!" << std::endl;
+        std::cout << "Program failed to create the geometry buffers, please CHECK!" << std::endl;
         return -1;
     }
+    std::cout << "Draw submission: " << (gGeometryArena.isIndirect() ? "multi-draw indirect" : "base vertex draws (GL 3.3)") << std::endl;
+
+    // Load the OBJ files in the background, components appear as their uploads finish
+    // Each component is fully self sufficient
+    // glfwGetTime counts from glfwInit, so this is also the startup time
+    double loadStart = glfwGetTime();
+    double firstComponentTime = 0.0;
+    chessAssetLoader assetLoader;
+    assetLoader.start({ "Lab3/Stone_Chess_Board/12951_Stone_Chess_Board_v1_L3.obj", "Lab3/Chess/chess-mod.obj" });
+    bool assetsLoading = true;
 
     // Setup the Chess board locations
     setupChessBoard(cTModelMap);
-
-    // Load it into a VBO (One time activity)
-    // Run through all the components for rendering
-    for (auto cit = gchessComponents.begin(); cit != gchessComponents.end(); cit++)
+    gHistory.reset(cTModelMap, gamePosition);
+    if (!watchMode && !allocCheckMode)
     {
-        // Setup VBO buffers
-        cit->setupGLBuffers();
-        // Setup Texture
-        cit->setupTextureBuffers();
+        gRecorder.open(GAME_RECORD_DIR, gamePosition);
     }
 
-    // Use our shader (Not changing the shader per chess component)
-    glUseProgram(programID);
-
-    // Get a handle for our "LightPosition" uniform
-     LightID = glGetUniformLocation(programID, "LightPosition_worldspace");
-
     // Input for chess player
     std::string input;
     std::string botResponse;
+    std::future<botReplyT> botReply;
+    // Reply comes from a ponder hit, and when it was asked for
+    bool botReplyPondered = false;
+    double botRequestTime = 0.0;
+    // Under a clock the search is stopped at this wait (ms)
+    long long botLimitMs = 0;
+    bool botStopSent = false;
     // Initialize camera angle
     computeMatricesFromInputFinal(45, 270, 45);
     bool readyForBot = false;
 
-    // Setup the bot
-    InitializeEngine();
+    // Setup the bot (a viewer only renders what it is sent)
+    bool watchEnded = false;
+    if (!watchMode && !allocCheckMode)
+    {
+        InitializeEngine();
+        sendMove("setoption name Ponder value true");
+        // Opening book is optional, the engine answers everything without it
+        gOpeningBook.open(BOOK_FILE);
+        // So is the network, "eval" reports it for the game position
+        gNetwork.load(NNUE_FILE);
+        // The engine probes the tablebases in its own search
+        if (gTablebase.init(SYZYGY_DIR) > 0)
+        {
+            std::cout << "Tablebases: up to " << gTablebase.getMaxPieces() << " pieces" << std::endl;
+            sendMove("setoption name SyzygyPath value " + gTablebase.getPaths());
+        }
+    }
+
+    // Room for a long game (clear() keeps it)
+    gameMoves.reserve(GAME_MOVES_RESERVE);
+
+    // Console input is read on its own thread
+    std::thread(consoleReader).detach();
+    std::cout << "Please enter a command: " << std::flush;
+    double previousTime = glfwGetTime();
+    // Allocation check progress once the scene is loaded, and its exit code
+    unsigned int allocCheckFrame = 0;
+    unsigned int allocCheckMove = 0;
+    unsigned long long allocCheckFirstFrame = 0;
+    int allocCheckResult = 0;
+    allocationCheck = allocCheckMode;
 
     // Main rendering loop
     do {
-        // Call the render helper function
+        // Everything the last iteration took from the frame arena is handed back
+        gFrameArena.reset();
+
+        // Upload what the loader threads finished, a few milliseconds per frame
+        if (assetsLoading)
+        {
+            if (assetLoader.hasFailed())
+            {
+                // Quit the program (Failed OBJ loading)
+                std::cout << "Program failed due to OBJ loading failure, please CHECK!" << std::endl;
+                return -1;
+            }
+            if (assetLoader.pump(gchessComponents, gGeometryArena, ASSET_UPLOAD_BUDGET) > 0)
+            {
+                if (firstComponentTime == 0.0)
+                {
+                    firstComponentTime = glfwGetTime();
+                }
+                if (gMultiBoard.isActive())
+                {
+                    resolveMultiBoardMeshes();
+                }
+                sceneDamage = DAMAGE_ALL;
+            }
+            if (assetLoader.isDone())
+            {
+                assetsLoading = false;
+                assetLoader.stop();
+                releaseStagingBuffer();
+                reportMeshMemory();
+                std::cout << "Scene loaded in " << glfwGetTime() - loadStart << " s (first component on screen after "
+                          << firstComponentTime << " s from start)" << std::endl;
+            }
+        }
+
+        // Development: rebuild the program when a shader file is saved
+        if (gShaderCache.isWatching())
+        {
+            GLuint reloaded = gShaderCache.pollReload();
+            if (reloaded != 0)
+            {
+                glDeleteProgram(programID);
+                programID = reloaded;
+                setupProgram();
+                sceneDamage = DAMAGE_ALL;
+            }
+        }
+
+        // Hand finished readbacks to the capture writer
+        gCapture.poll();
+
+        // Flag fall is announced once, the game itself goes on
+        bool flaggedWhite;
+        if (gClock.checkFlag(flaggedWhite))
+        {
+            std::cout << (flaggedWhite ? "White" : "Black") << " ran out of time" << std::endl;
+        }
+
+        // Analysis follows the game, the overlay redraws when its lines change
+        if (analysisEnabled)
+        {
+            if (analysisRestart || gameMoves != analysisMoves || gameStartFen != analysisFen)
+            {
+                analysisRestart = false;
+                analysisMoves = gameMoves;
+                analysisFen = gameStartFen;
+                gAnalysis.analyze(enginePositionCommand(), ++analysisPositionId, gamePosition.isWhiteToMove());
+                sceneDamage |= DAMAGE_OVERLAY;
+            }
+            if (gAnalysis.latest().linesVersion != analysisDrawnVersion)
+            {
+                sceneDamage |= DAMAGE_OVERLAY;
+            }
+            // Spectators get the lines as they change, at most once per frame
+            const analysisSnapshotT& lines = gAnalysis.latest();
+            if (gBroadcast.isRunning() && lines.linesVersion != analysisBroadcastVersion && lines.positionId == analysisPositionId)
+            {
+                analysisBroadcastVersion = lines.linesVersion;
+                gBroadcast.publishAnalysis(lines);
+            }
+        }
+
+        // Watching: the broadcast plays the game
+        if (watchMode)
+        {
+            applyBroadcastFrames();
+            if (!watchEnded && !gViewer.isConnected())
+            {
+                watchEnded = true;
+                std::cout << "Broadcast ended" << std::endl;
+            }
+        }
+
+        // Square and piece under the cursor in the title bar
+        if (hoverDirty && !gMultiBoard.isActive())
+        {
+            hoverDirty = false;
+            pickResultT hover = pickUnderCursor();
+            // Title built in the frame arena, only a new label is kept
+            std::pmr::string title("Game Of Chess 3D", &gFrameArena);
+            if (!hover.square.empty())
+            {
+                title += " - ";
+                title += hover.square;
+                if (!hover.piece.empty())
+                {
+                    title += ' ';
+                    title += hover.piece;
+                }
+            }
+            if (hoverLabel.compare(0, std::string::npos, title.data(), title.size()) != 0)
+            {
+                hoverLabel.assign(title.data(), title.size());
+                glfwSetWindowTitle(window, title.c_str());
+            }
+        }
+
+        // Allocation check: a full redraw every frame and a move every few, counted after the warm-up
+        if (allocCheckMode && !assetsLoading)
+        {
+            if (allocCheckFrame == ALLOC_CHECK_WARMUP_FRAMES)
+            {
+                framesWithAllocations = 0;
+                movesMeasured = 0;
+                movesWithAllocations = 0;
+                allocCheckFirstFrame = framesDrawn;
+            }
+            if (allocCheckFrame == allocCheckFrames)
+            {
+                unsigned long long framesChecked = framesDrawn - allocCheckFirstFrame;
+                std::cout << "Allocation check: " << framesWithAllocations << " of " << framesChecked
+                          << " frames and " << movesWithAllocations << " of " << movesMeasured << " moves reached the heap"
+                          << std::endl;
+                allocCheckResult = (framesWithAllocations > 0 || movesWithAllocations > 0) ? 1 : 0;
+                std::cout << (allocCheckResult == 0 ? "PASS" : "FAIL") << std::endl;
+                break;
+            }
+            if (allocCheckFrame % ALLOC_CHECK_MOVE_FRAMES == 0 && allocCheckMove < ALLOC_CHECK_MOVE_COUNT)
+            {
+                if (allocCheckMove % 2 == 0)
+                {
+                    // Taken by the input handling below, the same path as a typed "move e2e4"
+                    std::lock_guard<std::mutex> lock(consoleMutex);
+                    consoleLines.push_back(std::string("move ") + ALLOC_CHECK_MOVES[allocCheckMove++]);
+                }
+                else
+                {
+                    playBotMove(ALLOC_CHECK_MOVES[allocCheckMove++], RECORD_BY_ENGINE, nullptr);
+                }
+            }
+            allocCheckFrame++;
+            sceneDamage = DAMAGE_ALL;
+        }
+
+        // Advance animations by the wall clock, then draw
+        double currentTime = glfwGetTime();
+        if (gAnimator.update(currentTime - previousTime))
+        {
+            sceneDamage |= DAMAGE_PIECES;
+        }
+        if (gMultiBoard.update(currentTime))
+        {
+            sceneDamage |= DAMAGE_PIECES;
+        }
+        previousTime = currentTime;
         renderScene();
+        waitForNextFrame();
+
+        // Queued commands wait until the bot has replied
+        if (botReply.valid())
+        {
+            if (botReply.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                // Bounded reply: past its limit the search ends with the best move so far
+                if (gClock.isEnabled() && !botStopSent && 1000.0 * (glfwGetTime() - botRequestTime) > botLimitMs)
+                {
+                    sendMove("stop");
+                    botStopSent = true;
+                    gClock.recordStop();
+                }
+                continue;
+            }
+            botReplyT reply = botReply.get();
+            double latency = glfwGetTime() - botRequestTime;
+            gClock.recordReply(1000.0 * latency, reply.engineMs, botReplyPondered);
+            if (botReplyPondered)
+            {
+                ponderStats.hits++;
+                ponderStats.hitSeconds += latency;
+                std::cout << "Ponder hit, reply after " << 1000.0 * latency << " ms" << std::endl;
+            }
+            else
+            {
+                ponderStats.coldSearches++;
+                ponderStats.coldSeconds += latency;
+            }
+            // The clock only changes sides once the reply is on the board
+            if (playBotMove(reply.move, RECORD_BY_ENGINE, &reply.eval))
+            {
+                gClock.press();
+                startPondering(reply);
+            }
+            std::cout << "Please enter a command: " << std::flush;
+        }
 
         // Input handling
-        std::cout << "Please enter a command: ";
-        std::getline(std::cin, input);
+        if (!nextConsoleLine(input))
+        {
+            continue;
+        }
+        if (watchMode && isGameCommand(input))
+        {
+            std::cout << "Watching a broadcast, the game is played elsewhere" << std::endl;
+            std::cout << "Please enter a command: " << std::flush;
+            continue;
+        }
+        unsigned long long moveAllocationsBefore = threadAllocations();
+        completePromotion(input);
         readyForBot = commandChecker(input, cTModelMap);
+        bool playerSpecial = readyForBot && movesSeveralModels(uciToMove(input.substr(5)));
+        if (readyForBot && (!isLegalGameMove(input.substr(5)) || !gamePosition.applyUciMove(input.substr(5))))
+        {
+            // The board took it but the rules side did not: the last snapshot puts the pieces back
+            std::cout << "Move rejected for this position, board restored" << std::endl;
+            showHistorySnapshot();
+            readyForBot = false;
+        }
         if (readyForBot)
         {
-            sendMove("position startpos moves e2e4");
-            sendMove("go depth 10");
-            std::cout << getResponseMove(botResponse);
+            if (playerSpecial)
+            {
+                rebuildBoardModels();
+            }
+            // Record the player's move ("move e2e4", "move e7e8q")
+            std::string playerMove = input.substr(5);
+            commitPly(playerMove, RECORD_BY_PLAYER, nullptr);
+            recordMoveAllocations(moveAllocationsBefore);
+            gClock.press();
+            // The allocation check plays the replies itself (no engine is started)
+            if (allocCheckMode)
+            {
+                continue;
+            }
+
+            botRequestTime = glfwGetTime();
+            botLimitMs = gClock.moveLimitMs();
+            botStopSent = false;
+            botReplyPondered = ponderReply.valid() && playerMove == ponderMove;
+            if (!botReplyPondered)
+            {
+                stopPondering();
+            }
+
+            if (botReplyPondered)
+            {
+                // Predicted: the engine has been searching this position already
+                sendMove("ponderhit");
+                botReply = std::move(ponderReply);
+            }
+            // Book replies skip the engine round-trip (one that cannot be played falls through)
+            else if (bookBotMove(botResponse) && playBotMove(botResponse, RECORD_BY_BOOK, nullptr))
+            {
+                gClock.press();
+            }
+            else
+            {
+                sendSearch(enginePositionCommand(), botGoCommand(false));
+                botReply = std::async(std::launch::async, readBotReply);
+            }
+        }
+        if (!botReply.valid())
+        {
+            std::cout << "Please enter a command: " << std::flush;
         }
 
     } while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
         glfwWindowShouldClose(window) == 0);
 
+    // Finish the capture files before leaving
+    gCapture.stop();
+    gAnalysis.close();
+    gRecorder.close();
+    gBroadcast.stop();
+    gViewer.close();
     // Cleanup code remains unchanged ...
-    return 0;
+    return allocCheckMode ? allocCheckResult : 0;
+}
+
+
+// Check for "move e2e4" or "move e7e8q" without a regex (the player's move is timed for heap allocations)
+// Inputs: command
+// Output: true if it is a move command
+static bool isMoveCommand(const std::string& command)
+{
+    if ((command.size() != 9 && command.size() != 10) || command.compare(0, 5, "move ") != 0)
+    {
+        return false;
+    }
+    if (command.size() == 10 && command[9] != 'q' && command[9] != 'r' && command[9] != 'b' && command[9] != 'n')
+    {
+        return false;
+    }
+    for (size_t square = 5; square < 9; square += 2)
+    {
+        if (command[square] < 'a' || command[square] > 'h' || command[square + 1] < '1' || command[square + 1] > '8')
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
-
 bool commandChecker(const std::string& command, tModelMap& cTModelMap) 
 {
-    // Regular expressions for valid commands
-    std::regex moveRegex("^move ([a-h][1-8])([a-h][1-8])$");
-    std::regex cameraRegex("^camera (1[0-9]|[2-7][0-9]|80) (\\d{1,2}|[1-2]\\d{2}|3[0-5]\\d|360) (\\d+(\\.\\d+)?)$");
-    std::regex lightPosRegex("^light (1[0-9]|[2-7][0-9]|80) (\\d{1,2}|[1-2]\\d{2}|3[0-5]\\d|360) (\\d+(\\.\\d+)?)$");
-    std::regex lightPowerRegex("^power (\\d+(\\.\\d+)?)$");
+    // Regular expressions for valid commands (compiled once instead of per command)
+    static const std::regex cameraRegex("^camera (1[0-9]|[2-7][0-9]|80) (\\d{1,2}|[1-2]\\d{2}|3[0-5]\\d|360) (\\d+(\\.\\d+)?)$");
+    static const std::regex lightPosRegex("^light (1[0-9]|[2-7][0-9]|80) (\\d{1,2}|[1-2]\\d{2}|3[0-5]\\d|360) (\\d+(\\.\\d+)?)$");
+    static const std::regex lightPowerRegex("^power (\\d+(\\.\\d+)?)$");
+    static const std::regex bookDepthRegex("^book (\\d{1,3})$");
+    static const std::regex fenRegex("^fen (.+)$");
+    static const std::regex renderModeRegex("^render (always|ondemand|cached)$");
+    static const std::regex lodRegex("^lod (on|off)$");
+    static const std::regex shaderWatchRegex("^shaders watch (on|off)$");
+    static const std::regex ponderRegex("^ponder (on|off)$");
+    static const std::regex captureRegex("^capture (png|y4m)( (.+))?$");
+    static const std::regex analysisRegex("^analysis (on|off|[1-8])$");
+    static const std::regex clockRegex("^clock (.+)$");
+    static const std::regex undoRegex("^(undo|redo)( (\\d{1,4}))?$");
+    static const std::regex plyRegex("^ply (\\d{1,4}|end)$");
+    static const std::regex variationRegex("^variation (\\d)$");
+    static const std::regex broadcastRegex("^broadcast (on|off)( (\\d{1,5}))?$");
+    static const std::regex replayRegex("^replay (\\S+)( (\\d{1,5}))?$");
+    static const std::regex boardsRegex("^boards (\\d{1,3})( (\\S+))?$");
+    // The matcher keeps its state on the heap whatever the results use: only "move" (parsed by hand,
+    // tested before any regex) is kept off the heap, the other commands are not on a hot path
+    std::smatch match;
 
     if (command == "quit") 
     {
         std::cout << "Thanks for playing!!" << std::endl;
+        stopPondering();
+        reportPondering();
+        gCapture.stop();
+        gAnalysis.close();
+        gRecorder.close();
+        gBroadcast.stop();
+        gViewer.close();
         exit(0);
     }
-    else if (std::regex_match(command, moveRegex)) 
+    else if (isMoveCommand(command)) 
     {
-        // Extract source and target locations
-        std::smatch match;
-        if (std::regex_search(command, match, moveRegex)) 
+        // Moves of several models are left to the board rebuild once the rules side takes them
+        if (movesSeveralModels(uciToMove(command.substr(5))))
         {
-            std::string source = match[1].str();
-            std::string target = match[2].str();
-            return movePiece(source, target, cTModelMap);
+            return true;
         }
-        return false;
+        // Extract source and target locations (short enough to stay in the strings' own storage)
+        return movePiece(command.substr(5, 2), command.substr(7, 2), cTModelMap);
     }
     else if (std::regex_match(command, cameraRegex)) 
     {
-        std::smatch match;
         if (std::regex_search(command, match, cameraRegex))
         {
             float cTheta = std::stof(match[1].str());
             float cPhi = std::stof(match[2].str());
             float cRadius = std::stof(match[3].str());
             computeMatricesFromInputFinal(cTheta, cPhi, cRadius);
+            sceneDamage = DAMAGE_ALL;
         }
         return false;
     }
     else if (std::regex_match(command, lightPosRegex))
     {
-        std::smatch match;
         if (std::regex_search(command, match, lightPosRegex))
         {
             float cTheta = std::stof(match[1].str());
             float cPhi = std::stof(match[2].str());
             float cRadius = std::stof(match[3].str());
             lightPos = computeMatricesFromInputLightFinal(cTheta, cPhi, cRadius);
+            sceneDamage = DAMAGE_ALL;
         }
         return false;
     }
     else if (std::regex_match(command, lightPowerRegex))
     {
-        std::smatch match;
         if (std::regex_search(command, match, lightPowerRegex))
         {
             lightPower = std::stof(match[1].str());
+            sceneDamage = DAMAGE_ALL;
+        }
+        return false;
+    }
+    else if (command == "fen")
+    {
+        std::cout << gamePosition.toFen() << std::endl;
+        return false;
+    }
+    else if (std::regex_match(command, fenRegex))
+    {
+        chessPosition loaded;
+        if (std::regex_search(command, match, fenRegex) && loaded.setFromFen(match[1].str()))
+        {
+            newGameFrom(loaded);
+            std::cout << "Position loaded: " << gameStartFen << std::endl;
+        }
+        else
+        {
+            std::cout << "Invalid FEN!!" << std::endl;
+        }
+        return false;
+    }
+    else if (command == "render")
+    {
+        std::cout << "Frames drawn: " << framesDrawn << ", skipped: " << framesSkipped
+                  << ", last frame triangles: " << frameTriangles << ", draw calls: " << frameDrawCalls << ", average draw time: "
+                  << (framesDrawn ? 1000.0 * frameTimeTotal / framesDrawn : 0.0) << " ms" << std::endl;
+        return false;
+    }
+    else if (command == "render bench")
+    {
+        // Full redraws with and without level of detail
+        bool savedLod = lodEnabled;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            lodEnabled = (pass == 1);
+            unsigned long long triangles = 0;
+            unsigned long long allocations = 0;
+            double start = glfwGetTime();
+            for (unsigned int frame = 0; frame < RENDER_BENCH_FRAMES; frame++)
+            {
+                sceneDamage = DAMAGE_ALL;
+                renderScene();
+                glFinish();
+                triangles += frameTriangles;
+                allocations += lastFrameAllocations;
+            }
+            double elapsed = glfwGetTime() - start;
+            std::cout << "LOD " << (lodEnabled ? "on " : "off") << ": " << triangles / RENDER_BENCH_FRAMES
+                      << " triangles/frame, " << 1000.0 * elapsed / RENDER_BENCH_FRAMES << " ms/frame, "
+                      << static_cast<double>(allocations) / RENDER_BENCH_FRAMES << " heap allocations/frame" << std::endl;
+        }
+        lodEnabled = savedLod;
+        sceneDamage = DAMAGE_ALL;
+        return false;
+    }
+    else if (command == "alloc")
+    {
+        // Heap traffic of the hot paths, and how full the scratch arenas got
+        scratchStatsT frame = gFrameArena.getStats();
+        scratchStatsT search = searchArena().getStats();
+        std::cout << "Heap allocations: last frame " << lastFrameAllocations << " (" << framesWithAllocations << " of "
+                  << framesDrawn << " frames not zero), last move " << lastMoveAllocations << " (" << movesWithAllocations
+                  << " of " << movesMeasured << " moves not zero), last engine search " << getLastSearchAllocations()
+                  << std::endl;
+        std::cout << "Frame arena: " << frame.highWater << " of " << frame.capacity << " bytes at most, " << frame.spills
+                  << " spills to the heap; search arena (this thread): " << search.highWater << " of " << search.capacity
+                  << " bytes at most, " << search.spills << " spills" << std::endl;
+        return false;
+    }
+    else if (command == "alloc check on" || command == "alloc check off")
+    {
+        allocationCheck = (command == "alloc check on");
+        std::cout << "Allocation check " << (allocationCheck ? "on: frames and moves that reach the heap are reported" : "off")
+                  << std::endl;
+        return false;
+    }
+    else if (command == "boards")
+    {
+        if (!gMultiBoard.isActive())
+        {
+            std::cout << "Single board (boards N [pgn] tiles N games)" << std::endl;
+            return false;
+        }
+        unsigned int columns, rows;
+        gMultiBoard.getGrid(columns, rows);
+        const multiBoardStatsT& stats = gMultiBoard.getStats();
+        std::cout << "Boards: " << gMultiBoard.getBoardCount() << " in a " << columns << " x " << rows << " grid from "
+                  << gMultiBoard.getGameCount() << " games, last frame: " << stats.piecesDrawn << " pieces drawn, "
+                  << stats.piecesCulled << " culled, " << stats.triangles << " triangles in " << frameDrawCalls
+                  << " draw calls" << std::endl;
+        return false;
+    }
+    else if (command == "boards off" || command == "boards pause" || command == "boards play")
+    {
+        if (command == "boards off")
+        {
+            gMultiBoard.close();
+            std::cout << "Back to the game board" << std::endl;
+        }
+        else
+        {
+            gMultiBoard.setPaused(command == "boards pause", glfwGetTime());
+        }
+        sceneDamage = DAMAGE_ALL;
+        return false;
+    }
+    else if (std::regex_match(command, boardsRegex))
+    {
+        // Games of a PGN file (the bundled sample by default) played back on every board
+        std::regex_search(command, match, boardsRegex);
+        unsigned int count = static_cast<unsigned int>(std::stoul(match[1].str()));
+        std::string pgnPath = match[3].matched ? match[3].str() : PGN_SAMPLE_FILE;
+        if (count == 0 || count > MULTI_BOARD_MAX)
+        {
+            std::cout << "Between 1 and " << MULTI_BOARD_MAX << " boards" << std::endl;
+            return false;
+        }
+        if (gMultiBoard.load(pgnPath, count, glfwGetTime()))
+        {
+            clearSelection();
+            resolveMultiBoardMeshes();
+            std::cout << "Showing " << gMultiBoard.getBoardCount() << " boards from " << gMultiBoard.getGameCount()
+                      << " games of " << pgnPath << std::endl;
+        }
+        sceneDamage = DAMAGE_ALL;
+        return false;
+    }
+    else if (std::regex_match(command, shaderWatchRegex))
+    {
+        gShaderCache.setWatching(command == "shaders watch on");
+        std::cout << "Shader hot reload " << (gShaderCache.isWatching() ? "on" : "off") << std::endl;
+        return false;
+    }
+    else if (command == "screenshot")
+    {
+        // Next frame to a PNG (drawn even when nothing changed)
+        gCapture.start(CAPTURE_SCREENSHOT, std::string(CAPTURE_DIR) + "/screenshot_" +
+                       std::to_string(static_cast<long long>(time(nullptr))) + ".png", 0);
+        sceneDamage = DAMAGE_ALL;
+        return false;
+    }
+    else if (std::regex_match(command, captureRegex))
+    {
+        // png [directory]: one file per frame, y4m [file or |encoder command]: raw video
+        std::regex_search(command, match, captureRegex);
+        bool video = match[1].str() == "y4m";
+        std::string target = match[3].matched ? match[3].str() : std::string(CAPTURE_DIR) + (video ? "/capture.y4m" : "");
+        unsigned int framesPerSecond = static_cast<unsigned int>(1.0 / targetFrameTime + 0.5);
+        if (gCapture.start(video ? CAPTURE_Y4M : CAPTURE_PNG_SEQUENCE, target, framesPerSecond))
+        {
+            std::cout << "Capturing to " << target << " at " << framesPerSecond << " fps" << std::endl;
+        }
+        sceneDamage = DAMAGE_ALL;
+        return false;
+    }
+    else if (command == "capture stop")
+    {
+        gCapture.stop();
+        return false;
+    }
+    else if (command == "capture")
+    {
+        std::cout << "Capture: " << gCapture.status() << std::endl;
+        return false;
+    }
+    else if (command == "pick")
+    {
+        std::cout << "Picking latency (ms): " << pickLatency.summary() << std::endl;
+        return false;
+    }
+    else if (command == "shaders bench")
+    {
+        // Build the program repeatedly from source and from the cache, the scene keeps its own
+        gShaderCache.benchmark();
+        glUseProgram(programID);
+        return false;
+    }
+    else if (std::regex_match(command, lodRegex))
+    {
+        lodEnabled = command == "lod on";
+        sceneDamage = DAMAGE_ALL;
+        std::cout << "Level of detail " << (lodEnabled ? "on" : "off") << std::endl;
+        return false;
+    }
+    else if (std::regex_match(command, renderModeRegex))
+    {
+        // always: redraw every frame, ondemand: only on damage, cached: ondemand plus offscreen board
+        std::string mode = command.substr(7);
+        renderOnDemand = mode != "always";
+        useBoardCache = false;
+        boardCache.destroy();
+        if (mode == "cached")
+        {
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            useBoardCache = boardCache.create(width, height);
+            if (!useBoardCache)
+            {
+                std::cout << "Board cache could not be created, using ondemand" << std::endl;
+            }
+        }
+        sceneDamage = DAMAGE_ALL;
+        std::cout << "Render mode: " << mode << std::endl;
+        return false;
+    }
+    else if (command == "ponder")
+    {
+        reportPondering();
+        return false;
+    }
+    else if (std::regex_match(command, ponderRegex))
+    {
+        ponderEnabled = command == "ponder on";
+        if (!ponderEnabled)
+        {
+            stopPondering();
+        }
+        std::cout << "Pondering " << (ponderEnabled ? "on" : "off") << std::endl;
+        return false;
+    }
+    else if (std::regex_match(command, undoRegex))
+    {
+        std::regex_search(command, match, undoRegex);
+        unsigned int steps = match[3].matched ? std::stoi(match[3].str()) : 1;
+        unsigned int ply = gHistory.getPly();
+        if (match[1].str() == "undo")
+        {
+            ply = ply - gHistory.getFirstPly() > steps ? ply - steps : gHistory.getFirstPly();
+        }
+        else
+        {
+            ply = gHistory.getLastPly() - ply > steps ? ply + steps : gHistory.getLastPly();
+        }
+        if (ply != gHistory.getPly())
+        {
+            jumpToPly(ply);
+        }
+        std::cout << "Ply " << gHistory.getPly() << " of " << gHistory.getLastPly() << std::endl;
+        return false;
+    }
+    else if (std::regex_match(command, plyRegex))
+    {
+        std::string target = command.substr(4);
+        unsigned int ply = target == "end" ? gHistory.getLastPly() : std::stoi(target);
+        if (!jumpToPly(ply))
+        {
+            std::cout << "Ply " << ply << " is not kept (" << gHistory.getFirstPly() << " to " << gHistory.getLastPly() << ")" << std::endl;
+            return false;
+        }
+        std::cout << "Ply " << gHistory.getPly() << " of " << gHistory.getLastPly() << std::endl;
+        return false;
+    }
+    else if (command == "history")
+    {
+        reportHistory();
+        return false;
+    }
+    else if (std::regex_match(command, variationRegex))
+    {
+        stopPondering();
+        if (!gHistory.selectVariation(command[10] - '0', gameMoves))
+        {
+            std::cout << "No such variation" << std::endl;
+            return false;
+        }
+        showHistorySnapshot();
+        gRecorder.jump(gamePosition);
+        gBroadcast.publishPosition(gamePosition);
+        reportHistory();
+        return false;
+    }
+    else if (command == "broadcast")
+    {
+        if (!gBroadcast.isRunning())
+        {
+            std::cout << "Broadcast off" << std::endl;
+            return false;
+        }
+        broadcastStatsT stats = gBroadcast.getStats();
+        std::cout << "Broadcast on 127.0.0.1:" << gBroadcast.getPort() << ": " << stats.subscribers << " viewers, "
+                  << stats.framesPublished << " frames, " << stats.bytesSent << " bytes in " << stats.sendCalls << " sends, "
+                  << stats.resyncs << " slow viewers cut over, " << stats.disconnects << " disconnects" << std::endl;
+        return false;
+    }
+    else if (std::regex_match(command, broadcastRegex))
+    {
+        std::regex_search(command, match, broadcastRegex);
+        if (match[1].str() == "off")
+        {
+            gBroadcast.stop();
+            std::cout << "Broadcast off" << std::endl;
+            return false;
+        }
+        unsigned long port = BROADCAST_PORT;
+        if (match[3].matched && !parseBoundedNumber(match[3].str(), 1, 65535, port))
+        {
+            std::cout << "Invalid broadcast port (1..65535)" << std::endl;
+            return false;
+        }
+        if (!gBroadcast.start(static_cast<unsigned short>(port), gamePosition))
+        {
+            return false;
+        }
+        std::cout << "Broadcasting on 127.0.0.1:" << gBroadcast.getPort() << " (watch with: Lab3 --watch "
+                  << gBroadcast.getPort() << ")" << std::endl;
+        return false;
+    }
+    else if (command == "record")
+    {
+        unsigned long long bytes;
+        unsigned int writes;
+        gRecorder.getWriteStats(bytes, writes);
+        if (!gRecorder.isOpen())
+        {
+            std::cout << "Not recording (" << GAME_RECORD_DIR << " not writable?)" << std::endl;
+            return false;
+        }
+        std::cout << "Recording " << gRecorder.getPath() << ": " << gRecorder.getMoveCount() << " moves, " << bytes
+                  << " bytes in " << writes << " writes" << std::endl;
+        return false;
+    }
+    else if (std::regex_match(command, replayRegex))
+    {
+        // Position of a recorded game, played on from there as a new game
+        std::regex_search(command, match, replayRegex);
+        gameReplay replay;
+        chessPosition loaded;
+        if (!replay.open(match[1].str()))
+        {
+            std::cout << "Not a game record: " << match[1].str() << std::endl;
+            return false;
+        }
+        uint32_t moves = match[3].matched ? static_cast<uint32_t>(std::stoul(match[3].str())) : replay.getMoveCount();
+        if (moves > replay.getMoveCount() || !replay.seek(moves, loaded))
+        {
+            std::cout << "No position after " << moves << " moves (" << replay.getMoveCount() << " recorded)" << std::endl;
+            return false;
+        }
+        newGameFrom(loaded);
+        std::cout << "Replayed " << moves << " of " << replay.getMoveCount() << " moves: " << gameStartFen << std::endl;
+        return false;
+    }
+    else if (command == "clock")
+    {
+        reportClock();
+        return false;
+    }
+    else if (std::regex_match(command, clockRegex))
+    {
+        timeControlT control;
+        if (!parseTimeControl(command.substr(6), control))
+        {
+            std::cout << "Invalid time control (off, 5, 5+3, 5d2, movetime 500)" << std::endl;
+            return false;
+        }
+        gClock.configure(control, gamePosition.isWhiteToMove());
+        std::cout << "Clock: " << gClock.describe() << std::endl;
+        return false;
+    }
+    else if (command == "analysis")
+    {
+        reportAnalysis();
+        return false;
+    }
+    else if (std::regex_match(command, analysisRegex))
+    {
+        std::string mode = command.substr(9);
+        if (mode == "off")
+        {
+            gAnalysis.stop();
+            analysisEnabled = false;
+            sceneDamage |= DAMAGE_OVERLAY;
+            std::cout << "Analysis off" << std::endl;
+            return false;
+        }
+        if (mode != "on")
+        {
+            gAnalysis.setMultiPv(std::stoi(mode));
+        }
+        // Second engine process, the bot keeps its own
+        if (!gAnalysis.isRunning() && !gAnalysis.start(ENGINE_PATH))
+        {
+            std::cout << "Analysis engine failed to start" << std::endl;
+            return false;
+        }
+        analysisEnabled = true;
+        analysisRestart = true;
+        std::cout << "Analysis on, " << gAnalysis.getMultiPv() << " lines" << std::endl;
+        return false;
+    }
+    else if (command == "tablebase")
+    {
+        if (gTablebase.getMaxPieces() == 0)
+        {
+            std::cout << "No tablebases in " << SYZYGY_DIR << std::endl;
+            return false;
+        }
+        unsigned int wdlTables, dtzTables;
+        gTablebase.getTableCounts(wdlTables, dtzTables);
+        std::cout << "Tablebases: " << wdlTables << " WDL and " << dtzTables << " DTZ tables, up to "
+                  << gTablebase.getMaxPieces() << " pieces in " << gTablebase.getPaths() << std::endl;
+        std::cout << "Position " << (gTablebase.covers(gamePosition) ? "is" : "is not") << " probed by the engine" << std::endl;
+        return false;
+    }
+    else if (command == "eval")
+    {
+        if (!gNetwork.isLoaded())
+        {
+            std::cout << "No network loaded (" << NNUE_FILE << ")" << std::endl;
+            return false;
+        }
+        nnueEvaluator evaluator(gNetwork);
+        evaluator.reset(gamePosition);
+        int score = evaluator.evaluate(gamePosition.isWhiteToMove());
+        std::cout << "Network evaluation (" << nnueIsaName(evaluator.getIsa()) << "): "
+                  << (gamePosition.isWhiteToMove() ? score : -score) << " cp for white" << std::endl;
+        return false;
+    }
+    else if (std::regex_match(command, bookDepthRegex))
+    {
+        if (std::regex_search(command, match, bookDepthRegex))
+        {
+            gOpeningBook.setMaxPly(std::stoi(match[1].str()));
+            std::cout << "Opening book depth set to " << gOpeningBook.getMaxPly() << " plies" << std::endl;
         }
         return false;
     }
@@ -318,6 +2025,7 @@ bool commandChecker(const std::string& command, tModelMap& cTModelMap)
 }
 
 
+// Walks the path one square at a time (the target square itself is not checked)
 bool isPathClear(const glm::vec3& current, const glm::vec3& target, const std::string& pieceName, tModelMap& cTModelMap) {
     glm::vec3 position;
 
@@ -347,17 +2055,18 @@ bool isPathClear(const glm::vec3& current, const glm::vec3& target, const std::s
         return true;
     }
 
-    position.x = current.x + CHESS_BOX_SIZE * xAxisStep * 0.2;
-    position.y = current.y + CHESS_BOX_SIZE * yAxisStep * 0.2;
+    position.x = current.x + CHESS_BOX_SIZE * xAxisStep;
+    position.y = current.y + CHESS_BOX_SIZE * yAxisStep;
     position.z = -3;
 
-    //cTModelMap[pieceName].tPos = position;
-    waitForNextFrame();
-    renderScene();
+    // Arrived (the slide itself is drawn by the animator)
+    if (std::abs(target.x - position.x) <= 1 && std::abs(target.y - position.y) <= 1)
+    {
+        return true;
+    }
 
     if (getPieceAtPosition(position, cTModelMap) == "")
     {
-        cTModelMap[pieceName].tPos = position;
         return isPathClear(position, target, pieceName, cTModelMap);
     }
     else
@@ -378,10 +2087,6 @@ bool isValidMove(const std::string& pieceName, const std::string& targetName, co
     float dy = target.y - current.y;
     std::cout << "dx value: " << dx << std::endl;
     std::cout << "dy value: " << dy << std::endl;
-    glm::vec3 savedPos;
-    savedPos.x = current.x;
-    savedPos.y = current.y;
-    savedPos.z = current.z;
     constexpr float EPSILON = 1.0; // Tolerance for floating-point comparison
 
     if (pieceName.find("TORRE") != std::string::npos) 
@@ -389,7 +2094,6 @@ bool isValidMove(const std::string& pieceName, const std::string& targetName, co
         // Rook moves in straight lines along x or y
         if (!isPathClear(current, target, pieceName, cTModelMap))
         {
-            cTModelMap[pieceName].tPos = savedPos;
             return false;
         }
         else if ((std::abs(dx) < 1e-6 || std::abs(dy) < 1e-6) && isThisACapture(pieceName, targetName, cTModelMap)) 
@@ -402,7 +2106,6 @@ bool isValidMove(const std::string& pieceName, const std::string& targetName, co
         // Bishop moves diagonally (absolute change in x == absolute change in y)
         if (std::abs(std::abs(dx) - std::abs(dy)) < EPSILON) {
             if (!isPathClear(current, target, pieceName, cTModelMap)) {
-                cTModelMap[pieceName].tPos = savedPos;
                 return false;
             }
 
@@ -417,7 +2120,6 @@ bool isValidMove(const std::string& pieceName, const std::string& targetName, co
         // Queen moves like both rook and bishop
         if (!isPathClear(current, target, pieceName, cTModelMap))
         {
-            cTModelMap[pieceName].tPos = savedPos;
             return false;
         }
         if ((std::abs(dx) < 1e-6 || std::abs(dy) < 1e-6 || std::abs(std::abs(dx) - std::abs(dy)) < EPSILON) &&
@@ -443,7 +2145,6 @@ bool isValidMove(const std::string& pieceName, const std::string& targetName, co
             return false;
         }
         if (!isPathClear(current, target, pieceName, cTModelMap)) {
-            cTModelMap[pieceName].tPos = savedPos;
             return false;
         }
         if (std::abs(dx) > 1e-6 && isThisACapture(pieceName, targetName, cTModelMap))
@@ -454,11 +2155,6 @@ bool isValidMove(const std::string& pieceName, const std::string& targetName, co
     }
     else if (pieceName.find("Object") != std::string::npos) {
         // Knight moves in an L-shape (2 in one direction and 1 in the other)
-        /*if (!isPathClear(current, target, pieceName, cTModelMap)) {
-            cTModelMap[pieceName].tPos = savedPos;
-            return false;
-        }*/
-        
         return (std::abs(std::abs(dx) - 2 * CHESS_BOX_SIZE) < EPSILON && std::abs(std::abs(dy) - CHESS_BOX_SIZE) < EPSILON) ||
             (std::abs(std::abs(dx) - CHESS_BOX_SIZE) < EPSILON && std::abs(std::abs(dy) - 2 * CHESS_BOX_SIZE) < EPSILON);
     }
@@ -469,19 +2165,38 @@ bool isValidMove(const std::string& pieceName, const std::string& targetName, co
 
 
 // Checks if a target position is occupied and returns the piece name if occupied
-std::string getPieceAtPosition(const glm::vec3& position, tModelMap& cTModelMap) {
+// (the map key itself, valid until the entry is erased: no string is built per lookup)
+const std::string& getPieceAtPosition(const glm::vec3& position, tModelMap& cTModelMap) {
+    static const std::string EMPTY_SQUARE;
     constexpr float EPSILON = 1e-6; // Tolerance for floating-point comparison
 
     for (const auto& pair : cTModelMap) {
         const std::string& name = pair.first;
         const tPosition& data = pair.second;
 
+        // Captured or unused pieces are not on the board
+        if (!data.alive) {
+            continue;
+        }
+
         if (std::abs(data.tPos.x - position.x) < EPSILON &&
             std::abs(data.tPos.y - position.y) < EPSILON) {
             return name;
         }
     }
-    return "";
+    return EMPTY_SQUARE;
+}
+
+// Graveyard beside the board, eight per column (white on the -x side, black on +x)
+glm::vec3 graveyardPosition(bool player, unsigned int slot)
+{
+    float column = 5.5f + static_cast<float>(slot / 8);
+    float row = -3.5f + static_cast<float>(slot % 8);
+    if (player)
+    {
+        return glm::vec3(-column * CHESS_BOX_SIZE, row * CHESS_BOX_SIZE, PHEIGHT);
+    }
+    return glm::vec3(column * CHESS_BOX_SIZE, -row * CHESS_BOX_SIZE, PHEIGHT);
 }
 
 // Determines if a move is a capture must be used last in any if statements otherwise things will break
@@ -494,15 +2209,16 @@ bool isThisACapture(const std::string& pieceName, const std::string& targetName,
     }
     else if (cTModelMap[targetName].player != cTModelMap[pieceName].player)
     {
-        cTModelMap[targetName].alive = false;
-        cTModelMap[targetName].tPos = deathSpawn;
-        std::cout << "after death should happen" << std::endl;
-        deathSpawn.y =+ CHESS_BOX_SIZE;
-        if (deathSpawn.y > 11.4)
-        {
-            deathSpawn.y = -5.5 * CHESS_BOX_SIZE;
-            deathSpawn.x = -CHESS_BOX_SIZE;
-        }
+        // Next free graveyard slot of the captured side
+        tPosition& captured = cTModelMap[targetName];
+        glm::vec3 previousPos = captured.tPos;
+        captured.alive = false;
+        captured.tPos = graveyardPosition(captured.player, capturedCount[captured.player ? 0 : 1]++);
+
+        // Leaves its square as the capturing piece arrives
+        double arrival = (pieceName.find("Object") != std::string::npos) ? ANIMATION_KNIGHT_TIME : ANIMATION_SLIDE_TIME;
+        gAnimator.start(captured, previousPos, ANIM_CAPTURE, 0.8 * arrival);
+        sceneDamage |= DAMAGE_PIECES;
         return true;
     }
     return false;
@@ -516,8 +2232,8 @@ bool movePiece(const std::string& sourceNotation, const std::string& targetNotat
     std::cout << sourcePosition.x << ", " << sourcePosition.y << std::endl;
 
     // Get the piece at the source position
-    std::string pieceName = getPieceAtPosition(sourcePosition, cTModelMap);
-    std::string targetName = getPieceAtPosition(targetPosition, cTModelMap);
+    const std::string& pieceName = getPieceAtPosition(sourcePosition, cTModelMap);
+    const std::string& targetName = getPieceAtPosition(targetPosition, cTModelMap);
     std::cout << pieceName << std::endl;
 
     if (pieceName.empty()) {
@@ -529,13 +2245,16 @@ bool movePiece(const std::string& sourceNotation, const std::string& targetNotat
     if (isValidMove(pieceName, targetName, sourcePosition, targetPosition, cTModelMap)) 
     {
         // Update so it doesnt loop again at somepoint
-        targetName = getPieceAtPosition(targetPosition, cTModelMap);
-        std::cout << "Target player bool: " << cTModelMap[targetName].player << std::endl;
+        const std::string& occupant = getPieceAtPosition(targetPosition, cTModelMap);
+        std::cout << "Target player bool: " << cTModelMap[occupant].player << std::endl;
         std::cout << "Moving player bool: " << cTModelMap[pieceName].player << std::endl;
-        if (targetName.empty()) 
+        if (occupant.empty()) 
         {
-            // Move the piece
+            // Move the piece (drawn sliding, knights hop)
             cTModelMap[pieceName].tPos = targetPosition;
+            bool knight = pieceName.find("Object") != std::string::npos;
+            gAnimator.start(cTModelMap[pieceName], sourcePosition, knight ? ANIM_KNIGHT_ARC : ANIM_SLIDE);
+            sceneDamage |= DAMAGE_PIECES;
             std::cout << pieceName << " moved from " << sourceNotation << " to " << targetNotation << std::endl;
             return true;
         }
@@ -552,48 +2271,160 @@ bool movePiece(const std::string& sourceNotation, const std::string& targetNotat
 }
 
 
+// Render component per piece code (chessPosition codes index the table)
+typedef struct
+{
+    const char* cName;
+    unsigned int rDis;
+} pieceModelT;
+
+static const pieceModelT PIECE_MODELS[15] = {
+    { nullptr, 0 },
+    { "PEDONE13", 1 }, { "Object3", 5 }, { "ALFIERE3", 3 }, { "TORRE3", 7 }, { "REGINA2", 0 }, { "RE2", 0 },
+    { nullptr, 0 }, { nullptr, 0 },
+    { "PEDONE12", 1 }, { "Object02", 5 }, { "ALFIERE02", 3 }, { "TORRE02", 7 }, { "REGINA01", 0 }, { "RE01", 0 }
+};
+// Instances per piece kind (2 originals + 8 promotions)
+const unsigned int MAX_PIECE_INSTANCES = 10;
+
+// Multi-board view: the same meshes as the game board, by piece code
+void resolveMultiBoardMeshes()
+{
+    const char* pieceNames[MULTI_BOARD_PIECE_CODES];
+    for (unsigned int code = 0; code < MULTI_BOARD_PIECE_CODES; code++)
+    {
+        pieceNames[code] = PIECE_MODELS[code].cName;
+    }
+    gMultiBoard.resolveMeshes(gchessComponents, pieceNames);
+}
+
+// Board square to world position (a1 is -x/-y, rank 1 is the player's side)
+glm::vec3 squareToBoardPosition(int square)
+{
+    return glm::vec3((fileOf(square) - 3.5f) * CHESS_BOX_SIZE, (rankOf(square) - 3.5f) * CHESS_BOX_SIZE, PHEIGHT);
+}
+
+// Sets up the chess board from the standard start position
 void setupChessBoard(tModelMap& cTModelMap)
 {
-    // Target spec Hash
-    cTModelMap = {
-        // Chess board
-        {"12951_Stone_Chess_Board", {1, 0, 0.f, {1, 0, 0}, glm::vec3(CBSCALE), {0.f, 0.f, PHEIGHT}}},
-
-        // First player pieces
-        {"TORRE3",      {2, 7, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-3.5 * CHESS_BOX_SIZE, -3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"TORRE31",     {1, 7, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 3.5 * CHESS_BOX_SIZE, -3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"Object3",     {2, 5, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-2.5 * CHESS_BOX_SIZE, -3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"Object31",    {1, 5, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 2.5 * CHESS_BOX_SIZE, -3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"ALFIERE3",    {2, 3, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-1.5 * CHESS_BOX_SIZE, -3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"ALFIERE31",   {2, 3, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 1.5 * CHESS_BOX_SIZE, -3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"REGINA2",     {1, 0, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 0.5 * CHESS_BOX_SIZE, -3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"RE2",         {1, 0, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-0.5 * CHESS_BOX_SIZE, -3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"PEDONE13",    {8, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-3.5 * CHESS_BOX_SIZE, -2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"PEDONE131",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-2.5 * CHESS_BOX_SIZE, -2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"PEDONE132",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-1.5 * CHESS_BOX_SIZE, -2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"PEDONE133",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-0.5 * CHESS_BOX_SIZE, -2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"PEDONE134",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 0.5 * CHESS_BOX_SIZE, -2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"PEDONE135",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 1.5 * CHESS_BOX_SIZE, -2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"PEDONE136",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 2.5 * CHESS_BOX_SIZE, -2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-        {"PEDONE137",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 3.5 * CHESS_BOX_SIZE, -2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, true}},
-
-        // Bot pieces
-        {"TORRE02",     {2, 7, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-3.5 * CHESS_BOX_SIZE, 3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"TORRE021",    {1, 7, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 3.5 * CHESS_BOX_SIZE, 3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"Object02",    {2, 5, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-2.5 * CHESS_BOX_SIZE, 3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"Object021",   {1, 5, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 2.5 * CHESS_BOX_SIZE, 3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"ALFIERE02",   {2, 3, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-1.5 * CHESS_BOX_SIZE, 3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"ALFIERE021",  {2, 3, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 1.5 * CHESS_BOX_SIZE, 3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"REGINA01",    {1, 0, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-0.5 * CHESS_BOX_SIZE, 3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"RE01",        {1, 0, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 0.5 * CHESS_BOX_SIZE, 3.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"PEDONE12",    {8, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-3.5 * CHESS_BOX_SIZE, 2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"PEDONE121",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-2.5 * CHESS_BOX_SIZE, 2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"PEDONE122",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-1.5 * CHESS_BOX_SIZE, 2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"PEDONE123",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), {-0.5 * CHESS_BOX_SIZE, 2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"PEDONE124",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 0.5 * CHESS_BOX_SIZE, 2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"PEDONE125",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 1.5 * CHESS_BOX_SIZE, 2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"PEDONE126",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 2.5 * CHESS_BOX_SIZE, 2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}},
-        {"PEDONE127",   {1, 1, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), { 3.5 * CHESS_BOX_SIZE, 2.5 * CHESS_BOX_SIZE, PHEIGHT}, true, false}}
-    };
+    chessPosition startPosition;
+    setupChessBoard(startPosition, cTModelMap);
+}
+
+// Sets up the render transforms for any position in one walk over the squares
+void setupChessBoard(const chessPosition& position, tModelMap& cTModelMap)
+{
+    // Instance keys ("TORRE3", "TORRE31", ...) are built once, not per load
+    static std::string instanceKeys[15][MAX_PIECE_INSTANCES];
+    if (instanceKeys[PIECE_PAWN][0].empty())
+    {
+        for (int code = 0; code < 15; code++)
+        {
+            for (unsigned int i = 0; PIECE_MODELS[code].cName != nullptr && i < MAX_PIECE_INSTANCES; i++)
+            {
+                instanceKeys[code][i] = PIECE_MODELS[code].cName + (i == 0 ? std::string() : std::to_string(i));
+            }
+        }
+    }
+
+    // Transforms are rebuilt, running animations and graveyard slots go with them
+    gAnimator.clear();
+    capturedCount[0] = 0;
+    capturedCount[1] = 0;
+    sceneDamage |= DAMAGE_PIECES;
+
+    // Buckets are kept by clear(), reloading does not rehash
+    cTModelMap.clear();
+    cTModelMap[BOARD_COMPONENT] = {1, 0, 0.f, {1, 0, 0}, glm::vec3(CBSCALE), {0.f, 0.f, PHEIGHT}};
+
+    unsigned int instances[15] = { 0 };
+    for (int sq = 0; sq < 64; sq++)
+    {
+        unsigned char piece = position.pieceAt(sq);
+        if (piece == PIECE_NONE || instances[piece] >= MAX_PIECE_INSTANCES)
+        {
+            continue;
+        }
+        cTModelMap[instanceKeys[piece][instances[piece]++]] = {1, PIECE_MODELS[piece].rDis, 90.f, {1, 0, 0}, glm::vec3(CPSCALE),
+                                                               squareToBoardPosition(sq), true, (piece & PIECE_BLACK) == 0};
+    }
+
+    // The first instance carries the draw count, pieces not on the board are hidden
+    for (int code = 0; code < 15; code++)
+    {
+        if (PIECE_MODELS[code].cName == nullptr)
+        {
+            continue;
+        }
+        tPosition& base = cTModelMap[instanceKeys[code][0]];
+        if (instances[code] == 0)
+        {
+            base = {0, PIECE_MODELS[code].rDis, 90.f, {1, 0, 0}, glm::vec3(CPSCALE), deathSpawn, false, (code & PIECE_BLACK) == 0};
+        }
+        base.rCnt = instances[code];
+    }
+}
+
+// FEN setup timing and an optional engine search on one position
+int fenBenchmarkMain(int argc, char* argv[])
+{
+    std::string fen = START_FEN;
+    unsigned long iterations = 100000;
+    unsigned long depth = 0;
+    bool valid = true;
+    for (int i = 2; i < argc && valid; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) valid = parseBoundedNumber(argv[++i], 1, 100000000, iterations);
+        else if (arg == "--depth" && i + 1 < argc) valid = parseBoundedNumber(argv[++i], 1, PGN_MAX_DEPTH, depth);
+        else fen = arg;
+    }
 
+    chessPosition position;
+    if (!valid || !position.setFromFen(fen))
+    {
+        std::cerr << "Usage: Lab3 --bench-fen \"<fen>\" [--iterations N (1..100000000)] [--depth D (1.."
+                  << PGN_MAX_DEPTH << ")]" << std::endl;
+        return -1;
+    }
+
+    // FEN -> rules board -> render transforms
+    tModelMap benchMap;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        position.setFromFen(fen);
+        setupChessBoard(position, benchMap);
+    }
+    double loadUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    // Rules board -> FEN
+    std::string exported;
+    start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        exported = position.toFen();
+    }
+    double exportUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    std::cout << "Position: " << exported << std::endl;
+    std::cout << "FEN load + board setup: " << loadUs << " us, FEN export: " << exportUs << " us" << std::endl;
+
+    // Engine seeded with "position fen"
+    if (depth > 0)
+    {
+        enginePool pool;
+        engineReplyT reply;
+        int engineId = -1;
+        if (pool.start(1, ENGINE_PATH) && (engineId = pool.lease()) >= 0 &&
+            pool.search(engineId, "position fen " + exported, "go depth " + std::to_string(depth), reply))
+        {
+            std::cout << "bestmove " << reply.bestMove << " depth " << reply.depth
+                      << (reply.isMate ? " mate " : " cp ") << reply.scoreCp
+                      << " in " << reply.latencyMs << " ms" << std::endl;
+        }
+        pool.release(engineId);
+        pool.stop();
+    }
+    return 0;
 }